@@ -62,6 +62,17 @@ SharedHashFile::AttachExisting(
     return shf;
 }
 
+bool
+SharedHashFile::AttachExistingReadOnly(
+    const char * path, /* e.g. '/dev/shm' */
+    const char * name) /* e.g. 'myshf'    */
+{
+    SHF_DEBUG("%s(path='%s', name='%s')\n", __FUNCTION__, path, name);
+    shf = shf_attach_existing_read_only(path, name);
+    isAttached = shf ? 1 : 0;
+    return shf;
+}
+
 bool
 SharedHashFile::Attach(
     const char * path                    , /* e.g. '/dev/shm' */
@@ -82,7 +93,7 @@ SharedHashFile::IsAttached()
 }
 
 void
-SharedHashFile::MakeHash( // todo: warn in docs that ::MakeHash works __thread globally & not at the object/class level
+SharedHashFile::MakeHash( // note: ::MakeHash works __thread globally & not at the object/class level; use shf_op_hash() & ::Op*() for many ops in flight
     const char * key    ,
     uint32_t     key_len)
 {
@@ -90,6 +101,90 @@ SharedHashFile::MakeHash( // todo: warn in docs that ::MakeHash works __thread g
     shf_make_hash(key, key_len);
 }
 
+uint32_t
+SharedHashFile::GetKeyValAddr()
+{
+    SHF_DEBUG("%s()\n", __FUNCTION__);
+    return shf_get_key_val_addr(shf);
+}
+
+uint32_t
+SharedHashFile::GetUidValAddr(uint32_t uid)
+{
+    SHF_DEBUG("%s()\n", __FUNCTION__);
+    return shf_get_uid_val_addr(shf, uid);
+}
+
+uint32_t
+SharedHashFile::GetKeyKeyCopyBuf(char * buf, uint32_t buf_size)
+{
+    SHF_DEBUG("%s()\n", __FUNCTION__);
+    return shf_get_key_key_copy_buf(shf, buf, buf_size);
+}
+
+uint32_t
+SharedHashFile::GetUidKeyCopyBuf(uint32_t uid, char * buf, uint32_t buf_size)
+{
+    SHF_DEBUG("%s()\n", __FUNCTION__);
+    return shf_get_uid_key_copy_buf(shf, uid, buf, buf_size);
+}
+
+uint32_t
+SharedHashFile::GetKeyValCopyBuf(char * buf, uint32_t buf_size)
+{
+    SHF_DEBUG("%s()\n", __FUNCTION__);
+    return shf_get_key_val_copy_buf(shf, buf, buf_size);
+}
+
+uint32_t
+SharedHashFile::GetUidValCopyBuf(uint32_t uid, char * buf, uint32_t buf_size)
+{
+    SHF_DEBUG("%s()\n", __FUNCTION__);
+    return shf_get_uid_val_copy_buf(shf, uid, buf, buf_size);
+}
+
+uint32_t
+SharedHashFile::GetKeyKeyCopyIov(const struct iovec * iov, int iovcnt)
+{
+    SHF_DEBUG("%s()\n", __FUNCTION__);
+    return shf_get_key_key_copy_iov(shf, iov, iovcnt);
+}
+
+uint32_t
+SharedHashFile::GetUidKeyCopyIov(uint32_t uid, const struct iovec * iov, int iovcnt)
+{
+    SHF_DEBUG("%s()\n", __FUNCTION__);
+    return shf_get_uid_key_copy_iov(shf, uid, iov, iovcnt);
+}
+
+uint32_t
+SharedHashFile::GetKeyValCopyIov(const struct iovec * iov, int iovcnt)
+{
+    SHF_DEBUG("%s()\n", __FUNCTION__);
+    return shf_get_key_val_copy_iov(shf, iov, iovcnt);
+}
+
+uint32_t
+SharedHashFile::GetUidValCopyIov(uint32_t uid, const struct iovec * iov, int iovcnt)
+{
+    SHF_DEBUG("%s()\n", __FUNCTION__);
+    return shf_get_uid_val_copy_iov(shf, uid, iov, iovcnt);
+}
+
+uint32_t
+SharedHashFile::GetKeyValVisit(uint32_t (*cb)(const char * val, uint32_t val_len, void * ctx), void * ctx)
+{
+    SHF_DEBUG("%s()\n", __FUNCTION__);
+    return shf_get_key_val_visit(shf, cb, ctx);
+}
+
+uint32_t
+SharedHashFile::GetUidValVisit(uint32_t uid, uint32_t (*cb)(const char * val, uint32_t val_len, void * ctx), void * ctx)
+{
+    SHF_DEBUG("%s()\n", __FUNCTION__);
+    return shf_get_uid_val_visit(shf, uid, cb, ctx);
+}
+
 uint32_t
 SharedHashFile::GetKeyKeyCopy()
 {
@@ -141,6 +236,23 @@ SharedHashFile::PutKeyVal(
     return shf_put_key_val(shf, val, val_len);
 }
 
+uint32_t
+SharedHashFile::PutKeyValTtl(
+    const char * val    ,
+    uint32_t     val_len,
+    uint32_t     ttl    )
+{
+    SHF_DEBUG("%s(val=?, val_len=%u, ttl=%u)\n", __FUNCTION__, val_len, ttl);
+    return shf_put_key_val_ttl(shf, val, val_len, ttl);
+}
+
+uint32_t
+SharedHashFile::TtlReap()
+{
+    SHF_DEBUG("%s()\n", __FUNCTION__);
+    return shf_ttl_reap(shf);
+}
+
 uint32_t
 SharedHashFile::DelKeyVal()
 {
@@ -176,6 +288,83 @@ SharedHashFile::UpdCallbackCopy(const char * val, uint32_t val_len)
     return shf_upd_callback_copy(val, val_len);
 }
 
+uint32_t
+SharedHashFile::OpPut(SHF_OP * op, const char * val, uint32_t val_len)
+{
+    SHF_DEBUG("%s(op=?, val=?, val_len=%u)\n", __FUNCTION__, val_len);
+    return shf_op_put(shf, op, val, val_len);
+}
+
+uint32_t
+SharedHashFile::OpPutTtl(SHF_OP * op, const char * val, uint32_t val_len, uint32_t ttl)
+{
+    SHF_DEBUG("%s(op=?, val=?, val_len=%u, ttl=%u)\n", __FUNCTION__, val_len, ttl);
+    return shf_op_put_ttl(shf, op, val, val_len, ttl);
+}
+
+uint32_t
+SharedHashFile::OpGet(SHF_OP * op)
+{
+    SHF_DEBUG("%s(op=?)\n", __FUNCTION__);
+    return shf_op_get(shf, op);
+}
+
+uint32_t
+SharedHashFile::OpGetUid(SHF_OP * op, uint32_t uid)
+{
+    SHF_DEBUG("%s(op=?, uid=%u)\n", __FUNCTION__, uid);
+    return shf_op_get_uid(shf, op, uid);
+}
+
+uint32_t
+SharedHashFile::OpGetAddr(SHF_OP * op)
+{
+    SHF_DEBUG("%s(op=?)\n", __FUNCTION__);
+    return shf_op_get_addr(shf, op);
+}
+
+uint32_t
+SharedHashFile::OpGetBuf(SHF_OP * op, char * buf, uint32_t buf_size)
+{
+    SHF_DEBUG("%s(op=?, buf=?, buf_size=%u)\n", __FUNCTION__, buf_size);
+    return shf_op_get_buf(shf, op, buf, buf_size);
+}
+
+uint32_t
+SharedHashFile::OpAddAtom(SHF_OP * op, long add)
+{
+    SHF_DEBUG("%s(op=?, add=%ld)\n", __FUNCTION__, add);
+    return shf_op_add_atom(shf, op, add);
+}
+
+uint32_t
+SharedHashFile::OpDel(SHF_OP * op)
+{
+    SHF_DEBUG("%s(op=?)\n", __FUNCTION__);
+    return shf_op_del(shf, op);
+}
+
+uint32_t
+SharedHashFile::OpDelUid(SHF_OP * op, uint32_t uid)
+{
+    SHF_DEBUG("%s(op=?, uid=%u)\n", __FUNCTION__, uid);
+    return shf_op_del_uid(shf, op, uid);
+}
+
+void
+SharedHashFile::ReadBegin()
+{
+    SHF_DEBUG("%s()\n", __FUNCTION__);
+    shf_read_begin(shf);
+}
+
+void
+SharedHashFile::ReadEnd()
+{
+    SHF_DEBUG("%s()\n", __FUNCTION__);
+    shf_read_end(shf);
+}
+
 void
 SharedHashFile::TabCopyIterate(uint32_t * win_addr, uint32_t * tab_addr)
 {
@@ -183,6 +372,34 @@ SharedHashFile::TabCopyIterate(uint32_t * win_addr, uint32_t * tab_addr)
     shf_tab_copy_iterate(shf, win_addr, tab_addr);
 }
 
+SHF_ITER *
+SharedHashFile::IterNew()
+{
+    SHF_DEBUG("%s()\n", __FUNCTION__);
+    return shf_iter_new(shf);
+}
+
+uint32_t
+SharedHashFile::IterNext(SHF_ITER * iter)
+{
+    SHF_DEBUG("%s()\n", __FUNCTION__);
+    return shf_iter_next(iter);
+}
+
+void
+SharedHashFile::IterFree(SHF_ITER * iter)
+{
+    SHF_DEBUG("%s()\n", __FUNCTION__);
+    shf_iter_free(iter);
+}
+
+uint64_t
+SharedHashFile::ScanParallel(uint32_t nthreads, uint32_t (* filter_cb)(const SHF_SCAN * scan, void * ctx), void (* visit_cb)(const SHF_SCAN * scan, void * ctx), void * ctx)
+{
+    SHF_DEBUG("%s()\n", __FUNCTION__);
+    return shf_scan_parallel(shf, nthreads, filter_cb, visit_cb, ctx);
+}
+
 char *
 SharedHashFile::Del()
 {
@@ -200,6 +417,13 @@ SharedHashFile::DebugGetGarbage()
     return shf_debug_get_garbage(shf);
 }
 
+void
+SharedHashFile::StatsGet(SHF_STATS * stats)
+{
+    SHF_DEBUG("%s(stats=%p)\n", __FUNCTION__, stats);
+    shf_stats_get(shf, stats);
+}
+
 void
 SharedHashFile::DebugVerbosityLess()
 {
@@ -233,6 +457,69 @@ SharedHashFile::SetIsFixedLen(uint32_t fixed_key_len, uint32_t fixed_val_len)
     shf_set_is_fixed_len(shf, fixed_key_len, fixed_val_len);
 }
 
+void
+SharedHashFile::SetCacheBudget(uint64_t data_max, uint32_t keys_max)
+{
+    SHF_DEBUG("%s()\n", __FUNCTION__);
+    shf_set_cache_budget(shf, data_max, keys_max);
+}
+
+uint64_t
+SharedHashFile::CacheGetEvicted()
+{
+    SHF_DEBUG("%s()\n", __FUNCTION__);
+    return shf_cache_get_evicted(shf);
+}
+
+void
+SharedHashFile::SetLockTimes(uint32_t is_lock_timed)
+{
+    SHF_DEBUG("%s(is_lock_timed=%u)\n", __FUNCTION__, is_lock_timed);
+    shf_set_lock_times(shf, is_lock_timed);
+}
+
+const SHF_LOCK_TIMES_MMAP *
+SharedHashFile::LockTimesGet()
+{
+    SHF_DEBUG("%s()\n", __FUNCTION__);
+    return shf_lock_times_get(shf);
+}
+
+void
+SharedHashFile::SetHotKeys(uint32_t sample)
+{
+    SHF_DEBUG("%s(sample=%u)\n", __FUNCTION__, sample);
+    shf_set_hot_keys(shf, sample);
+}
+
+const SHF_HOT_KEYS_MMAP *
+SharedHashFile::HotKeysGet()
+{
+    SHF_DEBUG("%s()\n", __FUNCTION__);
+    return shf_hot_keys_get(shf);
+}
+
+void
+SharedHashFile::HotKeysReset()
+{
+    SHF_DEBUG("%s()\n", __FUNCTION__);
+    shf_hot_keys_reset(shf);
+}
+
+void
+SharedHashFile::Freeze()
+{
+    SHF_DEBUG("%s()\n", __FUNCTION__);
+    shf_freeze(shf);
+}
+
+void
+SharedHashFile::Thaw()
+{
+    SHF_DEBUG("%s()\n", __FUNCTION__);
+    shf_thaw(shf);
+}
+
 void *
 SharedHashFile::QNew(uint32_t shf_qs, uint32_t shf_q_items, uint32_t shf_q_item_size, uint32_t qids_nolock_max)
 {
@@ -268,7 +555,7 @@ SharedHashFile::QGetName(const char * name, uint32_t name_len)
     return shf_q_get_name(shf, name, name_len);
 }
 
-void
+uint32_t
 SharedHashFile::QPushHead(uint32_t qid, uint32_t qiid)
 {
     SHF_DEBUG("%s()\n", __FUNCTION__);
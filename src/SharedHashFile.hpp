@@ -35,9 +35,22 @@ public:
     ~SharedHashFile();
     void       Detach            ();
     bool       AttachExisting    (const char * path, const char * name);
+    bool       AttachExistingReadOnly(const char * path, const char * name);
     bool       Attach            (const char * path, const char * name, uint32_t delete_upon_process_exit);
     bool       IsAttached        ();
     void       MakeHash          (const char * key, uint32_t key_len);
+    uint32_t   GetKeyValAddr     ();
+    uint32_t   GetUidValAddr     (uint32_t uid);
+    uint32_t   GetKeyKeyCopyBuf  (              char * buf, uint32_t buf_size);
+    uint32_t   GetUidKeyCopyBuf  (uint32_t uid, char * buf, uint32_t buf_size);
+    uint32_t   GetKeyValCopyBuf  (              char * buf, uint32_t buf_size);
+    uint32_t   GetUidValCopyBuf  (uint32_t uid, char * buf, uint32_t buf_size);
+    uint32_t   GetKeyKeyCopyIov  (              const struct iovec * iov, int iovcnt);
+    uint32_t   GetUidKeyCopyIov  (uint32_t uid, const struct iovec * iov, int iovcnt);
+    uint32_t   GetKeyValCopyIov  (              const struct iovec * iov, int iovcnt);
+    uint32_t   GetUidValCopyIov  (uint32_t uid, const struct iovec * iov, int iovcnt);
+    uint32_t   GetKeyValVisit    (              uint32_t (*cb)(const char * val, uint32_t val_len, void * ctx), void * ctx);
+    uint32_t   GetUidValVisit    (uint32_t uid, uint32_t (*cb)(const char * val, uint32_t val_len, void * ctx), void * ctx);
     uint32_t   GetKeyKeyCopy     ();
     uint32_t   GetUidKeyCopy     (uint32_t uid);
     uint32_t   GetKeyValCopy     ();
@@ -45,25 +58,52 @@ public:
     uint32_t   AddKeyVal         (              long add);
     uint32_t   AddUidVal         (uint32_t uid, long add);
     uint32_t   PutKeyVal         (const char * val, uint32_t val_len);
+    uint32_t   PutKeyValTtl      (const char * val, uint32_t val_len, uint32_t ttl);
+    uint32_t   TtlReap           ();
     uint32_t   DelKeyVal         ();
     uint32_t   DelUidVal         (uint32_t uid);
     uint32_t   UpdKeyVal         ();
     uint32_t   UpdUidVal         (uint32_t uid);
     uint32_t   UpdCallbackCopy   (const char * val, uint32_t val_len);
+    uint32_t   OpPut             (SHF_OP * op, const char * val, uint32_t val_len);
+    uint32_t   OpPutTtl          (SHF_OP * op, const char * val, uint32_t val_len, uint32_t ttl);
+    uint32_t   OpGet             (SHF_OP * op              ); /* sets op->(uid|val|val_len) */
+    uint32_t   OpGetUid          (SHF_OP * op, uint32_t uid); /* sets op->(val|val_len) */
+    uint32_t   OpGetAddr         (SHF_OP * op              ); /* sets op->(uid|val_addr) */
+    uint32_t   OpGetBuf          (SHF_OP * op, char * buf, uint32_t buf_size);
+    uint32_t   OpAddAtom         (SHF_OP * op, long add    );
+    uint32_t   OpDel             (SHF_OP * op              );
+    uint32_t   OpDelUid          (SHF_OP * op, uint32_t uid);
+    void       ReadBegin         ();
+    void       ReadEnd           ();
     void       TabCopyIterate    (uint32_t * win_addr, uint32_t * tab_addr);
+    SHF_ITER * IterNew           ();
+    uint32_t   IterNext          (SHF_ITER * iter); /* sets iter->(uid|key|key_len|val|val_len) */
+    void       IterFree          (SHF_ITER * iter);
+    uint64_t   ScanParallel      (uint32_t nthreads, uint32_t (* filter_cb)(const SHF_SCAN * scan, void * ctx), void (* visit_cb)(const SHF_SCAN * scan, void * ctx), void * ctx);
     char     * Del               ();
     uint64_t   DebugGetGarbage   ();
+    void       StatsGet          (SHF_STATS * stats);
     void       DebugVerbosityLess();
     void       DebugVerbosityMore();
     void       SetDataNeedFactor (uint32_t data_needed_factor);
     void       SetIsLockable     (uint32_t is_lockable);
     void       SetIsFixedLen     (uint32_t fixed_key_len, uint32_t fixed_val_len);
+    void       SetCacheBudget    (uint64_t data_max, uint32_t keys_max);
+    uint64_t   CacheGetEvicted   ();
+    void       SetLockTimes      (uint32_t is_lock_timed);
+    const SHF_LOCK_TIMES_MMAP * LockTimesGet();
+    void       SetHotKeys        (uint32_t sample);
+    const SHF_HOT_KEYS_MMAP * HotKeysGet();
+    void       HotKeysReset      ();
+    void       Freeze            ();
+    void       Thaw              ();
     void     * QNew              (uint32_t shf_qs, uint32_t shf_q_items, uint32_t shf_q_item_size, uint32_t qids_nolock_max);
     void     * QGet              ();
     void       QDel              ();
     uint32_t   QNewName          (const char * name, uint32_t name_len);
     uint32_t   QGetName          (const char * name, uint32_t name_len);
-    void       QPushHead         (uint32_t qid, uint32_t qiid);
+    uint32_t   QPushHead         (uint32_t qid, uint32_t qiid);
     uint32_t   QPullTail         (uint32_t qid                                            ); /* sets shf_qiid & shf_qiid_addr & shf_qiid_addr_len */
 #if 0
     uint32_t   QTakeItem         (uint32_t qid                                            ); /* sets shf_qiid & shf_qiid_addr & shf_qiid_addr_len */
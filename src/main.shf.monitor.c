@@ -30,6 +30,9 @@
 
 static pid_t        shf_monitor_parent_pid;
 static const char * shf_monitor_path_name ;
+static SHF        * shf_monitor_shf           = NULL; /* only attached if shf_q_set_reap() or shf_ttl_set_reap() asked for reaping */
+static double       shf_monitor_q_reap_time   = 0   ;
+static double       shf_monitor_ttl_reap_time = 0   ;
 
 static void
 shf_monitor_delete_shf(void)
@@ -39,6 +42,74 @@ shf_monitor_delete_shf(void)
     fprintf(stderr, "shf.monitor: detected pid %u gone; deleted shf; shf size before deletion: %s\n", shf_monitor_parent_pid, shf_backticks(du_rm_folder));
 } /* shf_monitor_delete_shf() */
 
+static SHF * /* NULL unless file_reap exists & shf could be attached */
+shf_monitor_attach(const char * file_reap) /* e.g. 'q.reap' */
+{
+    char file_reap_path[256];
+    SHF_SNPRINTF(0, file_reap_path, "%s/%s", shf_monitor_path_name, file_reap);
+    struct stat mystat;
+    if (-1 == stat(file_reap_path, &mystat)) { /* come here if not asked to reap */
+        return NULL;
+    }
+
+    if (NULL == shf_monitor_shf) { /* path name is e.g. '/dev/shm/myshf.shf' */
+        char path[256];
+        char name[256];
+        SHF_SNPRINTF(0, path, "%s", shf_monitor_path_name);
+        char * slash = strrchr(path, '/'); SHF_ASSERT(slash, "shf.monitor: ERROR: expected '/' in '%s'", path);
+        *slash = 0;
+        SHF_SNPRINTF(0, name, "%s", slash + 1);
+        char * dot   = strrchr(name, '.'); SHF_ASSERT(dot  , "shf.monitor: ERROR: expected '.' in '%s'", name);
+        *dot   = 0;
+        shf_init();
+        shf_monitor_shf = shf_attach_existing(path, name);
+    }
+    return shf_monitor_shf;
+} /* shf_monitor_attach() */
+
+static void
+shf_monitor_q_reap(void) /* return qiids held by processes which went poof, every reap_ms set by shf_q_set_reap() */
+{
+    SHF * shf = shf_monitor_attach("q.reap");
+    if (NULL == shf) {
+        return;
+    }
+
+    shf_make_hash(SHF_CONST_STR_AND_SIZE("__q_reap"));
+    if (SHF_RET_KEY_FOUND != shf_get_key_val_copy(shf)) {
+        return;
+    }
+    uint32_t reap_ms = SHF_CAST(uint32_t *, shf_val)[1];
+    double   now     = shf_get_time_in_seconds();
+    if (reap_ms && (now - shf_monitor_q_reap_time >= reap_ms / 1000.0)) {
+        shf_monitor_q_reap_time = now;
+        uint32_t qiids = shf_q_reap(shf);
+        if (qiids) {
+            fprintf(stderr, "shf.monitor: reaped %u qiids held by processes which went poof\n", qiids);
+        }
+    }
+} /* shf_monitor_q_reap() */
+
+static void
+shf_monitor_ttl_reap(void) /* delete keys with expired ttl, every reap_ms set by shf_ttl_set_reap() */
+{
+    SHF * shf = shf_monitor_attach("ttl.reap");
+    if (NULL == shf) {
+        return;
+    }
+
+    shf_make_hash(SHF_CONST_STR_AND_SIZE("__ttl_reap"));
+    if (SHF_RET_KEY_FOUND != shf_get_key_val_copy(shf)) {
+        return;
+    }
+    uint32_t reap_ms = SHF_CAST(uint32_t *, shf_val)[0];
+    double   now     = shf_get_time_in_seconds();
+    if (reap_ms && (now - shf_monitor_ttl_reap_time >= reap_ms / 1000.0)) {
+        shf_monitor_ttl_reap_time = now;
+        shf_ttl_reap(shf);
+    }
+} /* shf_monitor_ttl_reap() */
+
 int
 main(int argc, char **argv)
 {
@@ -66,6 +137,8 @@ main(int argc, char **argv)
             exit(0);
         }
         SHF_ASSERT(0 == value, "shf.monitor: ERROR: INTERNAL: expected value to be 0 but got %d: %u: ", value, errno);
+        shf_monitor_q_reap();
+        shf_monitor_ttl_reap();
         // todo: shf.monitor: consider monitoring which threads are still attached & not deleting while they are still attached
     }
 }
@@ -0,0 +1,427 @@
+/*
+ * ============================================================================
+ * Copyright (c) 2014 Hardy-Francis Enterprises Inc.
+ * This file is part of SharedHashFile.
+ *
+ * SharedHashFile is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or (at your
+ * option) any later version.
+ *
+ * SharedHashFile is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU Affero General Public
+ * License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program. If not, see www.gnu.org/licenses/.
+ * ----------------------------------------------------------------------------
+ * To use SharedHashFile in a closed-source product, commercial licenses are
+ * available; email office [@] sharedhashfile [.] com for more information.
+ * ============================================================================
+ */
+
+// $ ./release-gcc/shf.stats [-f text|json|prom] [-i seconds] [-w] [-l n] [-k n] /dev/shm myshf
+//
+// -f: output format; text (default), json, or prom(etheus text exposition format)
+// -i: seconds between snapshots; 0 (default) means output 1 snapshot and exit
+// -w: also output per win stats for wins with tabs; otherwise only totals
+// -l: 1 or 0 to start or stop sampling lock wait & hold times in all processes attached to the shf
+// -k: n or 0 to start or stop sampling 1 in n key,value ops into hot keys & win op counts in all processes attached to the shf
+//
+// Lock wait & hold time percentiles per op, in rdtsc cycles, are output if lock times have ever been sampled.
+// Hot keys, hottest first, & sampled ops per win are output if hot keys have ever been sampled; multiply samples by n to estimate ops.
+// Hot keys are output with bytes other than [A-Za-z0-9_.:/-] as %xx, and truncated after 48 bytes.
+//
+// Apart from -l & -k the shf is only read: it is mmap()ed PROT_READ, no locks are taken, & nothing is written; a frozen shf is attached via shf_attach_existing_read_only(),
+// otherwise via shf_attach_existing_snapshot(). Counters are output as is and text output also shows tab part, shrink, & remap rates since the last snapshot.
+
+#include <stdio.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <unistd.h> /* for getopt() */
+#include <signal.h>
+#include <ctype.h> /* for isalnum() */
+
+#include <shf.private.h>
+#include <shf.h>
+
+#define SHF_STATS_COUNTERS(X) \
+    X(tabs_used      ) \
+    X(tabs_mmaps     ) \
+    X(tabs_mremaps   ) \
+    X(tabs_shrunk    ) \
+    X(tabs_parted    ) \
+    X(keylen_misses  ) \
+    X(memcmp_misses  ) \
+    X(keys_expired   ) \
+    X(keys_evicted   ) \
+    X(locks_recovered) \
+    X(refs_used      ) \
+    X(refs_size      ) \
+    X(tab_size       ) \
+    X(tab_data_used  ) \
+    X(tab_data_free  )
+
+static const char * shf_stats_path;
+static const char * shf_stats_name;
+
+static const char * shf_stats_lock_ops[SHF_LOCK_OPS] = { "get", "put", "del", "part", "shrink" };
+
+#define SHF_STATS_PERCENTILES (3)
+
+static const double shf_stats_percentiles[SHF_STATS_PERCENTILES] = { 0.5, 0.99, 0.999 };
+
+typedef struct SHF_STATS_LOCK {
+    uint64_t count                        ; /* samples */
+    uint64_t cycles[SHF_STATS_PERCENTILES]; /* least cycles of bucket holding percentile */
+} SHF_STATS_LOCK;
+
+static void
+shf_stats_lock_percentiles( /* sum histogram of op over all wins & find percentiles */
+    const volatile uint64_t   histogram[SHF_WINS_PER_SHF][SHF_LOCK_OPS][SHF_LOCK_TIMES_BUCKETS],
+    SHF_LOCK_OP               op        ,
+    SHF_STATS_LOCK          * stats_lock)
+{
+    uint64_t buckets[SHF_LOCK_TIMES_BUCKETS] = { 0 };
+    memset(stats_lock, 0, sizeof(SHF_STATS_LOCK));
+    for (uint32_t win = 0; win < SHF_WINS_PER_SHF; win++) {
+        for (uint32_t bucket = 0; bucket < SHF_LOCK_TIMES_BUCKETS; bucket++) {
+            buckets[bucket]   += histogram[win][op][bucket];
+            stats_lock->count += histogram[win][op][bucket];
+        }
+    }
+    for (uint32_t p = 0; p < SHF_STATS_PERCENTILES; p++) {
+        uint64_t rank  = shf_stats_percentiles[p] * stats_lock->count;
+        uint64_t count = 0;
+        for (uint32_t bucket = 0; bucket < SHF_LOCK_TIMES_BUCKETS; bucket++) {
+            count += buckets[bucket];
+            if (count > rank) {
+                stats_lock->cycles[p] = shf_lock_times_cycles(bucket);
+                break;
+            }
+        }
+    }
+} /* shf_stats_lock_percentiles() */
+
+static void
+shf_stats_output_lock(
+    const SHF_LOCK_TIMES_MMAP * lock_times,
+    const char                * format    )
+{
+    const char * comma = "";
+    if (0 == strcmp(format, "json")) { printf(",\"lock_times\":{"); }
+    for (uint32_t op = 0; op < SHF_LOCK_OPS; op++) {
+        SHF_STATS_LOCK wait;
+        SHF_STATS_LOCK hold;
+        shf_stats_lock_percentiles(lock_times->wait, op, &wait);
+        shf_stats_lock_percentiles(lock_times->hold, op, &hold);
+        if (0 == strcmp(format, "json")) {
+            printf("%s\"%s\":{\"wait\":{\"count\":%lu,\"p50\":%lu,\"p99\":%lu,\"p999\":%lu},\"hold\":{\"count\":%lu,\"p50\":%lu,\"p99\":%lu,\"p999\":%lu}}",
+                comma, shf_stats_lock_ops[op], wait.count, wait.cycles[0], wait.cycles[1], wait.cycles[2], hold.count, hold.cycles[0], hold.cycles[1], hold.cycles[2]);
+            comma = ",";
+        }
+        else if (0 == strcmp(format, "prom")) {
+            for (uint32_t p = 0; p < SHF_STATS_PERCENTILES; p++) {
+                printf("shf_lock_wait_cycles{path=\"%s\",name=\"%s\",op=\"%s\",quantile=\"%g\"} %lu\n", shf_stats_path, shf_stats_name, shf_stats_lock_ops[op], shf_stats_percentiles[p], wait.cycles[p]);
+                printf("shf_lock_hold_cycles{path=\"%s\",name=\"%s\",op=\"%s\",quantile=\"%g\"} %lu\n", shf_stats_path, shf_stats_name, shf_stats_lock_ops[op], shf_stats_percentiles[p], hold.cycles[p]);
+            }
+            printf("shf_lock_wait_cycles_count{path=\"%s\",name=\"%s\",op=\"%s\"} %lu\n", shf_stats_path, shf_stats_name, shf_stats_lock_ops[op], wait.count);
+            printf("shf_lock_hold_cycles_count{path=\"%s\",name=\"%s\",op=\"%s\"} %lu\n", shf_stats_path, shf_stats_name, shf_stats_lock_ops[op], hold.count);
+        }
+        else {
+            printf("shf.stats: %s/%s: lock %-6s cycles: waits=%lu p50=%lu p99=%lu p999=%lu; holds=%lu p50=%lu p99=%lu p999=%lu\n",
+                shf_stats_path, shf_stats_name, shf_stats_lock_ops[op], wait.count, wait.cycles[0], wait.cycles[1], wait.cycles[2], hold.count, hold.cycles[0], hold.cycles[1], hold.cycles[2]);
+        }
+    }
+    if (0 == strcmp(format, "json")) { printf("}"); }
+} /* shf_stats_output_lock() */
+
+#define SHF_STATS_HOT_WINS (8) /* hottest wins output as text */
+
+static int
+shf_stats_hot_key_compare( /* for qsort(); hottest first */
+    const void * a,
+    const void * b)
+{
+    const SHF_HOT_KEY * hot_key_a = a;
+    const SHF_HOT_KEY * hot_key_b = b;
+    return hot_key_a->count < hot_key_b->count ? 1 : hot_key_a->count > hot_key_b->count ? -1 : 0;
+} /* shf_stats_hot_key_compare() */
+
+static const char *
+shf_stats_hot_key_escape( /* safe for text, json, & prom label values */
+    const SHF_HOT_KEY * hot_key)
+{
+    static char key[SHF_HOT_KEYS_KEY_MAX * 3 + 1];
+    uint32_t    key_len = hot_key->key_len < SHF_HOT_KEYS_KEY_MAX ? hot_key->key_len : SHF_HOT_KEYS_KEY_MAX;
+    uint32_t    pos     = 0;
+    for (uint32_t i = 0; i < key_len; i++) {
+        unsigned char c = hot_key->key[i];
+        if (isalnum(c) || (c && strchr("_.:/-", c))) { key[pos ++] = c; }
+        else                                  { pos += sprintf(&key[pos], "%%%02x", c); }
+    }
+    key[pos] = 0;
+    return key;
+} /* shf_stats_hot_key_escape() */
+
+static uint64_t
+shf_stats_hot_win_ops(
+    const SHF_HOT_KEYS_MMAP * hot_keys,
+    uint32_t                  win     )
+{
+    return hot_keys->ops[win][SHF_LOCK_OP_GET] + hot_keys->ops[win][SHF_LOCK_OP_PUT] + hot_keys->ops[win][SHF_LOCK_OP_DEL];
+} /* shf_stats_hot_win_ops() */
+
+static void
+shf_stats_output_hot(
+    const SHF_HOT_KEYS_MMAP * hot_keys,
+    const char              * format  )
+{
+    SHF_HOT_KEY keys[SHF_HOT_KEYS_TOP];
+    memcpy(keys, hot_keys->keys, sizeof(keys)); /* racy snapshot is good enough */
+    qsort(keys, SHF_HOT_KEYS_TOP, sizeof(SHF_HOT_KEY), shf_stats_hot_key_compare);
+
+    const char * comma = "";
+    if      (0 == strcmp(format, "json")) { printf(",\"hot_keys\":{\"sample\":%u,\"samples\":%lu,\"keys\":[", hot_keys->sample, hot_keys->samples); }
+    else if (0 == strcmp(format, "prom")) { printf("shf_hot_samples{path=\"%s\",name=\"%s\",sample=\"%u\"} %lu\n", shf_stats_path, shf_stats_name, hot_keys->sample, hot_keys->samples); }
+    else                                  { printf("shf.stats: %s/%s: hot keys: sampled 1 in %u ops; samples=%lu\n", shf_stats_path, shf_stats_name, hot_keys->sample, hot_keys->samples); }
+    for (uint32_t slot = 0; slot < SHF_HOT_KEYS_TOP && keys[slot].count; slot++) {
+        const char * key = shf_stats_hot_key_escape(&keys[slot]);
+        if (0 == strcmp(format, "json")) {
+            printf("%s{\"key\":\"%s\",\"key_len\":%u,\"win\":%u,\"count\":%lu,\"error\":%lu}", comma, key, keys[slot].key_len, keys[slot].win, keys[slot].count, keys[slot].error);
+            comma = ",";
+        }
+        else if (0 == strcmp(format, "prom")) {
+            printf("shf_hot_key_samples{path=\"%s\",name=\"%s\",key=\"%s\",win=\"%u\"} %lu\n", shf_stats_path, shf_stats_name, key, keys[slot].win, keys[slot].count);
+        }
+        else {
+            printf("shf.stats: %s/%s: hot key %2u: win=%03u count=%lu error=%lu key_len=%u key=%s\n", shf_stats_path, shf_stats_name, slot, keys[slot].win, keys[slot].count, keys[slot].error, keys[slot].key_len, key);
+        }
+    }
+
+    comma = "";
+    if (0 == strcmp(format, "json")) { printf("],\"wins\":["); }
+    uint32_t shown[SHF_WINS_PER_SHF] = { 0 };
+    for (uint32_t hot = 0; hot < SHF_WINS_PER_SHF; hot++) { /* hottest win first */
+        uint32_t win_max = SHF_WINS_PER_SHF;
+        for (uint32_t win = 0; win < SHF_WINS_PER_SHF; win++) {
+            if (shown[win] || 0 == shf_stats_hot_win_ops(hot_keys, win)) { continue; }
+            if (SHF_WINS_PER_SHF == win_max || shf_stats_hot_win_ops(hot_keys, win) > shf_stats_hot_win_ops(hot_keys, win_max)) { win_max = win; }
+        }
+        if (SHF_WINS_PER_SHF == win_max) { break; }
+        shown[win_max] = 1;
+        const volatile uint64_t * ops = hot_keys->ops[win_max];
+        if (0 == strcmp(format, "json")) {
+            printf("%s{\"win\":%u,\"get\":%lu,\"put\":%lu,\"del\":%lu}", comma, win_max, ops[SHF_LOCK_OP_GET], ops[SHF_LOCK_OP_PUT], ops[SHF_LOCK_OP_DEL]);
+            comma = ",";
+        }
+        else if (0 == strcmp(format, "prom")) {
+            for (uint32_t op = SHF_LOCK_OP_GET; op <= SHF_LOCK_OP_DEL; op++) {
+                printf("shf_hot_win_samples{path=\"%s\",name=\"%s\",win=\"%u\",op=\"%s\"} %lu\n", shf_stats_path, shf_stats_name, win_max, shf_stats_lock_ops[op], ops[op]);
+            }
+        }
+        else if (hot < SHF_STATS_HOT_WINS) {
+            printf("shf.stats: %s/%s: hot win %03u: get=%lu put=%lu del=%lu\n", shf_stats_path, shf_stats_name, win_max, ops[SHF_LOCK_OP_GET], ops[SHF_LOCK_OP_PUT], ops[SHF_LOCK_OP_DEL]);
+        }
+    }
+    if (0 == strcmp(format, "json")) { printf("]}"); }
+} /* shf_stats_output_hot() */
+
+static void
+shf_stats_output_text(
+    SHF_STATS * stats     ,
+    SHF_STATS * stats_last, /* NULL means no previous snapshot */
+    uint32_t    show_wins )
+{
+    double seconds = stats_last ? stats->time - stats_last->time : 0;
+    printf("shf.stats: %s/%s: %.3f: keys=%lu tabs=%lu tab_size=%lu data_used=%lu data_free=%lu load_factor=%.3f garbage_ratio=%.3f\n",
+        shf_stats_path, shf_stats_name, stats->time, stats->total.refs_used, stats->total.tabs_used, stats->total.tab_size, stats->total.tab_data_used, stats->total.tab_data_free, stats->total.load_factor, stats->total.garbage_ratio);
+    printf("shf.stats: %s/%s: %.3f: mmaps=%lu mremaps=%lu shrunk=%lu parted=%lu keylen_misses=%lu memcmp_misses=%lu expired=%lu evicted=%lu recovered=%lu\n",
+        shf_stats_path, shf_stats_name, stats->time, stats->total.tabs_mmaps, stats->total.tabs_mremaps, stats->total.tabs_shrunk, stats->total.tabs_parted, stats->total.keylen_misses, stats->total.memcmp_misses, stats->total.keys_expired, stats->total.keys_evicted, stats->total.locks_recovered);
+    if (seconds > 0) {
+        printf("shf.stats: %s/%s: %.3f: per second: mremaps=%.1f shrunk=%.1f parted=%.1f\n",
+            shf_stats_path, shf_stats_name, stats->time,
+            (stats->total.tabs_mremaps - stats_last->total.tabs_mremaps) / seconds,
+            (stats->total.tabs_shrunk  - stats_last->total.tabs_shrunk ) / seconds,
+            (stats->total.tabs_parted  - stats_last->total.tabs_parted ) / seconds);
+    }
+    printf("shf.stats: %s/%s: %.3f: rows by refs used:", shf_stats_path, shf_stats_name, stats->time);
+    for (uint32_t refs_used = 0; refs_used <= SHF_REFS_PER_ROW; refs_used++) {
+        printf(" %u=%lu", refs_used, stats->total.row_fill[refs_used]);
+    }
+    printf("\n");
+    if (show_wins) {
+        for (uint32_t win = 0; win < SHF_WINS_PER_SHF; win++) {
+            SHF_STATS_WIN * stats_win = &stats->win[win];
+            if (0 == stats_win->tabs_used) { continue; }
+            printf("shf.stats: %s/%s: %.3f: win %03u: keys=%lu tabs=%lu tab_size=%lu load_factor=%.3f garbage_ratio=%.3f shrunk=%lu parted=%lu\n",
+                shf_stats_path, shf_stats_name, stats->time, win, stats_win->refs_used, stats_win->tabs_used, stats_win->tab_size, stats_win->load_factor, stats_win->garbage_ratio, stats_win->tabs_shrunk, stats_win->tabs_parted);
+        }
+    }
+} /* shf_stats_output_text() */
+
+static void
+shf_stats_output_json_win(
+    SHF_STATS_WIN * stats_win)
+{
+#define SHF_STATS_JSON(FIELD) printf("\"%s\":%lu,", #FIELD, stats_win->FIELD);
+    SHF_STATS_COUNTERS(SHF_STATS_JSON)
+    printf("\"row_fill\":[");
+    for (uint32_t refs_used = 0; refs_used <= SHF_REFS_PER_ROW; refs_used++) {
+        printf("%s%lu", refs_used ? "," : "", stats_win->row_fill[refs_used]);
+    }
+    printf("],\"load_factor\":%f,\"garbage_ratio\":%f", stats_win->load_factor, stats_win->garbage_ratio);
+} /* shf_stats_output_json_win() */
+
+static void
+shf_stats_output_json(
+    SHF_STATS                 * stats     ,
+    const SHF_LOCK_TIMES_MMAP * lock_times, /* NULL means never sampled */
+    const SHF_HOT_KEYS_MMAP   * hot_keys  , /* NULL means never sampled */
+    uint32_t                    show_wins )
+{
+    printf("{\"path\":\"%s\",\"name\":\"%s\",\"version\":%u,\"time\":%f,\"total\":{", shf_stats_path, shf_stats_name, stats->version, stats->time);
+    shf_stats_output_json_win(&stats->total);
+    printf("}");
+    if (show_wins) {
+        const char * comma = "";
+        printf(",\"wins\":[");
+        for (uint32_t win = 0; win < SHF_WINS_PER_SHF; win++) {
+            if (0 == stats->win[win].tabs_used) { continue; }
+            printf("%s{\"win\":%u,", comma, win);
+            shf_stats_output_json_win(&stats->win[win]);
+            printf("}");
+            comma = ",";
+        }
+        printf("]");
+    }
+    if (lock_times) {
+        shf_stats_output_lock(lock_times, "json");
+    }
+    if (hot_keys) {
+        shf_stats_output_hot(hot_keys, "json");
+    }
+    printf("}\n");
+} /* shf_stats_output_json() */
+
+static void
+shf_stats_output_prom_win(
+    SHF_STATS_WIN * stats_win,
+    const char    * labels   )
+{
+#define SHF_STATS_PROM(FIELD) printf("shf_%s{%s} %lu\n", #FIELD, labels, stats_win->FIELD);
+    SHF_STATS_COUNTERS(SHF_STATS_PROM)
+    for (uint32_t refs_used = 0; refs_used <= SHF_REFS_PER_ROW; refs_used++) {
+        printf("shf_row_fill{%s,refs=\"%u\"} %lu\n", labels, refs_used, stats_win->row_fill[refs_used]);
+    }
+    printf("shf_load_factor{%s} %f\n"  , labels, stats_win->load_factor  );
+    printf("shf_garbage_ratio{%s} %f\n", labels, stats_win->garbage_ratio);
+} /* shf_stats_output_prom_win() */
+
+static void
+shf_stats_output_prom(
+    SHF_STATS                 * stats     ,
+    const SHF_LOCK_TIMES_MMAP * lock_times, /* NULL means never sampled */
+    const SHF_HOT_KEYS_MMAP   * hot_keys  , /* NULL means never sampled */
+    uint32_t                    show_wins )
+{
+    char labels[256];
+    SHF_SNPRINTF(0, labels, "path=\"%s\",name=\"%s\"", shf_stats_path, shf_stats_name);
+    shf_stats_output_prom_win(&stats->total, labels);
+    if (show_wins) {
+        for (uint32_t win = 0; win < SHF_WINS_PER_SHF; win++) {
+            if (0 == stats->win[win].tabs_used) { continue; }
+            SHF_SNPRINTF(0, labels, "path=\"%s\",name=\"%s\",win=\"%u\"", shf_stats_path, shf_stats_name, win);
+            shf_stats_output_prom_win(&stats->win[win], labels);
+        }
+    }
+    if (lock_times) {
+        shf_stats_output_lock(lock_times, "prom");
+    }
+    if (hot_keys) {
+        shf_stats_output_hot(hot_keys, "prom");
+    }
+    printf("\n");
+} /* shf_stats_output_prom() */
+
+int
+main(int argc, char **argv)
+{
+    const char * format     = "text";
+    uint32_t     interval   = 0;
+    uint32_t     show_wins  = 0;
+    int          lock_time  = -1; /* -1 means leave as is */
+    int          hot_sample = -1; /* -1 means leave as is */
+    int          opt;
+
+    while (-1 != (opt = getopt(argc, argv, "f:i:wl:k:"))) {
+        switch (opt) {
+        case 'f': format     = optarg      ; break;
+        case 'i': interval   = atoi(optarg); break;
+        case 'w': show_wins  = 1           ; break;
+        case 'l': lock_time  = atoi(optarg); break;
+        case 'k': hot_sample = atoi(optarg); break;
+        default : SHF_ASSERT_INTERNAL(0, "shf.stats: ERROR: usage: shf.stats [-f text|json|prom] [-i seconds] [-w] [-l n] [-k n] <path> <name>");
+        }
+    }
+    SHF_ASSERT_INTERNAL(2 == argc - optind, "shf.stats: ERROR: expected <path> <name> but given %d arguments; usage: shf.stats [-f text|json|prom] [-i seconds] [-w] [-l n] [-k n] <path> <name>", argc - optind);
+    SHF_ASSERT_INTERNAL(lock_time >= -1, "shf.stats: ERROR: -l expects n >= 0 but got %d", lock_time);
+    SHF_ASSERT_INTERNAL(hot_sample >= -1, "shf.stats: ERROR: -k expects n >= 0 but got %d", hot_sample);
+    SHF_ASSERT_INTERNAL(0 == strcmp(format, "text") || 0 == strcmp(format, "json") || 0 == strcmp(format, "prom"), "shf.stats: ERROR: unknown format '%s'; expected text, json, or prom", format);
+
+    shf_stats_path = argv[optind    ];
+    shf_stats_name = argv[optind + 1];
+
+    char        file_name[256];
+    struct stat file_stat;
+    SHF_SNPRINTF(0, file_name, "%s/%s.shf/%s.shf", shf_stats_path, shf_stats_name, shf_stats_name);
+    SHF_ASSERT(0 == stat(file_name, &file_stat), "shf.stats: ERROR: shf '%s' does not exist: %u: ", file_name, errno); /* check first; attaching would create it */
+
+    shf_init();
+    SHF * shf = NULL;
+    if ((lock_time >= 0) || (hot_sample >= 0)) {
+        shf = shf_attach_existing(shf_stats_path, shf_stats_name); /* -l & -k write to the shf */
+    }
+    else {
+        shf = shf_attach_existing_read_only(shf_stats_path, shf_stats_name); /* NULL if not frozen */
+        if (NULL == shf) {
+            shf = shf_attach_existing_snapshot(shf_stats_path, shf_stats_name);
+        }
+    }
+    SHF_ASSERT_INTERNAL(NULL != shf, "shf.stats: ERROR: cannot attach to '%s'", file_name);
+
+    if (lock_time >= 0) {
+        shf_set_lock_times(shf, lock_time);
+    }
+    if (hot_sample >= 0) {
+        shf_set_hot_keys(shf, hot_sample);
+    }
+
+    SHF_STATS * stats      = malloc(sizeof(SHF_STATS)); SHF_ASSERT(NULL != stats     , "malloc(%lu): %u: ", sizeof(SHF_STATS), errno);
+    SHF_STATS * stats_last = malloc(sizeof(SHF_STATS)); SHF_ASSERT(NULL != stats_last, "malloc(%lu): %u: ", sizeof(SHF_STATS), errno);
+    uint32_t    snapshots  = 0;
+
+    signal(SIGPIPE, SIG_DFL); /* e.g. exit quietly if piped to head */
+
+    while (1) {
+        shf_stats_get(shf, stats);
+        const SHF_LOCK_TIMES_MMAP * lock_times = shf_lock_times_get(shf);
+        const SHF_HOT_KEYS_MMAP   * hot_keys   = shf_hot_keys_get  (shf);
+        if      (0 == strcmp(format, "json")) { shf_stats_output_json(stats, lock_times, hot_keys, show_wins); }
+        else if (0 == strcmp(format, "prom")) { shf_stats_output_prom(stats, lock_times, hot_keys, show_wins); }
+        else                                  { shf_stats_output_text(stats, snapshots ? stats_last : NULL, show_wins); if (lock_times) { shf_stats_output_lock(lock_times, format); } if (hot_keys) { shf_stats_output_hot(hot_keys, format); } }
+        fflush(stdout);
+        snapshots ++;
+        if (0 == interval) {
+            break;
+        }
+        SHF_STATS * stats_swap = stats_last; stats_last = stats; stats = stats_swap;
+        sleep(interval);
+    }
+
+    free(stats     );
+    free(stats_last);
+    shf_detach(shf);
+    return EXIT_SUCCESS;
+}
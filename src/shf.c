@@ -42,6 +42,8 @@
 #include <syslog.h>
 #include <sys/syscall.h> /* for syscall() */
 #include <sys/resource.h>/* for setrlimit() */
+#include <sys/uio.h>     /* for struct iovec */
+#include <time.h>        /* for time() */
 
 #include "shf.private.h"
 #include "shf.h"
@@ -87,6 +89,17 @@ static __thread       uint32_t       shf_upd_callback_failsafe
 static __thread const char         * shf_upd_callback_copy_val                             = NULL;
 static __thread       uint32_t       shf_upd_callback_copy_val_len                         = 0;
 
+static __thread       uint32_t       shf_visit_callback_failsafe                                         = 0;
+
+       __thread       uint64_t       shf_lock_owner                                                      = 0;    /* cached for writer lock owner */
+                      void(        * shf_lock_recover_hook)(void * lock)                                 = NULL; /* set by shf_init() */
+static                pthread_mutex_t shf_attached_mutex                                                 = PTHREAD_MUTEX_INITIALIZER;
+static                SHF          * shf_attached                                                        = NULL; /* list of shfs attached by process; for lock recovery */
+static                uint32_t       shf_q_fork_gen                                                      = 1;    /* incremented in forked child so its qs claim own __q_procs slots */
+
+static void shf_win_lock_recover(void * lock);
+static void shf_q_proc_release  (SHF  * shf );
+
 /**
  * @brief Spawn a child process & return its pid.
  * - Uses fork() & execl() under the covers.
@@ -191,6 +204,19 @@ shf_get_vfs_available(const char * shf_path)
     return vfs_available;
 } /* shf_get_vfs_available() */
 
+static void
+shf_atfork_child(void) /* forget parent's tid & pid for lock owner, parent's private arena free blocks, & parent's __q_procs slots */
+{
+    shf_lock_owner = 0;
+    shf_q_fork_gen ++;
+    pthread_mutex_init(&shf_attached_mutex, NULL);
+    for (SHF * shf = shf_attached; shf; shf = shf->attached_next) {
+        if (shf->arena_cache) {
+            memset(shf->arena_cache, 0, SHF_ARENA_CLASSES * sizeof(SHF_ARENA_CACHE)); /* parent still owns them */
+        }
+    }
+} /* shf_atfork_child() */
+
 void
 shf_init(void)
 {
@@ -201,6 +227,9 @@ shf_init(void)
     }
     shf_init_called = 1;
 
+    shf_lock_recover_hook = shf_win_lock_recover;
+    int value = pthread_atfork(NULL, NULL, shf_atfork_child); SHF_ASSERT(0 == value, "pthread_atfork(): %u: ", value);
+
 #ifdef SHF_DEBUG_VERSION
     SHF_DEBUG("turning on core dump for debug\n");
 
@@ -258,6 +287,53 @@ shf_init(void)
     EARLY_OUT:;
 } /* shf_init() */
 
+static void
+shf_tab_reclaim( /* munmap() retired tab mmap()s which no reader can still be using */
+    SHF      * shf,
+    uint32_t   all) /* 1 means munmap() all regardless of readers, e.g. upon detach */
+{
+    uint64_t epoch = shf->reader ? shf->shf_mmap->readers[shf->reader - 1].epoch : 0;
+    uint32_t kept  = 0;
+
+    for (uint32_t i = 0; i < shf->retired_used; i++) {
+        if (all || (0 == epoch) || (epoch - 1 >= shf->retired[i].epoch)) {
+            /* come here if reading started after tab mmap() was retired, or no reading */
+            SHF_DEBUG("- munmap() retired tab mmap() %p of %u bytes from epoch %lu\n", shf->retired[i].tab_mmap, shf->retired[i].tab_size, shf->retired[i].epoch);
+            int value = munmap(shf->retired[i].tab_mmap, shf->retired[i].tab_size); SHF_ASSERT(0 == value, "munmap(): %u: ", errno);
+            shf->count_mmap --;
+        }
+        else {
+            shf->retired[kept] = shf->retired[i];
+            kept ++;
+        }
+    }
+    shf->retired_used = kept;
+} /* shf_tab_reclaim() */
+
+static void
+shf_tab_retire( /* munmap() old tab mmap() now, or later if readers might be using its addresses */
+    SHF          * shf     ,
+    SHF_TAB_MMAP * tab_mmap,
+    uint32_t       tab_size)
+{
+    if (0 == shf->reader_nest) {
+        int value = munmap(tab_mmap, tab_size); SHF_ASSERT(0 == value, "munmap(): %u: ", errno);
+    }
+    else {
+        if (shf->retired_used == shf->retired_size) {
+            if (0 == shf->retired_size) { shf->count_xalloc ++; }
+            shf->retired_size += 64;
+            shf->retired       = realloc(shf->retired, shf->retired_size * sizeof(SHF_RETIRED)); SHF_ASSERT(shf->retired, "ERROR: realloc(%lu): %u", shf->retired_size * sizeof(SHF_RETIRED), errno);
+        }
+        shf->retired[shf->retired_used].tab_mmap = tab_mmap;
+        shf->retired[shf->retired_used].tab_size = tab_size;
+        shf->retired[shf->retired_used].epoch    = __sync_add_and_fetch(&shf->shf_mmap->epoch, 1);
+        shf->retired_used ++;
+        shf->count_mmap   ++; /* because still mapped until shf_tab_reclaim() */
+        SHF_DEBUG("- retired tab mmap() %p of %u bytes at epoch %lu; %u retired\n", tab_mmap, tab_size, shf->shf_mmap->epoch, shf->retired_used);
+    }
+} /* shf_tab_retire() */
+
 void
 shf_detach( /* free any (c|m)alloc()d memory & munmap() any mmap()s */
     SHF * shf)
@@ -269,6 +345,12 @@ shf_detach( /* free any (c|m)alloc()d memory & munmap() any mmap()s */
     SHF_DEBUG("%s(shf=?)\n", __FUNCTION__);
     SHF_ASSERT_INTERNAL(shf, "ERROR: shf must not be NULL; have you called shf_attach(_existing)()?");
 
+    pthread_mutex_lock(&shf_attached_mutex);
+    for (SHF ** attached = &shf_attached; *attached; attached = &(*attached)->attached_next) {
+        if (*attached == shf) { *attached = shf->attached_next; break; }
+    }
+    pthread_mutex_unlock(&shf_attached_mutex);
+
     if (shf->log_thread_active) {
         SHF_DEBUG("- ending log thread\n");
         shf_log_thread_del(shf);
@@ -278,8 +360,15 @@ shf_detach( /* free any (c|m)alloc()d memory & munmap() any mmap()s */
         shf_log_detach_existing(shf);
     }
 
-    if (shf->q.qids_nolock_push) { /* SHF_DEBUG("- free qids_nolock_push\n"); */ free(shf->q.qids_nolock_push); shf->count_xalloc --; }
-    if (shf->q.qids_nolock_pull) { /* SHF_DEBUG("- free qids_nolock_pull\n"); */ free(shf->q.qids_nolock_pull); shf->count_xalloc --; }
+    if (shf->q.q_proc          ) { /* SHF_DEBUG("- release q_proc\n"       ); */ shf_q_proc_release(shf); }
+    if (shf->q.q_spsc_caches   ) { /* SHF_DEBUG("- free q_spsc_caches\n"   ); */ free(shf->q.q_spsc_caches   ); shf->count_xalloc --; }
+
+    if (shf->reader) {
+        shf->shf_mmap->readers[shf->reader - 1].epoch = 0;
+        shf->shf_mmap->readers[shf->reader - 1].pid   = 0;
+    }
+    shf_tab_reclaim(shf, 1 /* all */);
+    if (shf->retired) { /* SHF_DEBUG("- free retired\n"); */ free(shf->retired); count_free ++; }
 
     /* SHF_DEBUG("- munmap shared memory for tabs\n"); */
     for (uint32_t win = 0; win < SHF_WINS_PER_SHF; win++) {
@@ -295,6 +384,45 @@ shf_detach( /* free any (c|m)alloc()d memory & munmap() any mmap()s */
     }
     /* SHF_DEBUG("- munmap shared memory for tabs complete\n"); */
 
+    for (uint32_t win = 0; win < SHF_WINS_PER_SHF; win++) {
+        if (shf->wheels[win].wheel_mmap) {
+            value = munmap(shf->wheels[win].wheel_mmap, shf->wheels[win].wheel_size);
+            count_munmap ++;
+            SHF_ASSERT(0 == value, "ERROR: munmap(<wheel win=%u>): %u: ", win, errno);
+        }
+    }
+
+    if (shf->lock_times) {
+        value = munmap(shf->lock_times, SHF_MOD_PAGE(sizeof(SHF_LOCK_TIMES_MMAP)));
+        count_munmap ++;
+        SHF_ASSERT(0 == value, "ERROR: munmap(<lock times>): %u: ", errno);
+    }
+
+    if (shf->hot_keys) {
+        value = munmap(shf->hot_keys, SHF_MOD_PAGE(sizeof(SHF_HOT_KEYS_MMAP)));
+        count_munmap ++;
+        SHF_ASSERT(0 == value, "ERROR: munmap(<hot keys>): %u: ", errno);
+    }
+
+    if (shf->arena_cache) {
+        shf_arena_flush(shf);
+        /* SHF_DEBUG("- free arena_cache\n"); */ free(shf->arena_cache); count_free ++;
+    }
+
+    for (uint32_t seg = 1; seg < SHF_ARENA_SEGS_MAX; seg++) {
+        if (shf->arena_segs[seg]) {
+            value = munmap(shf->arena_segs[seg], SHF_ARENA_SEG_SIZE);
+            count_munmap ++;
+            SHF_ASSERT(0 == value, "ERROR: munmap(<arena seg=%u>): %u: ", seg, errno);
+        }
+    }
+
+    if (shf->arena) {
+        value = munmap(shf->arena, SHF_MOD_PAGE(sizeof(SHF_ARENA_MMAP)));
+        count_munmap ++;
+        SHF_ASSERT(0 == value, "ERROR: munmap(<arena>): %u: ", errno);
+    }
+
     if (shf->path) { /* SHF_DEBUG("- free path\n"); */ free(shf->path); count_free ++; }
     if (shf->name) { /* SHF_DEBUG("- free name\n"); */ free(shf->name); count_free ++; }
 
@@ -310,40 +438,152 @@ shf_detach( /* free any (c|m)alloc()d memory & munmap() any mmap()s */
     /* SHF_DEBUG("- detached\n"); */
 } /* shf_detach() */
 
-SHF * /* NULL if name does not exist */
-shf_attach_existing(
-    const char * path, /* e.g. '/dev/shm' */
-    const char * name) /* e.g. 'myshf'    */
+static inline uint64_t shf_load_u64(const void * addr) { uint64_t u64; memcpy(&u64, addr, sizeof(u64)); return u64; } /* unaligned 64bit load */
+
+/* key compare & key,value copy for fixed key,value lengths; one of each selected once by shf_fixed_shape_set() so the find & append paths make no per key length decision */
+static uint32_t shf_key_is_equal_any(const void * tab_key, const void * key, uint32_t key_len) { return 0 == memcmp(tab_key, key, key_len); }
+static uint32_t shf_key_is_equal_4  (const void * tab_key, const void * key, uint32_t key_len) { SHF_UNUSE(key_len); return 0 == memcmp(tab_key, key, 4); }
+static uint32_t shf_key_is_equal_8  (const void * tab_key, const void * key, uint32_t key_len) { SHF_UNUSE(key_len); return shf_load_u64(tab_key) == shf_load_u64(key); }
+static uint32_t shf_key_is_equal_16 (const void * tab_key, const void * key, uint32_t key_len) { SHF_UNUSE(key_len); const uint8_t * a = tab_key; const uint8_t * b = key; return 0 == ((shf_load_u64(a     ) ^ shf_load_u64(b     ))
+                                                                                                                                                                      | (shf_load_u64(a +  8) ^ shf_load_u64(b +  8))); }
+static uint32_t shf_key_is_equal_32 (const void * tab_key, const void * key, uint32_t key_len) { SHF_UNUSE(key_len); const uint8_t * a = tab_key; const uint8_t * b = key; return 0 == ((shf_load_u64(a     ) ^ shf_load_u64(b     ))
+                                                                                                                                                                      | (shf_load_u64(a +  8) ^ shf_load_u64(b +  8))
+                                                                                                                                                                      | (shf_load_u64(a + 16) ^ shf_load_u64(b + 16))
+                                                                                                                                                                      | (shf_load_u64(a + 24) ^ shf_load_u64(b + 24))); }
+static void   * shf_cpy_4           (void * to, const void * from, size_t len) { SHF_UNUSE(len); return memcpy(to, from,  4); }
+static void   * shf_cpy_8           (void * to, const void * from, size_t len) { SHF_UNUSE(len); return memcpy(to, from,  8); }
+static void   * shf_cpy_16          (void * to, const void * from, size_t len) { SHF_UNUSE(len); return memcpy(to, from, 16); }
+static void   * shf_cpy_32          (void * to, const void * from, size_t len) { SHF_UNUSE(len); return memcpy(to, from, 32); }
+
+static void
+shf_fixed_shape_set( /* select specialized key compare & key,value copy once, from shf->(is_fixed_key_val_len|fixed_key_len|fixed_val_len) */
+    SHF * shf)
+{
+    uint32_t key_len = shf->fixed_key_len;
+    uint32_t val_len = shf->fixed_val_len;
+    if      (0 == shf->is_fixed_key_val_len   ) { shf->fixed_shape = SHF_FIXED_SHAPE_NONE ; }
+    else if (4  == key_len &&  4 == val_len   ) { shf->fixed_shape = SHF_FIXED_SHAPE_4_4  ; }
+    else if (8  == key_len &&  8 == val_len   ) { shf->fixed_shape = SHF_FIXED_SHAPE_8_8  ; }
+    else if (8  == key_len && 16 == val_len   ) { shf->fixed_shape = SHF_FIXED_SHAPE_8_16 ; }
+    else if (16 == key_len && 16 == val_len   ) { shf->fixed_shape = SHF_FIXED_SHAPE_16_16; }
+    else if (32 == key_len                    ) { shf->fixed_shape = SHF_FIXED_SHAPE_32_N ; }
+    else                                        { shf->fixed_shape = SHF_FIXED_SHAPE_NONE ; }
+    switch (shf->fixed_shape) {
+    case SHF_FIXED_SHAPE_4_4  : shf->key_is_equal = shf_key_is_equal_4  ; shf->key_cpy = shf_cpy_4 ; shf->val_cpy = shf_cpy_4 ; break;
+    case SHF_FIXED_SHAPE_8_8  : shf->key_is_equal = shf_key_is_equal_8  ; shf->key_cpy = shf_cpy_8 ; shf->val_cpy = shf_cpy_8 ; break;
+    case SHF_FIXED_SHAPE_8_16 : shf->key_is_equal = shf_key_is_equal_8  ; shf->key_cpy = shf_cpy_8 ; shf->val_cpy = shf_cpy_16; break;
+    case SHF_FIXED_SHAPE_16_16: shf->key_is_equal = shf_key_is_equal_16 ; shf->key_cpy = shf_cpy_16; shf->val_cpy = shf_cpy_16; break;
+    case SHF_FIXED_SHAPE_32_N : shf->key_is_equal = shf_key_is_equal_32 ; shf->key_cpy = shf_cpy_32; shf->val_cpy = memcpy    ; break;
+    default                   : shf->key_is_equal = shf_key_is_equal_any; shf->key_cpy = memcpy    ; shf->val_cpy = memcpy    ; break;
+    }
+} /* shf_fixed_shape_set() */
+
+/* default variable length key,values stay on direct, inlined memcmp() & memcpy(); only a fixed shape takes the indirect call to its fixed width routine */
+#define SHF_KEY_IS_EQUAL(SHF, TAB_KEY, KEY, KEY_LEN) (SHF_FIXED_SHAPE_NONE == (SHF)->fixed_shape ? 0 == memcmp(TAB_KEY, KEY, KEY_LEN) : (SHF)->key_is_equal(TAB_KEY, KEY, KEY_LEN))
+#define SHF_KEY_CPY(SHF, TO, FROM, LEN)              (SHF_FIXED_SHAPE_NONE == (SHF)->fixed_shape ?      memcpy(TO    , FROM, LEN    ) : (SHF)->key_cpy     (TO    , FROM, LEN    ))
+#define SHF_VAL_CPY(SHF, TO, FROM, LEN)              (SHF_FIXED_SHAPE_NONE == (SHF)->fixed_shape ?      memcpy(TO    , FROM, LEN    ) : (SHF)->val_cpy     (TO    , FROM, LEN    ))
+
+static SHF * /* NULL if name does not exist */
+shf_attach_existing_internal(
+    const char * path     , /* e.g. '/dev/shm' */
+    const char * name     , /* e.g. 'myshf'    */
+    uint32_t     read_only) /* 1 means mmap() PROT_READ */
 {
     SHF  * shf = NULL;
     char   file_name[256];
     int    fd;
 
-    SHF_DEBUG("%s(path='%s', name='%s')\n", __FUNCTION__, path, name);
     SHF_ASSERT(shf_init_called, "shf_init() not previously called");
 
     SHF_SNPRINTF(1, file_name, "%s/%s.shf/%s.shf", path, name, name);
-    fd = open(file_name, O_RDWR | O_CREAT, 0600);
+    fd = read_only ? open(file_name, O_RDONLY) : open(file_name, O_RDWR | O_CREAT, 0600);
     if (-1 != fd) {
         SHF_DEBUG("- allocating bytes for shf non mmap : %lu\n", sizeof(SHF));
         shf = calloc(1, sizeof(SHF)); SHF_ASSERT(shf != NULL, "calloc(1, %lu): %u: ", sizeof(SHF), errno);
 
         SHF_DEBUG("- allocating bytes for shf     mmap : %lu\n", SHF_MOD_PAGE(sizeof(SHF_SHF_MMAP)));
-        shf->shf_mmap = mmap(NULL, SHF_MOD_PAGE(sizeof(SHF_SHF_MMAP)), PROT_READ | PROT_WRITE, MAP_SHARED | MAP_NORESERVE | MAP_POPULATE, fd, 0); shf->count_mmap ++; SHF_ASSERT(MAP_FAILED != shf->shf_mmap, "mmap(): %u: ", errno);
+        shf->shf_mmap = mmap(NULL, SHF_MOD_PAGE(sizeof(SHF_SHF_MMAP)), read_only ? PROT_READ : PROT_READ | PROT_WRITE, MAP_SHARED | MAP_NORESERVE | MAP_POPULATE, fd, 0); shf->count_mmap ++; SHF_ASSERT(MAP_FAILED != shf->shf_mmap, "mmap(): %u: ", errno);
 
         int value = close(fd); SHF_ASSERT(-1 != value, "close(): %u: ", errno);
 
         shf->path                 = strdup(path); shf->count_xalloc ++;
         shf->name                 = strdup(name); shf->count_xalloc ++;
-        shf->is_lockable          = 1;
-        shf->is_fixed_key_val_len = 0;
+        shf->is_lockable          = read_only ? 0 : 1;
+        shf->is_read_only         = read_only;
+        shf->is_fixed_key_val_len = shf->shf_mmap->is_fixed_key_val_len; /* persisted by shf_set_is_fixed_len() */
+        shf->fixed_key_len        = shf->shf_mmap->fixed_key_len       ;
+        shf->fixed_val_len        = shf->shf_mmap->fixed_val_len       ;
+        shf_fixed_shape_set(shf);
         shf->log                  = NULL;
+
+        pthread_mutex_lock(&shf_attached_mutex);
+        shf->attached_next        = shf_attached;
+        shf_attached              = shf;
+        pthread_mutex_unlock(&shf_attached_mutex);
     }
 
+    return shf;
+} /* shf_attach_existing_internal() */
+
+SHF * /* NULL if name does not exist */
+shf_attach_existing(
+    const char * path, /* e.g. '/dev/shm' */
+    const char * name) /* e.g. 'myshf'    */
+{
+    SHF_DEBUG("%s(path='%s', name='%s')\n", __FUNCTION__, path, name);
+    SHF * shf = shf_attach_existing_internal(path, name, 0 /* read write */);
     SHF_DEBUG("- return %p // shf\n", shf);
     return shf;
 } /* shf_attach_existing() */
 
+/**
+ * @brief Attach to an existing frozen SHF with all memory mmap()ed PROT_READ.
+ * - Only gets work; key,value put, del, update, & add fail with SHF_RET_FROZEN.
+ * - Gets take no locks & write no shared memory, so any number of processes can read without contending.
+ *
+ * @param[in] path  e.g. "/dev/shm".
+ * @param[in] name  e.g. "myshf".
+ * @retval    shf   NULL if name does not exist or is not frozen via shf_freeze().
+ */
+SHF *
+shf_attach_existing_read_only(
+    const char * path,
+    const char * name)
+{
+    SHF_DEBUG("%s(path='%s', name='%s')\n", __FUNCTION__, path, name);
+    SHF * shf = shf_attach_existing_internal(path, name, 1 /* read only */);
+    if (shf && (0 == shf->shf_mmap->is_frozen)) {
+        SHF_DEBUG("- not frozen; detaching\n");
+        shf_detach(shf);
+        shf = NULL;
+    }
+    SHF_DEBUG("- return %p // shf\n", shf);
+    return shf;
+} /* shf_attach_existing_read_only() */
+
+/**
+ * @brief Attach to an existing SHF, frozen or not, with all memory mmap()ed PROT_READ; for monitoring.
+ * - Only shf_stats_get(), shf_lock_times_get(), & shf_hot_keys_get() work; key,value ops fail with SHF_RET_FROZEN.
+ * - Takes no locks & writes no shared memory; unless frozen, stats are a racy but harmless snapshot.
+ *
+ * @param[in] path  e.g. "/dev/shm".
+ * @param[in] name  e.g. "myshf".
+ * @retval    shf   NULL if name does not exist.
+ */
+SHF *
+shf_attach_existing_snapshot(
+    const char * path,
+    const char * name)
+{
+    SHF_DEBUG("%s(path='%s', name='%s')\n", __FUNCTION__, path, name);
+    SHF * shf = shf_attach_existing_internal(path, name, 1 /* read only */);
+    if (shf) {
+        shf->is_snapshot = 1;
+    }
+    SHF_DEBUG("- return %p // shf\n", shf);
+    return shf;
+} /* shf_attach_existing_snapshot() */
+
 #define SHF_TRUNCATE_FILE(PATH, FILE, SIZE, MKDIR) \
     { \
         int shf_truncate_file_value; \
@@ -458,29 +698,135 @@ shf_make_hash(
     }
     shf_hash_key     = key    ;
     shf_hash_key_len = key_len;
+    SHF_PROBE(hash, shf_hash.u32[0], key_len); /* args: hash, key bytes */
     SHF_DEBUG("%s(key=?, key_len=%u){} // %04x-%04x-%04x\n", __FUNCTION__, key_len, shf_hash.u16[0], shf_hash.u16[1], shf_hash.u16[2]);
 } /* shf_make_hash() */
 
+/**
+ * @brief Allocate a reentrant op context.
+ * - Unlike shf_make_hash() & the shf_(get|put|del)_*() functions, which communicate via __thread globals, each op holds its own hash, uid, & copy buffers.
+ * - So one thread can have many ops in flight, e.g. hash a batch of keys first & then look them all up.
+ * - An op is not thread safe; use one op per thread at a time.
+ *
+ * @retval Op to use with shf_op_hash() & shf_op_*(); free with shf_op_free().
+ */
+SHF_OP *
+shf_op_new(void)
+{
+    SHF_OP * op = calloc(1, sizeof(SHF_OP)); SHF_ASSERT(NULL != op, "calloc(): %u: ", errno);
+    op->uid      = SHF_UID_NONE;
+    op->key_size = 4096; op->key = mmap(NULL, op->key_size, PROT_READ|PROT_WRITE, MAP_ANONYMOUS | MAP_PRIVATE | MAP_NORESERVE, -1, 0); SHF_ASSERT(MAP_FAILED != op->key, "mmap(): %u: ", errno);
+    op->val_size = 4096; op->val = mmap(NULL, op->val_size, PROT_READ|PROT_WRITE, MAP_ANONYMOUS | MAP_PRIVATE | MAP_NORESERVE, -1, 0); SHF_ASSERT(MAP_FAILED != op->val, "mmap(): %u: ", errno);
+    SHF_DEBUG("%s(){} // return op=?\n", __FUNCTION__);
+    return op;
+} /* shf_op_new() */
+
+void
+shf_op_free(
+    SHF_OP * op)
+{
+    SHF_DEBUG("%s(op=?)\n", __FUNCTION__);
+    int value;
+    value = munmap(op->key, op->key_size); SHF_ASSERT(0 == value, "munmap(): %u: ", errno);
+    value = munmap(op->val, op->val_size); SHF_ASSERT(0 == value, "munmap(): %u: ", errno);
+    free(op);
+} /* shf_op_free() */
+
+void
+shf_op_hash( /* like shf_make_hash() but into op; key must stay valid while op in use */
+          SHF_OP   * op     ,
+    const char     * key    ,
+          uint32_t   key_len)
+{
+    MurmurHash3_x64_128(key, key_len, 12345 /* todo: handle seed better :-) */, &op->hash.u64[0]);
+    op->hash_key     = key    ;
+    op->hash_key_len = key_len;
+    SHF_PROBE(hash, op->hash.u32[0], key_len); /* args: hash, key bytes */
+    SHF_DEBUG("%s(op=?, key=?, key_len=%u){} // %04x-%04x-%04x\n", __FUNCTION__, key_len, op->hash.u16[0], op->hash.u16[1], op->hash.u16[2]);
+} /* shf_op_hash() */
+
+void
+shf_op_hash_set( /* reuse hash made earlier, e.g. by shf_op_hash() for another op, so key is hashed only once */
+          SHF_OP   * op     ,
+    const SHF_HASH * hash   ,
+    const char     * key    ,
+          uint32_t   key_len)
+{
+    op->hash         = *hash  ;
+    op->hash_key     = key    ;
+    op->hash_key_len = key_len;
+} /* shf_op_hash_set() */
+
+#define SHF_OP_LEGACY_KEY  (1 << 0) /* shf_key, shf_key_len, shf_key_size */
+#define SHF_OP_LEGACY_VAL  (1 << 1) /* shf_val, shf_val_len, shf_val_size */
+#define SHF_OP_LEGACY_ATOM (1 << 2) /* shf_val_long */
+#define SHF_OP_LEGACY_TTL  (1 << 3) /* shf_ttl */
+
+static inline void
+shf_op_legacy_in( /* mirror __thread globals into stack op used by legacy shf_(get|put|del)_*() functions; only fields in mask are copied */
+    SHF_OP   * op  ,
+    uint32_t   mask) /* SHF_OP_LEGACY_* bits; fields not in mask are never read by the op */
+{
+    op->hash         = shf_hash        ;
+    op->hash_key     = shf_hash_key    ;
+    op->hash_key_len = shf_hash_key_len;
+    op->uid          = shf_uid         ;
+    op->key_addr     = shf_key_addr    ;
+    op->val_addr     = shf_val_addr    ;
+    op->iov          = NULL            ;
+    op->iov_cnt      = 0               ;
+    op->visit_cb     = NULL            ;
+    op->visit_ctx    = NULL            ;
+    if (mask & SHF_OP_LEGACY_KEY ) { op->key      = shf_key     ; op->key_len    = shf_key_len; op->key_size = shf_key_size; }
+    if (mask & SHF_OP_LEGACY_VAL ) { op->val      = shf_val     ; op->val_len    = shf_val_len; op->val_size = shf_val_size; }
+    if (mask & SHF_OP_LEGACY_ATOM) { op->val_long = shf_val_long; op->val_offset = 0          ;                              }
+    if (mask & SHF_OP_LEGACY_TTL ) { op->ttl      = shf_ttl     ;                                                            }
+} /* shf_op_legacy_in() */
+
+static inline void
+shf_op_legacy_out( /* mirror stack op results back into __thread globals; mask as passed to shf_op_legacy_in() */
+    SHF_OP   * op  ,
+    uint32_t   mask)
+{
+    shf_uid      = op->uid     ;
+    shf_key_addr = op->key_addr;
+    shf_val_addr = op->val_addr;
+    if (mask & SHF_OP_LEGACY_KEY ) { shf_key      = op->key     ; shf_key_len = op->key_len; shf_key_size = op->key_size; }
+    if (mask & SHF_OP_LEGACY_VAL ) { shf_val      = op->val     ; shf_val_len = op->val_len; shf_val_size = op->val_size; }
+    if (mask & SHF_OP_LEGACY_ATOM) { shf_val_long = op->val_long;                                                         }
+    if (mask & SHF_OP_LEGACY_TTL ) { shf_ttl      = op->ttl     ;                                                         }
+} /* shf_op_legacy_out() */
+
+/* win lock probe args: win, tab, row (SHF_PROBE_NONE if not known), 1 if writer else 0 */
+#define SHF_PROBE_NONE                          (~0U)
+#define SHF_WIN_LOCK_READER(WIN, TAB, ROW)      SHF_PROBE(lock_wait   , SHF_CAST(uint32_t, WIN), SHF_CAST(uint32_t, TAB), SHF_CAST(uint32_t, ROW), 0); SHF_LOCK_READER  (&shf->shf_mmap->wins[WIN].lock); SHF_PROBE(lock_acquire, SHF_CAST(uint32_t, WIN), SHF_CAST(uint32_t, TAB), SHF_CAST(uint32_t, ROW), 0)
+#define SHF_WIN_UNLOCK_READER(WIN, TAB, ROW)                                                                                                      SHF_UNLOCK_READER(&shf->shf_mmap->wins[WIN].lock); SHF_PROBE(lock_release, SHF_CAST(uint32_t, WIN), SHF_CAST(uint32_t, TAB), SHF_CAST(uint32_t, ROW), 0)
+#define SHF_WIN_LOCK_WRITER(WIN, TAB, ROW)      SHF_PROBE(lock_wait   , SHF_CAST(uint32_t, WIN), SHF_CAST(uint32_t, TAB), SHF_CAST(uint32_t, ROW), 1); SHF_LOCK_WRITER  (&shf->shf_mmap->wins[WIN].lock); SHF_PROBE(lock_acquire, SHF_CAST(uint32_t, WIN), SHF_CAST(uint32_t, TAB), SHF_CAST(uint32_t, ROW), 1)
+#define SHF_WIN_UNLOCK_WRITER(WIN, TAB, ROW)                                                                                                      SHF_UNLOCK_WRITER(&shf->shf_mmap->wins[WIN].lock); SHF_PROBE(lock_release, SHF_CAST(uint32_t, WIN), SHF_CAST(uint32_t, TAB), SHF_CAST(uint32_t, ROW), 1)
+
 #ifdef SHF_DEBUG_VERSION
-#define SHF_LOCK_DEBUG_LINE(LOCK)        (LOCK)->line = __LINE__;
-#define SHF_LOCK_DEBUG_MACRO(LOCK,MACRO) (LOCK)->line = __LINE__; (LOCK)->macro = MACRO;
+#define SHF_LOCK_DEBUG_LINE(LOCK)        if (0 == shf->is_read_only) { (LOCK)->line = __LINE__;                         }
+#define SHF_LOCK_DEBUG_MACRO(LOCK,MACRO) if (0 == shf->is_read_only) { (LOCK)->line = __LINE__; (LOCK)->macro = MACRO; }
 #else
 #define SHF_LOCK_DEBUG_LINE(ARGS...)
 #define SHF_LOCK_DEBUG_MACRO(LOCK,MACRO)
 #endif
 
-#define SHF_MEM_CPY_MAYBE_MREMAP(KEYORVAL) \
-    if (KEYORVAL##_len > shf_##KEYORVAL##_size) { \
+#define SHF_MEM_CPY_MAYBE_MREMAP(OP, KEYORVAL, CPY) \
+    if (KEYORVAL##_len > (OP)->KEYORVAL##_size) { \
         /* SHF_LOCK_DEBUG_LINE(&shf->shf_mmap->wins[win].lock); */ \
-        shf_##KEYORVAL = mremap(shf_##KEYORVAL, shf_##KEYORVAL##_size, SHF_MOD_PAGE(KEYORVAL##_len), MREMAP_MAYMOVE); SHF_ASSERT(MAP_FAILED != shf_##KEYORVAL, "mremap(): %u: ", errno); \
-        shf_##KEYORVAL##_size = SHF_MOD_PAGE(KEYORVAL##_len); \
+        (OP)->KEYORVAL = mremap((OP)->KEYORVAL, (OP)->KEYORVAL##_size, SHF_MOD_PAGE(KEYORVAL##_len), MREMAP_MAYMOVE); SHF_ASSERT(MAP_FAILED != (OP)->KEYORVAL, "mremap(): %u: ", errno); \
+        (OP)->KEYORVAL##_size = SHF_MOD_PAGE(KEYORVAL##_len); \
         /* SHF_LOCK_DEBUG_LINE(&shf->shf_mmap->wins[win].lock); */ \
     } \
-    memcpy(shf_##KEYORVAL, shf_##KEYORVAL##_addr, KEYORVAL##_len); \
-    shf_##KEYORVAL##_len = KEYORVAL##_len;
+    (CPY)((OP)->KEYORVAL, (OP)->KEYORVAL##_addr, KEYORVAL##_len); \
+    (OP)->KEYORVAL##_len = KEYORVAL##_len;
+
+static inline void shf_op_copy_key(SHF_OP * op, uint32_t key_len, void * (* cpy)(void *, const void *, size_t)) { SHF_MEM_CPY_MAYBE_MREMAP(op, key, cpy); } /* copy key_len bytes from op->key_addr to op->key, setting op->key_len, and mremap() op->key if necessary */
+static inline void shf_op_copy_val(SHF_OP * op, uint32_t val_len, void * (* cpy)(void *, const void *, size_t)) { SHF_MEM_CPY_MAYBE_MREMAP(op, val, cpy); } /* copy val_len bytes from op->val_addr to op->val, setting op->val_len, and mremap() op->val if necessary */
 
-void shf_copy_key(uint32_t key_len) { SHF_MEM_CPY_MAYBE_MREMAP(key); } /* copy key_len bytes from shf_key_addr to shf_key, setting shf_key_len, and mremap() shf_key if necessary */
-void shf_copy_val(uint32_t val_len) { SHF_MEM_CPY_MAYBE_MREMAP(val); } /* copy val_len bytes from shf_val_addr to shf_val, setting shf_val_len, and mremap() shf_val if necessary */
+void shf_copy_key(uint32_t key_len) { SHF_OP op; shf_op_legacy_in(&op, SHF_OP_LEGACY_KEY); shf_op_copy_key(&op, key_len, memcpy); shf_op_legacy_out(&op, SHF_OP_LEGACY_KEY); } /* copy key_len bytes from shf_key_addr to shf_key, setting shf_key_len, and mremap() shf_key if necessary */
+void shf_copy_val(uint32_t val_len) { SHF_OP op; shf_op_legacy_in(&op, SHF_OP_LEGACY_VAL); shf_op_copy_val(&op, val_len, memcpy); shf_op_legacy_out(&op, SHF_OP_LEGACY_VAL); } /* copy val_len bytes from shf_val_addr to shf_val, setting shf_val_len, and mremap() shf_val if necessary */
 
 #define SHF_GET_TAB_MMAP(SHF, TAB) \
     if (0 == SHF->tabs[win][TAB].tab_mmap) { /* need to mmap() tab? */ \
@@ -490,12 +836,13 @@ void shf_copy_val(uint32_t val_len) { SHF_MEM_CPY_MAYBE_MREMAP(val); } /* copy v
         int value = stat(file_tab, &sb); SHF_ASSERT(-1 != value, "stat(): %u: ", errno); \
         SHF_DEBUG("- mmap() %lu tab bytes @ 0x%02x-xxx[%03x]-xxx-x for '%s'\n", sb.st_size, win, TAB, file_tab); \
         SHF_ASSERT(sb.st_size == SHF_MOD_PAGE(sb.st_size), "INTERNAL: '%s' has an unexpected size of %lu\n", file_tab, sb.st_size); \
-        int fd = open(file_tab, O_RDWR | O_CREAT, 0600); SHF_ASSERT(-1 != fd, "open(): %u: ", errno); \
-        SHF->tabs[win][TAB].tab_mmap = mmap(NULL, sb.st_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_NORESERVE | MAP_POPULATE, fd, 0); shf->count_mmap ++; SHF_ASSERT(MAP_FAILED != SHF->tabs[win][TAB].tab_mmap, "mmap(): %u: ", errno); \
+        int fd = open(file_tab, SHF->is_read_only ? O_RDONLY : O_RDWR | O_CREAT, 0600); SHF_ASSERT(-1 != fd, "open(): %u: ", errno); \
+        SHF->tabs[win][TAB].tab_mmap = mmap(NULL, sb.st_size, SHF->is_read_only ? PROT_READ : PROT_READ | PROT_WRITE, MAP_SHARED | MAP_NORESERVE | MAP_POPULATE, fd, 0); shf->count_mmap ++; SHF_ASSERT(MAP_FAILED != SHF->tabs[win][TAB].tab_mmap, "mmap(): %u: ", errno); \
         value = close(fd); SHF_ASSERT(-1 != value, "close(): %u: ", errno); \
         SHF->tabs[win][TAB].tab_size = sb.st_size; \
         SHF_DEBUG_FILE("pid %5u, win-tab %u-%u: initial mmap() %u bytes\n", getpid(), win, TAB, SHF->tabs[win][TAB].tab_size); \
-        SHF->shf_mmap->wins[win].tabs_mmaps ++; \
+        SHF_PROBE(tab_mmap, SHF_CAST(uint32_t, win), SHF_CAST(uint32_t, TAB), SHF_CAST(uint64_t, sb.st_size)); /* args: win, tab, tab bytes */ \
+        if (0 == SHF->is_read_only) { SHF->shf_mmap->wins[win].tabs_mmaps ++; } \
     } \
     tab_mmap = SHF->tabs[win][TAB].tab_mmap; \
     if (0 == tab_mmap->tab_size) { \
@@ -508,14 +855,15 @@ void shf_copy_val(uint32_t val_len) { SHF_MEM_CPY_MAYBE_MREMAP(val); } /* copy v
         SHF_DEBUG("- tab was %u, now %u bytes; remapping\n", SHF->tabs[win][TAB].tab_size, tab_mmap->tab_size); \
         SHF_DEBUG_FILE("pid %5u, win-tab %u-%u: remap  from %7u to %7u bytes\n", getpid(), win, TAB, SHF->tabs[win][TAB].tab_size, tab_mmap->tab_size); \
         uint32_t new_tab_size = tab_mmap->tab_size; \
-        if (1 /* reload replacement tab? */ == tab_mmap->tab_size) { \
+        if ((1 /* reload replacement tab? */ == tab_mmap->tab_size) \
+        ||  (SHF->reader_nest /* mremap() might move addresses in use by readers? */)) { \
             char file_tab[256]; \
             SHF_SNPRINTF(0, file_tab, "%s/%s.shf/%03u/%04u.tab", SHF->path, SHF->name, win, TAB); \
             struct stat sb; \
             int value = stat(file_tab, &sb); SHF_ASSERT(-1 != value, "stat(): %u: ", errno); \
             new_tab_size = sb.st_size; \
             int fd       =   open(file_tab, O_RDWR | O_CREAT, 0600); SHF_ASSERT(-1 != fd, "open(): %u: ", errno); \
-                value    = munmap(SHF->tabs[win][TAB].tab_mmap, SHF->tabs[win][TAB].tab_size); SHF_ASSERT(-1 != value, "munmap(): %u: ", errno); \
+                           shf_tab_retire(SHF, SHF->tabs[win][TAB].tab_mmap, SHF->tabs[win][TAB].tab_size); \
                 tab_mmap =   mmap(NULL, new_tab_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_NORESERVE | MAP_POPULATE, fd, 0); SHF_ASSERT(MAP_FAILED != tab_mmap, "mmap(): %u: ", errno); \
                 value    =  close(fd); SHF_ASSERT(-1 != value, "close(): %u: ", errno); \
             SHF->shf_mmap->wins[win].tabs_mmaps ++; \
@@ -536,15 +884,16 @@ void shf_copy_val(uint32_t val_len) { SHF_MEM_CPY_MAYBE_MREMAP(val); } /* copy v
 #define MYMADV_DONTDUMP 0
 #endif
 
-#define SHF_TAB_APPEND(SHF, TAB, TAB_MMAP, LEN_LEN, KEY, KEY_LEN, POS) \
+#define SHF_TAB_APPEND(SHF, TAB, TAB_MMAP, LEN_LEN, KEY, KEY_LEN, POS, EXPIRY) \
     /* todo: examine if file append & remap is faster than remap & direct memory access */ \
     /* todo: consider special mode with is write only, e.g. for initial startup? */ \
     /* todo: faster to use remap_file_pages() instead of multiple mmap()s? */ \
-    uint64_t data_needed    = sizeof(SHF_DATA_TYPE) + LEN_LEN + KEY_LEN + LEN_LEN + val_len; \
+    uint64_t data_needed    = sizeof(SHF_DATA_TYPE) + LEN_LEN + KEY_LEN + LEN_LEN + val_len + (EXPIRY ? sizeof(uint32_t) : 0); \
     uint64_t data_available = TAB_MMAP->tab_size - TAB_MMAP->tab_used; \
     SHF_DEBUG("- appending %lu bytes for ref @ 0x%02x-xxx[%03x]-%03x-%x // key,value are %u,%u bytes @ pos %u // todo: use SHF_DATA_TYPE instead of hard coding\n", data_needed, win, TAB, row, ref, KEY_LEN, val_len, TAB_MMAP->tab_used); \
     SHF_LOCK_DEBUG_MACRO(&SHF->shf_mmap->wins[win].lock, 1); \
     if ((0 == LEN_LEN                    )    /* if ->is_fixed_key_val_len */ \
+    &&  (0 == EXPIRY                     )    /* and no expiry to store after value */ \
     &&  (0 != TAB_MMAP->tab_data_free_pos)) { /* and single linked list chain link exists */ \
         /* come here to reuse deleted key,value pair on deleted link list */ \
                       POS = TAB_MMAP->tab_data_free_pos; \
@@ -553,16 +902,18 @@ void shf_copy_val(uint32_t val_len) { SHF_MEM_CPY_MAYBE_MREMAP(val); } /* copy v
         SHF_DATA_TYPE data_type; \
                       data_type.as_type.key_type = SHF_KEY_TYPE_KEY_IS_STR32; \
                       data_type.as_type.val_type = SHF_KEY_TYPE_VAL_IS_STR32; \
+                      data_type.as_type.extended = 0; \
         SHF_U08_AT(TAB_MMAP, POS                                                      )    =    data_type.as_u08; \
-        SHF_MEM_AT(TAB_MMAP, POS + sizeof(SHF_DATA_TYPE) + LEN_LEN                    , /* = */ KEY_LEN         , /* bytes at */ KEY); \
+        SHF_KEY_CPY(SHF, &SHF_U08_AT(TAB_MMAP, POS + sizeof(SHF_DATA_TYPE) + LEN_LEN                    ), KEY, KEY_LEN); \
         if (val) { \
-        SHF_MEM_AT(TAB_MMAP, POS + sizeof(SHF_DATA_TYPE) + LEN_LEN + KEY_LEN + LEN_LEN, /* = */ val_len         , /* bytes at */ val); \
+        SHF_VAL_CPY(SHF, &SHF_U08_AT(TAB_MMAP, POS + sizeof(SHF_DATA_TYPE) + LEN_LEN + KEY_LEN + LEN_LEN), val, val_len); \
         } \
         TAB_MMAP->tab_data_free -= 1 + KEY_LEN + val_len; \
         goto SKIP_APPEND_COS_REUSE; \
     } else if (data_needed > data_available) { \
         SHF_LOCK_DEBUG_MACRO(&SHF->shf_mmap->wins[win].lock, 2); \
         uint64_t new_tab_size = SHF_MOD_PAGE(TAB_MMAP->tab_size + (data_needed * shf_data_needed_factor)); \
+        SHF_PROBE(tab_grow, SHF_CAST(uint32_t, win), SHF_CAST(uint32_t, TAB), SHF_CAST(uint64_t, TAB_MMAP->tab_size), new_tab_size, data_needed); /* args: win, tab, old tab bytes, new tab bytes, bytes needed */ \
         uint64_t vfs_available = shf_get_vfs_available(SHF->path); \
         SHF_ASSERT_INTERNAL(new_tab_size - TAB_MMAP->tab_size <= vfs_available, "ERROR: requesting to expand tab by %lu but only %lu bytes available on '%s'; need an extra %lu bytes; if /dev/shm consider increasing RAM via e.g. sudo mount -o remount,size=4g /dev/shm", new_tab_size - TAB_MMAP->tab_size, vfs_available, SHF->path, new_tab_size - TAB_MMAP->tab_size - vfs_available); \
         char file_tab[256]; \
@@ -573,7 +924,7 @@ void shf_copy_val(uint32_t val_len) { SHF_MEM_CPY_MAYBE_MREMAP(val); } /* copy v
         int value = ftruncate(fd, new_tab_size); SHF_ASSERT(-1 != value, "ftruncate(): %u: ", errno); \
         if (1) { \
             /* note: why does mremap() not reflect in statvfs()? */ \
-            value    = munmap(SHF->tabs[win][TAB].tab_mmap, SHF->tabs[win][TAB].tab_size); SHF_ASSERT(-1 != value, "munmap(): %u: ", errno); \
+                       shf_tab_retire(SHF, SHF->tabs[win][TAB].tab_mmap, SHF->tabs[win][TAB].tab_size); \
             TAB_MMAP =   mmap(NULL, new_tab_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_NORESERVE | MAP_POPULATE, fd, 0); SHF_ASSERT(MAP_FAILED != TAB_MMAP, "mmap(): %u: ", errno); \
         } \
         else { \
@@ -593,6 +944,7 @@ void shf_copy_val(uint32_t val_len) { SHF_MEM_CPY_MAYBE_MREMAP(val); } /* copy v
     SHF_DATA_TYPE data_type; \
                   data_type.as_type.key_type = SHF_KEY_TYPE_KEY_IS_STR32; \
                   data_type.as_type.val_type = SHF_KEY_TYPE_VAL_IS_STR32; \
+                  data_type.as_type.extended = EXPIRY ? 1 : 0; /* expiry stored after value */ \
     SHF_U08_AT(TAB_MMAP, TAB_MMAP->tab_used                                                               )    =    data_type.as_u08; \
     if (0 == LEN_LEN) { \
         /* store key value *without* size data */ \
@@ -602,30 +954,56 @@ void shf_copy_val(uint32_t val_len) { SHF_MEM_CPY_MAYBE_MREMAP(val); } /* copy v
     SHF_U32_AT(TAB_MMAP, TAB_MMAP->tab_used + sizeof(SHF_DATA_TYPE)                                       )    =    KEY_LEN         ; \
     SHF_U32_AT(TAB_MMAP, TAB_MMAP->tab_used + sizeof(SHF_DATA_TYPE) + LEN_LEN + KEY_LEN                   )    =    val_len         ; \
     } \
-    SHF_MEM_AT(TAB_MMAP, TAB_MMAP->tab_used + sizeof(SHF_DATA_TYPE) + LEN_LEN                             , /* = */ KEY_LEN         , /* bytes at */ KEY); \
+    SHF_KEY_CPY(SHF, &SHF_U08_AT(TAB_MMAP, TAB_MMAP->tab_used + sizeof(SHF_DATA_TYPE) + LEN_LEN                    ), KEY, KEY_LEN); \
     if (val) { \
-    SHF_MEM_AT(TAB_MMAP, TAB_MMAP->tab_used + sizeof(SHF_DATA_TYPE) + LEN_LEN + KEY_LEN + LEN_LEN         , /* = */ val_len         , /* bytes at */ val); \
+    SHF_VAL_CPY(SHF, &SHF_U08_AT(TAB_MMAP, TAB_MMAP->tab_used + sizeof(SHF_DATA_TYPE) + LEN_LEN + KEY_LEN + LEN_LEN), val, val_len); \
+    } \
+    if (EXPIRY) { \
+    SHF_U32_AT(TAB_MMAP, TAB_MMAP->tab_used + sizeof(SHF_DATA_TYPE) + LEN_LEN + KEY_LEN + LEN_LEN + val_len)    =    EXPIRY          ; \
     } \
     TAB_MMAP->tab_used += data_needed; \
     SKIP_APPEND_COS_REUSE:; \
+    SHF_PROBE(tab_append, SHF_CAST(uint32_t, win), SHF_CAST(uint32_t, TAB), SHF_CAST(uint32_t, row), data_needed); /* args: win, tab, row, bytes appended */ \
     TAB_MMAP->tab_refs_used ++; \
-    TAB_MMAP->tab_data_used += data_needed;
+    TAB_MMAP->tab_data_used += data_needed; \
+    SHF->shf_mmap->wins[win].keys_used ++; \
+    SHF->shf_mmap->wins[win].data_used += data_needed;
+
+static uint32_t /* second key,value expires, or 0 if key,value has no expiry */
+shf_tab_ref_expiry(
+    SHF_TAB_MMAP * tab_mmap,
+    uint32_t       pos     ,
+    uint32_t       len_len ,
+    uint32_t       key_len ,
+    uint32_t       val_len )
+{
+    SHF_DATA_TYPE data_type;
+    data_type.as_u08 = SHF_U08_AT(tab_mmap, pos);
+    return data_type.as_type.extended ? SHF_U32_AT(tab_mmap, pos+1+len_len+key_len+len_len+val_len) : 0;
+} /* shf_tab_ref_expiry() */
 
-#define SHF_TAB_REF_MARK_AS_DELETED(TAB_MMAP, LEN_LEN) \
+#define SHF_TAB_REF_MARK_AS_DELETED(TAB_MMAP, LEN_LEN, LINK) \
     uint32_t old_pos = TAB_MMAP->tab_data_free_pos; \
+    SHF_DATA_TYPE old_data_type; \
+                  old_data_type.as_u08 = SHF_U08_AT(TAB_MMAP, TAB_MMAP->row[row].ref[ref].pos); \
+    uint32_t old_extended_len = old_data_type.as_type.extended ? sizeof(uint32_t) : 0; /* expiry after value? */ \
     /* mark data in old tab as deleted */ \
     SHF_U08_AT(TAB_MMAP, TAB_MMAP->row[row].ref[ref].pos) = SHF_DATA_TYPE_DELETED; \
-    if (0 == LEN_LEN) {                                                                                        } /* if ->is_fixed_key_val_len */ \
-    else              { SHF_U32_AT(TAB_MMAP, TAB_MMAP->row[row].ref[ref].pos+1) = key_len + LEN_LEN + val_len; } /* store total length of deleted key,value */ \
+    if (0 == LEN_LEN) {                                                                                                           } /* if ->is_fixed_key_val_len */ \
+    else              { SHF_U32_AT(TAB_MMAP, TAB_MMAP->row[row].ref[ref].pos+1) = key_len + LEN_LEN + val_len + old_extended_len; } /* store total length of deleted key,value */ \
     if ((                  0 == LEN_LEN        )    /* if ->is_fixed_key_val_len */ \
+    &&  (                 0 == old_extended_len)    /* and deleted key,value has same size as all others */ \
+    &&  (                  0 != LINK           )    /* and key,value bytes may be overwritten, i.e. not copied to another tab for readers */ \
     &&  ((key_len + val_len) >= sizeof(old_pos))) { /* and enough space to store single linked list chain link */ \
         /* come here to add deleted key,value pair to deleted link list */ \
         SHF_U32_AT(TAB_MMAP, TAB_MMAP->row[row].ref[ref].pos+1+sizeof(key_len)) = old_pos; \
         TAB_MMAP->tab_data_free_pos = TAB_MMAP->row[row].ref[ref].pos; \
         /* todo: consider having multiple linked lists for key,value powers of two sizes for use in non-fixed size key,vale mode */ \
     } \
-    TAB_MMAP->tab_data_used -= 1 + LEN_LEN + key_len + LEN_LEN + val_len; \
-    TAB_MMAP->tab_data_free += 1 + LEN_LEN + key_len + LEN_LEN + val_len; \
+    TAB_MMAP->tab_data_used -= 1 + LEN_LEN + key_len + LEN_LEN + val_len + old_extended_len; \
+    TAB_MMAP->tab_data_free += 1 + LEN_LEN + key_len + LEN_LEN + val_len + old_extended_len; \
+    shf->shf_mmap->wins[win].keys_used --; \
+    shf->shf_mmap->wins[win].data_used -= 1 + LEN_LEN + key_len + LEN_LEN + val_len + old_extended_len; \
     /* mark ref in old tab as unused */ \
     TAB_MMAP->row[row].ref[ref].pos = 0; \
     TAB_MMAP->tab_refs_used --;
@@ -637,49 +1015,308 @@ void shf_copy_val(uint32_t val_len) { SHF_MEM_CPY_MAYBE_MREMAP(val); } /* copy v
     uint32_t     val_len = 0 == LEN_LEN ? shf->fixed_val_len :                         SHF_U32_AT(tab_mmap_old, tab_mmap_old->row[row].ref[ref].pos+1+LEN_LEN+key_len        ) ; \
     const char * key     =                                     SHF_CAST(const char *, &SHF_U08_AT(tab_mmap_old, tab_mmap_old->row[row].ref[ref].pos+1+LEN_LEN                )); \
     const char * val     =                                     SHF_CAST(const char *, &SHF_U08_AT(tab_mmap_old, tab_mmap_old->row[row].ref[ref].pos+1+LEN_LEN+key_len+LEN_LEN)); \
+    uint32_t     expiry  = shf_tab_ref_expiry(tab_mmap_old, tab_mmap_old->row[row].ref[ref].pos, LEN_LEN, key_len, val_len); \
     /* copy data from old tab to new tab */ \
     shf_debug_disabled ++; \
-    SHF_TAB_APPEND(shf, tab, tab_mmap_new, LEN_LEN, key, key_len, tab_used_new); \
+    SHF_TAB_APPEND(shf, tab, tab_mmap_new, LEN_LEN, key, key_len, tab_used_new, expiry); \
     shf_debug_disabled --; \
-    SHF_TAB_REF_MARK_AS_DELETED(tab_mmap_old, LEN_LEN); \
+    SHF_TAB_REF_MARK_AS_DELETED(tab_mmap_old, LEN_LEN, 0 /* no link */); \
     /* copy ref from old tab to new tab */ \
     tab_mmap_new->row[row].ref[ref].pos = tab_used_new; \
     tab_mmap_new->row[row].ref[ref].tab = tab_mmap_old->row[row].ref[ref].tab; \
     tab_mmap_new->row[row].ref[ref].rnd = tab_mmap_old->row[row].ref[ref].rnd; \
-    tab_mmap_new->tab_refs_used ++;
-
-#ifdef SHF_DEBUG_VERSION
-static void
-shf_tab_validate(SHF * shf, SHF_TAB_MMAP * tab_mmap, uint32_t tab_size, uint32_t win, uint16_t tab)
+    tab_mmap_new->row[row].ref[ref].hit = tab_mmap_old->row[row].ref[ref].hit; /* tab_refs_used counted by SHF_TAB_APPEND() */
+
+static uint32_t /* number of problems found */
+shf_tab_check( /* check refs point at key,values inside tab & that tab counters add up; optionally repair by dropping bad refs */
+    SHF          * shf     ,
+    SHF_TAB_MMAP * tab_mmap,
+    uint32_t       tab_size,
+    uint32_t       win     ,
+    uint16_t       tab     ,
+    uint32_t       repair  ) /* 1 means drop bad refs & recount tab counters, e.g. after writer died holding lock */
 {
-    SHF_DEBUG("%s(tab_mmap=%p, tab_size=%u, win=%u, tab=%u) {\n", __FUNCTION__, tab_mmap, tab_size, win, tab);
+    SHF_DEBUG("%s(tab_mmap=%p, tab_size=%u, win=%u, tab=%u, repair=%u) {\n", __FUNCTION__, tab_mmap, tab_size, win, tab, repair);
     uint32_t len_len        = shf->is_fixed_key_val_len ? 0 : sizeof(shf->fixed_key_len);
+    uint32_t tab_used       = tab_mmap->tab_used <= tab_size ? tab_mmap->tab_used : tab_size;
+    uint32_t problems       = 0;
     uint32_t refs_validated = 0;
+    uint64_t data_validated = 0;
+    if (tab_used != tab_mmap->tab_used) {
+        fprintf(stderr, "WARN: %s: tab_used %u beyond tab size %u at win %u, tab %u\n", repair ? "repairing" : "validating", tab_mmap->tab_used, tab_size, win, tab);
+        problems ++;
+        if (repair) { tab_mmap->tab_used = tab_used; }
+    }
     for (uint32_t row = 0; row < SHF_ROWS_PER_TAB; row ++) {
         for (uint32_t ref = 0; ref < SHF_REFS_PER_ROW; ref ++) {
             uint32_t pos = tab_mmap->row[row].ref[ref].pos;
             if (pos) { /* if ref */
+                uint64_t key_len = 0;
+                uint64_t val_len = 0;
+                uint64_t ext_len = 0;
+                if (pos >= offsetof(SHF_TAB_MMAP, data) && pos+1+len_len <= tab_used) {
+                    SHF_DATA_TYPE data_type;
+                    data_type.as_u08 = SHF_U08_AT(tab_mmap, pos);
+                    ext_len          = data_type.as_type.extended ? sizeof(uint32_t) : 0;
+                    key_len          = 0 == len_len ? shf->fixed_key_len : SHF_U32_AT(tab_mmap, pos+1);
+                }
+                if (key_len && pos+1+len_len+key_len+len_len <= tab_used) {
+                    val_len          = 0 == len_len ? shf->fixed_val_len : SHF_U32_AT(tab_mmap, pos+1+len_len+key_len);
+                }
+                //debug shf_debug_disabled --; SHF_DEBUG("row %4u, ref %2d: pos %u, key_len %lu\n", row, ref, pos, key_len); shf_debug_disabled ++;
+                if ((0 == key_len)
+                ||  (pos+1+len_len+key_len+len_len+val_len+ext_len > tab_used)) {
+                    fprintf(stderr, "WARN: %s: expected key,value of %lu,%lu bytes inside %u bytes used at win %u, tab %u, row %u, ref %u, pos %u\n", repair ? "repairing" : "validating", key_len, val_len, tab_used, win, tab, row, ref, pos);
+                    problems ++;
+                    if (repair) { tab_mmap->row[row].ref[ref].pos = 0; }
+                    continue;
+                }
                 refs_validated ++;
-                uint32_t key_len = 0 == len_len ? shf->fixed_key_len : SHF_U32_AT(tab_mmap, pos+1                );
-                uint32_t val_len = 0 == len_len ? shf->fixed_val_len : SHF_U32_AT(tab_mmap, pos+1+len_len+key_len);
-                //debug shf_debug_disabled --; SHF_DEBUG("row %4u, ref %2d: pos %u, key_len %u\n", row, ref, pos, key_len); shf_debug_disabled ++;
-                SHF_ASSERT(key_len                               != 0       , "INTERNAL: VALIDATION FAILURE: expected key_len > 0 at win %u, tab %u, row %u, ref %u, pos %u\n"                                                                      , win, tab, row, ref, pos                   );
-                SHF_ASSERT(pos                                   <= tab_size, "INTERNAL: VALIDATION FAILURE: expected pos < %u but pos is %u at win %u, tab %u, row %u, ref %u, pos %u\n"            , tab_size, pos                                , win, tab, row, ref, pos                   );
-                SHF_ASSERT(pos+1+len_len+key_len                 <= tab_size, "INTERNAL: VALIDATION FAILURE: expected key < %u but pos is %u at win %u, tab %u, row %u, ref %u, pos %u; key_len %u\n", tab_size, pos+len_len+key_len                , win, tab, row, ref, pos, key_len          );
-                SHF_ASSERT(pos+1+len_len+key_len+len_len+val_len <= tab_size, "INTERNAL: VALIDATION FAILURE: expected val < %u but pos is %u at win %u, tab %u, row %u, ref %u, pos %u; xxx_len %u\n", tab_size, pos+len_len+key_len+len_len+val_len, win, tab, row, ref, pos, key_len + val_len);
+                data_validated += 1+len_len+key_len+len_len+val_len+ext_len;
             }
         }
     }
-    SHF_DEBUG("- refs_validated=%u\n", refs_validated);
+    if (refs_validated != tab_mmap->tab_refs_used) {
+        fprintf(stderr, "WARN: %s: counted %u refs but tab_refs_used is %u at win %u, tab %u\n", repair ? "repairing" : "validating", refs_validated, tab_mmap->tab_refs_used, win, tab);
+        problems ++;
+        if (repair) { tab_mmap->tab_refs_used = refs_validated; }
+    }
+    if (repair) { /* data of half appended or deleted key,value is garbage now */
+        tab_mmap->tab_data_used = data_validated;
+        if (tab_mmap->tab_data_free_pos >= tab_used) { tab_mmap->tab_data_free_pos = 0; }
+    }
+    SHF_DEBUG("- refs_validated=%u, problems=%u\n", refs_validated, problems);
     SHF_DEBUG("}\n");
+    return problems;
+} /* shf_tab_check() */
+
+static void
+shf_win_lock_recover( /* shf_lock_recover_hook(); called holding win lock of writer which died, so repair its tabs */
+    void * lock)
+{
+    pthread_mutex_lock(&shf_attached_mutex); /* so shf cannot be detached while repairing */
+    SHF      * shf = shf_attached;
+    uint32_t   win = 0;
+    for (; shf; shf = shf->attached_next) {
+        SHF_WIN_MMAP * wins = &shf->shf_mmap->wins[0];
+        if ((lock >= SHF_CAST(void *, wins)) && (lock < SHF_CAST(void *, &wins[SHF_WINS_PER_SHF]))) {
+            win = (SHF_CAST(char *, lock) - SHF_CAST(char *, wins)) / sizeof(SHF_WIN_MMAP);
+            if (lock == &wins[win].lock) { break; }
+        }
+    }
+    if (NULL == shf) { /* come here if not a win lock, e.g. hot keys lock */
+        pthread_mutex_unlock(&shf_attached_mutex);
+        return;
+    }
+
+    SHF_WIN_MMAP * win_mmap  = &shf->shf_mmap->wins[win];
+    uint32_t       problems  = 0;
+    uint64_t       keys_used = 0;
+    uint64_t       data_used = 0;
+    win_mmap->locks_recovered ++;
+    for (uint32_t tab = 0; tab < win_mmap->tabs_used; tab++) {
+        char file_tab[256];
+        SHF_SNPRINTF(0, file_tab, "%s/%s.shf/%03u/%04u.tab", shf->path, shf->name, win, tab);
+        int fd = open(file_tab, O_RDWR);
+        if (-1 == fd) { /* come here if writer died shrinking tab between unlink() & re-create */
+            fprintf(stderr, "WARN: repairing: re-creating missing tab '%s'; its keys are lost\n", file_tab);
+            shf_tab_create(shf->path, shf->name, win, tab, 0 /* no show */, 0 /* no temp/mkdir */);
+            problems ++;
+            continue;
+        }
+        struct stat sb;
+        int value = fstat(fd, &sb); SHF_ASSERT(-1 != value, "fstat(): %u: ", errno);
+        SHF_TAB_MMAP * tab_mmap = mmap(NULL, sb.st_size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0); SHF_ASSERT(MAP_FAILED != tab_mmap, "mmap(): %u: ", errno);
+        value = close(fd); SHF_ASSERT(-1 != value, "close(): %u: ", errno);
+        if (tab_mmap->tab_size) { /* if tab used since created */
+            problems  += shf_tab_check(shf, tab_mmap, sb.st_size, win, tab, 1 /* repair */);
+            keys_used += tab_mmap->tab_refs_used;
+            data_used += tab_mmap->tab_data_used;
+        }
+        value = munmap(tab_mmap, sb.st_size); SHF_ASSERT(0 == value, "munmap(): %u: ", errno);
+    }
+    win_mmap->keys_used = keys_used;
+    win_mmap->data_used = data_used;
+    fprintf(stderr, "WARN: repaired win %u of %u tabs in '%s/%s' with %u problems; %lu keys remain\n", win, win_mmap->tabs_used, shf->path, shf->name, problems, keys_used);
+    pthread_mutex_unlock(&shf_attached_mutex);
+} /* shf_win_lock_recover() */
+
+#ifdef SHF_DEBUG_VERSION
+static void
+shf_tab_validate(SHF * shf, SHF_TAB_MMAP * tab_mmap, uint32_t tab_size, uint32_t win, uint16_t tab)
+{
+    uint32_t problems = shf_tab_check(shf, tab_mmap, tab_size, win, tab, 0 /* no repair */);
+    SHF_ASSERT(0 == problems, "INTERNAL: VALIDATION FAILURE: %u problems at win %u, tab %u\n", problems, win, tab);
 } /* shf_tab_validate() */
 #endif
 
+static void * /* NULL if file does not exist & not created */
+shf_stats_file_map( /* mmap() zero filled stats file shared by all processes */
+    SHF        * shf   ,
+    const char * leaf  , /* e.g. lock.times */
+    uint64_t     size  ,
+    uint32_t     create) /* 0 means only map if file exists */
+{
+    char file_stats[256];
+    SHF_SNPRINTF(0, file_stats, "%s/%s.shf/%s", shf->path, shf->name, leaf);
+    SHF_ASSERT_INTERNAL(0 == create || 0 == shf->is_read_only, "ERROR: shf attached read only cannot create '%s'", file_stats);
+    int fd = open(file_stats, shf->is_read_only ? O_RDONLY : O_RDWR | (create ? O_CREAT : 0), 0600);
+    if (-1 == fd) {
+        SHF_ASSERT(0 == create && ENOENT == errno, "open(): %u: ", errno);
+        return NULL;
+    }
+    struct stat sb;
+    int value = fstat(fd, &sb); SHF_ASSERT(-1 != value, "fstat(): %u: ", errno);
+    if (sb.st_size < SHF_CAST(off_t, SHF_MOD_PAGE(size))) {
+        if (shf->is_read_only) { /* come here if creator has not yet grown the file */
+            value = close(fd); SHF_ASSERT(-1 != value, "close(): %u: ", errno);
+            return NULL;
+        }
+        value = ftruncate(fd, SHF_MOD_PAGE(size)); SHF_ASSERT(-1 != value, "ftruncate(): %u: ", errno); /* zero filled by ftruncate() */
+    }
+    SHF_DEBUG("- mapping %lu stats bytes from '%s'\n", SHF_MOD_PAGE(size), file_stats);
+    void * stats_mmap = mmap(NULL, SHF_MOD_PAGE(size), shf->is_read_only ? PROT_READ : PROT_READ | PROT_WRITE, MAP_SHARED | MAP_NORESERVE, fd, 0); shf->count_mmap ++; SHF_ASSERT(MAP_FAILED != stats_mmap, "mmap(): %u: ", errno);
+    value = close(fd); SHF_ASSERT(-1 != value, "close(): %u: ", errno);
+    return stats_mmap;
+} /* shf_stats_file_map() */
+
+static uint32_t /* 1 if lock.times mapped, else 0 */
+shf_lock_times_map( /* mmap() lock wait & hold histograms shared by all processes */
+    SHF      * shf   ,
+    uint32_t   create) /* 0 means only map if lock.times exists */
+{
+    shf->lock_times = shf_stats_file_map(shf, "lock.times", sizeof(SHF_LOCK_TIMES_MMAP), create);
+    return shf->lock_times ? 1 : 0;
+} /* shf_lock_times_map() */
+
+static inline uint32_t
+shf_lock_times_bucket( /* log-linear: 1 cycle buckets up to 16 cycles, then 4 buckets per power of 2 */
+    uint64_t cycles)
+{
+    if (cycles < SHF_LOCK_TIMES_LINEAR) {
+        return cycles;
+    }
+    uint32_t msb    = 63 - __builtin_clzll(cycles);
+    uint32_t sub    = (cycles >> (msb - SHF_LOCK_TIMES_SUBS_BITS)) & ((1 << SHF_LOCK_TIMES_SUBS_BITS) - 1);
+    uint32_t bucket = SHF_LOCK_TIMES_LINEAR + ((msb - __builtin_ctz(SHF_LOCK_TIMES_LINEAR)) << SHF_LOCK_TIMES_SUBS_BITS) + sub;
+    return bucket < SHF_LOCK_TIMES_BUCKETS ? bucket : SHF_LOCK_TIMES_BUCKETS - 1;
+} /* shf_lock_times_bucket() */
+
+static __thread uint32_t shf_sample_rnd = 2463534242; /* xorshift32 state for sampling jitter */
+
+static inline uint32_t /* ops to skip before next sample */
+shf_sample_skip( /* skip sample - 1 ops on average; jitter so periodic op patterns do not alias */
+    uint32_t sample)
+{
+    shf_sample_rnd ^= shf_sample_rnd << 13;
+    shf_sample_rnd ^= shf_sample_rnd >> 17;
+    shf_sample_rnd ^= shf_sample_rnd <<  5;
+    return sample > 1 ? shf_sample_rnd % (2 * sample - 1) : 0;
+} /* shf_sample_skip() */
+
+static __thread uint32_t shf_lock_times_skip; /* win locks to skip before next sample */
+
+static inline uint64_t /* rdtsc before locking if this op is sampled, else 0 */
+shf_lock_times_start(
+    SHF * shf)
+{
+    uint32_t sample = shf->shf_mmap->lock_times_sample;
+    if (0 == sample) {
+        return 0;
+    }
+    if (shf_lock_times_skip > 2 * sample - 2) { /* come here if sample lowered since skip was picked */
+        shf_lock_times_skip = 0;
+    }
+    if (shf_lock_times_skip) {
+        shf_lock_times_skip --;
+        return 0;
+    }
+    shf_lock_times_skip = shf_sample_skip(sample);
+    return shf_rdtsc();
+} /* shf_lock_times_start() */
+
+static void
+shf_lock_times_add( /* record cycles waited for & held win lock; call just after unlocking */
+    SHF         * shf     ,
+    uint32_t      win     ,
+    SHF_LOCK_OP   op      ,
+    uint64_t      lock_tsc, /* rdtsc before locking; 0 means no wait to record */
+    uint64_t      hold_tsc) /* rdtsc after  locking */
+{
+    uint64_t unlock_tsc = shf_rdtsc();
+    if (NULL == shf->lock_times) {
+        shf_lock_times_map(shf, 1 /* create */);
+    }
+    if (lock_tsc) { __sync_fetch_and_add(&shf->lock_times->wait[win][op][shf_lock_times_bucket(hold_tsc   - lock_tsc)], 1); }
+                    __sync_fetch_and_add(&shf->lock_times->hold[win][op][shf_lock_times_bucket(unlock_tsc - hold_tsc)], 1);
+} /* shf_lock_times_add() */
+
+static uint32_t /* 1 if hot.keys mapped, else 0 */
+shf_hot_keys_map( /* mmap() sampled hot keys & win ops shared by all processes */
+    SHF      * shf   ,
+    uint32_t   create) /* 0 means only map if hot.keys exists */
+{
+    shf->hot_keys = shf_stats_file_map(shf, "hot.keys", sizeof(SHF_HOT_KEYS_MMAP), create);
+    return shf->hot_keys ? 1 : 0;
+} /* shf_hot_keys_map() */
+
+static __thread uint32_t shf_hot_keys_skip;             /* ops to skip before next sample */
+
+static void
+shf_hot_keys_add( /* count sampled op by win & space-saving count its key; call before locking win */
+    SHF         * shf    ,
+    uint32_t      win    ,
+    SHF_LOCK_OP   op     ,
+    uint64_t      hash   , /* hash.u64[0] of key */
+    const char  * key    , /* NULL means op by uid; only win op is counted */
+    uint32_t      key_len)
+{
+    shf_hot_keys_skip = shf_sample_skip(shf->shf_mmap->hot_keys_sample);
+
+    if (NULL == shf->hot_keys) {
+        shf_hot_keys_map(shf, 1 /* create */);
+    }
+    SHF_HOT_KEYS_MMAP * hot_keys = shf->hot_keys;
+    __sync_fetch_and_add(&hot_keys->samples    , 1);
+    __sync_fetch_and_add(&hot_keys->ops[win][op], 1);
+    if (NULL == key) {
+        return;
+    }
+
+    uint32_t slot_min = 0;
+    SHF_LOCK_WRITER(&hot_keys->lock);
+    for (uint32_t slot = 0; slot < SHF_HOT_KEYS_TOP; slot++) {
+        SHF_HOT_KEY * hot_key = &hot_keys->keys[slot];
+        if (hot_key->count && hash == hot_key->hash && key_len == hot_key->key_len) {
+            hot_key->count ++;
+            goto SHF_HOT_KEY_COUNTED;
+        }
+        if (hot_key->count < hot_keys->keys[slot_min].count) {
+            slot_min = slot;
+        }
+    }
+    /* come here to replace least counted -- or unused -- key; new key inherits its count as error */
+    SHF_HOT_KEY * hot_key = &hot_keys->keys[slot_min];
+    hot_key->error   = hot_key->count;
+    hot_key->count   = hot_key->error + 1;
+    hot_key->hash    = hash;
+    hot_key->win     = win;
+    hot_key->key_len = key_len;
+    memcpy(hot_key->key, key, key_len < SHF_HOT_KEYS_KEY_MAX ? key_len : SHF_HOT_KEYS_KEY_MAX);
+    SHF_HOT_KEY_COUNTED:;
+    SHF_UNLOCK_WRITER(&hot_keys->lock);
+} /* shf_hot_keys_add() */
+
+#define SHF_HOT_KEYS_SAMPLE(SHF, WIN, OP, HASH, KEY, KEY_LEN) /* not while frozen, so frozen readers never write shared memory */ \
+    if (SHF->shf_mmap->hot_keys_sample && 0 == SHF->is_read_only && 0 == SHF->shf_mmap->is_frozen && 0 == shf_hot_keys_skip --) { shf_hot_keys_add(SHF, WIN, OP, HASH, KEY, KEY_LEN); }
+
 static void
 shf_tab_shrink(SHF * shf, uint32_t win, uint16_t tab)
 {
     SHF_DEBUG("%s(shf=?, win=%u, tab=%u) {\n", __FUNCTION__, win, tab);
 
+    uint64_t hold_tsc = shf->shf_mmap->lock_times_sample ? shf_rdtsc() : 0; /* rare, so never skipped */
+
     shf->shf_mmap->wins[win].tabs_shrunk ++;
 
     SHF_TAB_MMAP * tab_mmap;
@@ -711,18 +1348,22 @@ shf_tab_shrink(SHF * shf, uint32_t win, uint16_t tab)
     SHF_DEBUG_FILE("pid %5u, win-tab %u-%u: shrunk from %7u to %7u bytes; deleting old tab\n", getpid(), win, tab, tab_mmap_old->tab_size, tab_mmap_new->tab_size);
     uint32_t tab_size_old = tab_mmap_old->tab_size;
     tab_mmap_old->tab_size = 1; /* force other processes to munmap() this file & load the replacement */
-    int value = munmap(tab_mmap_old, tab_size_old); SHF_ASSERT(0 == value, "munmap(): %u", errno);
+    shf_tab_retire(shf, tab_mmap_old, tab_size_old);
     shf->count_mmap --; /* because we re-created it (see above) */
+    SHF_PROBE(tab_shrink, win, SHF_CAST(uint32_t, tab), tab_size_old, SHF_CAST(uint32_t, tab_mmap_new->tab_size), SHF_CAST(uint32_t, tab_mmap_new->tab_refs_used)); /* args: win, tab, old tab bytes, new tab bytes, refs */
 
 #ifdef SHF_DEBUG_VERSION
     shf_tab_validate(shf, tab_mmap_new, shf->tabs[win][tab].tab_size, win, tab);
 #endif
+
+    if (hold_tsc) { shf_lock_times_add(shf, win, SHF_LOCK_OP_SHRINK, 0 /* no wait */, hold_tsc); }
 } /* shf_tab_shrink() */
 
 static void
 shf_tab_part(SHF * shf, uint32_t win, uint16_t tab_old)
 {
-    uint16_t tab_new = shf->shf_mmap->wins[win].tabs_used;
+    uint16_t tab_new  = shf->shf_mmap->wins[win].tabs_used;
+    uint64_t hold_tsc = shf->shf_mmap->lock_times_sample ? shf_rdtsc() : 0; /* rare, so never skipped */
     SHF_DEBUG_FILE("pid %5u, win-tab %u-%u: parting to new tab %u\n", getpid(), win, tab_old, tab_new);
 
     SHF_DEBUG("%s(shf=?, win=%u, tab_old=%u) {\n", __FUNCTION__, win, tab_old);
@@ -774,15 +1415,224 @@ shf_tab_part(SHF * shf, uint32_t win, uint16_t tab_old)
     }
     SHF_DEBUG("- parted  #%lu: tab refs; %lu in old & %lu in new tab\n", shf->shf_mmap->wins[win].tabs_parted, shf->shf_mmap->wins[win].tabs_parted_old - tabs_parted_old, shf->shf_mmap->wins[win].tabs_parted_new - tabs_parted_new);
 
+    SHF_PROBE(tab_part, win, SHF_CAST(uint32_t, tab_old), SHF_CAST(uint32_t, tab_new), SHF_CAST(uint32_t, tab_mmap_new->tab_refs_used), SHF_CAST(uint64_t, tab_mmap_new->tab_data_used)); /* args: win, old tab, new tab, refs moved, bytes moved */
     SHF_DEBUG_FILE("pid %5u, win-tab %u-%u: shrink after part\n", getpid(), win, tab_old);
     shf_tab_shrink(shf, win, tab_old);
+
+    if (hold_tsc) { shf_lock_times_add(shf, win, SHF_LOCK_OP_PART, 0 /* no wait */, hold_tsc); }
 } /* shf_tab_part() */
 
-uint32_t /* see SHF_RET_* for result meaning */
-shf_put_key_val(
+static uint32_t /* 1 if key,value at ref had expired & was deleted, else 0 */
+shf_tab_ref_expire( /* lazily delete key,value at used ref if expired; win writer lock must be held */
+    SHF          * shf     ,
+    SHF_TAB_MMAP * tab_mmap,
+    uint32_t       win     ,
+    uint32_t       row     ,
+    uint32_t       ref     ,
+    uint32_t       now     ) /* 0 means current second */
+{
+    uint32_t len_len = shf->is_fixed_key_val_len ? 0 : sizeof(shf->fixed_key_len);
+    uint32_t pos     = tab_mmap->row[row].ref[ref].pos;
+    uint32_t key_len = 0 == len_len ? shf->fixed_key_len : SHF_U32_AT(tab_mmap, pos+1                );
+    uint32_t val_len = 0 == len_len ? shf->fixed_val_len : SHF_U32_AT(tab_mmap, pos+1+len_len+key_len);
+    uint32_t expiry  = shf_tab_ref_expiry(tab_mmap, pos, len_len, key_len, val_len);
+    if (0 == expiry                                           ) { return 0; } /* no ttl */
+    if ((0 == now ? SHF_CAST(uint32_t, time(NULL)) : now) < expiry) { return 0; } /* not expired yet */
+    SHF_DEBUG("- expiring key,value @ 0x%02x-xxx-%03x-%x; expired at second %u\n", win, row, ref, expiry);
+    SHF_TAB_REF_MARK_AS_DELETED(tab_mmap, len_len, 1 /* link */);
+    shf->shf_mmap->wins[win].keys_expired ++;
+    return 1;
+} /* shf_tab_ref_expire() */
+
+static void
+shf_wheel_map( /* (re)mmap() ttl timer wheel of win at size bytes; growing file if necessary */
+    SHF      * shf ,
+    uint32_t   win ,
+    uint32_t   size)
+{
+    char file_wheel[256];
+    SHF_SNPRINTF(0, file_wheel, "%s/%s.shf/%03u/ttl.wheel", shf->path, shf->name, win);
+    SHF_DEBUG("- mapping ttl timer wheel of %u bytes from '%s'\n", size, file_wheel);
+    int fd    = open(file_wheel, O_RDWR | O_CREAT, 0600); SHF_ASSERT(-1 != fd, "open(): %u: ", errno);
+    int value;
+    if (size > shf->shf_mmap->wins[win].wheel_size) {
+        value = ftruncate(fd, size); SHF_ASSERT(-1 != value, "ftruncate(): %u: ", errno);
+    }
+    if (shf->wheels[win].wheel_mmap) {
+        value = munmap(shf->wheels[win].wheel_mmap, shf->wheels[win].wheel_size); SHF_ASSERT(0 == value, "munmap(): %u: ", errno);
+    }
+    else {
+        shf->count_mmap ++;
+    }
+    shf->wheels[win].wheel_mmap = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_NORESERVE | MAP_POPULATE, fd, 0); SHF_ASSERT(MAP_FAILED != shf->wheels[win].wheel_mmap, "mmap(): %u: ", errno);
+    shf->wheels[win].wheel_size = size;
+    value = close(fd); SHF_ASSERT(-1 != value, "close(): %u: ", errno);
+} /* shf_wheel_map() */
+
+static SHF_WHEEL_MMAP * /* NULL if no key with ttl put in win yet */
+shf_wheel_get( /* map ttl timer wheel of win; creating or growing it if need_node & no free node; win writer lock must be held */
+    SHF      * shf      ,
+    uint32_t   win      ,
+    uint32_t   need_node)
+{
+    uint32_t wheel_size = shf->shf_mmap->wins[win].wheel_size;
+    if (wheel_size != shf->wheels[win].wheel_size) {
+        /* come here if another process created or grew the wheel */
+        shf_wheel_map(shf, win, wheel_size);
+    }
+    SHF_WHEEL_MMAP * wheel = shf->wheels[win].wheel_mmap;
+    if (need_node) {
+        uint32_t nodes_max = 0 == wheel_size ? 0 : (wheel_size - sizeof(SHF_WHEEL_MMAP)) / sizeof(SHF_WHEEL_NODE_MMAP);
+        if ((0 == wheel_size)
+        ||  ((0 == wheel->nodes_free) && (wheel->nodes_made + 1 >= nodes_max))) {
+            uint32_t wheel_size_new = 0 == wheel_size ? SHF_MOD_PAGE(sizeof(SHF_WHEEL_MMAP)) : 2 * wheel_size;
+            SHF_DEBUG("- grow ttl timer wheel for win %u from %u to %u bytes\n", win, wheel_size, wheel_size_new);
+            shf_wheel_map(shf, win, wheel_size_new);
+            wheel = shf->wheels[win].wheel_mmap;
+            if (0 == wheel_size) {
+                wheel->now = SHF_CAST(uint32_t, time(NULL)) - 1;
+            }
+            shf->shf_mmap->wins[win].wheel_size = wheel_size_new;
+        }
+    }
+    return wheel;
+} /* shf_wheel_get() */
+
+static void
+shf_wheel_insert( /* add node to the slot in which it fires; lower levels have finer slots */
+    SHF_WHEEL_MMAP * wheel,
+    uint32_t         node )
+{
+    uint32_t base = wheel->now + 1; /* next second to reap */
+    uint32_t when = wheel->node[node].expiry > base ? wheel->node[node].expiry : base;
+    if (when - base >= (1U << SHF_WHEEL_SPAN_BITS)) {
+        when = base + (1U << SHF_WHEEL_SPAN_BITS) - 1; /* too far in future; node gets re-inserted when its slot fires */
+    }
+    uint32_t level = 0;
+    while ((when - base) >= (1U << (SHF_WHEEL_SLOTS_BITS * (level + 1)))) {
+        level ++;
+    }
+    uint32_t slot = (when >> (SHF_WHEEL_SLOTS_BITS * level)) % SHF_WHEEL_SLOTS;
+    wheel->node[node].next   = wheel->slot[level][slot];
+    wheel->slot[level][slot] = node;
+} /* shf_wheel_insert() */
+
+static uint32_t /* number of keys deleted */
+shf_wheel_reap( /* fire slots up to second now & delete the keys which expired; win writer lock must be held */
+    SHF            * shf  ,
+    uint32_t         win  ,
+    SHF_WHEEL_MMAP * wheel,
+    uint32_t         now  )
+{
+    uint32_t keys_deleted = 0;
+    while (wheel->now < now) {
+        if (0 == wheel->nodes_used) {
+            wheel->now = now; /* nothing can fire; skip ahead */
+            break;
+        }
+        uint32_t second = wheel->now + 1;
+        for (uint32_t level = SHF_WHEEL_LEVELS - 1; level > 0; level --) {
+            if (0 == (second % (1U << (SHF_WHEEL_SLOTS_BITS * level)))) {
+                /* come here to cascade nodes from higher level slot into finer lower level slots */
+                uint32_t slot = (second >> (SHF_WHEEL_SLOTS_BITS * level)) % SHF_WHEEL_SLOTS;
+                uint32_t node = wheel->slot[level][slot];
+                wheel->slot[level][slot] = 0;
+                while (node) {
+                    uint32_t next = wheel->node[node].next;
+                    shf_wheel_insert(wheel, node);
+                    node = next;
+                }
+            }
+        }
+        uint32_t node = wheel->slot[0][second % SHF_WHEEL_SLOTS];
+        wheel->slot[0][second % SHF_WHEEL_SLOTS] = 0;
+        while (node) {
+            uint32_t next = wheel->node[node].next;
+            SHF_UID  uid;
+                     uid.as_u32 = wheel->node[node].uid;
+            uint32_t tab2       = uid.as_part.tab;
+            uint32_t row        = uid.as_part.row;
+            uint32_t ref        = uid.as_part.ref;
+            uint16_t tab        = shf->shf_mmap->wins[win].tabs[tab2].tab;
+            SHF_TAB_MMAP * tab_mmap;
+            SHF_GET_TAB_MMAP(shf, tab);
+            if ((tab_mmap->row[row].ref[ref].pos != 0   )   /* if key still exists; it may have been deleted or re-put since */
+            &&  (tab_mmap->row[row].ref[ref].tab == tab2)) {
+                if (wheel->node[node].expiry > second) {
+                    /* come here if expiry was clamped to wheel span; re-insert node instead of losing it */
+                    shf_wheel_insert(wheel, node);
+                    node = next;
+                    continue;
+                }
+                keys_deleted += shf_tab_ref_expire(shf, tab_mmap, win, row, ref, second);
+            }
+            wheel->node[node].next = wheel->nodes_free;
+            wheel->nodes_free      = node;
+            wheel->nodes_used --;
+            node = next;
+        }
+        wheel->now = second;
+    }
+    return keys_deleted;
+} /* shf_wheel_reap() */
+
+static void
+shf_cache_evict( /* CLOCK; evict keys not got since last sweep until data_needed fits win share of cache budget; win writer lock must be held */
+    SHF      * shf        ,
+    uint32_t   win        ,
+    uint64_t   data_needed)
+{
+    uint64_t data_max  = (shf->shf_mmap->cache_data_max + SHF_WINS_PER_SHF - 1) / SHF_WINS_PER_SHF;
+    uint32_t keys_max  = (shf->shf_mmap->cache_keys_max + SHF_WINS_PER_SHF - 1) / SHF_WINS_PER_SHF;
+    uint32_t refs_todo = 2 * shf->shf_mmap->wins[win].tabs_used * SHF_REFS_PER_TAB; /* 2 sweeps clear all reference bits */
+
+    while (((keys_max && (shf->shf_mmap->wins[win].keys_used + 1           > keys_max))
+    ||      (data_max && (shf->shf_mmap->wins[win].data_used + data_needed > data_max)))
+    &&     (refs_todo --)) {
+        if (shf->shf_mmap->wins[win].clock_tab >= shf->shf_mmap->wins[win].tabs_used) {
+            shf->shf_mmap->wins[win].clock_tab = 0;
+        }
+        uint16_t tab = shf->shf_mmap->wins[win].clock_tab;
+        uint32_t row = shf->shf_mmap->wins[win].clock_ref / SHF_REFS_PER_ROW;
+        uint32_t ref = shf->shf_mmap->wins[win].clock_ref % SHF_REFS_PER_ROW;
+
+        SHF_TAB_MMAP * tab_mmap;
+        SHF_GET_TAB_MMAP(shf, tab);
+
+        if (0 == tab_mmap->row[row].ref[ref].pos) {
+            /* come here if ref unused */
+        }
+        else if (shf_tab_ref_expire(shf, tab_mmap, win, row, ref, 0 /* now */)) {
+            /* come here if expired key deleted instead */
+        }
+        else if (tab_mmap->row[row].ref[ref].hit) {
+            tab_mmap->row[row].ref[ref].hit = 0; /* second chance */
+        }
+        else {
+            uint32_t len_len = shf->is_fixed_key_val_len ? 0 : sizeof(shf->fixed_key_len);
+            uint32_t pos     = tab_mmap->row[row].ref[ref].pos;
+            uint32_t key_len = 0 == len_len ? shf->fixed_key_len : SHF_U32_AT(tab_mmap, pos+1                );
+            uint32_t val_len = 0 == len_len ? shf->fixed_val_len : SHF_U32_AT(tab_mmap, pos+1+len_len+key_len);
+            SHF_DEBUG("- evicting key,value @ 0x%02x-xxx[%03x]-%03x-%x\n", win, tab, row, ref);
+            SHF_TAB_REF_MARK_AS_DELETED(tab_mmap, len_len, 1 /* link */);
+            shf->shf_mmap->wins[win].keys_evicted ++;
+        }
+
+        shf->shf_mmap->wins[win].clock_ref ++;
+        if (shf->shf_mmap->wins[win].clock_ref >= SHF_REFS_PER_TAB) {
+            shf->shf_mmap->wins[win].clock_ref = 0;
+            shf->shf_mmap->wins[win].clock_tab ++;
+        }
+    }
+} /* shf_cache_evict() */
+
+static uint32_t /* see SHF_RET_* for result meaning */
+shf_put_key_val_internal(
     SHF        * shf    ,
+    SHF_OP     * op     ,
     const char * val    , /* NULL means reserve val_len bytes */
-    uint32_t     val_len)
+    uint32_t     val_len,
+    uint32_t     expiry ) /* 0 means never expires, else second key,value expires */
 {
     uint32_t result = 0;
     SHF_UID  uid;
@@ -793,27 +1643,48 @@ shf_put_key_val(
 
     uint32_t len_len = shf->is_fixed_key_val_len ? 0 : sizeof(shf->fixed_key_len);
 
+    if (shf->is_read_only) {
+        result = SHF_RET_FROZEN;
+        goto SHF_PUT_FROZEN;
+    }
+
+    SHF_HOT_KEYS_SAMPLE(shf, op->hash.u16[0] % SHF_WINS_PER_SHF, SHF_LOCK_OP_PUT, op->hash.u64[0], op->hash_key, op->hash_key_len);
+
     SHF_NEED_NEW_TAB_AFTER_PARTING:;
 
     // todo: consider implementing maximum size for shf here
 
-    uint32_t win  = shf_hash.u16[0] %             SHF_WINS_PER_SHF       ;
-    uint32_t tab2 = shf_hash.u16[1] %             SHF_TABS_PER_WIN       ;
-    uint32_t row  = shf_hash.u16[2] %             SHF_ROWS_PER_TAB       ;
-    uint32_t rnd  = shf_hash.u32[2] % (1 << (32 - SHF_TABS_PER_WIN_BITS));
+    uint32_t win  = op->hash.u16[0] %             SHF_WINS_PER_SHF       ;
+    uint32_t tab2 = op->hash.u16[1] %             SHF_TABS_PER_WIN       ;
+    uint32_t row  = op->hash.u16[2] %             SHF_ROWS_PER_TAB       ;
+    uint32_t rnd  = op->hash.u32[2] % (1 << SHF_REF_RND_BITS);
 
-    if (shf->is_lockable) { SHF_LOCK_WRITER(&shf->shf_mmap->wins[win].lock); }
+    uint64_t lock_tsc = shf_lock_times_start(shf);
+    if (shf->is_lockable) { SHF_WIN_LOCK_WRITER(win, tab2, row); }
+    uint64_t hold_tsc = lock_tsc ? shf_rdtsc() : 0;
     SHF_LOCK_DEBUG_LINE(&shf->shf_mmap->wins[win].lock);
 
-    uint16_t tab = shf->shf_mmap->wins[win].tabs[tab2].tab;
+    if (shf->shf_mmap->is_frozen) { /* checked after lock because shf_freeze() holds all win locks while freezing */
+        if (shf->is_lockable) { SHF_WIN_UNLOCK_WRITER(win, tab2, row); }
+        result = SHF_RET_FROZEN;
+        goto SHF_PUT_FROZEN;
+    }
+
+    if (shf->shf_mmap->cache_keys_max || shf->shf_mmap->cache_data_max) {
+        shf_cache_evict(shf, win, sizeof(SHF_DATA_TYPE) + len_len + op->hash_key_len + len_len + val_len + (expiry ? sizeof(uint32_t) : 0));
+    }
+
+    uint16_t tab     = shf->shf_mmap->wins[win].tabs[tab2].tab;
+    uint32_t has_ttl = shf->shf_mmap->wins[win].wheel_size; /* any keys put with ttl in win? */
 
     SHF_TAB_MMAP * tab_mmap;
     SHF_GET_TAB_MMAP(shf, tab);
     SHF_LOCK_DEBUG_LINE(&shf->shf_mmap->wins[win].lock);
 
     for (uint32_t ref = 0; ref < SHF_REFS_PER_ROW; ref ++) {
-        if (tab_mmap->row[row].ref[ref].pos) {
-            /* row used */
+        if ((tab_mmap->row[row].ref[ref].pos)
+        &&  ((0 == has_ttl) || (0 == shf_tab_ref_expire(shf, tab_mmap, win, row, ref, 0 /* now */)))) {
+            /* row used; by key,value which has not expired */
         }
         else {
             uid.as_part.win = win;
@@ -822,11 +1693,12 @@ shf_put_key_val(
             uid.as_part.ref = ref;
             uint32_t pos = tab_mmap->tab_used;
             SHF_LOCK_DEBUG_LINE(&shf->shf_mmap->wins[win].lock);
-            SHF_TAB_APPEND(shf, tab, tab_mmap, len_len, shf_hash_key, shf_hash_key_len, pos);
+            SHF_TAB_APPEND(shf, tab, tab_mmap, len_len, op->hash_key, op->hash_key_len, pos, expiry);
             SHF_LOCK_DEBUG_LINE(&shf->shf_mmap->wins[win].lock);
             tab_mmap->row[row].ref[ref].pos = pos;
             tab_mmap->row[row].ref[ref].tab = tab2;
             tab_mmap->row[row].ref[ref].rnd = rnd;
+            tab_mmap->row[row].ref[ref].hit = 1; /* new key gets a second chance from CLOCK */
             goto SHF_SKIP_ROW_FULL_CHECK;
         }
     }
@@ -835,11 +1707,23 @@ shf_put_key_val(
     SHF_LOCK_DEBUG_LINE(&shf->shf_mmap->wins[win].lock);
     shf_tab_part(shf, win, tab);
     SHF_LOCK_DEBUG_LINE(&shf->shf_mmap->wins[win].lock);
-    if (shf->is_lockable) { SHF_UNLOCK_WRITER(&shf->shf_mmap->wins[win].lock); }
+    if (shf->is_lockable) { SHF_WIN_UNLOCK_WRITER(win, tab2, row); }
+    if (lock_tsc) { shf_lock_times_add(shf, win, SHF_LOCK_OP_PUT, lock_tsc, hold_tsc); }
     goto SHF_NEED_NEW_TAB_AFTER_PARTING;
 
     SHF_SKIP_ROW_FULL_CHECK:;
 
+    if (expiry) {
+        SHF_WHEEL_MMAP * wheel = shf_wheel_get(shf, win, 1 /* need node */);
+        uint32_t         node;
+        if (wheel->nodes_free) { node = wheel->nodes_free; wheel->nodes_free = wheel->node[node].next; } /* reuse fired node */
+        else                   { node = ++ wheel->nodes_made;                                         }
+        wheel->node[node].uid    = uid.as_u32;
+        wheel->node[node].expiry = expiry;
+        shf_wheel_insert(wheel, node);
+        wheel->nodes_used ++;
+    }
+
     if (tab_mmap->tab_data_free > (tab_mmap->tab_data_used * 20 / 100)) {
         SHF_DEBUG_FILE("pid %5u, win-tab %u-%u: shrink after put\n", getpid(), win, tab);
         SHF_LOCK_DEBUG_LINE(&shf->shf_mmap->wins[win].lock);
@@ -847,15 +1731,68 @@ shf_put_key_val(
         SHF_LOCK_DEBUG_LINE(&shf->shf_mmap->wins[win].lock);
     }
 
-    if (shf->is_lockable) { SHF_UNLOCK_WRITER(&shf->shf_mmap->wins[win].lock); }
+    if (shf->is_lockable) { SHF_WIN_UNLOCK_WRITER(win, tab2, row); }
+    if (lock_tsc) { shf_lock_times_add(shf, win, SHF_LOCK_OP_PUT, lock_tsc, hold_tsc); }
 
-    shf_uid = uid.as_u32;
     result = SHF_RET_KEY_PUT;
 
-    SHF_DEBUG("%s(shf=?, val=?, val_len=%u){} // return %u=%s;  0x%08x=%02x-%03x-%03x-%01x\n", __FUNCTION__, val_len, result, result & SHF_RET_KEY_PUT ? "SHF_RET_KEY_PUT" : "failure", uid.as_u32, uid.as_part.win, uid.as_part.tab, uid.as_part.row, uid.as_part.ref);
+    SHF_PUT_FROZEN:;
+    op->uid = uid.as_u32;
+
+    SHF_DEBUG("%s(shf=?, val=?, val_len=%u, expiry=%u){} // return %u=%s;  0x%08x=%02x-%03x-%03x-%01x\n", __FUNCTION__, val_len, expiry, result, result & SHF_RET_KEY_PUT ? "SHF_RET_KEY_PUT" : "failure", uid.as_u32, uid.as_part.win, uid.as_part.tab, uid.as_part.row, uid.as_part.ref);
 
     return result;
-} /* shf_put_key_val() */
+} /* shf_put_key_val_internal() */
+
+uint32_t shf_put_key_val    (SHF * shf, const char * val, uint32_t val_len              ) { SHF_OP op; shf_op_legacy_in(&op, 0); uint32_t result = shf_put_key_val_internal(shf, &op, val, val_len, 0                                     ); shf_op_legacy_out(&op, 0); return result; }
+uint32_t shf_put_key_val_ttl(SHF * shf, const char * val, uint32_t val_len, uint32_t ttl) { SHF_OP op; shf_op_legacy_in(&op, 0); uint32_t result = shf_put_key_val_internal(shf, &op, val, val_len, SHF_CAST(uint32_t, time(NULL)) + ttl); shf_op_legacy_out(&op, 0); return result; } /* key,value treated as missing after ttl seconds */
+
+uint32_t /* number of keys with expired ttl deleted */
+shf_ttl_reap( /* advance the ttl timer wheel of each win to now; cost is O(expired) not O(keys); call periodically from e.g. a background thread */
+    SHF * shf)
+{
+    SHF_ASSERT_INTERNAL(shf, "ERROR: shf must not be NULL; have you called shf_attach(_existing)()?");
+
+    uint32_t keys_deleted = 0;
+    uint32_t now          = time(NULL);
+    for (uint32_t win = 0; win < SHF_WINS_PER_SHF; win ++) {
+        if ((0 == shf->shf_mmap->wins[win].wheel_size)
+        ||  (shf->is_read_only || shf->shf_mmap->is_frozen)) {
+            continue; /* no key with ttl put in win yet, or frozen; expired keys are still treated as missing */
+        }
+        if (shf->is_lockable) { SHF_WIN_LOCK_WRITER(win, SHF_PROBE_NONE, SHF_PROBE_NONE); }
+        SHF_LOCK_DEBUG_LINE(&shf->shf_mmap->wins[win].lock);
+        SHF_WHEEL_MMAP * wheel = shf_wheel_get(shf, win, 0 /* no need node */);
+        keys_deleted += shf_wheel_reap(shf, win, wheel, now);
+        SHF_LOCK_DEBUG_LINE(&shf->shf_mmap->wins[win].lock);
+        if (shf->is_lockable) { SHF_WIN_UNLOCK_WRITER(win, SHF_PROBE_NONE, SHF_PROBE_NONE); }
+    }
+
+    SHF_DEBUG("%s(shf=?){} // return %u keys deleted\n", __FUNCTION__, keys_deleted);
+    return keys_deleted;
+} /* shf_ttl_reap() */
+
+void
+shf_ttl_set_reap( /* have shf.monitor call shf_ttl_reap() every reap_ms, if shf_attach() was called with delete_upon_process_exit; 0 means stop */
+    SHF      * shf    ,
+    uint32_t   reap_ms)
+{
+    SHF_ASSERT_INTERNAL(shf, "ERROR: shf must not be NULL; have you called shf_attach(_existing)()?");
+
+    shf_debug_verbosity_less();
+    shf_make_hash(SHF_CONST_STR_AND_SIZE("__ttl_reap"));
+    if      (0                 == reap_ms                  ) { shf_del_key_val(shf); } /* so no key is left behind once stopped */
+    else if (SHF_RET_KEY_FOUND == shf_get_key_val_addr(shf)) { memcpy(shf_val_addr, &reap_ms, sizeof(reap_ms)); }
+    else                                                     { shf_put_key_val(shf, SHF_CAST(const char *, &reap_ms), sizeof(reap_ms)); }
+    shf_debug_verbosity_more();
+
+    char file_reap[256]; /* shf.monitor only attaches to reap if this file exists */
+    SHF_SNPRINTF(0, file_reap, "%s/%s.shf/ttl.reap", shf->path, shf->name);
+    if (reap_ms) { int fd = open(file_reap, O_WRONLY | O_CREAT, 0600); SHF_ASSERT(-1 != fd, "open(): %u: ", errno); close(fd); }
+    else         { unlink(file_reap); }
+
+    SHF_DEBUG("%s(shf=?, reap_ms=%u){}\n", __FUNCTION__, reap_ms);
+} /* shf_ttl_set_reap() */
 
 typedef enum SHF_FIND_KEY_AND {
     SHF_FIND_KEY_OR_UID_ADDR         = 0,
@@ -863,12 +1800,61 @@ typedef enum SHF_FIND_KEY_AND {
     SHF_FIND_KEY_OR_UID_AND_COPY_VAL    ,
     SHF_FIND_KEY_OR_UID_AND_ATOM_ADD    ,
     SHF_FIND_KEY_OR_UID_AND_DELETE      ,
-    SHF_FIND_KEY_OR_UID_AND_UPDATE
+    SHF_FIND_KEY_OR_UID_AND_UPDATE      ,
+    SHF_FIND_KEY_OR_UID_AND_VISIT       ,
+    SHF_FIND_KEY_OR_UID_AND_COPY_KEY_IOV,
+    SHF_FIND_KEY_OR_UID_AND_COPY_VAL_IOV
 } SHF_FIND_KEY_AND;
 
-static uint32_t /* see SHF_RET_* for result meaning */
+static uint32_t /* SHF_RET_OK, or SHF_RET_BUF_SMALL if nothing copied */
+shf_copy_iov( /* scatter len bytes at from into op->iov */
+    const SHF_OP   * op  ,
+    const void     * from,
+          uint32_t   len )
+{
+    uint64_t iov_size = 0;
+    for (int i = 0; i < op->iov_cnt; i++) {
+        iov_size += op->iov[i].iov_len;
+    }
+    if (iov_size < len) {
+        return SHF_RET_BUF_SMALL;
+    }
+    for (int i = 0; len > 0; i++) {
+        uint32_t bytes = len < op->iov[i].iov_len ? len : op->iov[i].iov_len;
+        memcpy(op->iov[i].iov_base, from, bytes);
+        from  = SHF_CAST(const char *, from) + bytes;
+        len  -= bytes;
+    }
+    return SHF_RET_OK;
+} /* shf_copy_iov() */
+
+static uint32_t /* 1 if key,value expired & should be treated as missing, else 0 */
+shf_find_key_expired( /* if expired & caller holds writer lock then also lazily delete key,value */
+    SHF          * shf      ,
+    SHF_TAB_MMAP * tab_mmap ,
+    uint32_t       win      ,
+    uint32_t       row      ,
+    uint32_t       ref      ,
+    uint32_t       pos      ,
+    uint32_t       len_len  ,
+    uint32_t       key_len  ,
+    uint32_t       val_len  ,
+    uint32_t       is_reader)
+{
+    uint32_t expiry = shf_tab_ref_expiry(tab_mmap, pos, len_len, key_len, val_len);
+    if ((0 == expiry) || (SHF_CAST(uint32_t, time(NULL)) < expiry)) {
+        return 0;
+    }
+    if (0 == is_reader) {
+        shf_tab_ref_expire(shf, tab_mmap, win, row, ref, 0 /* now */);
+    }
+    return 1;
+} /* shf_find_key_expired() */
+
+static uint32_t /* see SHF_RET_* for result meaning */
 shf_find_key_internal(
     SHF              * shf ,
+    SHF_OP           * op  ,
     uint32_t           uid ,
     SHF_FIND_KEY_AND   what)
 {
@@ -877,7 +1863,7 @@ shf_find_key_internal(
     uint32_t      win       ;
     uint32_t      tab2      ;
     uint32_t      row       ;
-    uint32_t      rnd       ;
+    uint32_t      rnd    = 0; /* only used if SHF_UID_NONE == uid */
     uint16_t      tab       ;
     SHF_DATA_TYPE data_type ;
     uint32_t      ref       ;
@@ -890,10 +1876,10 @@ shf_find_key_internal(
     uint32_t len_len = shf->is_fixed_key_val_len ? 0 : sizeof(shf->fixed_key_len);
 
     if (SHF_UID_NONE == uid) {
-        win  = tmp_uid.as_part.win = shf_hash.u16[0] %             SHF_WINS_PER_SHF       ;
-        tab2 = tmp_uid.as_part.tab = shf_hash.u16[1] %             SHF_TABS_PER_WIN       ;
-        row  = tmp_uid.as_part.row = shf_hash.u16[2] %             SHF_ROWS_PER_TAB       ;
-        rnd  =                       shf_hash.u32[2] % (1 << (32 - SHF_TABS_PER_WIN_BITS));
+        win  = tmp_uid.as_part.win = op->hash.u16[0] %             SHF_WINS_PER_SHF       ;
+        tab2 = tmp_uid.as_part.tab = op->hash.u16[1] %             SHF_TABS_PER_WIN       ;
+        row  = tmp_uid.as_part.row = op->hash.u16[2] %             SHF_ROWS_PER_TAB       ;
+        rnd  =                       op->hash.u32[2] % (1 << SHF_REF_RND_BITS);
     }
     else {
                tmp_uid.as_u32 = uid;
@@ -902,12 +1888,37 @@ shf_find_key_internal(
         row  = tmp_uid.as_part.row;
     }
 
-    if    ((SHF_FIND_KEY_OR_UID_ADDR         == what)
-    ||     (SHF_FIND_KEY_OR_UID_AND_COPY_VAL == what)
-    ||     (SHF_FIND_KEY_OR_UID_AND_ATOM_ADD == what)) { if (shf->is_lockable) { SHF_LOCK_READER(&shf->shf_mmap->wins[win].lock); }}
-    else /* SHF_FIND_KEY_OR_UID_AND_(DELETE|UPDATE) */ { if (shf->is_lockable) { SHF_LOCK_WRITER(&shf->shf_mmap->wins[win].lock); }}
+    uint32_t is_reader = (SHF_FIND_KEY_OR_UID_ADDR             == what)
+                      || (SHF_FIND_KEY_OR_UID_AND_COPY_VAL     == what)
+                      || (SHF_FIND_KEY_OR_UID_AND_ATOM_ADD     == what)
+                      || (SHF_FIND_KEY_OR_UID_AND_VISIT        == what)
+                      || (SHF_FIND_KEY_OR_UID_AND_COPY_KEY_IOV == what)
+                      || (SHF_FIND_KEY_OR_UID_AND_COPY_VAL_IOV == what);
+
+    /* frozen means no writer can change key,values, so readers need no lock, no shared counters, & no atomics */
+    uint32_t is_frozen = shf->is_read_only || shf->shf_mmap->is_frozen;
+    if (is_frozen && ((0 == is_reader) || (SHF_FIND_KEY_OR_UID_AND_ATOM_ADD == what) || shf->is_snapshot)) {
+        SHF_DEBUG("%s(shf=?){} // return SHF_RET_FROZEN\n", __FUNCTION__);
+        return SHF_RET_FROZEN;
+    }
+    uint32_t is_locking = shf->is_lockable && ! is_frozen;
+
+    SHF_LOCK_OP lock_op  = SHF_FIND_KEY_OR_UID_AND_DELETE == what ? SHF_LOCK_OP_DEL
+                         : SHF_FIND_KEY_OR_UID_AND_UPDATE == what ? SHF_LOCK_OP_PUT
+                         :                                          SHF_LOCK_OP_GET;
+    SHF_HOT_KEYS_SAMPLE(shf, win, lock_op, op->hash.u64[0], SHF_UID_NONE == uid ? op->hash_key : NULL, op->hash_key_len);
+    uint64_t    lock_tsc = (0 == is_frozen) ? shf_lock_times_start(shf) : 0;
+    if (is_reader)                                     { if (is_locking) { SHF_WIN_LOCK_READER(win, tab2, row); }}
+    else /* SHF_FIND_KEY_OR_UID_AND_(DELETE|UPDATE) */ { if (is_locking) { SHF_WIN_LOCK_WRITER(win, tab2, row); }}
+    uint64_t    hold_tsc = lock_tsc ? shf_rdtsc() : 0;
     SHF_LOCK_DEBUG_LINE(&shf->shf_mmap->wins[win].lock);
 
+    if ((0 == is_reader) && shf->shf_mmap->is_frozen) { /* come here if shf_freeze() won the race for the win lock */
+        if (is_locking) { SHF_WIN_UNLOCK_WRITER(win, tab2, row); }
+        SHF_DEBUG("%s(shf=?){} // return SHF_RET_FROZEN\n", __FUNCTION__);
+        return SHF_RET_FROZEN;
+    }
+
     tab = shf->shf_mmap->wins[win].tabs[tab2].tab; /* important that this is looked up after the lock! */
 
     SHF_TAB_MMAP * tab_mmap;
@@ -915,7 +1926,7 @@ shf_find_key_internal(
     SHF_LOCK_DEBUG_LINE(&shf->shf_mmap->wins[win].lock);
 
     if (SHF_UID_NONE == uid) {
-        shf_uid = SHF_UID_NONE;
+        op->uid = SHF_UID_NONE;
         for (ref = 0; ref < SHF_REFS_PER_ROW; ref ++) { /* search for ref in row */
             if ((tab_mmap->row[row].ref[ref].pos != 0   ) /* if ref in row is valid looking key... */
             &&  (tab_mmap->row[row].ref[ref].rnd == rnd )
@@ -927,14 +1938,15 @@ shf_find_key_internal(
                 else              { key_len = SHF_U32_AT(tab_mmap, pos+1); val_len =  SHF_U32_AT(tab_mmap, pos+1+len_len+key_len); }
                 SHF_ASSERT(pos+1+len_len+key_len                 <= tab_mmap->tab_size, "INTERNAL: expected key < %u but pos is %u at win %u, tab %u; pos %u, len_len %u, key_len %u, val_len %u\n", tab_mmap->tab_size, pos+1+len_len+key_len                , win, tab, pos, len_len, key_len, val_len);
                 SHF_ASSERT(pos+1+len_len+key_len+len_len+val_len <= tab_mmap->tab_size, "INTERNAL: expected val < %u but pos is %u at win %u, tab %u; pos %u, len_len %u, key_len %u, val_len %u\n", tab_mmap->tab_size, pos+1+len_len+key_len+len_len+val_len, win, tab, pos, len_len, key_len, val_len);
-                shf_key_addr = &SHF_U08_AT(tab_mmap, pos+1+len_len                );
-                shf_val_addr = &SHF_U08_AT(tab_mmap, pos+1+len_len+key_len+len_len);
+                op->key_addr = &SHF_U08_AT(tab_mmap, pos+1+len_len                );
+                op->val_addr = &SHF_U08_AT(tab_mmap, pos+1+len_len+key_len+len_len);
                 SHF_UNUSE(data_type); // todo: remove hard coding of types
-                if (key_len != shf_hash_key_len                                                   ) { shf->shf_mmap->wins[win].keylen_misses ++; continue; }
-                if (0       != SHF_CMP_AT(tab_mmap, pos+1+len_len, shf_hash_key_len, shf_hash_key)) { shf->shf_mmap->wins[win].memcmp_misses ++; continue; }
+                if (key_len != op->hash_key_len                                                   ) { if (0 == is_frozen) { shf->shf_mmap->wins[win].keylen_misses ++; } continue; }
+                if (0       == SHF_KEY_IS_EQUAL(shf, op->key_addr, op->hash_key, key_len)  ) { if (0 == is_frozen) { shf->shf_mmap->wins[win].memcmp_misses ++; } continue; }
+                if (shf_find_key_expired(shf, tab_mmap, win, row, ref, pos, len_len, key_len, val_len, is_reader)) { continue; }
                 result = SHF_RET_KEY_FOUND;
                 tmp_uid.as_part.ref = ref;
-                shf_uid = tmp_uid.as_u32;
+                op->uid = tmp_uid.as_u32;
                 goto SHF_FOUND_KEY;
             }
         }
@@ -950,33 +1962,42 @@ shf_find_key_internal(
             else              { key_len = SHF_U32_AT(tab_mmap, pos+1); val_len =  SHF_U32_AT(tab_mmap, pos+1+len_len+key_len); }
             SHF_ASSERT(pos+1+len_len+key_len                 <= tab_mmap->tab_size, "INTERNAL: expected key < %u but pos is %u at win %u, tab %u; pos %u, len_len %u, key_len %u, val_len %u\n", tab_mmap->tab_size, pos+1+len_len+key_len                , win, tab, pos, len_len, key_len, val_len);
             SHF_ASSERT(pos+1+len_len+key_len+len_len+val_len <= tab_mmap->tab_size, "INTERNAL: expected val < %u but pos is %u at win %u, tab %u; pos %u, len_len %u, key_len %u, val_len %u\n", tab_mmap->tab_size, pos+1+len_len+key_len+len_len+val_len, win, tab, pos, len_len, key_len, val_len);
-            shf_key_addr = &SHF_U08_AT(tab_mmap, pos+1+len_len                );
-            shf_val_addr = &SHF_U08_AT(tab_mmap, pos+1+len_len+key_len+len_len);
+            op->key_addr = &SHF_U08_AT(tab_mmap, pos+1+len_len                );
+            op->val_addr = &SHF_U08_AT(tab_mmap, pos+1+len_len+key_len+len_len);
             SHF_UNUSE(data_type); // todo: remove hard coding of types
-            result = SHF_RET_KEY_FOUND;
-            goto SHF_FOUND_KEY;
+            if (0 == shf_find_key_expired(shf, tab_mmap, win, row, ref, pos, len_len, key_len, val_len, is_reader)) {
+                result = SHF_RET_KEY_FOUND;
+                goto SHF_FOUND_KEY;
+            }
         }
     }
 
-    shf_val_addr = NULL            ;
+    op->val_addr = NULL            ;
     result       = SHF_RET_KEY_NONE;
+    SHF_PROBE(row_miss, win, SHF_CAST(uint32_t, tab), row); /* args: win, tab, row */
 
     if (SHF_RET_KEY_FOUND == result) {
         SHF_FOUND_KEY:;
+        SHF_PROBE(row_hit, win, SHF_CAST(uint32_t, tab), row, ref, key_len, val_len); /* args: win, tab, row, ref, key bytes, val bytes */
 
         SHF_DEBUG("- found %lu bytes for key @ 0x%02x-%03x[%03x]-%03x-%x // key,value are %u,%u bytes @ pos %u\n", sizeof(SHF_DATA_TYPE) + len_len + key_len + len_len + val_len, win, tab2, tab, row, ref, key_len, val_len, pos);
+        if ((shf->shf_mmap->cache_keys_max || shf->shf_mmap->cache_data_max)
+        &&  (0 == tab_mmap->row[row].ref[ref].hit)
+        &&  (0 == is_frozen)) {
+            tab_mmap->row[row].ref[ref].hit = 1; /* racing readers only ever set the bit; writers are excluded by the lock */
+        }
         switch (what) {
         case SHF_FIND_KEY_OR_UID_ADDR:
             /* nothing to do here! */
             break;
         case SHF_FIND_KEY_OR_UID_AND_COPY_KEY:
-            shf_copy_key(key_len);
+            if (SHF_FIXED_SHAPE_NONE == shf->fixed_shape) { shf_op_copy_key(op, key_len, memcpy); } else { shf_op_copy_key(op, key_len, shf->key_cpy); } /* inlined memcpy() unless fixed shape */
             goto SHF_CONSIDER_TAB_SHRINK;
         case SHF_FIND_KEY_OR_UID_AND_COPY_VAL:
-            shf_copy_val(val_len);
+            if (SHF_FIXED_SHAPE_NONE == shf->fixed_shape) { shf_op_copy_val(op, val_len, memcpy); } else { shf_op_copy_val(op, val_len, shf->val_cpy); }
 
             SHF_CONSIDER_TAB_SHRINK:;
-            if (tab_mmap->tab_data_free > (tab_mmap->tab_data_used / 4)) { // todo: allow flexibility WRT how garbage collection gets triggered
+            if ((tab_mmap->tab_data_free > (tab_mmap->tab_data_used / 4)) && (0 == is_frozen)) { // todo: allow flexibility WRT how garbage collection gets triggered
                 SHF_DEBUG_FILE("pid %5u, win-tab %u-%u: shrink after get\n", getpid(), win, tab);
                 SHF_LOCK_DEBUG_LINE(&shf->shf_mmap->wins[win].lock);
                 shf_tab_shrink(shf, win, tab);
@@ -984,63 +2005,268 @@ shf_find_key_internal(
             }
             break;
         case SHF_FIND_KEY_OR_UID_AND_ATOM_ADD:
-            if (val_len >= sizeof(long)) {
-                shf_val_long = InterlockedExchangeAdd(SHF_CAST(long volatile *, shf_val_addr), shf_val_long);
+            if (val_len >= op->val_offset + sizeof(long)) {
+                op->val_long = InterlockedExchangeAdd(SHF_CAST(long volatile *, SHF_CAST(char *, op->val_addr) + op->val_offset), op->val_long);
             }
             else {
                 result |= SHF_RET_BAD_VAL; /* flag in result: atomic add failed */
             }
             break;
         case SHF_FIND_KEY_OR_UID_AND_DELETE:
-            if (shf_ttl) {
+            if (op->ttl) {
                 /* come here want to conditionally delete */
-                if (shf_ttl != SHF_U32_AT(shf_val_addr, 0)) {
+                if (op->ttl != SHF_U32_AT(op->val_addr, 0)) {
                     /* come here if conditionally deleting *and* TTL does not match */
                     result |= SHF_RET_NOT_TTL; /* flag in result: atomic del failed */
                     goto SHF_DELETE_SKIP;
                 }
                 /* come here if conditionally deleting *and* TTL matches */
-                shf_copy_val(val_len);
+                if (SHF_FIXED_SHAPE_NONE == shf->fixed_shape) { shf_op_copy_val(op, val_len, memcpy); } else { shf_op_copy_val(op, val_len, shf->val_cpy); }
             }
             SHF_LOCK_DEBUG_LINE(&shf->shf_mmap->wins[win].lock);
-            SHF_TAB_REF_MARK_AS_DELETED(tab_mmap, len_len);
+            SHF_TAB_REF_MARK_AS_DELETED(tab_mmap, len_len, 1 /* link */);
             SHF_LOCK_DEBUG_LINE(&shf->shf_mmap->wins[win].lock);
-            shf_uid = SHF_UID_NONE;
+            op->uid = SHF_UID_NONE;
 
             SHF_DELETE_SKIP:;
-            shf_ttl = 0; /* conditional delete is one shot */
+            op->ttl = 0; /* conditional delete is one shot */
             break;
         case SHF_FIND_KEY_OR_UID_AND_UPDATE:
             shf_upd_callback_failsafe ++;
             SHF_SYSLOG_ASSERT_INTERNAL(1 == shf_upd_callback_failsafe, "ERROR: %s() recursive call detected! shf_upd*() functions should never use themselves recursively!", __FUNCTION__);
-            result |= (*shf_upd_callback)(SHF_CAST(char *, shf_val_addr), val_len);
+            result |= (*shf_upd_callback)(SHF_CAST(char *, op->val_addr), val_len);
             shf_upd_callback_failsafe --;
             break;
+        case SHF_FIND_KEY_OR_UID_AND_VISIT:
+            shf_visit_callback_failsafe ++;
+            SHF_SYSLOG_ASSERT_INTERNAL(1 == shf_visit_callback_failsafe, "ERROR: %s() recursive call detected! shf_get_*_val_visit() callbacks should never call shf_*() functions because the reader lock is held!", __FUNCTION__);
+            result |= (*op->visit_cb)(SHF_CAST(const char *, op->val_addr), val_len, op->visit_ctx);
+            shf_visit_callback_failsafe --;
+            break;
+        case SHF_FIND_KEY_OR_UID_AND_COPY_KEY_IOV:
+            op->key_len  = key_len; /* length needed even if caller buffer too small */
+            result      |= shf_copy_iov(op, op->key_addr, key_len);
+            break;
+        case SHF_FIND_KEY_OR_UID_AND_COPY_VAL_IOV:
+            op->val_len  = val_len; /* length needed even if caller buffer too small */
+            result      |= shf_copy_iov(op, op->val_addr, val_len);
+            break;
         } /* switch (what) */
     } /* if (SHF_RET_KEY_FOUND == result) */
 
-    if    ((SHF_FIND_KEY_OR_UID_ADDR         == what)
-    ||     (SHF_FIND_KEY_OR_UID_AND_COPY_VAL == what)
-    ||     (SHF_FIND_KEY_OR_UID_AND_ATOM_ADD == what)) { if (shf->is_lockable) { SHF_UNLOCK_READER(&shf->shf_mmap->wins[win].lock); }}
-    else /* SHF_FIND_KEY_OR_UID_AND_(DELETE|UPDATE) */ { if (shf->is_lockable) { SHF_UNLOCK_WRITER(&shf->shf_mmap->wins[win].lock); }}
+    if (is_reader)                                     { if (is_locking) { SHF_WIN_UNLOCK_READER(win, tab2, row); }}
+    else /* SHF_FIND_KEY_OR_UID_AND_(DELETE|UPDATE) */ { if (is_locking) { SHF_WIN_UNLOCK_WRITER(win, tab2, row); }}
+    if (lock_tsc) { shf_lock_times_add(shf, win, lock_op, lock_tsc, hold_tsc); }
 
     SHF_DEBUG("%s(shf=?){} // return %u=%s%s%s%s; 0x%08x=%02x-%03x[%03x]-%03x-%01x\n", __FUNCTION__, result, result & SHF_RET_KEY_NONE ? "+SHF_RET_KEY_NONE" : "", result & SHF_RET_KEY_FOUND ? "+SHF_RET_KEY_FOUND" : "", result & SHF_RET_BAD_VAL ? "+SHF_RET_BAD_VAL" : "", result & SHF_RET_BAD_CB ? "+SHF_RET_BAD_CB" : "", tmp_uid.as_u32, tmp_uid.as_part.win, tmp_uid.as_part.tab, tab, tmp_uid.as_part.row, tmp_uid.as_part.ref);
 
     return result;
 } /* shf_find_key_internal() */
 
-uint32_t shf_get_key_val_addr(SHF * shf                        ) {                     return shf_find_key_internal(shf, SHF_UID_NONE, SHF_FIND_KEY_OR_UID_ADDR        ); } /* shf_val_addr points to 64bit address of val itself */ // todo: add shf_freeze() to make addr safer to use; disables key,val locking!
-uint32_t shf_get_uid_val_addr(SHF * shf, uint32_t uid          ) {                     return shf_find_key_internal(shf,     uid     , SHF_FIND_KEY_OR_UID_ADDR        ); } /* shf_val_addr points to 64bit address of val itself */ // todo: add shf_freeze() to make addr safer to use; disables key,val locking!
-uint32_t shf_get_key_key_copy(SHF * shf                        ) {                     return shf_find_key_internal(shf, SHF_UID_NONE, SHF_FIND_KEY_OR_UID_AND_COPY_KEY); }
-uint32_t shf_get_uid_key_copy(SHF * shf, uint32_t uid          ) {                     return shf_find_key_internal(shf,     uid     , SHF_FIND_KEY_OR_UID_AND_COPY_KEY); }
-uint32_t shf_get_key_val_copy(SHF * shf                        ) {                     return shf_find_key_internal(shf, SHF_UID_NONE, SHF_FIND_KEY_OR_UID_AND_COPY_VAL); }
-uint32_t shf_get_uid_val_copy(SHF * shf, uint32_t uid          ) {                     return shf_find_key_internal(shf,     uid     , SHF_FIND_KEY_OR_UID_AND_COPY_VAL); }
-uint32_t shf_add_key_val_atom(SHF * shf              , long add) { shf_val_long = add; return shf_find_key_internal(shf, SHF_UID_NONE, SHF_FIND_KEY_OR_UID_AND_ATOM_ADD); }
-uint32_t shf_add_uid_val_atom(SHF * shf, uint32_t uid, long add) { shf_val_long = add; return shf_find_key_internal(shf,     uid     , SHF_FIND_KEY_OR_UID_AND_ATOM_ADD); }
-uint32_t shf_del_key_val     (SHF * shf                        ) {                     return shf_find_key_internal(shf, SHF_UID_NONE, SHF_FIND_KEY_OR_UID_AND_DELETE  ); }
-uint32_t shf_del_uid_val     (SHF * shf, uint32_t uid          ) {                     return shf_find_key_internal(shf,     uid     , SHF_FIND_KEY_OR_UID_AND_DELETE  ); }
-uint32_t shf_upd_key_val     (SHF * shf                        ) {                     return shf_find_key_internal(shf, SHF_UID_NONE, SHF_FIND_KEY_OR_UID_AND_UPDATE  ); }
-uint32_t shf_upd_uid_val     (SHF * shf, uint32_t uid          ) {                     return shf_find_key_internal(shf,     uid     , SHF_FIND_KEY_OR_UID_AND_UPDATE  ); }
+static inline uint32_t /* see SHF_RET_* for result meaning */
+shf_find_key_legacy( /* run shf_find_key_internal() on __thread shf_hash, shf_uid, shf_val, etc via stack op */
+          SHF              * shf   ,
+          uint32_t           uid   ,
+          SHF_FIND_KEY_AND   what  ,
+    const struct iovec     * iov   ,
+          int                iovcnt)
+{
+    uint32_t mask;
+    switch (what) {
+    case SHF_FIND_KEY_OR_UID_AND_COPY_KEY    :
+    case SHF_FIND_KEY_OR_UID_AND_COPY_KEY_IOV: mask = SHF_OP_LEGACY_KEY                    ; break;
+    case SHF_FIND_KEY_OR_UID_AND_COPY_VAL    :
+    case SHF_FIND_KEY_OR_UID_AND_COPY_VAL_IOV: mask = SHF_OP_LEGACY_VAL                    ; break;
+    case SHF_FIND_KEY_OR_UID_AND_ATOM_ADD    : mask = SHF_OP_LEGACY_ATOM                   ; break;
+    case SHF_FIND_KEY_OR_UID_AND_DELETE      : mask = SHF_OP_LEGACY_TTL | SHF_OP_LEGACY_VAL; break; /* conditional delete copies val */
+    default                                  : mask = 0                                    ; break;
+    }
+    SHF_OP op;
+    shf_op_legacy_in(&op, mask);
+    op.iov     = iov   ;
+    op.iov_cnt = iovcnt;
+    uint32_t result = shf_find_key_internal(shf, &op, uid, what);
+    shf_op_legacy_out(&op, mask);
+    return result;
+} /* shf_find_key_legacy() */
+
+uint32_t shf_get_key_val_addr(SHF * shf                        ) {                     return shf_find_key_legacy(shf, SHF_UID_NONE, SHF_FIND_KEY_OR_UID_ADDR        , NULL, 0); } /* shf_val_addr points to 64bit address of val itself; stable while shf_read_begin() or shf_freeze() */
+uint32_t shf_get_uid_val_addr(SHF * shf, uint32_t uid          ) {                     return shf_find_key_legacy(shf,     uid     , SHF_FIND_KEY_OR_UID_ADDR        , NULL, 0); } /* shf_val_addr points to 64bit address of val itself; stable while shf_read_begin() or shf_freeze() */
+uint32_t shf_get_key_key_copy(SHF * shf                        ) {                     return shf_find_key_legacy(shf, SHF_UID_NONE, SHF_FIND_KEY_OR_UID_AND_COPY_KEY, NULL, 0); }
+uint32_t shf_get_uid_key_copy(SHF * shf, uint32_t uid          ) {                     return shf_find_key_legacy(shf,     uid     , SHF_FIND_KEY_OR_UID_AND_COPY_KEY, NULL, 0); }
+uint32_t shf_get_key_val_copy(SHF * shf                        ) {                     return shf_find_key_legacy(shf, SHF_UID_NONE, SHF_FIND_KEY_OR_UID_AND_COPY_VAL, NULL, 0); }
+uint32_t shf_get_uid_val_copy(SHF * shf, uint32_t uid          ) {                     return shf_find_key_legacy(shf,     uid     , SHF_FIND_KEY_OR_UID_AND_COPY_VAL, NULL, 0); }
+uint32_t shf_add_key_val_atom(SHF * shf              , long add) { shf_val_long = add; return shf_find_key_legacy(shf, SHF_UID_NONE, SHF_FIND_KEY_OR_UID_AND_ATOM_ADD, NULL, 0); }
+uint32_t shf_add_uid_val_atom(SHF * shf, uint32_t uid, long add) { shf_val_long = add; return shf_find_key_legacy(shf,     uid     , SHF_FIND_KEY_OR_UID_AND_ATOM_ADD, NULL, 0); }
+uint32_t shf_del_key_val     (SHF * shf                        ) {                     return shf_find_key_legacy(shf, SHF_UID_NONE, SHF_FIND_KEY_OR_UID_AND_DELETE  , NULL, 0); }
+uint32_t shf_del_uid_val     (SHF * shf, uint32_t uid          ) {                     return shf_find_key_legacy(shf,     uid     , SHF_FIND_KEY_OR_UID_AND_DELETE  , NULL, 0); }
+uint32_t shf_upd_key_val     (SHF * shf                        ) {                     return shf_find_key_legacy(shf, SHF_UID_NONE, SHF_FIND_KEY_OR_UID_AND_UPDATE  , NULL, 0); }
+uint32_t shf_upd_uid_val     (SHF * shf, uint32_t uid          ) {                     return shf_find_key_legacy(shf,     uid     , SHF_FIND_KEY_OR_UID_AND_UPDATE  , NULL, 0); }
+
+uint32_t shf_get_key_key_copy_iov(SHF * shf              , const struct iovec * iov, int iovcnt) { return shf_find_key_legacy(shf, SHF_UID_NONE, SHF_FIND_KEY_OR_UID_AND_COPY_KEY_IOV, iov, iovcnt); } /* copy key into caller iov; shf_key_len always set */
+uint32_t shf_get_uid_key_copy_iov(SHF * shf, uint32_t uid, const struct iovec * iov, int iovcnt) { return shf_find_key_legacy(shf,     uid     , SHF_FIND_KEY_OR_UID_AND_COPY_KEY_IOV, iov, iovcnt); } /* copy key into caller iov; shf_key_len always set */
+uint32_t shf_get_key_val_copy_iov(SHF * shf              , const struct iovec * iov, int iovcnt) { return shf_find_key_legacy(shf, SHF_UID_NONE, SHF_FIND_KEY_OR_UID_AND_COPY_VAL_IOV, iov, iovcnt); } /* copy val into caller iov; shf_val_len always set */
+uint32_t shf_get_uid_val_copy_iov(SHF * shf, uint32_t uid, const struct iovec * iov, int iovcnt) { return shf_find_key_legacy(shf,     uid     , SHF_FIND_KEY_OR_UID_AND_COPY_VAL_IOV, iov, iovcnt); } /* copy val into caller iov; shf_val_len always set */
+uint32_t shf_get_key_key_copy_buf(SHF * shf              , char * buf, uint32_t buf_size) { struct iovec iov = { buf, buf_size }; return shf_get_key_key_copy_iov(shf,      &iov, 1); }
+uint32_t shf_get_uid_key_copy_buf(SHF * shf, uint32_t uid, char * buf, uint32_t buf_size) { struct iovec iov = { buf, buf_size }; return shf_get_uid_key_copy_iov(shf, uid, &iov, 1); }
+uint32_t shf_get_key_val_copy_buf(SHF * shf              , char * buf, uint32_t buf_size) { struct iovec iov = { buf, buf_size }; return shf_get_key_val_copy_iov(shf,      &iov, 1); }
+uint32_t shf_get_uid_val_copy_buf(SHF * shf, uint32_t uid, char * buf, uint32_t buf_size) { struct iovec iov = { buf, buf_size }; return shf_get_uid_val_copy_iov(shf, uid, &iov, 1); }
+
+uint32_t /* see SHF_RET_* for result meaning; callback result is ORed in */
+shf_get_key_val_visit( /* call cb() with val in place under the reader lock; no copy */
+    SHF        * shf,
+    uint32_t  (* cb)(const char * val, uint32_t val_len, void * ctx),
+    void       * ctx)
+{
+    SHF_ASSERT_INTERNAL(cb, "ERROR: cb must not be NULL");
+    SHF_OP op;
+    shf_op_legacy_in(&op, 0);
+    op.visit_cb  = cb ;
+    op.visit_ctx = ctx;
+    uint32_t result = shf_find_key_internal(shf, &op, SHF_UID_NONE, SHF_FIND_KEY_OR_UID_AND_VISIT);
+    shf_op_legacy_out(&op, 0);
+    return result;
+} /* shf_get_key_val_visit() */
+
+uint32_t /* see SHF_RET_* for result meaning; callback result is ORed in */
+shf_get_uid_val_visit( /* call cb() with val in place under the reader lock; no copy */
+    SHF        * shf,
+    uint32_t     uid,
+    uint32_t  (* cb)(const char * val, uint32_t val_len, void * ctx),
+    void       * ctx)
+{
+    SHF_ASSERT_INTERNAL(cb, "ERROR: cb must not be NULL");
+    SHF_OP op;
+    shf_op_legacy_in(&op, 0);
+    op.visit_cb  = cb ;
+    op.visit_ctx = ctx;
+    uint32_t result = shf_find_key_internal(shf, &op, uid, SHF_FIND_KEY_OR_UID_AND_VISIT);
+    shf_op_legacy_out(&op, 0);
+    return result;
+} /* shf_get_uid_val_visit() */
+
+/* reentrant versions of the above; results in op instead of __thread globals, & op->hash made by shf_op_hash() or shf_op_hash_set() */
+uint32_t shf_op_put       (SHF * shf, SHF_OP * op, const char * val, uint32_t val_len              ) { return shf_put_key_val_internal(shf, op, val, val_len, 0                                     ); }
+uint32_t shf_op_put_ttl   (SHF * shf, SHF_OP * op, const char * val, uint32_t val_len, uint32_t ttl) { return shf_put_key_val_internal(shf, op, val, val_len, SHF_CAST(uint32_t, time(NULL)) + ttl); }
+uint32_t shf_op_get       (SHF * shf, SHF_OP * op                                                  ) { return shf_find_key_internal(shf, op, SHF_UID_NONE, SHF_FIND_KEY_OR_UID_AND_COPY_VAL); } /* copy val into op->val */
+uint32_t shf_op_get_uid   (SHF * shf, SHF_OP * op, uint32_t uid                                    ) { return shf_find_key_internal(shf, op,     uid     , SHF_FIND_KEY_OR_UID_AND_COPY_VAL); } /* copy val into op->val */
+uint32_t shf_op_get_addr  (SHF * shf, SHF_OP * op                                                  ) { return shf_find_key_internal(shf, op, SHF_UID_NONE, SHF_FIND_KEY_OR_UID_ADDR        ); } /* op->val_addr stable while shf_read_begin() or shf_freeze() */
+uint32_t shf_op_get_buf   (SHF * shf, SHF_OP * op, char * buf, uint32_t buf_size                   ) { struct iovec iov = { buf, buf_size }; op->iov = &iov; op->iov_cnt = 1; uint32_t result = shf_find_key_internal(shf, op, SHF_UID_NONE, SHF_FIND_KEY_OR_UID_AND_COPY_VAL_IOV); op->iov = NULL; return result; } /* copy val into caller buf; op->val_len always set */
+uint32_t shf_op_add_atom  (SHF * shf, SHF_OP * op, long add                                        ) { op->val_long = add; op->val_offset = 0         ; return shf_find_key_internal(shf, op, SHF_UID_NONE, SHF_FIND_KEY_OR_UID_AND_ATOM_ADD); }
+uint32_t shf_op_add_atom_at(SHF * shf, SHF_OP * op, uint32_t val_offset, long add                  ) { op->val_long = add; op->val_offset = val_offset; return shf_find_key_internal(shf, op, SHF_UID_NONE, SHF_FIND_KEY_OR_UID_AND_ATOM_ADD); } /* add to long at val_offset in value, e.g. a counter field in a struct */
+uint32_t shf_op_del       (SHF * shf, SHF_OP * op                                                  ) { return shf_find_key_internal(shf, op, SHF_UID_NONE, SHF_FIND_KEY_OR_UID_AND_DELETE  ); }
+uint32_t shf_op_del_uid   (SHF * shf, SHF_OP * op, uint32_t uid                                    ) { return shf_find_key_internal(shf, op,     uid     , SHF_FIND_KEY_OR_UID_AND_DELETE  ); }
+
+uint32_t /* next SHF_PREFETCH_* step, or SHF_PREFETCH_DONE */
+shf_op_prefetch( /* prefetch one step of the lookup path for op->hash without locking, so many lookups can be interleaved to hide memory latency */
+    SHF      * shf ,
+    SHF_OP   * op  ,
+    uint32_t   step) /* SHF_PREFETCH_WIN to start; call between shf_read_begin() & shf_read_end() so tabs stay mapped */
+{
+    uint32_t       win  = op->hash.u16[0] % SHF_WINS_PER_SHF;
+    uint32_t       tab2 = op->hash.u16[1] % SHF_TABS_PER_WIN;
+    uint32_t       row  = op->hash.u16[2] % SHF_ROWS_PER_TAB;
+    uint32_t       rnd  = op->hash.u32[2] % (1 << SHF_REF_RND_BITS);
+    SHF_TAB_MMAP * tab_mmap;
+
+    switch (step) {
+    case SHF_PREFETCH_WIN:
+        __builtin_prefetch(&shf->shf_mmap->wins[win].lock                                                                     );
+        __builtin_prefetch(&SHF_U08_AT(&shf->shf_mmap->wins[win], offsetof(SHF_WIN_MMAP, tabs) + tab2 * sizeof(SHF_OFF_MMAP)));
+        return SHF_PREFETCH_ROW;
+    case SHF_PREFETCH_ROW:
+        tab_mmap = shf->tabs[win][shf->shf_mmap->wins[win].tabs[tab2].tab].tab_mmap; /* unlocked hint; lookup checks again under lock */
+        if (NULL == tab_mmap) { return SHF_PREFETCH_DONE; } /* lookup will mmap() tab */
+        __builtin_prefetch(&SHF_U08_AT(tab_mmap, offsetof(SHF_TAB_MMAP, row) + row * SHF_SIZE_ROW                      ));
+        __builtin_prefetch(&SHF_U08_AT(tab_mmap, offsetof(SHF_TAB_MMAP, row) + row * SHF_SIZE_ROW + SHF_SIZE_CACHE_LINE));
+        return SHF_PREFETCH_DATA;
+    case SHF_PREFETCH_DATA:
+        tab_mmap = shf->tabs[win][shf->shf_mmap->wins[win].tabs[tab2].tab].tab_mmap;
+        if (NULL == tab_mmap) { return SHF_PREFETCH_DONE; }
+        for (uint32_t ref = 0; ref < SHF_REFS_PER_ROW; ref ++) {
+            uint32_t pos = tab_mmap->row[row].ref[ref].pos;
+            if ((pos != 0) && (pos < tab_mmap->tab_size) && (tab_mmap->row[row].ref[ref].rnd == rnd) && (tab_mmap->row[row].ref[ref].tab == tab2)) {
+                __builtin_prefetch(&SHF_U08_AT(tab_mmap, pos));
+            }
+        }
+        return SHF_PREFETCH_DONE;
+    }
+    return SHF_PREFETCH_DONE;
+} /* shf_op_prefetch() */
+
+/**
+ * @brief Start a guarded read so that addresses from shf_get_(key|uid)_val_addr() stay mapped.
+ * - Tab mmap()s retired by growing, parting, or shrinking are not munmap()ed until shf_read_end().
+ * - The value bytes may still change if another thread or process updates or deletes the key.
+ * - Calls may be nested; only the outermost shf_read_end() ends the guarded read.
+ *
+ * @param[in] shf  Attached SHF.
+ *
+ * Example usage:
+ * @code
+ * shf_read_begin(shf);
+ * if (SHF_RET_KEY_FOUND == shf_get_key_val_addr(shf)) { use(shf_val_addr); }
+ * shf_read_end(shf);
+ * @endcode
+ */
+void
+shf_read_begin(
+    SHF * shf)
+{
+    SHF_ASSERT_INTERNAL(shf, "ERROR: shf must not be NULL; have you called shf_attach(_existing)()?");
+
+    if (shf->is_read_only) {
+        shf->reader_nest ++; /* frozen tabs are never retired so no epoch needed */
+        return;
+    }
+
+    if (0 == shf->reader) {
+        /* come here to find a free or orphaned reader slot for this SHF instance */
+        pid_t pid = getpid();
+        for (uint32_t i = 0; i < SHF_READERS_MAX; i++) {
+            pid_t old_pid = shf->shf_mmap->readers[i].pid;
+            if ((0 != old_pid) && ((0 == kill(old_pid, 0)) || (ESRCH != errno))) {
+                continue; /* slot used by living process */
+            }
+            if (__sync_bool_compare_and_swap(&shf->shf_mmap->readers[i].pid, old_pid, pid)) {
+                shf->shf_mmap->readers[i].epoch = 0;
+                shf->reader = 1 + i;
+                break;
+            }
+        }
+        SHF_ASSERT(shf->reader, "ERROR: all %u reader slots in use; too many SHF instances reading at the same time?", SHF_READERS_MAX);
+    }
+
+    if (0 == shf->reader_nest) {
+        shf->shf_mmap->readers[shf->reader - 1].epoch = 1 + shf->shf_mmap->epoch;
+        __sync_synchronize();
+    }
+    shf->reader_nest ++;
+    SHF_DEBUG("%s(shf=?){} // nest %u, epoch %lu\n", __FUNCTION__, shf->reader_nest, shf->shf_mmap->readers[shf->reader - 1].epoch);
+} /* shf_read_begin() */
+
+/**
+ * @brief End a guarded read started by shf_read_begin().
+ * - Addresses from shf_get_(key|uid)_val_addr() must no longer be used afterwards.
+ * - Retired tab mmap()s no longer guarded by any reader get munmap()ed.
+ *
+ * @param[in] shf  Attached SHF.
+ */
+void
+shf_read_end(
+    SHF * shf)
+{
+    SHF_ASSERT_INTERNAL(shf, "ERROR: shf must not be NULL; have you called shf_attach(_existing)()?");
+    SHF_ASSERT_INTERNAL(shf->reader_nest > 0, "ERROR: %s() called without shf_read_begin()", __FUNCTION__);
+
+    shf->reader_nest --;
+    if (0 == shf->reader_nest && 0 == shf->is_read_only) {
+        __sync_synchronize();
+        shf->shf_mmap->readers[shf->reader - 1].epoch = 0;
+        shf_tab_reclaim(shf, 0 /* only unused */);
+    }
+    SHF_DEBUG("%s(shf=?){} // nest %u, %u retired\n", __FUNCTION__, shf->reader_nest, shf->retired_used);
+} /* shf_read_end() */
 
 uint32_t /* see SHF_RET_* for result meaning */
 shf_add_key_val(SHF * shf, long add)
@@ -1151,7 +2377,8 @@ shf_tab_copy_iterate(
     uint32_t       tabs_used;
     SHF_TAB_MMAP * tab_mmap;
 
-    if (shf->is_lockable) { SHF_LOCK_READER(&shf->shf_mmap->wins[win].lock); }
+    uint32_t is_locking = shf->is_lockable && ! shf->shf_mmap->is_frozen; /* frozen readers skip locking */
+    if (is_locking) { SHF_WIN_LOCK_READER(win, tab, SHF_PROBE_NONE); }
 
     tabs_used = shf->shf_mmap->wins[win].tabs_used;
 
@@ -1172,7 +2399,7 @@ shf_tab_copy_iterate(
     shf_tab_len = tab_mmap->tab_size;
     memcpy(shf_tab, tab_mmap, shf_tab_len); /* copy tab so that we can iterate over the keys at our leisure after the unlocking */
 
-    if (shf->is_lockable) { SHF_UNLOCK_READER(&shf->shf_mmap->wins[win].lock); }
+    if (is_locking) { SHF_WIN_UNLOCK_READER(win, tab, SHF_PROBE_NONE); }
 
     /* iterate to next win & tab */
     tab ++;
@@ -1187,6 +2414,236 @@ shf_tab_copy_iterate(
     *tab_addr = tab;
 } /* shf_tab_iterate() */
 
+SHF_ITER *
+shf_iter_new( /* cursor over all key,value pairs; use with shf_iter_next() & shf_iter_free() */
+    SHF * shf)
+{
+    SHF_ASSERT_INTERNAL(shf, "ERROR: shf must not be NULL; have you called shf_attach(_existing)()?");
+    SHF_ITER * iter = calloc(1, sizeof(SHF_ITER)); SHF_ASSERT(NULL != iter, "calloc(1, %lu): %u: ", sizeof(SHF_ITER), errno);
+    iter->shf = shf;
+    SHF_DEBUG("%s(shf=?){} // return %p\n", __FUNCTION__, iter);
+    return iter;
+} /* shf_iter_new() */
+
+static void
+shf_iter_copy_row( /* copy key,value pairs from the next used row into iter->buf under a short reader lock */
+    SHF_ITER * iter)
+{
+    SHF      * shf     = iter->shf;
+    uint32_t   len_len = shf->is_fixed_key_val_len ? 0 : sizeof(shf->fixed_key_len);
+
+    uint32_t   now     = time(NULL);
+
+    iter->buf_used = 0;
+    iter->buf_pos  = 0;
+    while ((0 == iter->buf_used) && (iter->win < SHF_WINS_PER_SHF)) {
+        uint32_t win = iter->win;
+        uint32_t tab = iter->tab;
+
+        uint32_t is_locking = shf->is_lockable && ! shf->shf_mmap->is_frozen; /* frozen readers skip locking */
+        if (is_locking) { SHF_WIN_LOCK_READER(win, tab, SHF_PROBE_NONE); }
+
+        uint32_t tabs_used = shf->shf_mmap->wins[win].tabs_used;
+
+        SHF_TAB_MMAP * tab_mmap;
+        SHF_GET_TAB_MMAP(shf, tab);
+
+        for (uint32_t row = iter->row; row < SHF_ROWS_PER_TAB; row ++) {
+            for (uint32_t ref = 0; ref < SHF_REFS_PER_ROW; ref ++) {
+                uint32_t pos = tab_mmap->row[row].ref[ref].pos;
+                if (pos) { /* if ref */
+                    uint32_t key_len = 0 == len_len ? shf->fixed_key_len : SHF_U32_AT(tab_mmap, pos+1                );
+                    uint32_t val_len = 0 == len_len ? shf->fixed_val_len : SHF_U32_AT(tab_mmap, pos+1+len_len+key_len);
+                    uint32_t expiry  = shf_tab_ref_expiry(tab_mmap, pos, len_len, key_len, val_len);
+                    if (expiry && (now >= expiry)) {
+                        continue; /* expired keys are treated as missing */
+                    }
+                    uint32_t needed  = 3 * sizeof(uint32_t) + key_len + val_len;
+                    if (iter->buf_used + needed > iter->buf_size) {
+                        iter->buf_size = SHF_MOD_PAGE(iter->buf_used + needed);
+                        iter->buf      = realloc(iter->buf, iter->buf_size); SHF_ASSERT(NULL != iter->buf, "realloc(%u): %u: ", iter->buf_size, errno);
+                    }
+                    SHF_UID uid;
+                    uid.as_part.win = win;
+                    uid.as_part.tab = tab_mmap->row[row].ref[ref].tab;
+                    uid.as_part.row = row;
+                    uid.as_part.ref = ref;
+                    SHF_U32_AT(iter->buf, iter->buf_used                       ) = uid.as_u32;
+                    SHF_U32_AT(iter->buf, iter->buf_used + 1 * sizeof(uint32_t)) = key_len   ;
+                    SHF_U32_AT(iter->buf, iter->buf_used + 2 * sizeof(uint32_t)) = val_len   ;
+                    SHF_MEM_AT(iter->buf, iter->buf_used + 3 * sizeof(uint32_t)          , key_len, &SHF_U08_AT(tab_mmap, pos+1+len_len                ));
+                    SHF_MEM_AT(iter->buf, iter->buf_used + 3 * sizeof(uint32_t) + key_len, val_len, &SHF_U08_AT(tab_mmap, pos+1+len_len+key_len+len_len));
+                    iter->buf_used += needed;
+                }
+            }
+            iter->row = row + 1;
+            if (iter->buf_used) {
+                break; /* only copy one used row at a time */
+            }
+        }
+
+        if (is_locking) { SHF_WIN_UNLOCK_READER(win, tab, SHF_PROBE_NONE); }
+
+        if (iter->row >= SHF_ROWS_PER_TAB) {
+            /* come here to iterate to next tab & maybe win */
+            iter->row = 0;
+            iter->tab ++;
+            if (iter->tab >= tabs_used) {
+                iter->tab = 0;
+                iter->win ++;
+            }
+        }
+    }
+} /* shf_iter_copy_row() */
+
+uint32_t /* SHF_RET_KEY_FOUND with iter->(uid|key|key_len|val|val_len) & shf_uid set, or SHF_RET_KEY_NONE if no more keys */
+shf_iter_next(
+    SHF_ITER * iter)
+{
+    SHF_ASSERT_INTERNAL(iter, "ERROR: iter must not be NULL; have you called shf_iter_new()?");
+
+    if (iter->buf_pos >= iter->buf_used) {
+        shf_iter_copy_row(iter);
+        if (0 == iter->buf_used) {
+            shf_uid = SHF_UID_NONE;
+            return SHF_RET_KEY_NONE;
+        }
+    }
+
+    iter->uid      = SHF_U32_AT(iter->buf, iter->buf_pos                       );
+    iter->key_len  = SHF_U32_AT(iter->buf, iter->buf_pos + 1 * sizeof(uint32_t));
+    iter->val_len  = SHF_U32_AT(iter->buf, iter->buf_pos + 2 * sizeof(uint32_t));
+    iter->key      = &iter->buf[iter->buf_pos + 3 * sizeof(uint32_t)                ];
+    iter->val      = &iter->buf[iter->buf_pos + 3 * sizeof(uint32_t) + iter->key_len];
+    iter->buf_pos += 3 * sizeof(uint32_t) + iter->key_len + iter->val_len;
+    shf_uid        = iter->uid;
+
+    return SHF_RET_KEY_FOUND;
+} /* shf_iter_next() */
+
+void
+shf_iter_free(
+    SHF_ITER * iter)
+{
+    SHF_DEBUG("%s(iter=%p){}\n", __FUNCTION__, iter);
+    if (iter) {
+        free(iter->buf);
+        free(iter);
+    }
+} /* shf_iter_free() */
+
+typedef struct SHF_SCAN_WORKER {
+    SHF        * shf                                         ; /* instance of caller; only used for attach & settings */
+    uint32_t  (* filter_cb)(const SHF_SCAN * scan, void * ctx);
+    void      (* visit_cb )(const SHF_SCAN * scan, void * ctx);
+    void       * ctx                                         ;
+    SHF_SCAN     scan                                        ;
+    pthread_t    pthread                                     ;
+} SHF_SCAN_WORKER;
+
+static void *
+shf_scan_worker( /* scan wins win_lo to win_hi via own shf instance; shf instances are not thread safe */
+    void * arg)
+{
+    SHF_SCAN_WORKER * worker   = arg;
+    SHF_SCAN        * scan     = &worker->scan;
+    SHF             * shf      = worker->shf->is_read_only ? shf_attach_existing_read_only(worker->shf->path, worker->shf->name)
+                               :                             shf_attach_existing          (worker->shf->path, worker->shf->name); SHF_ASSERT_INTERNAL(NULL != shf, "ERROR: shf_attach_existing() failed for scan thread %u", scan->thread);
+    shf->is_lockable           = worker->shf->is_lockable         ;
+    shf->is_fixed_key_val_len  = worker->shf->is_fixed_key_val_len;
+    shf->fixed_key_len         = worker->shf->fixed_key_len       ;
+    shf->fixed_val_len         = worker->shf->fixed_val_len       ;
+    shf_fixed_shape_set(shf);
+    uint32_t          len_len  = shf->is_fixed_key_val_len ? 0 : sizeof(shf->fixed_key_len);
+    uint32_t          now      = time(NULL);
+
+    SHF_DEBUG("%s(){} // thread %u scanning wins %u to %u\n", __FUNCTION__, scan->thread, scan->win_lo, scan->win_hi - 1);
+    for (uint32_t win = scan->win_lo; win < scan->win_hi; win ++) {
+        scan->win = win;
+
+        uint32_t is_locking = shf->is_lockable && ! shf->shf_mmap->is_frozen; /* frozen readers skip locking */
+        if (is_locking) { SHF_WIN_LOCK_READER(win, SHF_PROBE_NONE, SHF_PROBE_NONE); }
+
+        for (uint32_t tab = 0; tab < shf->shf_mmap->wins[win].tabs_used; tab ++) {
+            SHF_TAB_MMAP * tab_mmap;
+            SHF_GET_TAB_MMAP(shf, tab);
+            for (uint32_t row = 0; row < SHF_ROWS_PER_TAB; row ++) {
+                for (uint32_t ref = 0; ref < SHF_REFS_PER_ROW; ref ++) {
+                    uint32_t pos = tab_mmap->row[row].ref[ref].pos;
+                    if (pos) { /* if ref */
+                        SHF_UID uid;
+                        uid.as_part.win = win;
+                        uid.as_part.tab = tab_mmap->row[row].ref[ref].tab;
+                        uid.as_part.row = row;
+                        uid.as_part.ref = ref;
+                        scan->uid      = uid.as_u32;
+                        scan->key_len  = 0 == len_len ? shf->fixed_key_len : SHF_U32_AT(tab_mmap, pos+1                     );
+                        scan->val_len  = 0 == len_len ? shf->fixed_val_len : SHF_U32_AT(tab_mmap, pos+1+len_len+scan->key_len);
+                        scan->key      = SHF_CAST(const char *, &SHF_U08_AT(tab_mmap, pos+1+len_len                             ));
+                        scan->val      = SHF_CAST(const char *, &SHF_U08_AT(tab_mmap, pos+1+len_len+scan->key_len+len_len       ));
+                        uint32_t expiry = shf_tab_ref_expiry(tab_mmap, pos, len_len, scan->key_len, scan->val_len);
+                        if (expiry && (now >= expiry)) {
+                            continue; /* expired keys are treated as missing */
+                        }
+                        scan->keys_scanned ++;
+                        if (NULL == worker->filter_cb || worker->filter_cb(scan, worker->ctx)) {
+                            scan->keys_matched ++;
+                            worker->visit_cb(scan, worker->ctx);
+                        }
+                    }
+                }
+            }
+        }
+
+        if (is_locking) { SHF_WIN_UNLOCK_READER(win, SHF_PROBE_NONE, SHF_PROBE_NONE); }
+    }
+    scan->win = scan->win_hi;
+    scan->key = NULL;
+    scan->val = NULL;
+    SHF_DEBUG("%s(){} // thread %u scanned %lu keys and matched %lu keys\n", __FUNCTION__, scan->thread, scan->keys_scanned, scan->keys_matched);
+
+    shf_detach(shf);
+    return NULL;
+} /* shf_scan_worker() */
+
+uint64_t /* number of keys matched & visited */
+shf_scan_parallel( /* visit matching key,value pairs in place from nthreads threads; each thread scans a range of wins */
+    SHF      * shf                                         ,
+    uint32_t   nthreads                                    , /* 1 to 256 */
+    uint32_t(* filter_cb)(const SHF_SCAN * scan, void * ctx), /* NULL matches all keys; return non-zero to visit key */
+    void    (* visit_cb )(const SHF_SCAN * scan, void * ctx), /* called from worker thread while holding win reader lock */
+    void     * ctx                                         )
+{
+    SHF_ASSERT_INTERNAL(shf                                    , "ERROR: shf must not be NULL; have you called shf_attach(_existing)()?");
+    SHF_ASSERT_INTERNAL(nthreads > 0                           , "ERROR: nthreads must be 1 or more");
+    SHF_ASSERT_INTERNAL(visit_cb                               , "ERROR: visit_cb must not be NULL");
+    nthreads = nthreads > SHF_WINS_PER_SHF ? SHF_WINS_PER_SHF : nthreads;
+    SHF_DEBUG("%s(shf=?, nthreads=%u, filter_cb=%p, visit_cb=%p, ctx=%p){}\n", __FUNCTION__, nthreads, filter_cb, visit_cb, ctx);
+
+    SHF_SCAN_WORKER * workers = calloc(nthreads, sizeof(SHF_SCAN_WORKER)); SHF_ASSERT(NULL != workers, "calloc(%u, %lu): %u: ", nthreads, sizeof(SHF_SCAN_WORKER), errno);
+    for (uint32_t thread = 0; thread < nthreads; thread ++) {
+        workers[thread].shf          = shf      ;
+        workers[thread].filter_cb    = filter_cb;
+        workers[thread].visit_cb     = visit_cb ;
+        workers[thread].ctx          = ctx      ;
+        workers[thread].scan.thread  = thread   ;
+        workers[thread].scan.win_lo  = (thread    ) * SHF_WINS_PER_SHF / nthreads;
+        workers[thread].scan.win_hi  = (thread + 1) * SHF_WINS_PER_SHF / nthreads;
+        workers[thread].scan.win     = workers[thread].scan.win_lo;
+        errno = pthread_create(&workers[thread].pthread, NULL, shf_scan_worker, &workers[thread]); SHF_ASSERT(0 == errno, "pthread_create(): %d: ", errno);
+    }
+
+    uint64_t keys_matched = 0;
+    for (uint32_t thread = 0; thread < nthreads; thread ++) {
+        errno = pthread_join(workers[thread].pthread, NULL); SHF_ASSERT(0 == errno, "pthread_join(): %d: ", errno);
+        keys_matched += workers[thread].scan.keys_matched;
+    }
+    free(workers);
+
+    SHF_DEBUG("- return %lu // keys matched\n", keys_matched);
+    return keys_matched;
+} /* shf_scan_parallel() */
+
 uint64_t
 shf_debug_get_garbage( /* get total bytes marked as deleted aka garbage */
     SHF * shf)
@@ -1202,6 +2659,126 @@ shf_debug_get_garbage( /* get total bytes marked as deleted aka garbage */
     return all_data_free;
 } /* shf_debug_get_garbage() */
 
+static void
+shf_stats_ratios(
+    SHF_STATS_WIN * stats_win)
+{
+    uint64_t data_all = stats_win->tab_data_used + stats_win->tab_data_free;
+    stats_win->load_factor   = stats_win->refs_size ? (double) stats_win->refs_used     / stats_win->refs_size : 0;
+    stats_win->garbage_ratio = data_all             ? (double) stats_win->tab_data_free / data_all             : 0;
+} /* shf_stats_ratios() */
+
+static void
+shf_stats_tab_add(
+    SHF_TAB_MMAP  * tab_mmap ,
+    SHF_STATS_WIN * stats_win)
+{
+    stats_win->refs_used     += tab_mmap->tab_refs_used;
+    stats_win->tab_size      += tab_mmap->tab_size     ;
+    stats_win->tab_data_used += tab_mmap->tab_data_used;
+    stats_win->tab_data_free += tab_mmap->tab_data_free;
+    for (uint32_t row = 0; row < SHF_ROWS_PER_TAB; row++) {
+        uint32_t refs_used = 0;
+        for (uint32_t ref = 0; ref < SHF_REFS_PER_ROW; ref++) {
+            refs_used += tab_mmap->row[row].ref[ref].pos ? 1 : 0;
+        }
+        stats_win->row_fill[refs_used] ++;
+    }
+} /* shf_stats_tab_add() */
+
+static void
+shf_stats_tab_snapshot( /* add tab to stats via a transient PROT_READ mmap(); tabs are only grown in place & otherwise replaced, so the mapped inode stays valid */
+    SHF           * shf      ,
+    uint32_t        win      ,
+    uint32_t        tab      ,
+    SHF_STATS_WIN * stats_win)
+{
+    char file_tab[256];
+    SHF_SNPRINTF(0, file_tab, "%s/%s.shf/%03u/%04u.tab", shf->path, shf->name, win, tab);
+    int fd = open(file_tab, O_RDONLY);
+    if (-1 == fd) {
+        SHF_ASSERT(ENOENT == errno, "open(): %u: ", errno);
+        return; /* come here if tab is being replaced by shrink */
+    }
+    struct stat sb;
+    int value = fstat(fd, &sb); SHF_ASSERT(-1 != value, "fstat(): %u: ", errno);
+    if (sb.st_size >= SHF_CAST(off_t, sizeof(SHF_TAB_MMAP))) { /* else tab is being created */
+        SHF_TAB_MMAP * tab_mmap = mmap(NULL, sb.st_size, PROT_READ, MAP_SHARED | MAP_NORESERVE, fd, 0); SHF_ASSERT(MAP_FAILED != tab_mmap, "mmap(): %u: ", errno);
+        shf_stats_tab_add(tab_mmap, stats_win);
+        value = munmap(tab_mmap, sb.st_size); SHF_ASSERT(0 == value, "munmap(): %u: ", errno);
+    }
+    value = close(fd); SHF_ASSERT(-1 != value, "close(): %u: ", errno);
+} /* shf_stats_tab_snapshot() */
+
+void
+shf_stats_get( /* snapshot counters, tab memory usage, & row fill histograms for each win and in total; only reads shf */
+    SHF       * shf  ,
+    SHF_STATS * stats) /* caller allocated; filled in including version & size */
+{
+    SHF_ASSERT_INTERNAL(shf  , "ERROR: shf must not be NULL; have you called shf_attach(_existing)()?");
+    SHF_ASSERT_INTERNAL(stats, "ERROR: stats must not be NULL");
+    SHF_DEBUG("%s(shf=?, stats=?){}\n", __FUNCTION__);
+
+    memset(stats, 0, sizeof(SHF_STATS));
+    stats->version = SHF_STATS_VERSION;
+    stats->size    = sizeof(SHF_STATS);
+    stats->time    = shf_get_time_in_seconds();
+
+    for (uint32_t win = 0; win < SHF_WINS_PER_SHF; win++) {
+        SHF_WIN_MMAP  * win_mmap  = &shf->shf_mmap->wins[win];
+        SHF_STATS_WIN * stats_win = &stats->win[win];
+
+        uint32_t is_locking  = shf->is_lockable && ! shf->shf_mmap->is_frozen; /* frozen readers skip locking */
+        uint32_t is_snapshot = shf->is_snapshot && ! shf->shf_mmap->is_frozen; /* unfrozen snapshot readers skip locking & tab remapping */
+        if (is_locking) { SHF_WIN_LOCK_READER(win, SHF_PROBE_NONE, SHF_PROBE_NONE); }
+
+        stats_win->tabs_used       = win_mmap->tabs_used      ;
+        stats_win->tabs_mmaps      = win_mmap->tabs_mmaps     ;
+        stats_win->tabs_mremaps    = win_mmap->tabs_mremaps   ;
+        stats_win->tabs_shrunk     = win_mmap->tabs_shrunk    ;
+        stats_win->tabs_parted     = win_mmap->tabs_parted    ;
+        stats_win->keylen_misses   = win_mmap->keylen_misses  ;
+        stats_win->memcmp_misses   = win_mmap->memcmp_misses  ;
+        stats_win->keys_expired    = win_mmap->keys_expired   ;
+        stats_win->keys_evicted    = win_mmap->keys_evicted   ;
+        stats_win->locks_recovered = win_mmap->locks_recovered;
+        stats_win->refs_size     = win_mmap->tabs_used * SHF_REFS_PER_TAB;
+        for (uint32_t tab = 0; tab < win_mmap->tabs_used; tab++) {
+            if (is_snapshot) {
+                shf_stats_tab_snapshot(shf, win, tab, stats_win);
+                continue;
+            }
+            SHF_TAB_MMAP * tab_mmap;
+            SHF_GET_TAB_MMAP(shf, tab);
+            shf_stats_tab_add(tab_mmap, stats_win);
+        }
+
+        if (is_locking) { SHF_WIN_UNLOCK_READER(win, SHF_PROBE_NONE, SHF_PROBE_NONE); }
+
+        shf_stats_ratios(stats_win);
+
+        stats->total.tabs_used       += stats_win->tabs_used      ;
+        stats->total.tabs_mmaps      += stats_win->tabs_mmaps     ;
+        stats->total.tabs_mremaps    += stats_win->tabs_mremaps   ;
+        stats->total.tabs_shrunk     += stats_win->tabs_shrunk    ;
+        stats->total.tabs_parted     += stats_win->tabs_parted    ;
+        stats->total.keylen_misses   += stats_win->keylen_misses  ;
+        stats->total.memcmp_misses   += stats_win->memcmp_misses  ;
+        stats->total.keys_expired    += stats_win->keys_expired   ;
+        stats->total.keys_evicted    += stats_win->keys_evicted   ;
+        stats->total.locks_recovered += stats_win->locks_recovered;
+        stats->total.refs_used       += stats_win->refs_used      ;
+        stats->total.refs_size       += stats_win->refs_size      ;
+        stats->total.tab_size        += stats_win->tab_size       ;
+        stats->total.tab_data_used   += stats_win->tab_data_used  ;
+        stats->total.tab_data_free   += stats_win->tab_data_free  ;
+        for (uint32_t refs_used = 0; refs_used <= SHF_REFS_PER_ROW; refs_used++) {
+            stats->total.row_fill[refs_used] += stats_win->row_fill[refs_used];
+        }
+    }
+    shf_stats_ratios(&stats->total);
+} /* shf_stats_get() */
+
 void
 shf_set_data_need_factor(
     uint32_t data_needed_factor)
@@ -1218,9 +2795,59 @@ shf_set_is_lockable(
 {
     SHF_ASSERT_INTERNAL(shf             , "ERROR: shf must not be NULL; have you called shf_attach(_existing)()?");
     SHF_ASSERT_INTERNAL(is_lockable <= 1, "ERROR: is_lockable must be 0 or 1");
+    SHF_ASSERT_INTERNAL(0 == is_lockable || 0 == shf->is_read_only, "ERROR: shf attached read only cannot lock");
     shf->is_lockable = is_lockable;
 } /* shf_set_is_lockable() */
 
+/**
+ * @brief Freeze key,values so that readers in all processes skip locking.
+ * - Afterwards key,value put, del, update, & add fail with SHF_RET_FROZEN.
+ * - Readers take no locks, update no shared counters, & use no atomics; so gets scale with cores.
+ * - Tabs are never remapped while frozen, so shf_val_addr stays valid until shf_thaw().
+ * - Processes may then use shf_attach_existing_read_only() to mmap() PROT_READ.
+ *
+ * @param[in] shf  Attached SHF; not read only.
+ */
+void
+shf_freeze(
+    SHF * shf)
+{
+    SHF_ASSERT_INTERNAL(shf                   , "ERROR: shf must not be NULL; have you called shf_attach(_existing)()?");
+    SHF_ASSERT_INTERNAL(0 == shf->is_read_only, "ERROR: shf attached read only cannot freeze");
+    SHF_DEBUG("%s(shf=?)\n", __FUNCTION__);
+
+    /* hold all win locks so that no writer is half way through a change once frozen */
+    for (uint32_t win = 0; win < SHF_WINS_PER_SHF; win++) {
+        if (shf->is_lockable) { SHF_WIN_LOCK_WRITER(win, SHF_PROBE_NONE, SHF_PROBE_NONE); }
+        for (uint16_t tab = 0; tab < shf->shf_mmap->wins[win].tabs_used; tab++) {
+            SHF_TAB_MMAP * tab_mmap;
+            SHF_GET_TAB_MMAP(shf, tab); /* initializes never used tabs, which read only attached readers cannot */
+        }
+    }
+    shf->shf_mmap->is_frozen = 1;
+    for (uint32_t win = 0; win < SHF_WINS_PER_SHF; win++) {
+        if (shf->is_lockable) { SHF_WIN_UNLOCK_WRITER(win, SHF_PROBE_NONE, SHF_PROBE_NONE); } /* barrier; is_frozen visible before next writer */
+    }
+} /* shf_freeze() */
+
+/**
+ * @brief Thaw key,values frozen by shf_freeze() so that they can change again.
+ * - Caller must ensure no reader is still using the frozen path, e.g. read only attached processes have detached, because
+ *   frozen readers do not lock & would race with writers.
+ *
+ * @param[in] shf  Attached SHF; not read only.
+ */
+void
+shf_thaw(
+    SHF * shf)
+{
+    SHF_ASSERT_INTERNAL(shf                   , "ERROR: shf must not be NULL; have you called shf_attach(_existing)()?");
+    SHF_ASSERT_INTERNAL(0 == shf->is_read_only, "ERROR: shf attached read only cannot thaw");
+    SHF_DEBUG("%s(shf=?)\n", __FUNCTION__);
+    shf->shf_mmap->is_frozen = 0;
+    __sync_synchronize();
+} /* shf_thaw() */
+
 void
 shf_set_is_fixed_len(
     SHF      * shf,
@@ -1228,100 +2855,495 @@ shf_set_is_fixed_len(
     uint32_t   fixed_val_len)
 {
     SHF_ASSERT_INTERNAL(shf, "ERROR: shf must not be NULL; have you called shf_attach(_existing)()?");
+    SHF_DEBUG("%s(shf=?, fixed_key_len=%u, fixed_val_len=%u)\n", __FUNCTION__, fixed_key_len, fixed_val_len);
+    if (shf->shf_mmap->is_fixed_key_val_len) {
+        SHF_ASSERT_INTERNAL((fixed_key_len == shf->shf_mmap->fixed_key_len) && (fixed_val_len == shf->shf_mmap->fixed_val_len), "ERROR: shf already has fixed key,value lengths %u,%u; cannot change to %u,%u", shf->shf_mmap->fixed_key_len, shf->shf_mmap->fixed_val_len, fixed_key_len, fixed_val_len);
+    }
+    else if (0 == shf->is_read_only) {
+        shf->shf_mmap->fixed_key_len        = fixed_key_len;
+        shf->shf_mmap->fixed_val_len        = fixed_val_len;
+        __sync_synchronize(); /* lengths visible before flag; processes attaching later adopt them */
+        shf->shf_mmap->is_fixed_key_val_len = 1;
+    }
     shf->fixed_key_len        = fixed_key_len;
     shf->fixed_val_len        = fixed_val_len;
     shf->is_fixed_key_val_len = 1;
+    shf_fixed_shape_set(shf);
 } /* shf_set_is_fixed_len() */
 
-/**
- * @brief Get a set of -- already created -- queue items & queues for those items to be pulled and pushed to.
- * - Sets the thread local variable @ref shf_qiid_addr to point to the first byte of the queue items array.
- * - Sets the thread local variable @ref shf_qiid_addr_len the length in bytes of the queue items array.
- * - Normally called by `Process B`; see @ref ipc_sec.
- *
- * @param[in] shf      Attached SHF.
- * @retval    Pointer  Process specific pointer to the array of queue items.
- *
- * Example usage:
- * @code
- * char * qiid_array = shf_q_get(shf);
- * @endcode
- */
-void *
-shf_q_get(
-    SHF * shf)
+void
+shf_set_cache_budget( /* cache mode: evict keys via CLOCK instead of growing beyond budget; 0,0 means unlimited */
+    SHF      * shf     ,
+    uint64_t   data_max, /* key,value bytes; 0 means unlimited; each win gets 1/256th */
+    uint32_t   keys_max) /* keys           ; 0 means unlimited; each win gets 1/256th */
 {
-    shf_make_hash(SHF_CONST_STR_AND_SIZE("__qs"             )); SHF_ASSERT(SHF_RET_KEY_FOUND == shf_get_key_val_copy(shf), "ERROR: could not get key '%s'", "__qs"             ); shf->q.qs              = SHF_CAST(uint32_t *, shf_val)[0];
-    shf_make_hash(SHF_CONST_STR_AND_SIZE("__q_items"        )); SHF_ASSERT(SHF_RET_KEY_FOUND == shf_get_key_val_copy(shf), "ERROR: could not get key '%s'", "__q_items"        ); shf->q.q_items         = SHF_CAST(uint32_t *, shf_val)[0];
-    shf_make_hash(SHF_CONST_STR_AND_SIZE("__q_item_size"    )); SHF_ASSERT(SHF_RET_KEY_FOUND == shf_get_key_val_copy(shf), "ERROR: could not get key '%s'", "__q_item_size"    ); shf->q.q_item_size     = SHF_CAST(uint32_t *, shf_val)[0];
-    shf_make_hash(SHF_CONST_STR_AND_SIZE("__qids_nolock_max")); SHF_ASSERT(SHF_RET_KEY_FOUND == shf_get_key_val_copy(shf), "ERROR: could not get key '%s'", "__qids_nolock_max"); shf->q.qids_nolock_max = SHF_CAST(uint32_t *, shf_val)[0];
-    shf_make_hash(SHF_CONST_STR_AND_SIZE("__qids"           )); SHF_ASSERT(SHF_RET_KEY_FOUND == shf_get_key_val_addr(shf), "ERROR: could not get key '%s'", "__qids"           ); shf->q.qids            = shf_val_addr;
-    shf_make_hash(SHF_CONST_STR_AND_SIZE("__qiids"          )); SHF_ASSERT(SHF_RET_KEY_FOUND == shf_get_key_val_addr(shf), "ERROR: could not get key '%s'", "__qiids"          ); shf->q.qiids           = shf_val_addr;
-    shf_make_hash(SHF_CONST_STR_AND_SIZE("__q_lock"         )); SHF_ASSERT(SHF_RET_KEY_FOUND == shf_get_key_val_addr(shf), "ERROR: could not get key '%s'", "__q_lock"         ); shf->q.q_lock          = shf_val_addr;
-    shf_make_hash(SHF_CONST_STR_AND_SIZE("__q_items_addr"   )); SHF_ASSERT(SHF_RET_KEY_FOUND == shf_get_key_val_addr(shf), "ERROR: could not get key '%s'", "__q_items_addr"   ); shf->q.q_item_addr     = shf_val_addr;
+    SHF_ASSERT_INTERNAL(shf, "ERROR: shf must not be NULL; have you called shf_attach(_existing)()?");
+    SHF_DEBUG("%s(shf=?, data_max=%lu, keys_max=%u){}\n", __FUNCTION__, data_max, keys_max);
+    shf->shf_mmap->cache_data_max = data_max;
+    shf->shf_mmap->cache_keys_max = keys_max;
+} /* shf_set_cache_budget() */
 
-    shf_qiid_addr     = shf->q.q_item_addr                 ;
-    shf_qiid_addr_len = shf->q.q_item_size * shf->q.q_items;
+uint64_t
+shf_cache_get_evicted( /* get total keys evicted in cache mode */
+    SHF * shf)
+{
+    SHF_ASSERT_INTERNAL(shf, "ERROR: shf must not be NULL; have you called shf_attach(_existing)()?");
+    uint64_t keys_evicted = 0;
+    for (uint32_t win = 0; win < SHF_WINS_PER_SHF; win++) {
+        keys_evicted += shf->shf_mmap->wins[win].keys_evicted;
+    }
+    return keys_evicted;
+} /* shf_cache_get_evicted() */
 
-    SHF_DEBUG("%s(shf=?){} // 0x%p\n", __FUNCTION__, shf->q.q_item_addr);
+void
+shf_set_lock_times( /* sample win lock wait & hold times into histograms; affects all processes attached to shf */
+    SHF      * shf   ,
+    uint32_t   sample) /* sample 1 in sample win locks per thread on average, so shared histograms stay cheap; 0 means stop sampling; histograms are kept */
+{
+    SHF_ASSERT_INTERNAL(shf, "ERROR: shf must not be NULL; have you called shf_attach(_existing)()?");
+    SHF_DEBUG("%s(shf=?, sample=%u){}\n", __FUNCTION__, sample);
+    if (sample && NULL == shf->lock_times) {
+        shf_lock_times_map(shf, 1 /* create */);
+    }
+    shf->shf_mmap->lock_times_sample = sample;
+} /* shf_set_lock_times() */
 
-#ifdef SHF_DEBUG_VERSION
-    SHF_ASSERT(1234567 == shf->q.q_lock->debug_magic, "ERROR: INTERNAL: shf->q.q_lock->debug_magic has unexpected value %u\n", shf->q.q_lock->debug_magic);
-#endif
+const SHF_LOCK_TIMES_MMAP * /* NULL if lock times never sampled */
+shf_lock_times_get( /* get win lock wait & hold histograms; see shf_lock_times_cycles() for bucket meaning */
+    SHF * shf)
+{
+    SHF_ASSERT_INTERNAL(shf, "ERROR: shf must not be NULL; have you called shf_attach(_existing)()?");
+    if (NULL == shf->lock_times) {
+        shf_lock_times_map(shf, 0 /* no create */);
+    }
+    return shf->lock_times;
+} /* shf_lock_times_get() */
 
-#ifdef SHF_DEBUG_VERSION
-    SHF_ASSERT(NULL == shf->q.qids_nolock_push, "ERROR: did %s() accidentally get called twice?", __FUNCTION__);
-    SHF_ASSERT(NULL == shf->q.qids_nolock_pull, "ERROR: did %s() accidentally get called twice?", __FUNCTION__);
-#endif
-    shf->q.qids_nolock_push = malloc(shf->q.qs * sizeof(SHF_QID_MMAP)); shf->count_xalloc ++; SHF_ASSERT(shf->q.qids_nolock_push, "ERROR: malloc(%lu): %u", shf->q.qs * sizeof(SHF_QID_MMAP), errno);
-    shf->q.qids_nolock_pull = malloc(shf->q.qs * sizeof(SHF_QID_MMAP)); shf->count_xalloc ++; SHF_ASSERT(shf->q.qids_nolock_pull, "ERROR: malloc(%lu): %u", shf->q.qs * sizeof(SHF_QID_MMAP), errno);
-    for (uint32_t i = 0; i < shf->q.qs; i++) {
-        shf->q.qids_nolock_push[i].tail = SHF_QID_NONE;
-        shf->q.qids_nolock_push[i].head = SHF_QID_NONE;
-        shf->q.qids_nolock_push[i].size = 0           ;
-        shf->q.qids_nolock_pull[i].tail = SHF_QID_NONE;
-        shf->q.qids_nolock_pull[i].head = SHF_QID_NONE;
-        shf->q.qids_nolock_pull[i].size = 0           ;
+uint64_t /* least cycles counted in bucket */
+shf_lock_times_cycles(
+    uint32_t bucket)
+{
+    SHF_ASSERT_INTERNAL(bucket < SHF_LOCK_TIMES_BUCKETS, "ERROR: bucket must be < %u", SHF_LOCK_TIMES_BUCKETS);
+    if (bucket < SHF_LOCK_TIMES_LINEAR) {
+        return bucket;
     }
+    uint32_t octave = (bucket - SHF_LOCK_TIMES_LINEAR) >> SHF_LOCK_TIMES_SUBS_BITS;
+    uint32_t sub    = (bucket - SHF_LOCK_TIMES_LINEAR) &  ((1 << SHF_LOCK_TIMES_SUBS_BITS) - 1);
+    return SHF_CAST(uint64_t, (1 << SHF_LOCK_TIMES_SUBS_BITS) + sub) << (octave + __builtin_ctz(SHF_LOCK_TIMES_LINEAR) - SHF_LOCK_TIMES_SUBS_BITS);
+} /* shf_lock_times_cycles() */
 
-    shf->q.q_is_ready = 1;
+void
+shf_set_hot_keys( /* sample key,value ops into hot keys & win op counts; affects all processes attached to shf */
+    SHF      * shf   ,
+    uint32_t   sample) /* sample 1 in sample ops per thread on average; 0 means stop sampling; counts are kept */
+{
+    SHF_ASSERT_INTERNAL(shf, "ERROR: shf must not be NULL; have you called shf_attach(_existing)()?");
+    SHF_DEBUG("%s(shf=?, sample=%u){}\n", __FUNCTION__, sample);
+    if (sample) {
+        if (NULL == shf->hot_keys) {
+            shf_hot_keys_map(shf, 1 /* create */);
+        }
+        shf->hot_keys->sample = sample;
+    }
+    shf->shf_mmap->hot_keys_sample = sample;
+} /* shf_set_hot_keys() */
 
-    return shf->q.q_item_addr;
-} /* shf_q_get() */
+const SHF_HOT_KEYS_MMAP * /* NULL if hot keys never sampled */
+shf_hot_keys_get( /* get sampled hot keys & win op counts; multiply counts by ->sample to estimate ops */
+    SHF * shf)
+{
+    SHF_ASSERT_INTERNAL(shf, "ERROR: shf must not be NULL; have you called shf_attach(_existing)()?");
+    if (NULL == shf->hot_keys) {
+        shf_hot_keys_map(shf, 0 /* no create */);
+    }
+    return shf->hot_keys;
+} /* shf_hot_keys_get() */
 
-/**
- * @brief Delete the set of queue items & queues for an SHF instance.
- * - Normally called by `Process A`; see @ref ipc_sec.
- *
- * @param[in] shf  Attached SHF.
- *
- * Example usage:
- * @code
- * shf_q_del(shf);
- * @endcode
- */
 void
-shf_q_del(
+shf_hot_keys_reset( /* zero sampled hot keys & win op counts, e.g. to find hot keys for the next interval */
     SHF * shf)
 {
-    SHF_ASSERT_INTERNAL(shf->q.q_is_ready, "ERROR: have you called shf_q_(new|get)()?");
-
-    shf_make_hash(SHF_CONST_STR_AND_SIZE("__qs"          )); SHF_ASSERT(shf_del_key_val(shf), "ERROR: could not del key '%s'", "__qs"          );
-    shf_make_hash(SHF_CONST_STR_AND_SIZE("__q_items"     )); SHF_ASSERT(shf_del_key_val(shf), "ERROR: could not del key '%s'", "__q_items"     );
-    shf_make_hash(SHF_CONST_STR_AND_SIZE("__q_item_size" )); SHF_ASSERT(shf_del_key_val(shf), "ERROR: could not del key '%s'", "__q_item_size" );
-    shf_make_hash(SHF_CONST_STR_AND_SIZE("__qids"        )); SHF_ASSERT(shf_del_key_val(shf), "ERROR: could not del key '%s'", "__qids"        );
-    shf_make_hash(SHF_CONST_STR_AND_SIZE("__qiids"       )); SHF_ASSERT(shf_del_key_val(shf), "ERROR: could not del key '%s'", "__qiids"       );
-    shf_make_hash(SHF_CONST_STR_AND_SIZE("__q_lock"      )); SHF_ASSERT(shf_del_key_val(shf), "ERROR: could not del key '%s'", "__q_lock"      );
-    shf_make_hash(SHF_CONST_STR_AND_SIZE("__q_items_addr")); SHF_ASSERT(shf_del_key_val(shf), "ERROR: could not del key '%s'", "__q_items_addr");
-
-    if (shf->q.qids_nolock_push) { free(shf->q.qids_nolock_push); shf->count_xalloc --; }
-    if (shf->q.qids_nolock_pull) { free(shf->q.qids_nolock_pull); shf->count_xalloc --; }
-
-    shf->q.q_is_ready = 0;
-
+    SHF_ASSERT_INTERNAL(shf, "ERROR: shf must not be NULL; have you called shf_attach(_existing)()?");
     SHF_DEBUG("%s(shf=?){}\n", __FUNCTION__);
-} /* shf_q_del() */
-
+    if (NULL == shf->hot_keys && 0 == shf_hot_keys_map(shf, 0 /* no create */)) {
+        return;
+    }
+    SHF_HOT_KEYS_MMAP * hot_keys = shf->hot_keys;
+    SHF_LOCK_WRITER(&hot_keys->lock);
+    hot_keys->samples = 0;
+    memset(SHF_CAST(void *, hot_keys->ops ), 0, sizeof(hot_keys->ops )); /* racing samplers may count an op before or after */
+    memset(               hot_keys->keys  , 0, sizeof(hot_keys->keys));
+    SHF_UNLOCK_WRITER(&hot_keys->lock);
+} /* shf_hot_keys_reset() */
+
+static uint32_t /* 1 if arena mapped, else 0 */
+shf_arena_map( /* mmap() arena header shared by all processes */
+    SHF      * shf   ,
+    uint32_t   create) /* 0 means only map if arena exists */
+{
+    shf->arena = shf_stats_file_map(shf, "arena", sizeof(SHF_ARENA_MMAP), create);
+    return shf->arena ? 1 : 0;
+} /* shf_arena_map() */
+
+static void
+shf_arena_seg_map( /* mmap() arena seg, creating it if necessary; seg never moves so its blocks have stable addresses */
+    SHF      * shf,
+    uint32_t   seg)
+{
+    char file_seg[256];
+    SHF_SNPRINTF(0, file_seg, "%s/%s.shf/arena.%04u", shf->path, shf->name, seg);
+    SHF_DEBUG("- mapping arena seg of %u bytes from '%s'\n", SHF_ARENA_SEG_SIZE, file_seg);
+    int fd = open(file_seg, shf->is_read_only ? O_RDONLY : O_RDWR | O_CREAT, 0600); SHF_ASSERT(-1 != fd, "open(): %u: ", errno);
+    struct stat sb;
+    int value = fstat(fd, &sb); SHF_ASSERT(-1 != value, "fstat(): %u: ", errno);
+    if (sb.st_size < SHF_ARENA_SEG_SIZE) { /* zero filled by ftruncate() */
+        value = ftruncate(fd, SHF_ARENA_SEG_SIZE); SHF_ASSERT(-1 != value, "ftruncate(): %u: ", errno);
+    }
+    shf->arena_segs[seg] = mmap(NULL, SHF_ARENA_SEG_SIZE, shf->is_read_only ? PROT_READ : PROT_READ | PROT_WRITE, MAP_SHARED | MAP_NORESERVE, fd, 0); shf->count_mmap ++; SHF_ASSERT(MAP_FAILED != shf->arena_segs[seg], "mmap(): %u: ", errno);
+    value = close(fd); SHF_ASSERT(-1 != value, "close(): %u: ", errno);
+} /* shf_arena_seg_map() */
+
+void * /* stable address of block in this process until shf_detach() */
+shf_arena_addr(
+    SHF      * shf   ,
+    uint64_t   handle) /* from shf_arena_alloc() in any attached process */
+{
+    uint64_t seg = handle >> SHF_ARENA_SEG_BITS;
+    SHF_ASSERT_INTERNAL((seg > 0) && (seg < SHF_ARENA_SEGS_MAX), "ERROR: arena handle 0x%lx has bad seg", handle);
+    if (NULL == shf->arena_segs[seg]) {
+        shf_arena_seg_map(shf, seg);
+    }
+    return shf->arena_segs[seg] + (handle & (SHF_ARENA_SEG_SIZE - 1));
+} /* shf_arena_addr() */
+
+uint64_t /* 0 if addr not in an arena seg mapped by this process */
+shf_arena_handle( /* reverse of shf_arena_addr(); searches mapped segs */
+          SHF  * shf ,
+    const void * addr)
+{
+    if ((NULL == shf->arena) && (0 == shf_arena_map(shf, 0 /* no create */))) {
+        return 0;
+    }
+    const char * addr_char = SHF_CAST(const char *, addr);
+    uint32_t     segs_used = shf->arena->segs_used;
+    for (uint32_t seg = 1; seg <= segs_used; seg++) {
+        if (shf->arena_segs[seg] && (addr_char >= shf->arena_segs[seg]) && (addr_char < shf->arena_segs[seg] + SHF_ARENA_SEG_SIZE)) {
+            return (SHF_CAST(uint64_t, seg) << SHF_ARENA_SEG_BITS) | SHF_CAST(uint64_t, addr_char - shf->arena_segs[seg]);
+        }
+    }
+    return 0;
+} /* shf_arena_handle() */
+
+static uint32_t
+shf_arena_size_class( /* smallest power of 2 size class holding size */
+    uint32_t size)
+{
+    uint32_t bits = size <= (1 << SHF_ARENA_CLASS_MIN_BITS) ? SHF_ARENA_CLASS_MIN_BITS : 32 - __builtin_clz(size - 1);
+    return bits - SHF_ARENA_CLASS_MIN_BITS;
+} /* shf_arena_size_class() */
+
+static void
+shf_arena_cache_flush( /* move private free blocks of size class to shared free list; arena lock must be held */
+    SHF      * shf       ,
+    uint32_t   size_class,
+    uint32_t   keep      ) /* private free blocks to keep */
+{
+    SHF_ARENA_CACHE * cache = &shf->arena_cache[size_class];
+    while (cache->used > keep) {
+        uint64_t handle = cache->handles[-- cache->used];
+        SHF_U64_AT(shf_arena_addr(shf, handle), 0) = shf->arena->free[size_class];
+        shf->arena->free[size_class] = handle;
+    }
+} /* shf_arena_cache_flush() */
+
+static void
+shf_arena_cache_fill( /* move shared free blocks of size class, or else a new slab, to private free blocks; arena lock must be held */
+    SHF      * shf       ,
+    uint32_t   size_class)
+{
+    SHF_ARENA_CACHE * cache = &shf->arena_cache[size_class];
+    SHF_ARENA_MMAP  * arena = shf->arena;
+    while ((cache->used < SHF_ARENA_CACHE_MAX / 2) && arena->free[size_class]) {
+        uint64_t handle = arena->free[size_class];
+        arena->free[size_class] = SHF_U64_AT(shf_arena_addr(shf, handle), 0);
+        cache->handles[cache->used ++] = handle;
+    }
+    if (cache->used) {
+        return;
+    }
+
+    uint32_t block_size = 1 << (size_class + SHF_ARENA_CLASS_MIN_BITS);
+    uint32_t slab_size  = block_size > SHF_ARENA_SLAB_SIZE ? block_size : SHF_ARENA_SLAB_SIZE;
+    if ((0 == arena->segs_used) || (arena->seg_bump + slab_size > SHF_ARENA_SEG_SIZE)) {
+        if (arena->segs_used + 1 >= SHF_ARENA_SEGS_MAX) {
+            return; /* arena full */
+        }
+        shf_arena_seg_map(shf, arena->segs_used + 1); /* sized before any handle to it is shared */
+        arena->seg_bump  = 0;
+        arena->segs_used ++;
+        SHF_DEBUG("- arena grew to %u segs\n", arena->segs_used);
+    }
+    uint64_t slab = (SHF_CAST(uint64_t, arena->segs_used) << SHF_ARENA_SEG_BITS) | arena->seg_bump;
+    arena->seg_bump += slab_size;
+    for (uint32_t pos = 0; pos < slab_size; pos += block_size) {
+        if (cache->used < SHF_ARENA_CACHE_MAX / 2) {
+            cache->handles[cache->used ++] = slab + pos;
+        }
+        else {
+            SHF_U64_AT(shf_arena_addr(shf, slab + pos), 0) = arena->free[size_class];
+            arena->free[size_class] = slab + pos;
+        }
+    }
+} /* shf_arena_cache_fill() */
+
+static void
+shf_arena_cache_new( /* map arena & allocate private free blocks if not already done */
+    SHF * shf)
+{
+    if (NULL == shf->arena) {
+        shf_arena_map(shf, 1 /* create */);
+    }
+    if (NULL == shf->arena_cache) {
+        shf->arena_cache = calloc(SHF_ARENA_CLASSES, sizeof(SHF_ARENA_CACHE)); shf->count_xalloc ++; SHF_ASSERT(NULL != shf->arena_cache, "calloc(): %u: ", errno);
+    }
+} /* shf_arena_cache_new() */
+
+uint64_t /* handle of block; 0 if size is 0 or > SHF_ARENA_SEG_SIZE, arena full, or read only */
+shf_arena_alloc( /* allocate block of size bytes in arena; block never moves */
+    SHF      * shf ,
+    uint32_t   size)
+{
+    SHF_ASSERT_INTERNAL(shf, "ERROR: shf must not be NULL; have you called shf_attach(_existing)()?");
+    if (shf->is_read_only || (0 == size) || (size > SHF_ARENA_SEG_SIZE)) {
+        return 0;
+    }
+    shf_arena_cache_new(shf);
+    uint32_t          size_class = shf_arena_size_class(size);
+    SHF_ARENA_CACHE * cache      = &shf->arena_cache[size_class];
+    if (0 == cache->used) {
+        SHF_LOCK_WRITER(&shf->arena->lock);
+        shf_arena_cache_fill(shf, size_class);
+        SHF_UNLOCK_WRITER(&shf->arena->lock);
+        if (0 == cache->used) {
+            return 0;
+        }
+    }
+    uint64_t handle = cache->handles[-- cache->used];
+    SHF_DEBUG("%s(shf=?, size=%u){} // return 0x%lx\n", __FUNCTION__, size, handle);
+    return handle;
+} /* shf_arena_alloc() */
+
+void
+shf_arena_free( /* return block to private free blocks of its size class, or to shared free list if too many */
+    SHF      * shf   ,
+    uint64_t   handle, /* 0 means do nothing */
+    uint32_t   size  ) /* as passed to shf_arena_alloc() */
+{
+    SHF_DEBUG("%s(shf=?, handle=0x%lx, size=%u){}\n", __FUNCTION__, handle, size);
+    if (0 == handle) {
+        return;
+    }
+    shf_arena_cache_new(shf); /* e.g. if block allocated by another process */
+    uint32_t          size_class = shf_arena_size_class(size);
+    SHF_ARENA_CACHE * cache      = &shf->arena_cache[size_class];
+    if (SHF_ARENA_CACHE_MAX == cache->used) {
+        SHF_LOCK_WRITER(&shf->arena->lock);
+        shf_arena_cache_flush(shf, size_class, SHF_ARENA_CACHE_MAX / 2);
+        SHF_UNLOCK_WRITER(&shf->arena->lock);
+    }
+    cache->handles[cache->used ++] = handle;
+} /* shf_arena_free() */
+
+void
+shf_arena_flush( /* return all private free blocks to shared free lists, e.g. so other processes can use them; also done by shf_detach() */
+    SHF * shf)
+{
+    if (NULL == shf->arena_cache) {
+        return;
+    }
+    SHF_LOCK_WRITER(&shf->arena->lock);
+    for (uint32_t size_class = 0; size_class < SHF_ARENA_CLASSES; size_class++) {
+        shf_arena_cache_flush(shf, size_class, 0);
+    }
+    SHF_UNLOCK_WRITER(&shf->arena->lock);
+} /* shf_arena_flush() */
+
+static void *
+shf_q_align( /* round value address up to cache line; tabs are page aligned so same offset in every process */
+    void * addr)
+{
+    return SHF_CAST(void *, (SHF_CAST(uint64_t, addr) + 63) & ~SHF_CAST(uint64_t, 63));
+} /* shf_q_align() */
+
+static uint64_t
+shf_q_rings_size(
+    uint32_t qs     ,
+    uint32_t q_items)
+{
+    uint64_t ring_size = 1;
+    while (ring_size < q_items) { ring_size *= 2; }
+    return 63 /* for cache line alignment */ + (qs * sizeof(SHF_Q_RING_MMAP)) + (qs * ring_size * sizeof(SHF_Q_SLOT_MMAP));
+} /* shf_q_rings_size() */
+
+static void
+shf_q_rings_set(
+    SHF  * shf       ,
+    char * rings_addr) /* value of __q_rings key */
+{
+    uint32_t ring_size = 1;
+    while (ring_size < shf->q.q_items) { ring_size *= 2; }
+    char * rings = shf_q_align(rings_addr);
+    shf->q.q_ring_mask = ring_size - 1;
+    shf->q.q_rings     = SHF_CAST(SHF_Q_RING_MMAP *, rings);
+    shf->q.q_slots     = SHF_CAST(SHF_Q_SLOT_MMAP *, rings + (shf->q.qs * sizeof(SHF_Q_RING_MMAP)));
+    if (SHF_Q_SPSC == shf->q.qids_nolock_max) { /* all zero caches are stale so each end re-reads the other end's position at first use */
+        shf->q.q_spsc_caches = calloc(shf->q.qs, sizeof(SHF_Q_SPSC_CACHE)); shf->count_xalloc ++; SHF_ASSERT(shf->q.q_spsc_caches, "ERROR: calloc(%lu): %u", shf->q.qs * sizeof(SHF_Q_SPSC_CACHE), errno);
+    }
+} /* shf_q_rings_set() */
+
+static uint32_t
+shf_q_proc_size( /* bytes per __q_procs slot; whole cache lines so processes don't false share */
+    uint32_t qs)
+{
+    return (sizeof(SHF_Q_PROC_MMAP) + (2 * qs * sizeof(SHF_QID_MMAP)) + 63) & ~63U;
+} /* shf_q_proc_size() */
+
+static void
+shf_q_procs_set(
+    SHF  * shf        ,
+    char * procs_addr , /* value of __q_procs  key */
+    char * leases_addr) /* value of __q_leases key */
+{
+    shf->q.q_procs          = shf_q_align(procs_addr );
+    shf->q.q_leases         = shf_q_align(leases_addr);
+    shf->q.q_proc_size      = shf_q_proc_size(shf->q.qs);
+    shf->q.q_proc           = NULL; /* claimed upon first push or pull */
+    shf->q.q_proc_gen       = 0;
+    shf->q.q_proc_retry     = 0;
+    shf->q.qids_nolock_push = NULL;
+    shf->q.qids_nolock_pull = NULL;
+} /* shf_q_procs_set() */
+
+static SHF_Q_PROC_MMAP *
+shf_q_proc_at(
+    SHF      * shf ,
+    uint32_t   slot)
+{
+    return SHF_CAST(SHF_Q_PROC_MMAP *, SHF_CAST(char *, shf->q.q_procs) + sizeof(SHF_Q_PROCS_MMAP) + (slot * shf->q.q_proc_size));
+} /* shf_q_proc_at() */
+
+/**
+ * @brief Get a set of -- already created -- queue items & queues for those items to be pulled and pushed to.
+ * - Sets the thread local variable @ref shf_qiid_addr to point to the first byte of the queue items array.
+ * - Sets the thread local variable @ref shf_qiid_addr_len the length in bytes of the queue items array.
+ * - Normally called by `Process B`; see @ref ipc_sec.
+ *
+ * @param[in] shf      Attached SHF.
+ * @retval    Pointer  Process specific pointer to the array of queue items.
+ *
+ * Example usage:
+ * @code
+ * char * qiid_array = shf_q_get(shf);
+ * @endcode
+ */
+void *
+shf_q_get(
+    SHF * shf)
+{
+#ifdef SHF_DEBUG_VERSION
+    SHF_ASSERT(NULL == shf->q.q_proc, "ERROR: did %s() accidentally get called twice?", __FUNCTION__);
+#endif
+
+    shf_make_hash(SHF_CONST_STR_AND_SIZE("__qs"             )); SHF_ASSERT(SHF_RET_KEY_FOUND == shf_get_key_val_copy(shf), "ERROR: could not get key '%s'", "__qs"             ); shf->q.qs              = SHF_CAST(uint32_t *, shf_val)[0];
+    shf_make_hash(SHF_CONST_STR_AND_SIZE("__q_items"        )); SHF_ASSERT(SHF_RET_KEY_FOUND == shf_get_key_val_copy(shf), "ERROR: could not get key '%s'", "__q_items"        ); shf->q.q_items         = SHF_CAST(uint32_t *, shf_val)[0];
+    shf_make_hash(SHF_CONST_STR_AND_SIZE("__q_item_size"    )); SHF_ASSERT(SHF_RET_KEY_FOUND == shf_get_key_val_copy(shf), "ERROR: could not get key '%s'", "__q_item_size"    ); shf->q.q_item_size     = SHF_CAST(uint32_t *, shf_val)[0];
+    shf_make_hash(SHF_CONST_STR_AND_SIZE("__qids_nolock_max")); SHF_ASSERT(SHF_RET_KEY_FOUND == shf_get_key_val_copy(shf), "ERROR: could not get key '%s'", "__qids_nolock_max"); shf->q.qids_nolock_max = SHF_CAST(uint32_t *, shf_val)[0];
+    shf->q.q_nolock_batch  = shf->q.qids_nolock_max;
+    shf->q.q_is_adaptive   = 0;
+    shf->q.q_linger_cycles = 0;
+    shf->q.q_linger_start  = 0;
+    shf->q.q_window_start  = 0;
+    shf->q.q_window_pushed = 0;
+    shf_make_hash(SHF_CONST_STR_AND_SIZE("__q_lock"         )); SHF_ASSERT(SHF_RET_KEY_FOUND == shf_get_key_val_addr(shf), "ERROR: could not get key '%s'", "__q_lock"         ); shf->q.q_lock          = shf_val_addr;
+    shf_make_hash(SHF_CONST_STR_AND_SIZE("__q_items_addr"   )); SHF_ASSERT(SHF_RET_KEY_FOUND == shf_get_key_val_addr(shf), "ERROR: could not get key '%s'", "__q_items_addr"   ); shf->q.q_item_addr     = shf_val_addr;
+    shf_make_hash(SHF_CONST_STR_AND_SIZE("__q_waits"        )); SHF_ASSERT(SHF_RET_KEY_FOUND == shf_get_key_val_addr(shf), "ERROR: could not get key '%s'", "__q_waits"        ); shf->q.q_waits         = shf_q_align(shf_val_addr);
+    if ((SHF_Q_MPMC == shf->q.qids_nolock_max) || (SHF_Q_SPSC == shf->q.qids_nolock_max)) {
+        shf_make_hash(SHF_CONST_STR_AND_SIZE("__q_rings"        )); SHF_ASSERT(SHF_RET_KEY_FOUND == shf_get_key_val_addr(shf), "ERROR: could not get key '%s'", "__q_rings"        ); shf_q_rings_set(shf, shf_val_addr);
+    }
+    else {
+        shf_make_hash(SHF_CONST_STR_AND_SIZE("__qids"           )); SHF_ASSERT(SHF_RET_KEY_FOUND == shf_get_key_val_addr(shf), "ERROR: could not get key '%s'", "__qids"           ); shf->q.qids            = shf_val_addr;
+        shf_make_hash(SHF_CONST_STR_AND_SIZE("__qiids"          )); SHF_ASSERT(SHF_RET_KEY_FOUND == shf_get_key_val_addr(shf), "ERROR: could not get key '%s'", "__qiids"          ); shf->q.qiids           = shf_val_addr;
+        shf_make_hash(SHF_CONST_STR_AND_SIZE("__q_procs"        )); SHF_ASSERT(SHF_RET_KEY_FOUND == shf_get_key_val_addr(shf), "ERROR: could not get key '%s'", "__q_procs"        ); char * procs_addr      = shf_val_addr;
+        shf_make_hash(SHF_CONST_STR_AND_SIZE("__q_leases"       )); SHF_ASSERT(SHF_RET_KEY_FOUND == shf_get_key_val_addr(shf), "ERROR: could not get key '%s'", "__q_leases"       ); shf_q_procs_set(shf, procs_addr, shf_val_addr);
+    }
+
+    shf_qiid_addr     = shf->q.q_item_addr                 ;
+    shf_qiid_addr_len = shf->q.q_item_size * shf->q.q_items;
+
+    SHF_DEBUG("%s(shf=?){} // 0x%p\n", __FUNCTION__, shf->q.q_item_addr);
+
+#ifdef SHF_DEBUG_VERSION
+    SHF_ASSERT(1234567 == shf->q.q_lock->debug_magic, "ERROR: INTERNAL: shf->q.q_lock->debug_magic has unexpected value %u\n", shf->q.q_lock->debug_magic);
+#endif
+
+    shf->q.q_is_ready = 1;
+
+    return shf->q.q_item_addr;
+} /* shf_q_get() */
+
+/**
+ * @brief Delete the set of queue items & queues for an SHF instance.
+ * - Normally called by `Process A`; see @ref ipc_sec.
+ *
+ * @param[in] shf  Attached SHF.
+ *
+ * Example usage:
+ * @code
+ * shf_q_del(shf);
+ * @endcode
+ */
+void
+shf_q_del(
+    SHF * shf)
+{
+    SHF_ASSERT_INTERNAL(shf->q.q_is_ready, "ERROR: have you called shf_q_(new|get)()?");
+
+    shf_make_hash(SHF_CONST_STR_AND_SIZE("__qs"             )); SHF_ASSERT(shf_del_key_val(shf), "ERROR: could not del key '%s'", "__qs"             );
+    shf_make_hash(SHF_CONST_STR_AND_SIZE("__q_items"        )); SHF_ASSERT(shf_del_key_val(shf), "ERROR: could not del key '%s'", "__q_items"        );
+    shf_make_hash(SHF_CONST_STR_AND_SIZE("__q_item_size"    )); SHF_ASSERT(shf_del_key_val(shf), "ERROR: could not del key '%s'", "__q_item_size"    );
+    shf_make_hash(SHF_CONST_STR_AND_SIZE("__qids_nolock_max")); SHF_ASSERT(shf_del_key_val(shf), "ERROR: could not del key '%s'", "__qids_nolock_max");
+    shf_make_hash(SHF_CONST_STR_AND_SIZE("__q_lock"         )); SHF_ASSERT(shf_del_key_val(shf), "ERROR: could not del key '%s'", "__q_lock"         );
+    shf_make_hash(SHF_CONST_STR_AND_SIZE("__q_items_addr"   )); SHF_ASSERT(shf_del_key_val(shf), "ERROR: could not del key '%s'", "__q_items_addr"   );
+    shf_make_hash(SHF_CONST_STR_AND_SIZE("__q_waits"        )); SHF_ASSERT(shf_del_key_val(shf), "ERROR: could not del key '%s'", "__q_waits"        );
+    if (shf->q.q_rings) {
+        shf_make_hash(SHF_CONST_STR_AND_SIZE("__q_rings"        )); SHF_ASSERT(shf_del_key_val(shf), "ERROR: could not del key '%s'", "__q_rings"        );
+    }
+    else {
+        shf_make_hash(SHF_CONST_STR_AND_SIZE("__qids"           )); SHF_ASSERT(shf_del_key_val(shf), "ERROR: could not del key '%s'", "__qids"           );
+        shf_make_hash(SHF_CONST_STR_AND_SIZE("__qiids"          )); SHF_ASSERT(shf_del_key_val(shf), "ERROR: could not del key '%s'", "__qiids"          );
+        shf_make_hash(SHF_CONST_STR_AND_SIZE("__q_procs"        )); SHF_ASSERT(shf_del_key_val(shf), "ERROR: could not del key '%s'", "__q_procs"        );
+        shf_make_hash(SHF_CONST_STR_AND_SIZE("__q_leases"       )); SHF_ASSERT(shf_del_key_val(shf), "ERROR: could not del key '%s'", "__q_leases"       );
+        shf_make_hash(SHF_CONST_STR_AND_SIZE("__q_reap"         )); shf_del_key_val(shf); /* only exists if shf_q_set_reap() called */
+        char file_reap[256];
+        SHF_SNPRINTF(0, file_reap, "%s/%s.shf/q.reap", shf->path, shf->name);
+        unlink(file_reap);
+    }
+
+    if (shf->q.q_spsc_caches   ) { free(shf->q.q_spsc_caches   ); shf->count_xalloc --; shf->q.q_spsc_caches    = NULL; }
+    shf->q.qids_nolock_push = NULL; /* own __q_procs slot deleted with other processes' slots */
+    shf->q.qids_nolock_pull = NULL;
+    shf->q.q_proc   = NULL;
+    shf->q.q_procs  = NULL;
+    shf->q.q_leases = NULL;
+    shf->q.q_rings = NULL;
+    shf->q.q_slots = NULL;
+    shf->q.q_waits = NULL;
+
+    shf->q.q_is_ready = 0;
+
+    SHF_DEBUG("%s(shf=?){}\n", __FUNCTION__);
+} /* shf_q_del() */
+
 /**
  * @brief Create a set of queue items & queues for those items to be pulled and pushed to.
  * - Sets the thread local variable @ref shf_qiid_addr to point to the first byte of the queue items array.
@@ -1333,12 +3355,14 @@ shf_q_del(
  * @param[in] qs               Number of queues to create.
  * @param[in] q_items          Number of queue items to create.
  * @param[in] q_item_size      Size of each queue item in bytes.
- * @param[in] qids_nolock_max  Number of queue items to push or pull without locking, e.g. 1.
+ * @param[in] qids_nolock_max  Number of queue items to push or pull without locking, e.g. 1, or #SHF_Q_MPMC for a lock free ring per qid, or #SHF_Q_SPSC for a ring per qid with one pushing & one pulling process.
  * @retval    Pointer          Process specific pointer to the array of queue items.
  *
  * Example usage:
  * @code
  * char * qiid_array = shf_q_new(shf, 3, 10, 1024, 1); // Create 10 qiids of size 1024 bytes each, to be shared between 3 qids; don't batch up locking
+ * char * qiid_array = shf_q_new(shf, 3, 10, 1024, SHF_Q_MPMC); // Same but many processes push & pull each qid without q_lock
+ * char * qiid_array = shf_q_new(shf, 3, 10, 1024, SHF_Q_SPSC); // Same but each qid only pushed by one process & pulled by one process
  * @endcode
  */
 void *
@@ -1353,49 +3377,112 @@ shf_q_new(
     shf->q.q_items         = q_items        ;
     shf->q.q_item_size     = q_item_size    ;
     shf->q.qids_nolock_max = qids_nolock_max;
+    shf->q.q_nolock_batch  = qids_nolock_max;
+    shf->q.q_is_adaptive   = 0;
+    shf->q.q_linger_cycles = 0;
+    shf->q.q_linger_start  = 0;
+    shf->q.q_window_start  = 0;
+    shf->q.q_window_pushed = 0;
 
     SHF_ASSERT_INTERNAL(shf->q.q_is_ready == 0      , "ERROR: shf_q_new() already called"       );
     SHF_ASSERT_INTERNAL(qs                >  2      , "ERROR: qs must be > 2"                   );
     SHF_ASSERT_INTERNAL(q_items           >  1      , "ERROR: q_items must be > 2"              );
-    SHF_ASSERT_INTERNAL(qids_nolock_max   >  0      , "ERROR: qids_nolock_max must be > 0"      );
-    SHF_ASSERT_INTERNAL(qids_nolock_max   <  q_items, "ERROR: qids_nolock_max must be < q_items");
+    SHF_ASSERT_INTERNAL(q_items           <= (1U << 31), "ERROR: q_items must be <= 2^31"       ); /* ring positions wrap at 2^32 */
+
+    uint32_t is_ring   = (SHF_Q_MPMC == qids_nolock_max) || (SHF_Q_SPSC == qids_nolock_max);
+    SHF_ASSERT_INTERNAL(qids_nolock_max   >  0       || is_ring, "ERROR: qids_nolock_max must be > 0"      );
+    SHF_ASSERT_INTERNAL(qids_nolock_max   <  q_items || is_ring, "ERROR: qids_nolock_max must be < q_items");
+    uint32_t uid_rings  = SHF_UID_NONE; /* __q_rings if is_ring */
+    uint32_t uid_qids   = SHF_UID_NONE; /* __qids, __qiids, __q_procs, & __q_leases if ! is_ring */
+    uint32_t uid_qiids  = SHF_UID_NONE;
+    uint32_t uid_procs  = SHF_UID_NONE;
+    uint32_t uid_leases = SHF_UID_NONE;
 
     shf_debug_verbosity_less();
     shf_make_hash(SHF_CONST_STR_AND_SIZE("__qs"             )); shf_put_key_val(shf, SHF_CAST(const char *, &qs             ),           sizeof(qs             )); uint32_t uid_qs              = shf_uid;
     shf_make_hash(SHF_CONST_STR_AND_SIZE("__q_items"        )); shf_put_key_val(shf, SHF_CAST(const char *, &q_items        ),           sizeof(q_items        )); uint32_t uid_q_items         = shf_uid;
     shf_make_hash(SHF_CONST_STR_AND_SIZE("__q_item_size"    )); shf_put_key_val(shf, SHF_CAST(const char *, &q_item_size    ),           sizeof(q_item_size    )); uint32_t uid_q_item_size     = shf_uid;
     shf_make_hash(SHF_CONST_STR_AND_SIZE("__qids_nolock_max")); shf_put_key_val(shf, SHF_CAST(const char *, &qids_nolock_max),           sizeof(qids_nolock_max)); uint32_t uid_qids_nolock_max = shf_uid;
-    shf_make_hash(SHF_CONST_STR_AND_SIZE("__qids"           )); shf_put_key_val(shf, NULL                                    , qs      * sizeof(SHF_QID_MMAP   )); uint32_t uid_qids            = shf_uid;
-    shf_make_hash(SHF_CONST_STR_AND_SIZE("__qiids"          )); shf_put_key_val(shf, NULL                                    , q_items * sizeof(SHF_QIID_MMAP  )); uint32_t uid_qiids           = shf_uid;
+    if (is_ring) {
+        shf_make_hash(SHF_CONST_STR_AND_SIZE("__q_rings"        )); shf_put_key_val(shf, NULL                                    , shf_q_rings_size(qs, q_items)   ); uid_rings = shf_uid;
+    }
+    else {
+        shf_make_hash(SHF_CONST_STR_AND_SIZE("__qids"           )); shf_put_key_val(shf, NULL                                    , qs      * sizeof(SHF_QID_MMAP   )); uid_qids  = shf_uid;
+        shf_make_hash(SHF_CONST_STR_AND_SIZE("__qiids"          )); shf_put_key_val(shf, NULL                                    , q_items * sizeof(SHF_QIID_MMAP  )); uid_qiids = shf_uid;
+        shf_make_hash(SHF_CONST_STR_AND_SIZE("__q_procs"        )); shf_put_key_val(shf, NULL                                    , 63 + sizeof(SHF_Q_PROCS_MMAP) + (SHF_Q_PROCS_MAX * shf_q_proc_size(qs))); uid_procs  = shf_uid;
+        shf_make_hash(SHF_CONST_STR_AND_SIZE("__q_leases"       )); shf_put_key_val(shf, NULL                                    , 63 + (q_items * sizeof(uint64_t))                                 ); uid_leases = shf_uid;
+    }
     shf_make_hash(SHF_CONST_STR_AND_SIZE("__q_lock"         )); shf_put_key_val(shf, NULL                                    ,           sizeof(SHF_Q_LOCK_MMAP)); uint32_t uid_q_lock          = shf_uid;
     shf_make_hash(SHF_CONST_STR_AND_SIZE("__q_items_addr"   )); shf_put_key_val(shf, NULL                                    , q_items * q_item_size            ); uint32_t uid_q_items_addr    = shf_uid;
+    shf_make_hash(SHF_CONST_STR_AND_SIZE("__q_waits"        )); shf_put_key_val(shf, NULL                                    , qs * sizeof(SHF_Q_WAIT_MMAP) + 63); uint32_t uid_q_waits         = shf_uid;
     shf_debug_verbosity_more();
 
     SHF_ASSERT(SHF_UID_NONE != uid_qs             , "ERROR: could not put key: __qs"             );
     SHF_ASSERT(SHF_UID_NONE != uid_q_items        , "ERROR: could not put key: __q_items"        );
     SHF_ASSERT(SHF_UID_NONE != uid_q_item_size    , "ERROR: could not put key: __q_item_size"    );
     SHF_ASSERT(SHF_UID_NONE != uid_qids_nolock_max, "ERROR: could not put key: __qids_nolock_max");
-    SHF_ASSERT(SHF_UID_NONE != uid_qids           , "ERROR: could not put key: __qids"           );
-    SHF_ASSERT(SHF_UID_NONE != uid_qiids          , "ERROR: could not put key: __qiids"          );
+    SHF_ASSERT(SHF_UID_NONE != uid_rings || ! is_ring, "ERROR: could not put key: __q_rings"     );
+    SHF_ASSERT(SHF_UID_NONE != uid_qids  ||   is_ring, "ERROR: could not put key: __qids"        );
+    SHF_ASSERT(SHF_UID_NONE != uid_qiids ||   is_ring, "ERROR: could not put key: __qiids"       );
+    SHF_ASSERT(SHF_UID_NONE != uid_procs ||   is_ring, "ERROR: could not put key: __q_procs"     );
+    SHF_ASSERT(SHF_UID_NONE != uid_leases||   is_ring, "ERROR: could not put key: __q_leases"    );
     SHF_ASSERT(SHF_UID_NONE != uid_q_lock         , "ERROR: could not put key: __q_lock"         );
     SHF_ASSERT(SHF_UID_NONE != uid_q_items_addr   , "ERROR: could not put key: __q_items_addr"   );
+    SHF_ASSERT(SHF_UID_NONE != uid_q_waits        , "ERROR: could not put key: __q_waits"        );
 
     // todo: freeze at this point; all memory has been allocated
 
+    shf_get_uid_val_addr(shf, uid_q_lock      ); shf->q.q_lock      = shf_val_addr;
+    shf_get_uid_val_addr(shf, uid_q_items_addr); shf->q.q_item_addr = shf_val_addr;
+    shf_get_uid_val_addr(shf, uid_q_waits     ); shf->q.q_waits     = shf_q_align(shf_val_addr);
+    memset(shf->q.q_waits, 0, qs * sizeof(SHF_Q_WAIT_MMAP));
+    for (uint32_t i = 0; i < q_items; i++) {
+        SHF_ASSERT(shf->q.q_item_size >= 9, "ERROR: q_item_size is %u but must be at least 4", q_item_size);
+        snprintf(&shf->q.q_item_addr[i * shf->q.q_item_size], 9, "%08x", i);
+    }
+
+    if (is_ring) {
+        /* add qiid q items to default qid q 0 ring as if pushed in order; other rings empty */
+        shf_get_uid_val_addr(shf, uid_rings); shf_q_rings_set(shf, shf_val_addr);
+        for (uint32_t i = 0; i < qs; i++) {
+            shf->q.q_rings[i].push_pos = 0;
+            shf->q.q_rings[i].pull_pos = 0;
+            SHF_Q_SLOT_MMAP * slots = &shf->q.q_slots[i * (shf->q.q_ring_mask + 1)];
+            for (uint32_t pos = 0; pos <= shf->q.q_ring_mask; pos++) {
+                slots[pos].seq  = pos          ;
+                slots[pos].qiid = SHF_QIID_NONE;
+            }
+        }
+        for (uint32_t i = 0; i < q_items; i++) {
+            shf->q.q_slots[i].seq  = i + 1;
+            shf->q.q_slots[i].qiid = i    ;
+        }
+        shf->q.q_rings[0].push_pos = q_items;
+        goto EARLY_OUT;
+    }
+
+    /* all __q_procs slots free with empty nolock qs, & no qiids pulled */
+    shf_get_uid_val_addr(shf, uid_procs       ); char * procs_addr  = shf_val_addr;
+    shf_get_uid_val_addr(shf, uid_leases      ); shf_q_procs_set(shf, procs_addr, shf_val_addr);
+    shf->q.q_procs->lease_ms = 0;
+    shf->q.q_procs->is_reap  = 0;
+    shf->q.q_procs->nonce    = 0;
+    for (uint32_t slot = 0; slot < SHF_Q_PROCS_MAX; slot++) {
+        SHF_Q_PROC_MMAP * proc = shf_q_proc_at(shf, slot);
+        proc->pid   = 0;
+        proc->nonce = 0;
+        for (uint32_t i = 0; i < 2 * qs; i++) {
+            proc->qids_nolock[i].tail = SHF_QID_NONE;
+            proc->qids_nolock[i].head = SHF_QID_NONE;
+            proc->qids_nolock[i].size = 0           ;
+        }
+    }
+    memset(shf->q.q_leases, 0, q_items * sizeof(uint64_t));
+
     /* add qiid q items to default qid q 0 */
-    shf->q.qids_nolock_push = malloc(shf->q.qs * sizeof(SHF_QID_MMAP)); shf->count_xalloc ++; SHF_ASSERT(shf->q.qids_nolock_push, "ERROR: malloc(%lu): %u", shf->q.qs * sizeof(SHF_QID_MMAP), errno);
-    shf->q.qids_nolock_pull = malloc(shf->q.qs * sizeof(SHF_QID_MMAP)); shf->count_xalloc ++; SHF_ASSERT(shf->q.qids_nolock_pull, "ERROR: malloc(%lu): %u", shf->q.qs * sizeof(SHF_QID_MMAP), errno);
     shf_get_uid_val_addr(shf, uid_qids        ); shf->q.qids        = shf_val_addr;
     shf_get_uid_val_addr(shf, uid_qiids       ); shf->q.qiids       = shf_val_addr;
-    shf_get_uid_val_addr(shf, uid_q_lock      ); shf->q.q_lock      = shf_val_addr;
-    shf_get_uid_val_addr(shf, uid_q_items_addr); shf->q.q_item_addr = shf_val_addr;
     for (uint32_t i = 0; i < shf->q.qs; i++) {
-        shf->q.qids_nolock_push[i].tail = SHF_QID_NONE;
-        shf->q.qids_nolock_push[i].head = SHF_QID_NONE;
-        shf->q.qids_nolock_push[i].size = 0           ;
-        shf->q.qids_nolock_pull[i].tail = SHF_QID_NONE;
-        shf->q.qids_nolock_pull[i].head = SHF_QID_NONE;
-        shf->q.qids_nolock_pull[i].size = 0           ;
         shf->q.qids            [i].tail = SHF_QID_NONE;
         shf->q.qids            [i].head = SHF_QID_NONE;
         shf->q.qids            [i].size = 0           ;
@@ -1403,9 +3490,6 @@ shf_q_new(
     for (uint32_t i = 0; i < q_items; i++) {
         shf->q.qiids[i].last = i - 1;
         shf->q.qiids[i].next = i + 1;
-
-        SHF_ASSERT(shf->q.q_item_size >= 9, "ERROR: q_item_size is %u but must be at least 4", q_item_size);
-        snprintf(&shf->q.q_item_addr[i * shf->q.q_item_size], 9, "%08x", i);
     }
     shf->q.qiids[0          ].last = SHF_QID_NONE;
     shf->q.qiids[q_items - 1].next = SHF_QID_NONE;
@@ -1413,139 +3497,760 @@ shf_q_new(
     shf->q.qids[0].head            = q_items - 1 ;
     shf->q.qids[0].size            = q_items     ;
 
-    shf_qiid_addr     = shf->q.q_item_addr                 ;
-    shf_qiid_addr_len = shf->q.q_item_size * shf->q.q_items;
+    EARLY_OUT:;
+
+    shf_qiid_addr     = shf->q.q_item_addr                 ;
+    shf_qiid_addr_len = shf->q.q_item_size * shf->q.q_items;
+
+    SHF_DEBUG("%s(shf=?, qs=%u, q_items=%u, q_item_size=%u){} // 0x%p\n", __FUNCTION__, qs, q_items, q_item_size, shf->q.q_item_addr);
+
+#ifdef SHF_DEBUG_VERSION
+    shf->q.q_lock->debug_magic = 1234567;
+#endif
+
+    shf->q.q_is_ready = 1;
+
+    return shf->q.q_item_addr;
+} /* shf_q_new() */
+
+static uint64_t
+shf_rdtsc_per_ms(void) /* calibrated once per process against the monotonic clock */
+{
+    static uint64_t cycles_per_ms = 0;
+    if (0 == cycles_per_ms) {
+        struct timespec start, now;
+        clock_gettime(CLOCK_MONOTONIC, &start);
+        uint64_t start_tsc = shf_rdtsc();
+        do {
+            clock_gettime(CLOCK_MONOTONIC, &now);
+        } while (((now.tv_sec - start.tv_sec) * 1000000000L) + (now.tv_nsec - start.tv_nsec) < 2000000L); /* 2ms */
+        uint64_t ns   = ((now.tv_sec - start.tv_sec) * 1000000000L) + (now.tv_nsec - start.tv_nsec);
+        cycles_per_ms = ((shf_rdtsc() - start_tsc) * 1000000) / ns;
+    }
+    return cycles_per_ms;
+} /* shf_rdtsc_per_ms() */
+
+/**
+ * @brief Bound how long pushed qiids may wait invisible in this process's nolock push queues.
+ * - Only affects this process; call after shf_q_new() or shf_q_get().
+ * - Nolock push queues are flushed once `qids_nolock_max` qiids, or once the first qiid pushed waited `linger_us`.
+ * - The deadline is checked by each shf_q_push_head(), shf_q_pull_tail(), or shf_q_push_head_pull_tail(); an otherwise idle process should call shf_q_flush().
+ * - If adaptive then the flush batch size, for pushing & pulling, follows the arrival rate:
+ *   about the qiids pushed per `linger_us`, between 1 & `qids_nolock_max`.
+ *   So at peak rate batches are large, & off peak qiids are flushed at once.
+ * - Not for #SHF_Q_MPMC or #SHF_Q_SPSC queues which have no nolock queues.
+ *
+ * @param[in] shf          Attached SHF.
+ * @param[in] linger_us    Microseconds a qiid may wait in nolock push queues; 0 means no max.
+ * @param[in] is_adaptive  1 means adapt the batch size to the arrival rate; needs `linger_us`.
+ *
+ * Example usage:
+ * @code
+ * shf_q_new(shf, 3, 100000, 1024, 1000);
+ * shf_q_set_nolock_linger(shf, 100, 1); // flush within ~100us & batch up to 1000 qiids at peak rate
+ * @endcode
+ */
+void
+shf_q_set_nolock_linger(
+    SHF      * shf        ,
+    uint32_t   linger_us  ,
+    uint32_t   is_adaptive)
+{
+    SHF_ASSERT_INTERNAL(shf                                 , "ERROR: shf must not be NULL; have you called shf_attach(_existing)()?");
+    SHF_ASSERT_INTERNAL(shf->q.q_is_ready                   , "ERROR: have you called shf_q_(new|get)()?");
+    SHF_ASSERT_INTERNAL(NULL == shf->q.q_rings              , "ERROR: SHF_Q_MPMC & SHF_Q_SPSC queues have no nolock queues");
+    SHF_ASSERT_INTERNAL(linger_us > 0 || 0 == is_adaptive   , "ERROR: is_adaptive needs linger_us > 0");
+
+    shf_q_flush(shf, SHF_QID_NONE); /* start afresh with empty nolock push qs */
+    shf->q.q_linger_cycles = (SHF_CAST(uint64_t, linger_us) * shf_rdtsc_per_ms()) / 1000;
+    shf->q.q_is_adaptive   = is_adaptive;
+    shf->q.q_nolock_batch  = shf->q.qids_nolock_max;
+    shf->q.q_window_start  = 0;
+    shf->q.q_window_pushed = 0;
+
+    SHF_DEBUG("%s(shf=?, linger_us=%u, is_adaptive=%u){} // %lu cycles\n", __FUNCTION__, linger_us, is_adaptive, shf->q.q_linger_cycles);
+} /* shf_q_set_nolock_linger() */
+
+/**
+ * @brief Associate an unused qid with an ascii name.
+ * - After calling shf_q_new(), call this function q_items times.
+ * - Normally called by `Process A`; see @ref ipc_sec.
+ *
+ * @param[in] shf       Attached SHF.
+ * @param[in] name      Ascii name of qid.
+ * @param[in] name_len  Length of ascii name in bytes.
+ * @retval    qid       qid which is now used.
+ *
+ * Example usage:
+ * @code
+ * uint32_t qid = shf_q_new_name(shf, "qid-free");
+ * @endcode
+ */
+uint32_t
+shf_q_new_name(
+    SHF        * shf     ,
+    const char * name    ,
+    uint32_t     name_len)
+{
+    SHF_ASSERT_INTERNAL(shf              , "ERROR: shf must not be NULL; have you called shf_attach(_existing)()?");
+    SHF_ASSERT_INTERNAL(shf->q.q_is_ready, "ERROR: have you called shf_q_(new|get)()?");
+
+    uint32_t qid = shf->q.q_next; /* todo: enforce this function only called by the queue creator */
+
+    shf->q.q_next ++; SHF_ASSERT(shf->q.q_next <= shf->q.qs, "ERROR: called %s() %u times but only allocated %u queues", __FUNCTION__, shf->q.q_next, shf->q.qs);
+
+    shf_debug_verbosity_less();
+    shf_make_hash(name, name_len);
+    SHF_ASSERT_INTERNAL(SHF_RET_KEY_NONE == shf_get_key_val_copy(shf), "ERROR: %s(): unique queue name already exists!", __FUNCTION__);
+    shf_put_key_val(shf, SHF_CAST(const char *, &qid), sizeof(qid));
+    uint32_t uid_qid = shf_uid;
+    SHF_ASSERT(SHF_UID_NONE != uid_qid, "ERROR: could not put key '%.*s'", name_len, name);
+    // todo: somehow store name for use in debug messages
+    shf_debug_verbosity_more();
+
+    SHF_DEBUG("%s(shf=?, name='%.*s', name_len=%u){} // qid %u\n", __FUNCTION__, name_len, name, name_len, qid);
+
+    return qid;
+} /* shf_q_new_name() */
+
+/**
+ * @brief Associate an unused qid with an ascii name.
+ * - After calling shf_q_get(), call this function for each expected qid.
+ * - Normally called by `Process B`; see @ref ipc_sec.
+ *
+ * @param[in] shf       Attached SHF.
+ * @param[in] name      Ascii name of qid.
+ * @param[in] name_len  Length of ascii name in bytes.
+ * @retval    qid       qid which is now used.
+ *
+ * Example usage:
+ * @code
+ * uint32_t qid = shf_q_get_name(shf, "qid-free");
+ * @endcode
+ */
+uint32_t
+shf_q_get_name(
+    SHF        * shf     ,
+    const char * name    ,
+    uint32_t     name_len)
+{
+    SHF_ASSERT_INTERNAL(shf              , "ERROR: shf must not be NULL; have you called shf_attach(_existing)()?");
+    SHF_ASSERT_INTERNAL(shf->q.q_is_ready, "ERROR: have you called shf_q_(new|get)()?");
+
+    uint32_t qid;
+
+    shf_debug_verbosity_less();
+    shf_make_hash(name, name_len); SHF_ASSERT(SHF_RET_KEY_FOUND == shf_get_key_val_copy(shf), "ERROR: could not get key '%.*s'", name_len, name);
+    shf_debug_verbosity_more();
+
+    SHF_ASSERT(sizeof(qid) == shf_val_len, "ERROR: expected key '%.*s' to have size %lu but got size %u", name_len, name, sizeof(qid), shf_val_len);
+    qid = SHF_CAST(uint32_t *, shf_val)[0];
+    SHF_ASSERT(qid < shf->q.qs, "ERROR: expected 0 <= qid < %u but got %u; did you call shf_q_get() or shf_q_new()?", shf->q.qs, qid);
+
+    SHF_DEBUG("%s(shf=?, name='%.*s', name_len=%u){} // qid %u\n", __FUNCTION__, name_len, name, name_len, qid);
+
+    return qid;
+} /* shf_q_get_name() */
+
+// before:                  tail     next     ...      head
+// before:                  ----     ----     ----     ----
+// before: SHF_QID_NONE <-- last <-- last <-- last <-- last
+// before:                  next --> next --> next --> next --> SHF_QID_NONE
+
+// after :                           tail     ...      head
+// after :                           ----     ----     ----
+// after : SHF_QID_NONE <--      <-- last <-- last <-- last
+// after :                           next --> next --> next --> SHF_QID_NONE
+
+#if 0
+/**
+ * @brief Take a qiid from a qid.
+ *
+ * @param[in] shf             Attached SHF.
+ * @param[in] qiid            qiid to remove from (maybe middle) of qid double linked list.
+ * @retval    #SHF_QIID_NONE  This function is not implemented yet!
+ *
+ * Example usage:
+ * @code
+ * uint32_t qiid = shf_q_take_item(shf, qiid);
+ * @endcode
+ */
+uint32_t
+shf_q_take_item(
+    SHF      * shf ,
+    uint32_t   qiid)
+{
+    SHF_ASSERT_INTERNAL(shf              , "ERROR: shf must not be NULL; have you called shf_attach(_existing)()?");
+    SHF_ASSERT_INTERNAL(shf->q.q_is_ready, "ERROR: have you called shf_q_(new|get)()?");
+
+    SHF_UNUSE(qiid);
+
+    // todo: implement shf_q_take_item()
+
+    return SHF_QIID_NONE;
+} /* shf_q_take_item() */
+#endif
+
+static inline uint32_t
+shf_q_is_lingering( /* 1 if first q item in nolock push qs pushed max linger ago */
+    SHF * shf)
+{
+    return shf->q.q_linger_start && (shf_rdtsc() - shf->q.q_linger_start >= shf->q.q_linger_cycles);
+} /* shf_q_is_lingering() */
+
+static inline void
+shf_q_wake( /* wake all pullers sleeping on qid, if any; called after qiids published by a flush or ring push */
+    SHF      * shf,
+    uint32_t   qid)
+{
+    SHF_Q_WAIT_MMAP * wait = &shf->q.q_waits[qid];
+    __atomic_thread_fence(__ATOMIC_SEQ_CST); /* pairs with fence in shf_q_pull_tail_wait(); either we see its sleepers & armed, or it sees our qiids */
+    if (wait->sleepers && wait->armed && __sync_bool_compare_and_swap(&wait->armed, 1, 0)) { /* only 1 pusher wakes per sleep, not 1 per push */
+        __sync_add_and_fetch(&wait->wakes, 1);
+        syscall(SYS_futex, &wait->wakes, FUTEX_WAKE, INT_MAX, NULL, NULL, 0);
+    }
+} /* shf_q_wake() */
+
+static void
+shf_q_wake_all( /* wake pullers sleeping on any qid with qiids */
+    SHF * shf)
+{
+    for (uint32_t qid = 0; qid < shf->q.qs; qid++) {
+        if (shf->q.qids[qid].size) { shf_q_wake(shf, qid); }
+    }
+} /* shf_q_wake_all() */
+
+static inline uint32_t
+shf_q_now_ms(void) /* monotonic ms for lease deadlines; wraps after ~49 days so only compare differences */
+{
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC_COARSE, &now);
+    return SHF_CAST(uint32_t, (now.tv_sec * 1000) + (now.tv_nsec / 1000000));
+} /* shf_q_now_ms() */
+
+static uint32_t
+shf_q_proc_link( /* caller holds q_lock; walk qiids from tail via next & link them onto qid head; returns qiids linked */
+    SHF      * shf ,
+    uint32_t   qid ,
+    uint32_t   tail)
+{
+    if (SHF_QIID_NONE == tail) {
+        return 0;
+    }
+    /* walk instead of trusting nolock q size & head, which a process may have died before updating */
+    uint32_t size = 1;
+    uint32_t head = tail;
+    shf->q.q_leases[head] = 0; /* qiids in a nolock q are not pulled */
+    while (SHF_QIID_NONE != shf->q.qiids[head].next) {
+        head = shf->q.qiids[head].next;
+        shf->q.q_leases[head] = 0;
+        size ++;
+        SHF_ASSERT_INTERNAL(size <= shf->q.q_items, "ERROR: INTERNAL: walked more than %u qiids from qiid %u", shf->q.q_items, tail);
+    }
+    uint32_t qiid_last = shf->q.qids[qid].head;
+    shf->q.qiids[tail].last = qiid_last;
+    shf->q.qids[qid].head   = head;
+    if (SHF_QIID_NONE == qiid_last) { shf->q.qids[qid].tail     = tail; }
+    else                            { shf->q.qiids[qiid_last].next = tail; }
+    shf->q.qids[qid].size += size;
+    return size;
+} /* shf_q_proc_link() */
+
+static uint32_t
+shf_q_proc_drain( /* caller holds q_lock; move qiids in slot's nolock push qs on to their qids, & in its nolock pull qs back on to their qids */
+    SHF             * shf ,
+    SHF_Q_PROC_MMAP * proc)
+{
+    uint32_t qiids = 0;
+    for (uint32_t i = 0; i < 2 * shf->q.qs; i++) {
+        qiids += shf_q_proc_link(shf, i % shf->q.qs, proc->qids_nolock[i].tail);
+        proc->qids_nolock[i].tail = SHF_QIID_NONE;
+        proc->qids_nolock[i].head = SHF_QIID_NONE;
+        proc->qids_nolock[i].size = 0           ;
+    }
+    return qiids;
+} /* shf_q_proc_drain() */
+
+static uint64_t /* starttime + 1 of pid from /proc/<pid>/stat; 0 if pid went poof or is a zombie; UINT64_MAX if cannot tell */
+shf_q_proc_start(
+    uint32_t pid)
+{
+    char proc_pid_stat[256];
+    SHF_SNPRINTF(0, proc_pid_stat, "/proc/%u/stat", pid);
+    int fd = open(proc_pid_stat, O_RDONLY);
+    if (-1 == fd) {
+        return ENOENT == errno ? 0 : UINT64_MAX; /* e.g. EMFILE; cannot tell */
+    }
+    char    stat[512];
+    ssize_t bytes = read(fd, stat, sizeof(stat) - 1);
+    close(fd);
+    if (bytes <= 0) {
+        return 0; /* process exiting */
+    }
+    stat[bytes] = 0;
+    const char * field = strrchr(stat, ')'); /* e.g. '1234 (comm) S ...'; comm may hold spaces & parens */
+    if (NULL == field) {
+        return UINT64_MAX;
+    }
+    if (('Z' == field[2]) || ('X' == field[2])) {
+        return 0; /* zombie means died but not reaped yet */
+    }
+    for (uint32_t i = 3; (i <= 22) && field; i++) { /* starttime is field 22 */
+        field = strchr(field + 1, ' ');
+    }
+    return field ? strtoull(field + 1, NULL, 10) + 1 : UINT64_MAX;
+} /* shf_q_proc_start() */
+
+static uint32_t /* 1 unless slot owner surely went poof; a reused pid does not count as the owner */
+shf_q_proc_is_alive(
+    SHF_Q_PROC_MMAP * proc ,
+    uint32_t          pid  )
+{
+    uint32_t ns = SHF_LOCK_OWNER_NS(shf_lock_owner_get());
+    if ((0 == ns) || (ns != proc->ns)) {
+        return 1; /* owner's pid is not in our pid namespace, so /proc cannot tell */
+    }
+    uint64_t start = shf_q_proc_start(pid);
+    return (UINT64_MAX == start) || (start == proc->start);
+} /* shf_q_proc_is_alive() */
+
+static void
+shf_q_proc_free( /* nonce first, so a reaper never sees the next owner's pid with this owner's nonce */
+    SHF_Q_PROC_MMAP * proc)
+{
+    __atomic_store_n(&proc->nonce, 0, __ATOMIC_RELEASE);
+    __atomic_store_n(&proc->pid  , 0, __ATOMIC_RELEASE);
+} /* shf_q_proc_free() */
+
+static uint32_t
+shf_q_procs_reap( /* caller holds q_lock; drain & free slots of processes which went poof */
+    SHF * shf)
+{
+    uint32_t qiids = 0;
+    for (uint32_t slot = 0; slot < SHF_Q_PROCS_MAX; slot++) {
+        SHF_Q_PROC_MMAP * proc = shf_q_proc_at(shf, slot);
+        uint32_t          pid  = __atomic_load_n(&proc->pid, __ATOMIC_ACQUIRE);
+        if (pid && __atomic_load_n(&proc->nonce, __ATOMIC_ACQUIRE) && (0 == shf_q_proc_is_alive(proc, pid))) { /* no nonce yet means still claiming */
+            uint32_t drained = shf_q_proc_drain(shf, proc);
+            SHF_DEBUG("%s() // reaped %u qiids from nolock qs of slot %u for pid %u which went poof\n", __FUNCTION__, drained, slot, pid);
+            qiids += drained;
+            shf_q_proc_free(proc);
+        }
+    }
+    return qiids;
+} /* shf_q_procs_reap() */
+
+static uint32_t
+shf_q_proc_claim( /* claim a free __q_procs slot for own nolock qs; upon first push or pull, & first after fork(); 0 if all slots used */
+    SHF * shf)
+{
+    if (shf->q.q_proc_retry && (shf->q.q_proc_retry_gen == shf_q_fork_gen)) { /* come here if recently found all slots used */
+        shf->q.q_proc_retry --;
+        return 0;
+    }
+    uint32_t pid = getpid();
+    for (uint32_t attempt = 0; attempt < 2; attempt++) {
+        for (uint32_t slot = 0; slot < SHF_Q_PROCS_MAX; slot++) {
+            SHF_Q_PROC_MMAP * proc = shf_q_proc_at(shf, slot);
+            if ((0 == proc->pid) && __sync_bool_compare_and_swap(&proc->pid, 0, pid)) {
+                uint32_t nonce;
+                do { nonce = __sync_add_and_fetch(&shf->q.q_procs->nonce, 1) & ~SHF_Q_LEASE_OWNER_UNSLOTTED; } while (0 == nonce);
+                uint64_t start = shf_q_proc_start(pid);
+                proc->start             = start;
+                proc->ns                = ((0 == start) || (UINT64_MAX == start)) ? 0 : SHF_LOCK_OWNER_NS(shf_lock_owner_get()); /* e.g. no /proc, so never reaped */
+                __atomic_store_n(&proc->nonce, nonce, __ATOMIC_RELEASE); /* last, so a reaper sees the start & ns which go with pid */
+                shf->q.q_proc           = proc;
+                shf->q.q_proc_owner     = nonce;
+                shf->q.q_proc_gen       = shf_q_fork_gen;
+                shf->q.qids_nolock_push = &proc->qids_nolock[0        ];
+                shf->q.qids_nolock_pull = &proc->qids_nolock[shf->q.qs];
+                shf->q.q_linger_start   = 0; /* a forked child starts with empty nolock qs */
+                SHF_DEBUG("%s() // claimed slot %u for pid %u\n", __FUNCTION__, slot, pid);
+                return 1;
+            }
+        }
+        /* come here if all slots used; free slots of processes which went poof & try again */
+        shf_debug_verbosity_less(); SHF_LOCK_WRITER(&shf->q.q_lock->lock); shf_debug_verbosity_more();
+        uint32_t qiids = shf_q_procs_reap(shf);
+        shf_debug_verbosity_less(); SHF_UNLOCK_WRITER(&shf->q.q_lock->lock); shf_debug_verbosity_more();
+        if (qiids) { shf_q_wake_all(shf); }
+    }
+    /* come here if all slots used by live processes; push & pull via locked qs for a while, then try again */
+    shf->q.q_proc           = NULL;
+    shf->q.q_proc_owner     = pid | SHF_Q_LEASE_OWNER_UNSLOTTED;
+    shf->q.q_proc_gen       = 0; /* so each push & pull comes back here */
+    shf->q.q_proc_retry     = SHF_Q_PROC_RETRY;
+    shf->q.q_proc_retry_gen = shf_q_fork_gen;
+    shf->q.qids_nolock_push = NULL;
+    shf->q.qids_nolock_pull = NULL;
+    SHF_DEBUG("%s() // all %u slots used by live processes; pid %u pushes & pulls via locked qs\n", __FUNCTION__, SHF_Q_PROCS_MAX, pid);
+    return 0;
+} /* shf_q_proc_claim() */
+
+static void
+shf_q_proc_release( /* return qiids in own nolock qs to their qids & free own __q_procs slot; upon shf_detach() */
+    SHF * shf)
+{
+    if (shf->q.q_proc && (shf->q.q_proc_gen == shf_q_fork_gen)) { /* a forked child's q_proc is still its parent's */
+        shf_debug_verbosity_less(); SHF_LOCK_WRITER(&shf->q.q_lock->lock); shf_debug_verbosity_more();
+        uint32_t qiids = shf_q_proc_drain(shf, shf->q.q_proc);
+        shf_debug_verbosity_less(); SHF_UNLOCK_WRITER(&shf->q.q_lock->lock); shf_debug_verbosity_more();
+        if (qiids) { shf_q_wake_all(shf); }
+        shf_q_proc_free(shf->q.q_proc);
+    }
+    shf->q.q_proc           = NULL;
+    shf->q.q_proc_gen       = 0;
+    shf->q.qids_nolock_push = NULL;
+    shf->q.qids_nolock_pull = NULL;
+} /* shf_q_proc_release() */
+
+static inline void
+shf_q_lease_begin( /* record own process as owner of qiid being pulled; before unlinking it from nolock pull q */
+    SHF      * shf ,
+    uint32_t   qiid)
+{
+    shf->q.q_leases[qiid] = SHF_Q_LEASE(shf->q.q_proc_owner, 0); /* no deadline yet, so reaper cannot take qiid while still linked */
+} /* shf_q_lease_begin() */
+
+static inline void
+shf_q_lease_deadline( /* start lease time of qiid pulled by own process; after unlinking it from nolock pull q */
+    SHF      * shf ,
+    uint32_t   qiid)
+{
+    uint32_t lease_ms = shf->q.q_procs->lease_ms;
+    if (lease_ms) {
+        uint32_t deadline = shf_q_now_ms() + lease_ms;
+        deadline = deadline ? deadline : 1; /* 0 means never */
+        shf->q.q_leases[qiid] = SHF_Q_LEASE(shf->q.q_proc_owner, deadline);
+    }
+} /* shf_q_lease_deadline() */
+
+static inline uint32_t
+shf_q_lease_end( /* 1 if qiid may be pushed; 0 if reaped; before linking it into nolock push q */
+    SHF      * shf ,
+    uint32_t   qiid)
+{
+    if (0 == shf->q.q_procs->is_reap) { /* come here if shf_q_set_reap() not called; no leases to check */
+        return 1;
+    }
+    uint64_t lease = __atomic_load_n(&shf->q.q_leases[qiid], __ATOMIC_ACQUIRE);
+    if (0 == SHF_Q_LEASE_OWNER(lease)) {
+        SHF_DEBUG("%s() // ignoring push of qiid %u which is not pulled; reaped or pushed twice?\n", __FUNCTION__, qiid);
+        return 0;
+    }
+    if ((SHF_Q_LEASE_OWNER(lease) != shf->q.q_proc_owner) || SHF_Q_LEASE_DEADLINE(lease)) {
+        /* come here if reaper may race us; lease may expire, or qiid pulled by another process, e.g. parent before fork() or before shf_q_set_reap(); take lease with no deadline */
+        if (0 == __sync_bool_compare_and_swap(&shf->q.q_leases[qiid], lease, SHF_Q_LEASE(shf->q.q_proc_owner, 0))) {
+            SHF_DEBUG("%s() // ignoring push of qiid %u which was reaped\n", __FUNCTION__, qiid);
+            return 0;
+        }
+    }
+    return 1;
+} /* shf_q_lease_end() */
+
+static void
+shf_q_unslotted_push( /* push qiid straight on to qid under q lock; for a process without a __q_procs slot */
+    SHF      * shf      ,
+    uint32_t   push_qid ,
+    uint32_t   push_qiid)
+{
+    if ((SHF_QIID_NONE == push_qiid) || (0 == shf_q_lease_end(shf, push_qiid))) {
+        return;
+    }
+
+    shf_debug_verbosity_less(); SHF_LOCK_WRITER(&shf->q.q_lock->lock); shf_debug_verbosity_more();
+
+    uint32_t qiid_last = shf->q.qids[push_qid].head;
+    shf->q.qiids[push_qiid].last = qiid_last;
+    shf->q.qiids[push_qiid].next = SHF_QIID_NONE;
+    shf->q.qids[push_qid].head   = push_qiid;
+    if (SHF_QIID_NONE == qiid_last) { shf->q.qids[push_qid].tail   = push_qiid; }
+    else                            { shf->q.qiids[qiid_last].next = push_qiid; }
+    shf->q.qids[push_qid].size ++;
+    if (shf->q.q_procs->is_reap) { shf->q.q_leases[push_qiid] = 0; }
+
+    shf_debug_verbosity_less(); SHF_UNLOCK_WRITER(&shf->q.q_lock->lock); shf_debug_verbosity_more();
 
-    SHF_DEBUG("%s(shf=?, qs=%u, q_items=%u, q_item_size=%u){} // 0x%p\n", __FUNCTION__, qs, q_items, q_item_size, shf->q.q_item_addr);
+    shf_q_wake(shf, push_qid);
+} /* shf_q_unslotted_push() */
 
-#ifdef SHF_DEBUG_VERSION
-    shf->q.q_lock->debug_magic = 1234567;
-#endif
+static uint32_t
+shf_q_unslotted_pull( /* pull qiid straight off qid tail under q lock; for a process without a __q_procs slot */
+    SHF      * shf     ,
+    uint32_t   pull_qid)
+{
+    shf_debug_verbosity_less(); SHF_LOCK_WRITER(&shf->q.q_lock->lock); shf_debug_verbosity_more();
 
-    shf->q.q_is_ready = 1;
+    uint32_t pull_qiid = shf->q.qids[pull_qid].tail;
+    if (SHF_QIID_NONE != pull_qiid) {
+        if (shf->q.q_procs->is_reap) { /* reaper also takes q lock, so cannot see lease before unlink */
+            shf_q_lease_begin   (shf, pull_qiid);
+            shf_q_lease_deadline(shf, pull_qiid);
+        }
+        uint32_t qiid_next = shf->q.qiids[pull_qiid].next;
+        shf->q.qids[pull_qid].tail = qiid_next;
+        if (SHF_QIID_NONE == qiid_next) { shf->q.qids[pull_qid].head   = SHF_QIID_NONE; }
+        else                            { shf->q.qiids[qiid_next].last = SHF_QIID_NONE; }
+        shf->q.qids[pull_qid].size --;
+    }
 
-    return shf->q.q_item_addr;
-} /* shf_q_new() */
+    shf_debug_verbosity_less(); SHF_UNLOCK_WRITER(&shf->q.q_lock->lock); shf_debug_verbosity_more();
+
+    shf_qiid          = pull_qiid;
+    shf_qiid_addr     = SHF_QIID_NONE == pull_qiid ? NULL : shf->q.q_item_addr + (pull_qiid * shf->q.q_item_size);
+    shf_qiid_addr_len = SHF_QIID_NONE == pull_qiid ? 0    :                                   shf->q.q_item_size ;
+    return pull_qiid;
+} /* shf_q_unslotted_pull() */
 
 /**
- * @brief Associate an unused qid with an ascii name.
- * - After calling shf_q_new(), call this function q_items times.
- * - Normally called by `Process A`; see @ref ipc_sec.
+ * @brief Set where shf_q_reap() returns qiids pulled by processes which went poof, & optionally a lease time.
+ * - Only for queues created with a `qids_nolock_max` count, not #SHF_Q_MPMC or #SHF_Q_SPSC; see @ref ipc_sec.
+ * - Enables shf_q_reap(); until then it does nothing, & pulls & pushes record no leases, so cost nothing extra.
+ * - Qiids already pulled when first called are never reaped, because their owners are unknown.
+ * - If shf_attach() was called with `delete_upon_process_exit` then `shf.monitor` calls shf_q_reap() every `reap_ms`.
  *
  * @param[in] shf       Attached SHF.
- * @param[in] name      Ascii name of qid.
- * @param[in] name_len  Length of ascii name in bytes.
- * @retval    qid       qid which is now used.
+ * @param[in] reap_qid  qid to push reaped qiids on to, e.g. the free qid.
+ * @param[in] lease_ms  0 means a pulled qiid is only reaped if the process which pulled it goes poof, & never if it had no __q_procs slot, else also if not pushed within lease_ms.
+ * @param[in] reap_ms   0 means only reap when shf_q_reap() called, else also by `shf.monitor` every reap_ms.
  *
  * Example usage:
  * @code
- * uint32_t qid = shf_q_new_name(shf, "qid-free");
+ * shf_q_set_reap(shf, qid_free, 0, 1000); // shf.monitor returns qiids of crashed processes to qid_free within about a second
  * @endcode
  */
-uint32_t
-shf_q_new_name(
-    SHF        * shf     ,
-    const char * name    ,
-    uint32_t     name_len)
+void
+shf_q_set_reap(
+    SHF      * shf     ,
+    uint32_t   reap_qid,
+    uint32_t   lease_ms,
+    uint32_t   reap_ms )
 {
-    SHF_ASSERT_INTERNAL(shf              , "ERROR: shf must not be NULL; have you called shf_attach(_existing)()?");
-    SHF_ASSERT_INTERNAL(shf->q.q_is_ready, "ERROR: have you called shf_q_(new|get)()?");
-
-    uint32_t qid = shf->q.q_next; /* todo: enforce this function only called by the queue creator */
-
-    shf->q.q_next ++; SHF_ASSERT(shf->q.q_next <= shf->q.qs, "ERROR: called %s() %u times but only allocated %u queues", __FUNCTION__, shf->q.q_next, shf->q.qs);
+    SHF_ASSERT_INTERNAL(shf                   , "ERROR: shf must not be NULL; have you called shf_attach(_existing)()?");
+    SHF_ASSERT_INTERNAL(shf->q.q_is_ready     , "ERROR: have you called shf_q_(new|get)()?");
+    SHF_ASSERT_INTERNAL(NULL == shf->q.q_rings, "ERROR: SHF_Q_MPMC & SHF_Q_SPSC queues have no nolock queues or leases");
+    SHF_ASSERT_INTERNAL(reap_qid < shf->q.qs  , "ERROR: expected 0 <= reap_qid < %u but got %u", shf->q.qs, reap_qid);
+
+    shf->q.q_procs->lease_ms = lease_ms;
+    if (0 == shf->q.q_procs->is_reap) { /* come here if first call; no leases written yet */
+        for (uint32_t qiid = 0; qiid < shf->q.q_items; qiid++) {
+            shf->q.q_leases[qiid] = SHF_Q_LEASE(SHF_Q_LEASE_OWNER_UNKNOWN, 0); /* pushes still allowed, but never reaped */
+        }
+        __atomic_store_n(&shf->q.q_procs->is_reap, 1, __ATOMIC_RELEASE); /* after leases, so pullers which see it overwrite them */
+    }
 
+    uint32_t reap[2] = { reap_qid, reap_ms };
     shf_debug_verbosity_less();
-    shf_make_hash(name, name_len);
-    SHF_ASSERT_INTERNAL(SHF_RET_KEY_NONE == shf_get_key_val_copy(shf), "ERROR: %s(): unique queue name already exists!", __FUNCTION__);
-    shf_put_key_val(shf, SHF_CAST(const char *, &qid), sizeof(qid));
-    uint32_t uid_qid = shf_uid;
-    SHF_ASSERT(SHF_UID_NONE != uid_qid, "ERROR: could not put key '%.*s'", name_len, name);
-    // todo: somehow store name for use in debug messages
+    shf_make_hash(SHF_CONST_STR_AND_SIZE("__q_reap"));
+    if (SHF_RET_KEY_FOUND == shf_get_key_val_addr(shf)) { memcpy(shf_val_addr, reap, sizeof(reap)); }
+    else                                                { shf_put_key_val(shf, SHF_CAST(const char *, reap), sizeof(reap)); }
     shf_debug_verbosity_more();
 
-    SHF_DEBUG("%s(shf=?, name='%.*s', name_len=%u){} // qid %u\n", __FUNCTION__, name_len, name, name_len, qid);
+    char file_reap[256]; /* shf.monitor only attaches to reap if this file exists */
+    SHF_SNPRINTF(0, file_reap, "%s/%s.shf/q.reap", shf->path, shf->name);
+    if (reap_ms) { int fd = open(file_reap, O_WRONLY | O_CREAT, 0600); SHF_ASSERT(-1 != fd, "open(): %u: ", errno); close(fd); }
+    else         { unlink(file_reap); }
 
-    return qid;
-} /* shf_q_new_name() */
+    SHF_DEBUG("%s(shf=?, reap_qid=%u, lease_ms=%u, reap_ms=%u){}\n", __FUNCTION__, reap_qid, lease_ms, reap_ms);
+} /* shf_q_set_reap() */
 
 /**
- * @brief Associate an unused qid with an ascii name.
- * - After calling shf_q_get(), call this function for each expected qid.
- * - Normally called by `Process B`; see @ref ipc_sec.
+ * @brief Return qiids held by processes which went poof to qids.
+ * - Qiids in a dead process's nolock push qs are pushed on to their qids, as if it had flushed.
+ * - Qiids in a dead process's nolock pull qs go back on to their qids; it never saw them.
+ * - Qiids pulled by a dead or detached process, or not pushed within the lease time, are pushed on to `reap_qid`.
+ * - A process counts as gone once /proc shows its pid gone, a zombie, or reused since it claimed its __q_procs slot.
+ * - So reaping needs the reaping & reaped processes to share a pid namespace; slots of processes in other pid namespaces are never reaped.
+ * - Qiids pulled by a process without a __q_procs slot, see @ref ipc_sec, are only reaped once their lease expires, so set a `lease_ms` if more than 64 processes may pull.
+ * - A later push of a reaped qiid by a live process is ignored.
+ * - Does nothing until shf_q_set_reap() has been called, so may be called periodically by any attached process, e.g. `shf.monitor`.
+ * - Gets the qs if shf_q_get() not yet called; see @ref ipc_sec.
  *
- * @param[in] shf       Attached SHF.
- * @param[in] name      Ascii name of qid.
- * @param[in] name_len  Length of ascii name in bytes.
- * @retval    qid       qid which is now used.
+ * @param[in] shf  Attached SHF.
+ * @retval    Number of qiids returned to qids.
  *
  * Example usage:
  * @code
- * uint32_t qid = shf_q_get_name(shf, "qid-free");
+ * waitpid(worker, NULL, 0);
+ * shf_q_reap(shf);
  * @endcode
  */
 uint32_t
-shf_q_get_name(
-    SHF        * shf     ,
-    const char * name    ,
-    uint32_t     name_len)
+shf_q_reap(
+    SHF * shf)
 {
-    SHF_ASSERT_INTERNAL(shf              , "ERROR: shf must not be NULL; have you called shf_attach(_existing)()?");
-    SHF_ASSERT_INTERNAL(shf->q.q_is_ready, "ERROR: have you called shf_q_(new|get)()?");
-
-    uint32_t qid;
+    SHF_ASSERT_INTERNAL(shf, "ERROR: shf must not be NULL; have you called shf_attach(_existing)()?");
 
     shf_debug_verbosity_less();
-    shf_make_hash(name, name_len); SHF_ASSERT(SHF_RET_KEY_FOUND == shf_get_key_val_copy(shf), "ERROR: could not get key '%.*s'", name_len, name);
+    shf_make_hash(SHF_CONST_STR_AND_SIZE("__q_reap" )); uint32_t is_reap  = SHF_RET_KEY_FOUND == shf_get_key_val_copy(shf); uint32_t reap_qid = is_reap ? SHF_CAST(uint32_t *, shf_val)[0] : SHF_QID_NONE;
+    shf_make_hash(SHF_CONST_STR_AND_SIZE("__q_procs")); uint32_t is_procs = SHF_RET_KEY_FOUND == shf_get_key_val_addr(shf);
     shf_debug_verbosity_more();
+    if (0 == is_reap) { /* come here if shf_q_set_reap() not called, or qs deleted */
+        return 0;
+    }
+    if (shf->q.q_is_ready && (shf->q.q_procs != shf_q_align(shf_val_addr))) { /* come here if qs deleted & created again since shf_q_get(), e.g. by a monitoring process */
+        shf->q.q_proc     = NULL;
+        shf->q.q_is_ready = 0;
+    }
+    if (0 == shf->q.q_is_ready) {
+        SHF_ASSERT_INTERNAL(is_procs, "ERROR: INTERNAL: __q_reap key without __q_procs key");
+        shf_q_get(shf);
+    }
 
-    SHF_ASSERT(sizeof(qid) == shf_val_len, "ERROR: expected key '%.*s' to have size %lu but got size %u", name_len, name, sizeof(qid), shf_val_len);
-    qid = SHF_CAST(uint32_t *, shf_val)[0];
-    SHF_ASSERT(qid < shf->q.qs, "ERROR: expected 0 <= qid < %u but got %u; did you call shf_q_get() or shf_q_new()?", shf->q.qs, qid);
+    shf_debug_verbosity_less(); SHF_LOCK_WRITER(&shf->q.q_lock->lock); shf_debug_verbosity_more();
 
-    SHF_DEBUG("%s(shf=?, name='%.*s', name_len=%u){} // qid %u\n", __FUNCTION__, name_len, name, name_len, qid);
+    uint32_t qiids  = shf_q_procs_reap(shf); /* first, so qiids in dead nolock qs are not also reaped as leased */
+    uint32_t leased = 0;
+    uint32_t now    = shf_q_now_ms();
+    for (uint32_t qiid = 0; qiid < shf->q.q_items; qiid++) {
+        uint64_t lease = shf->q.q_leases[qiid];
+        if (0 == lease) {
+            continue;
+        }
+        uint32_t owner    = SHF_Q_LEASE_OWNER   (lease);
+        uint32_t deadline = SHF_Q_LEASE_DEADLINE(lease);
+        uint32_t is_owned = 1; /* a process without a slot has no token to tell its pid from a reused one, so only its deadline counts */
+        if (SHF_Q_LEASE_OWNER_UNKNOWN == owner) {
+            continue;
+        }
+        else if (0 == (owner & SHF_Q_LEASE_OWNER_UNSLOTTED)) {
+            is_owned = 0; /* by a live process with a slot? */
+            for (uint32_t slot = 0; slot < SHF_Q_PROCS_MAX; slot++) {
+                if (owner == shf_q_proc_at(shf, slot)->nonce) { is_owned = 1; break; }
+            }
+        }
+        if (is_owned && ((0 == deadline) || (SHF_CAST(int32_t, now - deadline) < 0))) {
+            continue;
+        }
+        if (0 == __sync_bool_compare_and_swap(&shf->q.q_leases[qiid], lease, 0)) { /* come here if owner pushed qiid meanwhile */
+            continue;
+        }
+        shf->q.qiids[qiid].next = SHF_QIID_NONE; /* still points into the nolock pull q it was pulled from */
+        leased += shf_q_proc_link(shf, reap_qid, qiid);
+    }
 
-    return qid;
-} /* shf_q_get_name() */
+    shf_debug_verbosity_less(); SHF_UNLOCK_WRITER(&shf->q.q_lock->lock); shf_debug_verbosity_more();
 
-// before:                  tail     next     ...      head
-// before:                  ----     ----     ----     ----
-// before: SHF_QID_NONE <-- last <-- last <-- last <-- last
-// before:                  next --> next --> next --> next --> SHF_QID_NONE
+    if (qiids + leased) { shf_q_wake_all(shf); }
 
-// after :                           tail     ...      head
-// after :                           ----     ----     ----
-// after : SHF_QID_NONE <--      <-- last <-- last <-- last
-// after :                           next --> next --> next --> SHF_QID_NONE
+    SHF_DEBUG("%s(shf=?){} // %u qiids from nolock qs & %u leased qiids to reap_qid %u\n", __FUNCTION__, qiids, leased, reap_qid);
+    return qiids + leased;
+} /* shf_q_reap() */
 
-#if 0
-/**
- * @brief Take a qiid from a qid.
- *
- * @param[in] shf             Attached SHF.
- * @param[in] qiid            qiid to remove from (maybe middle) of qid double linked list.
- * @retval    #SHF_QIID_NONE  This function is not implemented yet!
- *
- * Example usage:
- * @code
- * uint32_t qiid = shf_q_take_item(shf, qiid);
- * @endcode
- */
-uint32_t
-shf_q_take_item(
-    SHF      * shf ,
-    uint32_t   qiid)
+static inline uint32_t /* SHF_RET_OK, or SHF_RET_Q_FULL if batch not pushed */
+shf_q_spsc_push( /* one release store publishes whole batch to the puller */
+    SHF            * shf           ,
+    uint32_t         push_qid      ,
+    const uint32_t * push_qiids    ,
+    uint32_t         push_qiids_len)
 {
-    SHF_ASSERT_INTERNAL(shf              , "ERROR: shf must not be NULL; have you called shf_attach(_existing)()?");
-    SHF_ASSERT_INTERNAL(shf->q.q_is_ready, "ERROR: have you called shf_q_(new|get)()?");
+    SHF_Q_RING_MMAP  * ring  =  &shf->q.q_rings      [push_qid];
+    SHF_Q_SLOT_MMAP  * slots =  &shf->q.q_slots      [push_qid * (shf->q.q_ring_mask + 1)];
+    SHF_Q_SPSC_CACHE * cache =  &shf->q.q_spsc_caches[push_qid];
+    uint32_t           pos   = ring->push_pos; /* only written by this process */
+    if (pos + push_qiids_len - cache->pull_pos_seen > shf->q.q_ring_mask + 1) { /* come here if ring looks too full to push */
+        cache->pull_pos_seen = __atomic_load_n(&ring->pull_pos, __ATOMIC_ACQUIRE);
+        if (pos + push_qiids_len - cache->pull_pos_seen > shf->q.q_ring_mask + 1) {
+            return SHF_RET_Q_FULL; /* ring holds all q_items so a qiid was pushed while already queued */
+        }
+    }
+    for (uint32_t i = 0; i < push_qiids_len; i++) {
+        slots[(pos + i) & shf->q.q_ring_mask].qiid = push_qiids[i];
+    }
+    __atomic_store_n(&ring->push_pos, pos + push_qiids_len, __ATOMIC_RELEASE);
+    shf_q_wake(shf, push_qid);
+    return SHF_RET_OK;
+} /* shf_q_spsc_push() */
+
+static inline uint32_t
+shf_q_spsc_pull( /* one release store frees whole batch of slots to the pusher */
+    SHF      * shf           ,
+    uint32_t   pull_qid      ,
+    uint32_t * pull_qiids    ,
+    uint32_t   pull_qiids_max)
+{
+    SHF_Q_RING_MMAP  * ring  =  &shf->q.q_rings      [pull_qid];
+    SHF_Q_SLOT_MMAP  * slots =  &shf->q.q_slots      [pull_qid * (shf->q.q_ring_mask + 1)];
+    SHF_Q_SPSC_CACHE * cache =  &shf->q.q_spsc_caches[pull_qid];
+    uint32_t           pos   = ring->pull_pos; /* only written by this process */
+    int32_t            avail = cache->push_pos_seen - pos;
+    if (avail < SHF_CAST(int32_t, pull_qiids_max)) { /* come here if too few qiids seen to pull */
+        cache->push_pos_seen = __atomic_load_n(&ring->push_pos, __ATOMIC_ACQUIRE);
+        avail                = cache->push_pos_seen - pos;
+    }
+    uint32_t pulled = avail <= 0 ? 0 : (SHF_CAST(uint32_t, avail) < pull_qiids_max ? SHF_CAST(uint32_t, avail) : pull_qiids_max);
+    for (uint32_t i = 0; i < pulled; i++) {
+        pull_qiids[i] = slots[(pos + i) & shf->q.q_ring_mask].qiid;
+    }
+    if (pulled) { __atomic_store_n(&ring->pull_pos, pos + pulled, __ATOMIC_RELEASE); }
+    return pulled;
+} /* shf_q_spsc_pull() */
 
-    SHF_UNUSE(qiid);
+static inline uint32_t /* SHF_RET_OK, or SHF_RET_Q_FULL if not pushed */
+shf_q_ring_push(
+    SHF      * shf      ,
+    uint32_t   push_qid ,
+    uint32_t   push_qiid)
+{
+    if (shf->q.q_spsc_caches) {
+        return shf_q_spsc_push(shf, push_qid, &push_qiid, 1);
+    }
 
-    // todo: implement shf_q_take_item()
+    SHF_Q_RING_MMAP * ring  =  &shf->q.q_rings[push_qid];
+    SHF_Q_SLOT_MMAP * slots =  &shf->q.q_slots[push_qid * (shf->q.q_ring_mask + 1)];
+    SHF_Q_SLOT_MMAP * slot  ;
+    uint32_t          pos   = ring->push_pos;
+    do {
+        slot         = &slots[pos & shf->q.q_ring_mask];
+        int32_t diff = __atomic_load_n(&slot->seq, __ATOMIC_ACQUIRE) - pos;
+        if      (0 == diff) { if (__sync_bool_compare_and_swap(&ring->push_pos, pos, pos + 1)) { break; } pos = ring->push_pos; } /* claim slot */
+        else if (0 <  diff) {                                                                             pos = ring->push_pos; } /* other pusher claimed slot */
+        else                { return SHF_RET_Q_FULL;                                                                             } /* ring holds all q_items so a qiid was pushed while already queued */
+    } while (1);
+    slot->qiid = push_qiid;
+    __atomic_store_n(&slot->seq, pos + 1, __ATOMIC_RELEASE); /* publish qiid to pullers */
+    shf_q_wake(shf, push_qid);
+    return SHF_RET_OK;
+} /* shf_q_ring_push() */
+
+static inline uint32_t
+shf_q_ring_pull( /* sets shf_qiid* like shf_q_pull_tail() */
+    SHF      * shf     ,
+    uint32_t   pull_qid)
+{
+    uint32_t pull_qiid;
+
+    if (shf->q.q_spsc_caches) {
+        if (0 == shf_q_spsc_pull(shf, pull_qid, &pull_qiid, 1)) { goto SHF_Q_RING_EMPTY; }
+        goto SHF_Q_RING_PULLED;
+    }
+
+    SHF_Q_RING_MMAP * ring  =  &shf->q.q_rings[pull_qid];
+    SHF_Q_SLOT_MMAP * slots =  &shf->q.q_slots[pull_qid * (shf->q.q_ring_mask + 1)];
+    SHF_Q_SLOT_MMAP * slot  ;
+    uint32_t          pos   = ring->pull_pos;
+    do {
+        slot         = &slots[pos & shf->q.q_ring_mask];
+        int32_t diff = __atomic_load_n(&slot->seq, __ATOMIC_ACQUIRE) - (pos + 1);
+        if      (0 == diff) { if (__sync_bool_compare_and_swap(&ring->pull_pos, pos, pos + 1)) { break; } pos = ring->pull_pos; } /* claim slot */
+        else if (0 <  diff) {                                                                             pos = ring->pull_pos; } /* other puller claimed slot */
+        else                { goto SHF_Q_RING_EMPTY;                                                                             }
+    } while (1);
+    pull_qiid = slot->qiid;
+    __atomic_store_n(&slot->seq, pos + shf->q.q_ring_mask + 1, __ATOMIC_RELEASE); /* free slot for push one lap later */
+
+    SHF_Q_RING_PULLED:;
+    shf_qiid          =                       pull_qiid                      ;
+    shf_qiid_addr     = shf->q.q_item_addr + (pull_qiid * shf->q.q_item_size);
+    shf_qiid_addr_len =                                   shf->q.q_item_size ;
+    return pull_qiid;
 
+    SHF_Q_RING_EMPTY:;
+    shf_qiid          = SHF_QIID_NONE;
+    shf_qiid_addr     = NULL         ;
+    shf_qiid_addr_len = 0            ;
     return SHF_QIID_NONE;
-} /* shf_q_take_item() */
-#endif
+} /* shf_q_ring_pull() */
 
 /**
  * @brief Pull a qiid off qid tail.
@@ -1578,8 +4283,16 @@ shf_q_pull_tail(
     SHF_ASSERT(pull_qid  < shf->q.qs, "ERROR: expected 0 <= pull_qid < %u but got %u", shf->q.qs, pull_qid );
 #endif
 
-    if (shf->q.qids_nolock_pull[pull_qid].size == 0) {
-        /* come here if local pull queue is emtpy */
+    if (shf->q.q_rings) {
+        return shf_q_ring_pull(shf, pull_qid);
+    }
+
+    if ((shf->q.q_proc_gen != shf_q_fork_gen) && (0 == shf_q_proc_claim(shf))) { /* come here upon first push or pull, or first after fork(), or if no slot */
+        return shf_q_unslotted_pull(shf, pull_qid);
+    }
+
+    if ((shf->q.qids_nolock_pull[pull_qid].size == 0) || shf_q_is_lingering(shf)) {
+        /* come here if local pull queue is emtpy or local push queues lingered too long */
         shf_q_flush(shf, pull_qid);
     }
 
@@ -1598,10 +4311,13 @@ shf_q_pull_tail(
 #ifdef SHF_DEBUG_VERSION
         SHF_ASSERT(pull_qiid < shf->q.q_items, "ERROR: INTERNAL: in nolock pull tail qiid is %u but should be < %u\n", pull_qiid, shf->q.q_items);
 #endif
+        uint32_t is_reap = shf->q.q_procs->is_reap;
+        if (is_reap) { shf_q_lease_begin(shf, pull_qiid); } /* before unlinking; if we go poof in between then reaper finds it in nolock pull q */
         uint32_t qiid_next = shf->q.qiids[pull_qiid].next;
         shf->q.qids_nolock_pull[pull_qid].tail = qiid_next;
         if (SHF_QIID_NONE == qiid_next) { shf->q.qids_nolock_pull[pull_qid].head = SHF_QIID_NONE; }
         else                            { shf->q.qiids[qiid_next].last           = SHF_QIID_NONE; }
+        if (is_reap) { shf_q_lease_deadline(shf, pull_qiid); } /* after unlinking; so an expired lease is never on a linked qiid */
 #ifdef SHF_DEBUG_VERSION
         SHF_DEBUG("%s() // nolock pull q size=%u, pull_qid=%u, qiid=%u, qiid_next=%u, head=%u, tail=%u\n", __FUNCTION__, shf->q.qids_nolock_pull[pull_qid].size, pull_qid, pull_qiid, qiid_next, shf->q.qids_nolock_pull[pull_qid].head, shf->q.qids_nolock_pull[pull_qid].tail);
 #endif
@@ -1614,25 +4330,112 @@ shf_q_pull_tail(
     return pull_qiid;
 } /* shf_q_pull_tail() */
 
+static uint32_t
+shf_q_is_empty_hint( /* cheap check for polling; no lock & may be stale */
+    SHF      * shf,
+    uint32_t   qid)
+{
+    if (shf->q.q_rings) { return shf->q.q_rings[qid].push_pos == shf->q.q_rings[qid].pull_pos; }
+    else                { return ((NULL == shf->q.qids_nolock_pull) || (0 == shf->q.qids_nolock_pull[qid].size)) && (0 == shf->q.qids[qid].size); } /* NULL if no slot */
+} /* shf_q_is_empty_hint() */
+
 /**
- * @brief Push a qiid on qid head.
- * - Sets the thread local variable @ref shf_qiid          to the qiid pulled if found, else #SHF_QIID_NONE.
- * - Sets the thread local variable @ref shf_qiid_addr     to point to the first byte of the queue item if found, else NULL.
- * - Sets the thread local variable @ref shf_qiid_addr_len to the length in bytes of the queue item if found, else zero.
- * - For a faster function see shf_q_push_head_pull_tail(); see @ref ipc_sec for why.
+ * @brief Pull a qiid off qid tail, waiting for one to be pushed if necessary.
+ * - Sets the thread local variables @ref shf_qiid etc like shf_q_pull_tail().
+ * - First polls for an adaptive period, so busy pullers get full polling throughput.
+ * - Then sleeps on a per qid futex in shared memory until a pusher wakes it, so idle pullers cost no CPU.
+ * - Pushers only make a wake syscall if pullers sleep on the qid, & then only the first push since a puller started sleeping does.
+ * - With a `qids_nolock_max` > 1 then qiids stay invisible in the pusher's nolock pre-queue until it flushes; see @ref ipc_sec.
  *
  * @param[in] shf             Attached SHF.
- * @param[in] push_qid        qid to push on to.
- * @param[in] push_qiid       qiid to push.
+ * @param[in] pull_qid        qid to pull qiid from.
+ * @param[in] timeout_ms      Milliseconds to wait, or #SHF_Q_WAIT_FOREVER.
  * @retval    qiid            qiid pulled from qid.
- * @retval    #SHF_QIID_NONE  If no qiid available.
+ * @retval    #SHF_QIID_NONE  If no qiid pushed before timeout.
  *
  * Example usage:
  * @code
- * uint32_t qiid = shf_q_pull_tail(shf, qid_free);
+ * while(SHF_QIID_NONE != shf_q_pull_tail_wait(shf, qid_a2b, SHF_Q_WAIT_FOREVER)) {
+ *     // your business logic here
+ *     shf_q_push_head(shf, qid_b2a, shf_qiid);
+ * }
  * @endcode
  */
-void
+uint32_t
+shf_q_pull_tail_wait(
+    SHF      * shf       ,
+    uint32_t   pull_qid  ,
+    uint32_t   timeout_ms)
+{
+    SHF_ASSERT_INTERNAL(shf              , "ERROR: shf must not be NULL; have you called shf_attach(_existing)()?");
+    SHF_ASSERT_INTERNAL(shf->q.q_is_ready, "ERROR: have you called shf_q_(new|get)()?");
+
+    uint32_t pull_qiid = shf_q_pull_tail(shf, pull_qid); /* also flushes own nolock push qs */
+    if (SHF_QIID_NONE != pull_qiid) {
+        return pull_qiid;
+    }
+
+    SHF_Q_WAIT_MMAP * wait       = &shf->q.q_waits[pull_qid];
+    uint32_t          spin_limit = wait->spin_limit ? wait->spin_limit : SHF_Q_WAIT_SPIN_MIN;
+    uint32_t          spin       = 0;
+    uint32_t          slept      = 0;
+    for (; spin < spin_limit; spin++) {
+        SHF_CPU_PAUSE();
+        if (! shf_q_is_empty_hint(shf, pull_qid) && (SHF_QIID_NONE != (pull_qiid = shf_q_pull_tail(shf, pull_qid)))) {
+            goto SHF_Q_WAITED;
+        }
+    }
+
+    struct timespec deadline; /* absolute for FUTEX_WAIT_BITSET */
+    clock_gettime(CLOCK_MONOTONIC, &deadline);
+    deadline.tv_sec  += timeout_ms / 1000;
+    deadline.tv_nsec += (timeout_ms % 1000) * 1000000L;
+    if (deadline.tv_nsec >= 1000000000L) { deadline.tv_sec ++; deadline.tv_nsec -= 1000000000L; }
+    do {
+        uint32_t wakes = wait->wakes; /* before arming, so a pusher which disarms after us also bumps wakes past this */
+        __sync_fetch_and_add(&wait->sleepers, 1);
+        __atomic_store_n(&wait->armed, 1, __ATOMIC_RELAXED);
+        __atomic_thread_fence(__ATOMIC_SEQ_CST); /* pairs with fence in shf_q_wake(); before re-pulling, so pusher either sees us or we see its qiid */
+        pull_qiid = shf_q_pull_tail(shf, pull_qid);
+        if (SHF_QIID_NONE == pull_qiid) {
+            struct timespec now;
+            clock_gettime(CLOCK_MONOTONIC, &now);
+            if ((SHF_Q_WAIT_FOREVER != timeout_ms) && ((now.tv_sec > deadline.tv_sec) || ((now.tv_sec == deadline.tv_sec) && (now.tv_nsec >= deadline.tv_nsec)))) {
+                __sync_fetch_and_sub(&wait->sleepers, 1);
+                break; /* timed out */
+            }
+            syscall(SYS_futex, &wait->wakes, FUTEX_WAIT_BITSET, wakes, SHF_Q_WAIT_FOREVER == timeout_ms ? NULL : &deadline, NULL, FUTEX_BITSET_MATCH_ANY); /* returns at once if wakes changed */
+            slept = 1;
+        }
+        __sync_fetch_and_sub(&wait->sleepers, 1);
+    } while (SHF_QIID_NONE == pull_qiid);
+
+    SHF_Q_WAITED:;
+    /* poll longer next time if polling paid off, else shorter; moves 1/8 of the way like shf_rw_futex_lock_wait() */
+    uint32_t spin_target = slept ? SHF_Q_WAIT_SPIN_MIN : (spin * 2 < SHF_Q_WAIT_SPIN_MAX ? spin * 2 : SHF_Q_WAIT_SPIN_MAX);
+             spin_target = spin_target < SHF_Q_WAIT_SPIN_MIN ? SHF_Q_WAIT_SPIN_MIN : spin_target;
+    wait->spin_limit = spin_limit + (SHF_CAST(int32_t, spin_target - spin_limit) / 8); /* racy but only a hint */
+
+    return pull_qiid;
+} /* shf_q_pull_tail_wait() */
+
+/**
+ * @brief Push a qiid on qid head.
+ * - For a faster function see shf_q_push_head_pull_tail(); see @ref ipc_sec for why.
+ * - A qiid must not be pushed while already queued; with #SHF_Q_MPMC or #SHF_Q_SPSC that is the only way a ring can fill up.
+ *
+ * @param[in] shf              Attached SHF.
+ * @param[in] push_qid         qid to push on to.
+ * @param[in] push_qiid        qiid to push.
+ * @retval    #SHF_RET_OK      If qiid pushed, or push_qiid is #SHF_QIID_NONE.
+ * @retval    #SHF_RET_Q_FULL  If qiid not pushed because the qid ring is full.
+ *
+ * Example usage:
+ * @code
+ * shf_q_push_head(shf, qid_a2b, shf_qiid);
+ * @endcode
+ */
+uint32_t
 shf_q_push_head(
     SHF      * shf      ,
     uint32_t   push_qid ,
@@ -1646,7 +4449,16 @@ shf_q_push_head(
     if (SHF_QIID_NONE != push_qiid) { SHF_ASSERT(push_qiid < shf->q.q_items, "ERROR: expected 0 <= push_qiid < %u but got %u", shf->q.q_items, push_qiid); }
 #endif
 
-    if (SHF_QIID_NONE != push_qiid) {
+    if (shf->q.q_rings) {
+        return SHF_QIID_NONE == push_qiid ? SHF_RET_OK : shf_q_ring_push(shf, push_qid, push_qiid);
+    }
+
+    if ((shf->q.q_proc_gen != shf_q_fork_gen) && (0 == shf_q_proc_claim(shf))) { /* come here upon first push or pull, or first after fork(), or if no slot */
+        shf_q_unslotted_push(shf, push_qid, push_qiid);
+        return SHF_RET_OK;
+    }
+
+    if ((SHF_QIID_NONE != push_qiid) && shf_q_lease_end(shf, push_qiid)) {
         shf->q.qids_nolock_push[push_qid].size ++;
 
         uint32_t qiid_last = shf->q.qids_nolock_push[push_qid].head;
@@ -1658,12 +4470,15 @@ shf_q_push_head(
 #ifdef SHF_DEBUG_VERSION
         SHF_DEBUG("%s() // nolock push q size=%u, push_qid=%u, push_qiid=%u, qiid_last=%u, head=%u, tail=%u\n", __FUNCTION__, shf->q.qids_nolock_push[push_qid].size, push_qid, push_qiid, qiid_last, shf->q.qids_nolock_push[push_qid].head, shf->q.qids_nolock_push[push_qid].tail);
 #endif
+        if (shf->q.q_procs->is_reap) { shf->q.q_leases[push_qiid] = 0; } /* after linking; if we go poof in between then reaper finds it in nolock push q */
 
-        if (shf->q.qids_nolock_push[push_qid].size >= shf->q.qids_nolock_max) {
-            /* come here if local push queue is full */
+        if (shf->q.q_linger_cycles && (0 == shf->q.q_linger_start)) { shf->q.q_linger_start = shf_rdtsc(); }
+        if ((shf->q.qids_nolock_push[push_qid].size >= shf->q.q_nolock_batch) || shf_q_is_lingering(shf)) {
+            /* come here if local push queue is full or lingered too long */
             shf_q_flush(shf, SHF_QID_NONE);
         }
     }
+    return SHF_RET_OK;
 } /* shf_q_push_head() */
 
 #ifdef SHF_DEBUG_VERSION
@@ -1682,6 +4497,16 @@ shf_q_size( /* this function only used for debugging... */
     SHF_ASSERT_INTERNAL(shf              , "ERROR: shf must not be NULL; have you called shf_attach(_existing)()?");
     SHF_ASSERT_INTERNAL(shf->q.q_is_ready, "ERROR: have you called shf_q_(new|get)()?");
 
+    if (shf->q.q_rings) {
+        SHF_DEBUG("%s(shf=?, qid=%u) // ring size=%u\n", __FUNCTION__, qid, shf->q.q_rings[qid].push_pos - shf->q.q_rings[qid].pull_pos);
+        return;
+    }
+
+    if ((shf->q.q_proc_gen != shf_q_fork_gen) && (0 == shf_q_proc_claim(shf))) { /* come here upon first push or pull, or first after fork(), or if no slot */
+        SHF_DEBUG("%s(shf=?, qid=%u) // no slot so no nolock qs; shf->q.qids[qid].size=%u\n", __FUNCTION__, qid, shf->q.qids[qid].size);
+        return;
+    }
+
     shf_debug_verbosity_less(); SHF_LOCK_WRITER(&shf->q.q_lock->lock); shf_debug_verbosity_more();
 
     SHF_DEBUG("%s(shf=?, qid=%u) // shf->q.qids_nolock_push[qid].size=%u, shf->q.qids[qid].size=%u, shf->q.qids_nolock_pull[qid].size=%u\n", __FUNCTION__, qid, shf->q.qids_nolock_push[qid].size, shf->q.qids[qid].size, shf->q.qids_nolock_pull[qid].size);
@@ -1706,12 +4531,23 @@ shf_q_flush(
     SHF_ASSERT_INTERNAL(shf              , "ERROR: shf must not be NULL; have you called shf_attach(_existing)()?");
     SHF_ASSERT_INTERNAL(shf->q.q_is_ready, "ERROR: have you called shf_q_(new|get)()?");
 
+    if (shf->q.q_rings) { /* rings have no nolock queues to flush */
+        return;
+    }
+
+    if ((shf->q.q_proc_gen != shf_q_fork_gen) && (0 == shf_q_proc_claim(shf))) { /* come here upon first push or pull, or first after fork(), or if no slot */
+        return; /* no nolock qs to flush */
+    }
+
     shf_debug_verbosity_less(); SHF_LOCK_WRITER(&shf->q.q_lock->lock); shf_debug_verbosity_more();
 
 #ifdef SHF_DEBUG_VERSION
     SHF_DEBUG("%s(shf=?, pull_qid=%u) // shf->q.qids[pull_qid].size=%u, shf->q.qids_nolock_pull[pull_qid].size=%u\n", __FUNCTION__, pull_qid, SHF_QID_NONE == pull_qid ? 0 : shf->q.qids[pull_qid].size, SHF_QID_NONE == pull_qid ? 0 : shf->q.qids_nolock_pull[pull_qid].size);
 #endif
 
+    uint32_t qiids_pushed = 0; /* for probe */
+    uint32_t qiids_pulled = 0; /* for probe */
+
     /* empty nolock push queues */
     for (uint32_t push_qid = 0; push_qid < shf->q.qs; push_qid++) { /* foreach q: */
         if (shf->q.qids_nolock_push[push_qid].size > 0) { /* push this nolock onto that locked q */
@@ -1736,6 +4572,7 @@ shf_q_flush(
             SHF_DEBUG("%s() // locked push q size=%u, push_qid=%u, +size=%u, qiid_last=%u, head=%u, tail=%u\n", __FUNCTION__, shf->q.qids[push_qid].size, push_qid, shf->q.qids_nolock_push[push_qid].size, qiid_last, shf->q.qids[push_qid].head, shf->q.qids[push_qid].tail);
 #endif
 
+            qiids_pushed                           += shf->q.qids_nolock_push[push_qid].size;
             shf->q.qids[push_qid].size             += shf->q.qids_nolock_push[push_qid].size;
             shf->q.qids_nolock_push[push_qid].size  = 0;
             shf->q.qids_nolock_push[push_qid].tail  = SHF_QIID_NONE;
@@ -1743,9 +4580,22 @@ shf_q_flush(
         }
     }
 
+    if (shf->q.q_linger_start) { /* nolock push qs now empty */
+        if (shf->q.q_is_adaptive && shf->q.q_window_start) {
+            /* arrival rate is q items pushed in last window over time from its first push to the first push of this window;
+             * aim batch at q items arriving per max linger, so batches fill at peak rate & don't wait off peak; move half way to damp */
+            double   target = SHF_CAST(double, shf->q.q_window_pushed) * shf->q.q_linger_cycles / (shf->q.q_linger_start - shf->q.q_window_start + 1);
+            uint32_t batch  = target < 1 ? 1 : (target > shf->q.qids_nolock_max ? shf->q.qids_nolock_max : SHF_CAST(uint32_t, target));
+            shf->q.q_nolock_batch = (shf->q.q_nolock_batch + batch) / 2;
+        }
+        shf->q.q_window_start  = shf->q.q_linger_start;
+        shf->q.q_window_pushed = qiids_pushed;
+        shf->q.q_linger_start  = 0;
+    }
+
     /* fill nolock pull queue from locked queue if possible */
     if (SHF_QID_NONE != pull_qid) {
-        uint32_t qiids_to_pull_max = shf->q.qids_nolock_pull[pull_qid].size < shf->q.qids_nolock_max ? shf->q.qids_nolock_max - shf->q.qids_nolock_pull[pull_qid].size : 0                   ;
+        uint32_t qiids_to_pull_max = shf->q.qids_nolock_pull[pull_qid].size < shf->q.q_nolock_batch  ? shf->q.q_nolock_batch  - shf->q.qids_nolock_pull[pull_qid].size : 0                   ;
         uint32_t qiids_to_pull     = shf->q.qids[pull_qid].size             < qiids_to_pull_max      ?                          shf->q.qids[pull_qid].size             : qiids_to_pull_max   ;
         if (qiids_to_pull > 0) {
 #ifdef SHF_DEBUG_VERSION
@@ -1779,6 +4629,7 @@ shf_q_flush(
             SHF_DEBUG("%s() // nolock pull q size=%u, pull_qid=%u, +size=%u, qiid_last_nolock=%u, head=%u, tail=%u\n", __FUNCTION__, shf->q.qids_nolock_pull[pull_qid].size, pull_qid, qiids_to_pull, qiid_last_nolock, shf->q.qids[pull_qid].head, shf->q.qids[pull_qid].tail);
 #endif
 
+            qiids_pulled                            = qiids_to_pull;
             shf->q.qids_nolock_pull[pull_qid].size += qiids_to_pull;
             shf->q.qids[pull_qid].size             -= qiids_to_pull;
             if (shf->q.qids[pull_qid].size) { shf->q.qids[pull_qid].tail = qiid_next_locked; }
@@ -1787,7 +4638,14 @@ shf_q_flush(
         } /* if (qiids_to_pull > 0) */
     } /* if (SHF_QID_NONE != pull_qid)() */
 
+    SHF_PROBE(q_flush, pull_qid, qiids_pushed, qiids_pulled); /* args: pull qid, qiids moved from nolock push qs, qiids moved to nolock pull q */
     shf_debug_verbosity_less(); SHF_UNLOCK_WRITER(&shf->q.q_lock->lock); shf_debug_verbosity_more();
+
+    if (qiids_pushed) { /* after unlock, so sleepers woken don't block on q_lock; one wake per qid per flush */
+        for (uint32_t push_qid = 0; push_qid < shf->q.qs; push_qid++) {
+            if (shf->q.qids[push_qid].size) { shf_q_wake(shf, push_qid); }
+        }
+    }
 } /* shf_q_flush() */
 
 /**
@@ -1796,13 +4654,14 @@ shf_q_flush(
  * - Sets the thread local variable @ref shf_qiid_addr     to point to the first byte of the queue item if found, else NULL.
  * - Sets the thread local variable @ref shf_qiid_addr_len to the length in bytes of the queue item if found, else zero.
  * - This is faster than shf_q_push_head() & shf_q_pull_tail(); see @ref ipc_sec for why.
+ * - If push_qid's ring is full, see shf_q_push_head(), then push_qiid is not pushed, nothing is pulled, & the thread local variables are unchanged.
  *
  * @param[in] shf             Attached SHF.
  * @param[in] push_qid        qid to push on to.
  * @param[in] push_qiid       qiid to push.
  * @param[in] pull_qid        qid to try and pull qiid from.
  * @retval    qiid            qiid pulled from pull_qid.
- * @retval    #SHF_QIID_NONE  If no qiid available.
+ * @retval    #SHF_QIID_NONE  If no qiid available, or push_qiid not pushed.
  *
  * Example usage:
  * @code
@@ -1830,7 +4689,19 @@ shf_q_push_head_pull_tail(
                                       SHF_ASSERT(pull_qid  < shf->q.qs     , "ERROR: expected 0 <= pull_qid < %u but got %u" , shf->q.qs     , pull_qid );
 #endif
 
-    if (SHF_QIID_NONE != push_qiid) {
+    if (shf->q.q_rings) {
+        if ((SHF_QIID_NONE != push_qiid) && (SHF_RET_Q_FULL == shf_q_ring_push(shf, push_qid, push_qiid))) {
+            return SHF_QIID_NONE; /* not pushed so nothing pulled; shf_qiid etc still refer to push_qiid */
+        }
+        return shf_q_ring_pull(shf, pull_qid);
+    }
+
+    if ((shf->q.q_proc_gen != shf_q_fork_gen) && (0 == shf_q_proc_claim(shf))) { /* come here upon first push or pull, or first after fork(), or if no slot */
+        shf_q_unslotted_push(shf, push_qid, push_qiid);
+        return shf_q_unslotted_pull(shf, pull_qid);
+    }
+
+    if ((SHF_QIID_NONE != push_qiid) && shf_q_lease_end(shf, push_qiid)) {
         shf->q.qids_nolock_push[push_qid].size ++;
 
         uint32_t qiid_last = shf->q.qids_nolock_push[push_qid].head;
@@ -1842,11 +4713,14 @@ shf_q_push_head_pull_tail(
 #ifdef SHF_DEBUG_VERSION
         SHF_DEBUG("%s() // nolock push q size=%u, push_qid=%u, push_qiid=%u, qiid_last=%u, head=%u, tail=%u\n", __FUNCTION__, shf->q.qids_nolock_push[push_qid].size, push_qid, push_qiid, qiid_last, shf->q.qids_nolock_push[push_qid].head, shf->q.qids_nolock_push[push_qid].tail);
 #endif
+        if (shf->q.q_procs->is_reap) { shf->q.q_leases[push_qiid] = 0; } /* after linking; if we go poof in between then reaper finds it in nolock push q */
+        if (shf->q.q_linger_cycles && (0 == shf->q.q_linger_start)) { shf->q.q_linger_start = shf_rdtsc(); }
     }
 
-    if ((shf->q.qids_nolock_push[push_qid].size >= shf->q.qids_nolock_max)
-    ||  (shf->q.qids_nolock_pull[pull_qid].size == 0                     )) {
-        /* come here if local push queue is full or local pull queue is emtpy */
+    if ((shf->q.qids_nolock_push[push_qid].size >= shf->q.q_nolock_batch)
+    ||  (shf->q.qids_nolock_pull[pull_qid].size == 0                    )
+    ||  (shf_q_is_lingering(shf)                                        )) {
+        /* come here if local push queue is full or lingered too long, or local pull queue is emtpy */
         shf_q_flush(shf, pull_qid);
     }
 
@@ -1865,10 +4739,13 @@ shf_q_push_head_pull_tail(
 #ifdef SHF_DEBUG_VERSION
         SHF_ASSERT(pull_qiid < shf->q.q_items, "ERROR: INTERNAL: in nolock pull tail qiid is %u but should be < %u\n", pull_qiid, shf->q.q_items);
 #endif
+        uint32_t is_reap = shf->q.q_procs->is_reap;
+        if (is_reap) { shf_q_lease_begin(shf, pull_qiid); } /* before unlinking; if we go poof in between then reaper finds it in nolock pull q */
         uint32_t qiid_next = shf->q.qiids[pull_qiid].next;
         shf->q.qids_nolock_pull[pull_qid].tail = qiid_next;
         if (SHF_QIID_NONE == qiid_next) { shf->q.qids_nolock_pull[pull_qid].head = SHF_QIID_NONE; }
         else                            { shf->q.qiids[qiid_next].last           = SHF_QIID_NONE; }
+        if (is_reap) { shf_q_lease_deadline(shf, pull_qiid); } /* after unlinking; so an expired lease is never on a linked qiid */
 #ifdef SHF_DEBUG_VERSION
         SHF_DEBUG("%s() // nolock pull q size=%u, pull_qid=%u, qiid=%u, qiid_next=%u, head=%u, tail=%u\n", __FUNCTION__, shf->q.qids_nolock_pull[pull_qid].size, pull_qid, pull_qiid, qiid_next, shf->q.qids_nolock_pull[pull_qid].head, shf->q.qids_nolock_pull[pull_qid].tail);
 #endif
@@ -1881,6 +4758,97 @@ shf_q_push_head_pull_tail(
     return pull_qiid;
 } /* shf_q_push_head_pull_tail() */
 
+/**
+ * @brief Push a batch of qiids on qid head.
+ * - For #SHF_Q_SPSC qids then the whole batch is published to the puller at once.
+ * - Otherwise the same as calling shf_q_push_head() for each qiid until one returns #SHF_RET_Q_FULL.
+ * - For #SHF_Q_SPSC qids the batch is pushed all or none, so a full ring pushes none.
+ *
+ * @param[in] shf             Attached SHF.
+ * @param[in] push_qid        qid to push on to.
+ * @param[in] push_qiids      qiids to push; first is pulled first.
+ * @param[in] push_qiids_len  Number of qiids to push.
+ * @retval    Number          Number of qiids pushed; push_qiids_len unless the qid ring is full, see shf_q_push_head().
+ *
+ * Example usage:
+ * @code
+ * uint32_t pushed = shf_q_push_head_many(shf, qid_a2b, qiids, qiids_len);
+ * @endcode
+ */
+uint32_t
+shf_q_push_head_many(
+    SHF            * shf           ,
+    uint32_t         push_qid      ,
+    const uint32_t * push_qiids    ,
+    uint32_t         push_qiids_len)
+{
+    SHF_ASSERT_INTERNAL(shf              , "ERROR: shf must not be NULL; have you called shf_attach(_existing)()?");
+    SHF_ASSERT_INTERNAL(shf->q.q_is_ready, "ERROR: have you called shf_q_(new|get)()?");
+
+#ifdef SHF_DEBUG_VERSION
+    SHF_ASSERT(push_qid < shf->q.qs, "ERROR: expected 0 <= push_qid < %u but got %u", shf->q.qs, push_qid);
+    for (uint32_t i = 0; i < push_qiids_len; i++) { SHF_ASSERT(push_qiids[i] < shf->q.q_items, "ERROR: expected 0 <= push_qiid < %u but got %u", shf->q.q_items, push_qiids[i]); }
+#endif
+
+    if (shf->q.q_spsc_caches) {
+        return SHF_RET_OK == shf_q_spsc_push(shf, push_qid, push_qiids, push_qiids_len) ? push_qiids_len : 0;
+    }
+
+    uint32_t pushed = 0;
+    while ((pushed < push_qiids_len) && (SHF_RET_OK == shf_q_push_head(shf, push_qid, push_qiids[pushed]))) {
+        pushed ++;
+    }
+    return pushed;
+} /* shf_q_push_head_many() */
+
+/**
+ * @brief Pull a batch of qiids off qid tail.
+ * - For #SHF_Q_SPSC qids then the whole batch of slots is freed for the pusher at once.
+ * - Otherwise the same as calling shf_q_pull_tail() until pull_qiids_max qiids or none left.
+ * - Leaves the thread local variables @ref shf_qiid etc unchanged, for every engine; qiid n is at `qiid_array + (n * q_item_size)`.
+ *
+ * @param[in]  shf             Attached SHF.
+ * @param[in]  pull_qid        qid to try and pull qiids from.
+ * @param[out] pull_qiids      qiids pulled; first pulled first.
+ * @param[in]  pull_qiids_max  Maximum number of qiids to pull.
+ * @retval     Number          Number of qiids pulled; zero if none available.
+ *
+ * Example usage:
+ * @code
+ * uint32_t qiids_len = shf_q_pull_tail_many(shf, qid_a2b, qiids, 64);
+ * @endcode
+ */
+uint32_t
+shf_q_pull_tail_many(
+    SHF      * shf           ,
+    uint32_t   pull_qid      ,
+    uint32_t * pull_qiids    ,
+    uint32_t   pull_qiids_max)
+{
+    SHF_ASSERT_INTERNAL(shf              , "ERROR: shf must not be NULL; have you called shf_attach(_existing)()?");
+    SHF_ASSERT_INTERNAL(shf->q.q_is_ready, "ERROR: have you called shf_q_(new|get)()?");
+
+#ifdef SHF_DEBUG_VERSION
+    SHF_ASSERT(pull_qid < shf->q.qs, "ERROR: expected 0 <= pull_qid < %u but got %u", shf->q.qs, pull_qid);
+#endif
+
+    if (shf->q.q_spsc_caches) {
+        return shf_q_spsc_pull(shf, pull_qid, pull_qiids, pull_qiids_max);
+    }
+
+    uint32_t   qiid          = shf_qiid         ; /* shf_q_pull_tail() sets these so restore them below */
+    char     * qiid_addr     = shf_qiid_addr    ;
+    uint32_t   qiid_addr_len = shf_qiid_addr_len;
+    uint32_t   pulled        = 0;
+    while ((pulled < pull_qiids_max) && (SHF_QIID_NONE != shf_q_pull_tail(shf, pull_qid))) {
+        pull_qiids[pulled ++] = shf_qiid;
+    }
+    shf_qiid          = qiid         ;
+    shf_qiid_addr     = qiid_addr    ;
+    shf_qiid_addr_len = qiid_addr_len;
+    return pulled;
+} /* shf_q_pull_tail_many() */
+
 /**
  * @brief Checks if queue has been initialized via shf_q_new() or shf_q_get().
  * - This function is intended for internal use. Cannot think of a use case for the caller to use it.
@@ -2141,6 +5109,7 @@ shf_log_output_set(void (*shf_log_output_new)(char * log_line, uint32_t log_line
             shf->log->write_fail = second; /* throttle write errors during this second */ \
             break; \
         } \
+        SHF_PROBE(log_write, SHF_CAST(int64_t, bytes_written), SHF_CAST(uint32_t, log_left)); /* args: bytes written, bytes attempted */ \
         log_left -= bytes_written; \
         log_work += bytes_written; \
         SHF_SYSLOG_DEBUG("%s() // wrote %lu bytes", __FUNCTION__, bytes_written); \
@@ -57,6 +57,24 @@ extern void   shf_log_await_flush(void);
 #define SHF_DEBUG_FILE(ARGS...)
 #endif
 
+/* USDT probes for e.g. perf, bpftrace, & systemtap; e.g. bpftrace -e 'usdt:./myprog:sharedhashfile:tab_part { @[arg0] = count(); }'
+ * each probe is a single nop plus a note section entry if sys/sdt.h is available, else compiled out; define SHF_PROBES_DISABLE to always compile out
+ * probe args must not be bitfields because sys/sdt.h takes the sizeof() of each arg
+ */
+#if defined(__has_include) && !defined(SHF_PROBES_DISABLE)
+#if __has_include(<sys/sdt.h>)
+#include <sys/sdt.h>
+#define SHF_PROBES_ENABLED
+#endif
+#endif
+
+#ifdef SHF_PROBES_ENABLED
+#define SHF_PROBE(NAME, ARGS...) STAP_PROBEV(sharedhashfile, NAME, ##ARGS)
+#else
+static inline void shf_probe_nop(int unused, ...) { SHF_UNUSE(unused); }
+#define SHF_PROBE(NAME, ARGS...) do { if (0) { shf_probe_nop(0, ##ARGS); } } while (0) /* args still count as used */
+#endif
+
 #define SHF_SYSLOG_ASSERT(CONDITION,ARGS...)          if (!(CONDITION)) { shf_log(shf_log_prefix_get(), "%05u:%s: ERROR: assertion: ", __LINE__, __FILE__, strerror(errno), "\n", LOG_CRIT   , ARGS); shf_log_await_flush(); exit(EXIT_FAILURE); }
 #define SHF_SYSLOG_ASSERT_INTERNAL(CONDITION,ARGS...) if (!(CONDITION)) { shf_log(shf_log_prefix_get(), "%05u:%s: ERROR: assertion: ", __LINE__, __FILE__, NULL           , "\n", LOG_CRIT   , ARGS); shf_log_await_flush(); exit(EXIT_FAILURE); }
 #define SHF_SYSLOG_WARNING(ARGS...)                                     { shf_log(shf_log_prefix_get(), "%05u:%s: WARNING: "         , __LINE__, __FILE__, NULL           , NULL, LOG_WARNING, ARGS); }
@@ -80,6 +98,7 @@ extern void   shf_log_await_flush(void);
 
 #define SHF_U08_AT(BASE, OFFSET)                                        SHF_CAST(uint8_t *, BASE)[OFFSET]
 #define SHF_U32_AT(BASE, OFFSET)                 SHF_CAST(uint32_t *, &(SHF_CAST(uint8_t *, BASE)[OFFSET]))[0]
+#define SHF_U64_AT(BASE, OFFSET)                 SHF_CAST(uint64_t *, &(SHF_CAST(uint8_t *, BASE)[OFFSET]))[0]
 #define SHF_MEM_AT(BASE, OFFSET, FROM_LEN, FROM)               memcpy(&(SHF_CAST(uint8_t *, BASE)[OFFSET]), &(SHF_CAST(uint8_t *, FROM)[0]), FROM_LEN)
 #define SHF_CMP_AT(BASE, OFFSET, FROM_LEN, FROM)               memcmp(&(SHF_CAST(uint8_t *, BASE)[OFFSET]), &(SHF_CAST(uint8_t *, FROM)[0]), FROM_LEN)
 
@@ -122,8 +122,10 @@
  *   - E.g. another process might trigger a table split simultaneously.
  * - Therefore most API functions return a copy of the key value data.
  * - It is possible to get the direct memory address of key value data:
- *   - But do not add or delete any more keys to ensure no table splits.
- *   - Only table splits cause addresses to change.
+ *   - Wrap the access in shf_read_begin() & shf_read_end().
+ *   - Between these calls replaced table memory is not unmapped.
+ *   - Instead it is retired & unmapped after the last shf_read_end().
+ *   - Reader epochs are kept per attached instance in `myname.shf`.
  *   - todo: Allow large key value data to exist outside of tables.
  *   - E.g. IPC queues and logging use shared memory directly.
  *
@@ -215,7 +217,31 @@
  *     - Only double linked list ends are updated to move many items.
  *   - Therefore, if `qids_nolock_max` is set to 1,000 then:
  *     - 1 million hybrid calls == only 1,000 locks total.
- *   - The lockless pre-queues are not stored in shared memory.
+ *   - Each process's pre-queues are in its own slot in shared memory,
+ *     tagged with its pid, so they survive the process.
+ *   - There are 64 slots; slots of processes which went poof are
+ *     reused. While all 64 are used by live processes, any further
+ *     process pushes & pulls straight via the qids, taking the lock
+ *     each time, & tries for a slot again every 1,000 calls.
+ *   - At low rates items may wait long in a pre-queue, so
+ *     shf_q_set_nolock_linger() bounds the wait & can adapt the
+ *     batch size to the arrival rate.
+ * - Alternatively, shf_q_new() takes `qids_nolock_max` #SHF_Q_MPMC:
+ *   - Each qid is a lock free bounded ring of qiids in shared memory.
+ *   - Each ring slot has a sequence number, so pushers & pullers claim
+ *     a slot with one compare & swap & never take the q lock.
+ *   - So throughput scales with many pushing & pulling processes.
+ *   - And no qiids are held back in per process pre-queues.
+ *   - Each ring has room for all `q_items` qiids, so it is only full if
+ *     a qiid is pushed while already queued; then the push returns
+ *     #SHF_RET_Q_FULL & the qiid is not pushed.
+ * - Or, if each qid has exactly 1 pushing & 1 pulling process, #SHF_Q_SPSC:
+ *   - Each qid is a ring with push & pull positions on own cache lines.
+ *   - Each end caches the other end's position & only re-reads it when
+ *     the ring looks full or empty; no compare & swap, just a release
+ *     store per push or pull.
+ *   - shf_q_push_head_many() & shf_q_pull_tail_many() publish a whole
+ *     batch of qiids with one release store.
  * - The architecture is designed for maximum possible performance.
  *
  * Suggestion for caller hybrid poll / notification approach:
@@ -230,6 +256,11 @@
  *     - Otherwise throughput will lower to unwanted 100k per second.
  *   - Use poller timer to sweep for last item sent.
  *     - i.e. pusher sent 2 items in last single OS notify period.
+ * - Or use shf_q_pull_tail_wait() which does this multi stage dance:
+ *   - Polls for an adaptive period, then sleeps on a per qid futex.
+ *   - Pushers only call futex() if pullers sleep on the qid, & then
+ *     only the first push since a puller started sleeping does.
+ *   - So busy pullers poll at full speed & idle pullers cost no CPU.
  *
  * Suggestion for run-time order of operations / pattern:
  * - `Process A` wants to IPC with (not yet started) `Process B`.
@@ -250,10 +281,17 @@
  *   - It is left up to `Process A` to decide that `Process B` is no
  *     longer using the SHF instance, so that the SHF instance can be
  *     deleted.
- *   - If `Process B` exits (e.g. unexpectedly) then it should not be
- *     expected that `Process A` can launch another `Process B` to
- *     continue where the old `Process B` left off. This is because of
- *     `qids_nolock_max`; see above.
+ *   - If `Process B` exits (e.g. unexpectedly) then `Process A` can
+ *     launch another `Process B` to continue where the old `Process B`
+ *     left off, after calling shf_q_reap():
+ *     - Each pulled qiid is leased to the pulling process until pushed.
+ *     - shf_q_reap() pushes qiids in dead pre-queues on to their qids,
+ *       & leased qiids of dead processes on to a qid chosen via
+ *       shf_q_set_reap(), e.g. "qid-free".
+ *     - Optionally, leases also expire, & `shf.monitor` reaps too.
+ *     - So large `qids_nolock_max` batches lose no qiids in a crash.
+ *     - A process which goes poof while holding the q lock is not
+ *       covered.
  *
  * Caveats:
  * - Once shf_q_new() or shf_q_get() has been called then the key value
@@ -293,6 +331,7 @@
 #define __SHF_H__
 
 #include <stdint.h>
+#include <sys/uio.h> /* for struct iovec */
 
 #include "shf.defines.h"
 
@@ -347,13 +386,24 @@ typedef union SHF_DATA_TYPE {
 #define SHF_RET_BAD_CB       (1<<2) /* e.g. if callback updating a key with wrong sized value */
 #define SHF_RET_KEY_PUT      (1<<3) /* e.g. if key put */
 #define SHF_RET_NOT_TTL      (1<<4) /* e.g. if key del fails due to unmatching TTL */
+#define SHF_RET_BUF_SMALL    (1<<5) /* e.g. if caller buffer too small to copy into; needed length in shf_(key|val)_len */
+#define SHF_RET_FROZEN       (1<<6) /* e.g. if key put, del, update, or add fails because shf frozen or attached read only */
 #define SHF_RET_KEY_NONE     (1<<7) /* e.g. if key or UID not found */
+#define SHF_RET_Q_FULL       (1<<8) /* e.g. if qiid not pushed because ring full, which only happens if a qiid is pushed while already queued */
+
+#define SHF_PREFETCH_DONE    (0)    /* e.g. shf_op_prefetch() has nothing more to prefetch; do lookup now */
+#define SHF_PREFETCH_WIN     (1)    /* e.g. first step: prefetch win lock & tab index */
+#define SHF_PREFETCH_ROW     (2)    /* e.g. next  step: prefetch row of refs in tab */
+#define SHF_PREFETCH_DATA    (3)    /* e.g. last  step: prefetch key,value data for refs matching hash */
 
 /* UINT32_MAX; note: defined here for use with either C or C++ clients */
 #define SHF_DATA_TYPE_DELETED (0xff)
 #define SHF_UID_NONE          (4294967295U) /*!< Value used to represent no uid */
 #define SHF_QID_NONE          (4294967295U) /*!< Value used to represent no qid */
 #define SHF_QIID_NONE         (4294967295U) /*!< Value used to represent no qiid */
+#define SHF_Q_MPMC            (4294967293U) /*!< Value for shf_q_new() qids_nolock_max to make each qid a lock free MPMC ring */
+#define SHF_Q_SPSC            (4294967294U) /*!< Value for shf_q_new() qids_nolock_max to make each qid a single pusher, single puller ring */
+#define SHF_Q_WAIT_FOREVER    (4294967295U) /*!< Value for shf_q_pull_tail_wait() timeout_ms to wait until a qiid is pulled */
 
 extern __thread uint32_t       shf_ttl          ;
 extern __thread uint32_t       shf_uid          ;
@@ -377,11 +427,36 @@ extern void       shf_init                 (void);
 extern void       shf_detach               (SHF * shf);
 extern uint64_t   shf_get_vfs_available    (const char * path);
 extern SHF      * shf_attach_existing      (const char * path, const char * name);
+extern SHF      * shf_attach_existing_read_only(const char * path, const char * name);
+extern SHF      * shf_attach_existing_snapshot(const char * path, const char * name);
 extern SHF      * shf_attach               (const char * path, const char * name, uint32_t delete_upon_process_exit);
 extern void       shf_make_hash            (const char * key, uint32_t key_len);
 extern void       shf_copy_key             (uint32_t key_len);
 extern void       shf_copy_val             (uint32_t val_len);
+extern SHF_OP   * shf_op_new               (void);
+extern void       shf_op_free              (SHF_OP * op);
+extern void       shf_op_hash              (SHF_OP * op, const char * key, uint32_t key_len);
+extern void       shf_op_hash_set          (SHF_OP * op, const SHF_HASH * hash, const char * key, uint32_t key_len);
+extern uint32_t   shf_op_put               (SHF * shf, SHF_OP * op, const char * val, uint32_t val_len);
+extern uint32_t   shf_op_put_ttl           (SHF * shf, SHF_OP * op, const char * val, uint32_t val_len, uint32_t ttl);
+extern uint32_t   shf_op_get               (SHF * shf, SHF_OP * op              );
+extern uint32_t   shf_op_get_uid           (SHF * shf, SHF_OP * op, uint32_t uid);
+extern uint32_t   shf_op_get_addr          (SHF * shf, SHF_OP * op              );
+extern uint32_t   shf_op_get_buf           (SHF * shf, SHF_OP * op, char * buf, uint32_t buf_size);
+extern uint32_t   shf_op_add_atom          (SHF * shf, SHF_OP * op, long add    );
+extern uint32_t   shf_op_add_atom_at       (SHF * shf, SHF_OP * op, uint32_t val_offset, long add);
+extern uint32_t   shf_op_del               (SHF * shf, SHF_OP * op              );
+extern uint32_t   shf_op_del_uid           (SHF * shf, SHF_OP * op, uint32_t uid);
+extern uint32_t   shf_op_prefetch          (SHF * shf, SHF_OP * op, uint32_t step);
+extern uint64_t   shf_arena_alloc          (SHF * shf, uint32_t size);
+extern void       shf_arena_free           (SHF * shf, uint64_t handle, uint32_t size);
+extern void     * shf_arena_addr           (SHF * shf, uint64_t handle);
+extern uint64_t   shf_arena_handle         (SHF * shf, const void * addr);
+extern void       shf_arena_flush          (SHF * shf);
 extern uint32_t   shf_put_key_val          (SHF * shf, const char * val, uint32_t val_len);
+extern uint32_t   shf_put_key_val_ttl      (SHF * shf, const char * val, uint32_t val_len, uint32_t ttl);
+extern uint32_t   shf_ttl_reap             (SHF * shf);
+extern void       shf_ttl_set_reap         (SHF * shf, uint32_t reap_ms);
 extern uint32_t   shf_get_key_val_addr     (SHF * shf                        );
 extern uint32_t   shf_get_uid_val_addr     (SHF * shf, uint32_t uid          );
 extern uint32_t   shf_get_key_key_copy     (SHF * shf                        );
@@ -396,24 +471,57 @@ extern uint32_t   shf_del_key_val          (SHF * shf                        );
 extern uint32_t   shf_del_uid_val          (SHF * shf, uint32_t uid          );
 extern uint32_t   shf_upd_key_val          (SHF * shf                        );
 extern uint32_t   shf_upd_uid_val          (SHF * shf, uint32_t uid          );
+extern uint32_t   shf_get_key_key_copy_buf (SHF * shf              , char * buf, uint32_t buf_size     );
+extern uint32_t   shf_get_uid_key_copy_buf (SHF * shf, uint32_t uid, char * buf, uint32_t buf_size     );
+extern uint32_t   shf_get_key_val_copy_buf (SHF * shf              , char * buf, uint32_t buf_size     );
+extern uint32_t   shf_get_uid_val_copy_buf (SHF * shf, uint32_t uid, char * buf, uint32_t buf_size     );
+extern uint32_t   shf_get_key_key_copy_iov (SHF * shf              , const struct iovec * iov, int iovcnt);
+extern uint32_t   shf_get_uid_key_copy_iov (SHF * shf, uint32_t uid, const struct iovec * iov, int iovcnt);
+extern uint32_t   shf_get_key_val_copy_iov (SHF * shf              , const struct iovec * iov, int iovcnt);
+extern uint32_t   shf_get_uid_val_copy_iov (SHF * shf, uint32_t uid, const struct iovec * iov, int iovcnt);
+extern uint32_t   shf_get_key_val_visit    (SHF * shf              , uint32_t (*cb)(const char * val, uint32_t val_len, void * ctx), void * ctx);
+extern uint32_t   shf_get_uid_val_visit    (SHF * shf, uint32_t uid, uint32_t (*cb)(const char * val, uint32_t val_len, void * ctx), void * ctx);
+extern void       shf_read_begin           (SHF * shf                        );
+extern void       shf_read_end             (SHF * shf                        );
 extern void       shf_upd_callback_set     (uint32_t (*shf_upd_callback_new)(const char * val, uint32_t val_len));
 extern uint32_t   shf_upd_callback_copy    (const char * val, uint32_t val_len);
 extern void       shf_tab_copy_iterate     (SHF * shf, uint32_t * win_addr, uint32_t * tab_addr);
+extern SHF_ITER * shf_iter_new             (SHF * shf);
+extern uint32_t   shf_iter_next            (SHF_ITER * iter);
+extern void       shf_iter_free            (SHF_ITER * iter);
+extern uint64_t   shf_scan_parallel        (SHF * shf, uint32_t nthreads, uint32_t (* filter_cb)(const SHF_SCAN * scan, void * ctx), void (* visit_cb)(const SHF_SCAN * scan, void * ctx), void * ctx);
 extern char     * shf_del                  (SHF * shf);
 extern uint64_t   shf_debug_get_garbage    (SHF * shf);
+extern void       shf_stats_get            (SHF * shf, SHF_STATS * stats);
 extern void       shf_debug_verbosity_less (void);
 extern void       shf_debug_verbosity_more (void);
 extern void       shf_set_data_need_factor (uint32_t data_needed_factor);
 extern void       shf_set_is_lockable      (SHF * shf, uint32_t is_lockable);
+extern void       shf_freeze               (SHF * shf);
+extern void       shf_thaw                 (SHF * shf);
 extern void       shf_set_is_fixed_len     (SHF * shf, uint32_t fixed_key_len, uint32_t fixed_val_len);
+extern void       shf_set_cache_budget     (SHF * shf, uint64_t data_max, uint32_t keys_max);
+extern uint64_t   shf_cache_get_evicted    (SHF * shf);
+extern void       shf_set_lock_times       (SHF * shf, uint32_t sample);
+extern const SHF_LOCK_TIMES_MMAP * shf_lock_times_get(SHF * shf);
+extern uint64_t   shf_lock_times_cycles    (uint32_t bucket);
+extern void       shf_set_hot_keys         (SHF * shf, uint32_t sample);
+extern const SHF_HOT_KEYS_MMAP * shf_hot_keys_get(SHF * shf);
+extern void       shf_hot_keys_reset       (SHF * shf);
 extern void     * shf_q_new                (SHF * shf, uint32_t shf_qs, uint32_t shf_q_items, uint32_t shf_q_item_size, uint32_t qids_nolock_max);
 extern void     * shf_q_get                (SHF * shf);
 extern void       shf_q_del                (SHF * shf);
+extern void       shf_q_set_nolock_linger  (SHF * shf, uint32_t linger_us, uint32_t is_adaptive);
+extern void       shf_q_set_reap           (SHF * shf, uint32_t reap_qid, uint32_t lease_ms, uint32_t reap_ms);
+extern uint32_t   shf_q_reap               (SHF * shf);
 extern uint32_t   shf_q_new_name           (SHF * shf, const char * name, uint32_t name_len);
 extern uint32_t   shf_q_get_name           (SHF * shf, const char * name, uint32_t name_len);
-extern void       shf_q_push_head          (SHF * shf, uint32_t      qid, uint32_t qiid);
+extern uint32_t   shf_q_push_head          (SHF * shf, uint32_t      qid, uint32_t qiid);
 extern uint32_t   shf_q_pull_tail          (SHF * shf, uint32_t      qid                                       );
+extern uint32_t   shf_q_pull_tail_wait     (SHF * shf, uint32_t      qid, uint32_t timeout_ms                  );
 extern uint32_t   shf_q_push_head_pull_tail(SHF * shf, uint32_t push_qid, uint32_t push_qiid, uint32_t pull_qid);
+extern uint32_t   shf_q_push_head_many     (SHF * shf, uint32_t push_qid, const uint32_t * push_qiids, uint32_t push_qiids_len);
+extern uint32_t   shf_q_pull_tail_many     (SHF * shf, uint32_t pull_qid,       uint32_t * pull_qiids, uint32_t pull_qiids_max);
 #if 0
 extern uint32_t   shf_q_take_item          (SHF * shf, uint32_t      qiid                                      );
 #endif
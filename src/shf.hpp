@@ -0,0 +1,570 @@
+/*
+ * ============================================================================
+ * Copyright (c) 2014 Hardy-Francis Enterprises Inc.
+ * This file is part of SharedHashFile.
+ *
+ * SharedHashFile is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or (at your
+ * option) any later version.
+ *
+ * SharedHashFile is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU Affero General Public
+ * License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program. If not, see www.gnu.org/licenses/.
+ * ----------------------------------------------------------------------------
+ * To use SharedHashFile in a closed-source product, commercial licenses are
+ * available; email office [@] sharedhashfile [.] com for more information.
+ * ============================================================================
+ */
+
+#ifndef __SHF_HPP__
+#define __SHF_HPP__
+
+/* C++17 handle API; header only & built on the reentrant shf_op_*() functions so
+ * no __thread globals (shf_hash, shf_uid, shf_val, etc) are read or written and
+ * no MakeHash() call is needed before each operation. Each shf::Instance owns
+ * one SHF_OP, so use one instance per thread; shf_attach_existing() is cheap.
+ * shf::Executor & shf::Task need C++20 coroutines.
+ */
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <iterator>
+#include <new>
+#include <optional>
+#include <string_view>
+#include <type_traits>
+#include <utility>
+#if defined(__cpp_impl_coroutine)
+#include <coroutine>
+#include <deque>
+#include <exception>
+#include <vector>
+#endif
+
+extern "C" {
+#include <shf.private.h>
+#include <shf.h>
+}
+
+namespace shf {
+
+struct Value { /* val was copied once into the instance's op buffer under the lock; view valid until next call on same instance */
+    uint32_t         uid;
+    std::string_view val;
+};
+
+struct Item { /* key,value pair copied once into the cursor's row buffer; views valid until cursor advances */
+    uint32_t         uid;
+    std::string_view key;
+    std::string_view val;
+};
+
+template <typename RANGE>
+using EnableIfRange = std::enable_if_t<! std::is_convertible_v<const RANGE &, std::string_view>, int>;
+
+class Cursor { /* single pass range over all key,value pairs; wraps shf_iter_*() which copies one row at a time under a short reader lock */
+public:
+    class Iterator {
+    public:
+        using iterator_category = std::input_iterator_tag;
+        using value_type        = Item;
+        using difference_type   = std::ptrdiff_t;
+        using pointer           = const Item *;
+        using reference         = Item;
+
+        explicit   Iterator  (SHF_ITER * cursor_iter) : iter(cursor_iter) { next(); }
+        Item       operator* () const { return Item{iter->uid, std::string_view(iter->key, iter->key_len), std::string_view(iter->val, iter->val_len)}; }
+        Iterator & operator++()       { next(); return *this; }
+        bool       operator==(const Iterator & other) const { return iter == other.iter; }
+        bool       operator!=(const Iterator & other) const { return iter != other.iter; }
+
+    private:
+        void       next      ()       { if (iter && (SHF_RET_KEY_FOUND != shf_iter_next(iter))) { iter = nullptr; } }
+        SHF_ITER * iter;
+    };
+
+    explicit   Cursor    (SHF * cursor_shf) : iter(shf_iter_new(cursor_shf)) {}
+              ~Cursor    ()                 { shf_iter_free(iter); }
+               Cursor    (Cursor && other) noexcept : iter(other.iter) { other.iter = nullptr; }
+               Cursor    (const Cursor &)   = delete;
+    Cursor   & operator= (const Cursor &)   = delete;
+    Cursor   & operator= (Cursor &&)        = delete;
+    Iterator   begin     ()                 { return Iterator(iter   ); }
+    Iterator   end       ()                 { return Iterator(nullptr); }
+
+private:
+    SHF_ITER * iter;
+};
+
+class Instance { /* movable RAII handle; detaches in destructor */
+public:
+               Instance  () noexcept : shf(nullptr), op(nullptr) {}
+               Instance  (const char * path, const char * name, uint32_t delete_upon_process_exit) : Instance((shf_init(), shf_attach(path, name, delete_upon_process_exit))) {}
+              ~Instance  ()                 { detach(); }
+               Instance  (Instance && other) noexcept : shf(other.shf), op(other.op) { other.shf = nullptr; other.op = nullptr; }
+    Instance & operator= (Instance && other) noexcept { if (this != &other) { detach(); std::swap(shf, other.shf); std::swap(op, other.op); } return *this; }
+               Instance  (const Instance &) = delete;
+    Instance & operator= (const Instance &) = delete;
+
+    static Instance attach_existing          (const char * path, const char * name) { return Instance((shf_init(), shf_attach_existing          (path, name))); } /* unattached if not found */
+    static Instance attach_existing_read_only(const char * path, const char * name) { return Instance((shf_init(), shf_attach_existing_read_only(path, name))); } /* unattached if not found */
+
+    explicit operator bool() const { return nullptr != shf; }
+    SHF    * handle       () const { return shf; } /* for shf_set_*() & other C functions not wrapped here */
+    SHF_OP * op_handle    () const { return op ; } /* for shf_op_*() functions not wrapped here */
+
+    void detach() {
+        if (op ) { shf_op_free(op ); op  = nullptr; }
+        if (shf) { shf_detach (shf); shf = nullptr; }
+    }
+
+    char * destroy() { /* detach & delete shf folder; returns du output like shf_del() */
+        if (op) { shf_op_free(op); op = nullptr; }
+        char * hint = shf_del(shf);
+        shf = nullptr;
+        return hint;
+    }
+
+    std::optional<Value> get(std::string_view key) {
+        shf_op_hash(op, key.data(), key.size());
+        if (SHF_RET_KEY_FOUND != shf_op_get(shf, op)) { return std::nullopt; }
+        return Value{op->uid, std::string_view(op->val, op->val_len)};
+    }
+
+    bool put(std::string_view key, const void * val, size_t val_len) { /* val,val_len is the span copied once into shf */
+        shf_op_hash(op, key.data(), key.size());
+        return SHF_RET_KEY_PUT == shf_op_put(shf, op, static_cast<const char *>(val), val_len);
+    }
+
+    bool put(std::string_view key, std::string_view val) { return put(key, val.data(), val.size()); }
+
+    bool del(std::string_view key) {
+        shf_op_hash(op, key.data(), key.size());
+        return SHF_RET_KEY_FOUND == shf_op_del(shf, op);
+    }
+
+    template <typename RANGE, EnableIfRange<RANGE> = 0>
+    size_t put(const RANGE & key_vals) { /* range of pair like key,value elements, e.g. std::map<std::string, std::string>; returns keys put */
+        size_t puts = 0;
+        for (const auto & [key, val] : key_vals) { puts += put(std::string_view(key), std::string_view(val)) ? 1 : 0; }
+        return puts;
+    }
+
+    template <typename RANGE, typename VISIT, EnableIfRange<RANGE> = 0>
+    size_t get(const RANGE & keys, VISIT && visit) { /* calls visit(key, std::optional<Value>) per key; returns keys found; keys must stay valid for a group, e.g. elements of a container */
+        size_t           found = 0;
+        uint32_t         group = 0;
+        std::string_view group_keys[GET_GROUP_MAX];
+        SHF_OP           group_ops [GET_GROUP_MAX]; /* only hash used; for shf_op_prefetch() */
+        for (const auto & key : keys) {
+            group_keys[group] = std::string_view(key);
+            shf_op_hash(&group_ops[group], group_keys[group].data(), group_keys[group].size());
+            if (GET_GROUP_MAX == ++ group) { found += get_group(group_keys, group_ops, group, visit); group = 0; }
+        }
+        if (group) { found += get_group(group_keys, group_ops, group, visit); }
+        return found;
+    }
+
+    template <typename RANGE, EnableIfRange<RANGE> = 0>
+    size_t del(const RANGE & keys) { /* returns keys deleted */
+        size_t dels = 0;
+        for (const auto & key : keys) { dels += del(std::string_view(key)) ? 1 : 0; }
+        return dels;
+    }
+
+    Cursor items() { return Cursor(shf); } /* e.g. for (shf::Item item : instance.items()) { ... } */
+
+private:
+    static constexpr uint32_t GET_GROUP_MAX = 16; /* keys per group; enough lookups in flight to hide memory latency */
+
+    template <typename VISIT>
+    size_t get_group(const std::string_view * group_keys, SHF_OP * group_ops, uint32_t group, VISIT & visit) { /* prefetch each lookup path step by step across the group, then look up each key */
+        uint32_t steps[GET_GROUP_MAX];
+        shf_read_begin(shf); /* keeps tabs mapped for shf_op_prefetch() */
+        for (uint32_t i = 0; i < group; i++) { steps[i] = SHF_PREFETCH_WIN; }
+        for (uint32_t pass = SHF_PREFETCH_WIN; pass <= SHF_PREFETCH_DATA; pass++) {
+            for (uint32_t i = 0; i < group; i++) {
+                if (SHF_PREFETCH_DONE != steps[i]) { steps[i] = shf_op_prefetch(shf, &group_ops[i], steps[i]); }
+            }
+        }
+        size_t found = 0;
+        for (uint32_t i = 0; i < group; i++) {
+            shf_op_hash_set(op, &group_ops[i].hash, group_keys[i].data(), group_keys[i].size());
+            std::optional<Value> value;
+            if (SHF_RET_KEY_FOUND == shf_op_get(shf, op)) { value = Value{op->uid, std::string_view(op->val, op->val_len)}; found ++; }
+            visit(group_keys[i], value);
+        }
+        shf_read_end(shf);
+        return found;
+    }
+
+    explicit Instance(SHF * attached) : shf(attached), op(attached ? shf_op_new() : nullptr) {}
+
+    SHF    * shf;
+    SHF_OP * op ;
+};
+
+inline uint64_t HashMix(uint64_t bits) { /* MurmurHash3 fmix64() finalizer */
+    bits ^= bits >> 33; bits *= 0xff51afd7ed558ccdULL;
+    bits ^= bits >> 33; bits *= 0xc4ceb9fe1a85ec53ULL;
+    bits ^= bits >> 33;
+    return bits;
+}
+
+template <typename K, typename V>
+class SharedHashMap { /* typed map over one shf in fixed length mode; sizeof(K),sizeof(V) pick the fixed shape fast paths, e.g. 4,4 or 8,16 */
+    static_assert(std::is_trivially_copyable_v<K>, "SharedHashMap key   must be trivially copyable");
+    static_assert(std::is_trivially_copyable_v<V>, "SharedHashMap value must be trivially copyable");
+    static_assert(sizeof(K) <= UINT32_MAX && sizeof(V) <= UINT32_MAX, "SharedHashMap key,value too big");
+
+public:
+    class Ref { /* guarded reference to value in place; shf_read_begin() keeps it mapped until destroyed; value may be unaligned so is only read via memcpy() */
+    public:
+                   Ref       (Ref && other) noexcept : shf(other.shf), val(other.val) { other.shf = nullptr; other.val = nullptr; }
+                  ~Ref       ()                 { if (shf) { shf_read_end(shf); } }
+                   Ref       (const Ref &)      = delete;
+        Ref      & operator= (const Ref &)      = delete;
+        Ref      & operator= (Ref &&)           = delete;
+        explicit   operator bool() const        { return nullptr != val; }
+        V          operator* () const           { return load(val); } /* copy of value as it is now */
+        const void * addr    () const           { return val; } /* unaligned address of value in place */
+
+    private:
+        friend class SharedHashMap;
+                   Ref       (SHF * ref_shf, const void * ref_val) : shf(ref_shf), val(ref_val) {}
+        SHF        * shf;
+        const void * val;
+    };
+
+    SharedHashMap() = default;
+    SharedHashMap(const char * path, const char * name, uint32_t delete_upon_process_exit) : instance(path, name, delete_upon_process_exit) { adopt(1); }
+
+    static SharedHashMap attach_existing          (const char * path, const char * name) { return SharedHashMap(Instance::attach_existing          (path, name)); } /* unattached if not found or other key,value lengths */
+    static SharedHashMap attach_existing_read_only(const char * path, const char * name) { return SharedHashMap(Instance::attach_existing_read_only(path, name)); } /* unattached if not found or other key,value lengths */
+
+    explicit operator bool() const { return static_cast<bool>(instance); }
+    SHF    * handle       () const { return instance.handle(); }
+    void     detach       ()       { instance.detach(); }
+    char   * destroy      ()       { return instance.destroy(); }
+
+    std::optional<V> get(const K & key) { /* copies value into raw storage, then into returned V; so V need not be default constructible */
+        alignas(V) unsigned char raw[sizeof(V)];
+        hash(key);
+        if (SHF_RET_KEY_FOUND != shf_op_get_buf(instance.handle(), instance.op_handle(), reinterpret_cast<char *>(raw), sizeof(V))) { return std::nullopt; }
+        return std::optional<V>(load(raw));
+    }
+
+    Ref ref(const K & key) {
+        SHF * shf = instance.handle();
+        shf_read_begin(shf);
+        hash(key);
+        if (SHF_RET_KEY_FOUND != shf_op_get_addr(shf, instance.op_handle())) { shf_read_end(shf); return Ref(nullptr, nullptr); }
+        return Ref(shf, instance.op_handle()->val_addr);
+    }
+
+    bool put(const K & key, const V & val) {
+        hash(key);
+        return SHF_RET_KEY_PUT == shf_op_put(instance.handle(), instance.op_handle(), reinterpret_cast<const char *>(&val), sizeof(V));
+    }
+
+    bool del(const K & key) {
+        hash(key);
+        return SHF_RET_KEY_FOUND == shf_op_del(instance.handle(), instance.op_handle());
+    }
+
+    template <typename F>
+    std::optional<F> add(const K & key, size_t val_offset, F increment) { /* atomically add to long sized field at val_offset, e.g. offsetof(V, hits), in place under the win lock; returns field after add */
+        static_assert(std::is_integral_v<F> && sizeof(F) == sizeof(long), "SharedHashMap::add() field must be long sized integer");
+        if (val_offset + sizeof(F) > sizeof(V)) { return std::nullopt; } /* field must lie within value */
+        hash(key);
+        SHF_OP * op = instance.op_handle();
+        if (SHF_RET_KEY_FOUND != shf_op_add_atom_at(instance.handle(), op, static_cast<uint32_t>(val_offset), static_cast<long>(increment))) { return std::nullopt; }
+        return static_cast<F>(op->val_long);
+    }
+
+private:
+    explicit SharedHashMap(Instance && attached) : instance(std::move(attached)) { adopt(0); }
+
+    void adopt(uint32_t is_new) { /* only use shf with fixed key,value lengths of K,V; else detach */
+        SHF * shf = instance.handle();
+        if (! shf) { return; }
+        uint32_t is_fixed = shf->shf_mmap->is_fixed_key_val_len;
+        if (( is_fixed && ((sizeof(K) != shf->shf_mmap->fixed_key_len) || (sizeof(V) != shf->shf_mmap->fixed_val_len)))
+        ||  (!is_fixed && !is_new)) {
+            instance.detach();
+            return;
+        }
+        shf_set_is_fixed_len(shf, sizeof(K), sizeof(V));
+    }
+
+    void hash(const K & key) { /* integer keys skip MurmurHash3; so only SharedHashMap<K,...> users find them */
+        SHF_OP * op = instance.op_handle();
+        if constexpr (std::is_integral_v<K> || std::is_enum_v<K>) {
+            SHF_HASH hash;
+            hash.u64[0] = HashMix(static_cast<uint64_t>(key)                        );
+            hash.u64[1] = HashMix(static_cast<uint64_t>(key) ^ 0x9e3779b97f4a7c15ULL);
+            shf_op_hash_set(op, &hash, reinterpret_cast<const char *>(&key), sizeof(K));
+        }
+        else {
+            shf_op_hash(op, reinterpret_cast<const char *>(&key), sizeof(K));
+        }
+    }
+
+    static V load(const void * addr) { /* copy of possibly unaligned value via raw storage */
+        alignas(V) unsigned char raw[sizeof(V)];
+        std::memcpy(raw, addr, sizeof(V));
+        return *std::launder(reinterpret_cast<const V *>(raw));
+    }
+
+    Instance instance;
+};
+
+class Arena { /* view of the arena in an shf; blocks never move & handles are valid in every attached process */
+public:
+    explicit Arena(SHF      * arena_shf) : shf(arena_shf        ) {}
+    explicit Arena(Instance & instance ) : shf(instance.handle()) {}
+
+    uint64_t alloc (uint32_t size) { return shf_arena_alloc(shf, size); } /* 0 if arena full */
+    void     free  (uint64_t handle, uint32_t size) { shf_arena_free(shf, handle, size); }
+    void   * addr  (uint64_t handle) const { /* seg already mapped by this process is the fast path */
+        char * seg = shf->arena_segs[handle >> SHF_ARENA_SEG_BITS];
+        return seg ? seg + (handle & (SHF_ARENA_SEG_SIZE - 1)) : shf_arena_addr(shf, handle);
+    }
+    SHF    * handle() const { return shf; }
+
+private:
+    SHF * shf;
+};
+
+template <typename T>
+struct ArenaPtr { /* offset pointer; trivially copyable so it can live in values or arena blocks */
+    uint64_t handle;
+
+    T      * get     (const Arena & arena) const { return handle ? static_cast<T *>(arena.addr(handle)) : nullptr; }
+    explicit operator bool() const { return 0 != handle; }
+};
+
+template <typename T>
+class ArenaAllocator { /* std allocator of arena blocks, e.g. elements at stable shared addresses; the container itself is process local */
+public:
+    using value_type = T;
+
+    explicit ArenaAllocator(Arena allocator_arena) : arena(allocator_arena) {}
+    template <typename U>
+    ArenaAllocator(const ArenaAllocator<U> & other) : arena(other.arena) {}
+
+    T * allocate(size_t n) {
+        uint64_t handle = n * sizeof(T) <= SHF_ARENA_SEG_SIZE ? arena.alloc(n * sizeof(T)) : 0;
+        if (0 == handle) { throw std::bad_alloc(); }
+        return static_cast<T *>(arena.addr(handle));
+    }
+    void deallocate(T * addr, size_t n) { arena.free(shf_arena_handle(arena.handle(), addr), n * sizeof(T)); }
+
+    template <typename U> bool operator==(const ArenaAllocator<U> & other) const { return arena.handle() == other.arena.handle(); }
+    template <typename U> bool operator!=(const ArenaAllocator<U> & other) const { return arena.handle() != other.arena.handle(); }
+
+    Arena arena;
+};
+
+template <typename T>
+struct ArenaVector { /* offset based vector; lives in shared memory, e.g. in an arena block, so takes the arena per call; caller serializes access */
+    static_assert(std::is_trivially_copyable_v<T>, "ArenaVector element must be trivially copyable");
+
+    uint64_t data    ; /* arena handle of elements; 0 if none */
+    uint32_t size    ;
+    uint32_t capacity;
+
+    T      * begin    (const Arena & arena) const { return data ? static_cast<T *>(arena.addr(data)) : nullptr; }
+    T      * end      (const Arena & arena) const { return begin(arena) + size; }
+    T      & at       (const Arena & arena, uint32_t i) const { return begin(arena)[i]; }
+    void     pop_back ()                          { size --; }
+
+    bool reserve(Arena & arena, uint32_t want) { /* false if arena full */
+        if (want <= capacity) { return true; }
+        uint64_t grown = arena.alloc(want * sizeof(T));
+        if (0 == grown) { return false; }
+        if (data) { std::memcpy(arena.addr(grown), arena.addr(data), size * sizeof(T)); }
+        arena.free(data, capacity * sizeof(T));
+        data     = grown;
+        capacity = want ;
+        return true;
+    }
+
+    bool push_back(Arena & arena, const T & val) { /* false if arena full */
+        if ((size == capacity) && ! reserve(arena, capacity ? 2 * capacity : 4)) { return false; }
+        begin(arena)[size ++] = val;
+        return true;
+    }
+
+    void clear(Arena & arena) { /* frees elements */
+        arena.free(data, capacity * sizeof(T));
+        data     = 0;
+        size     = 0;
+        capacity = 0;
+    }
+};
+
+template <typename T>
+struct ArenaDeque { /* offset based ring buffer deque; lives in shared memory like ArenaVector; caller serializes access */
+    static_assert(std::is_trivially_copyable_v<T>, "ArenaDeque element must be trivially copyable");
+
+    uint64_t data    ; /* arena handle of elements; 0 if none */
+    uint32_t head    ; /* index of front element */
+    uint32_t size    ;
+    uint32_t capacity; /* power of 2 */
+
+    T      & at       (const Arena & arena, uint32_t i) const { return static_cast<T *>(arena.addr(data))[(head + i) & (capacity - 1)]; }
+    T      & front    (const Arena & arena) const { return at(arena, 0       ); }
+    T      & back     (const Arena & arena) const { return at(arena, size - 1); }
+    void     pop_front()                          { head = (head + 1) & (capacity - 1); size --; }
+    void     pop_back ()                          { size --; }
+
+    bool push_back(Arena & arena, const T & val) { /* false if arena full */
+        if ((size == capacity) && ! grow(arena)) { return false; }
+        size ++;
+        back(arena) = val;
+        return true;
+    }
+
+    bool push_front(Arena & arena, const T & val) { /* false if arena full */
+        if ((size == capacity) && ! grow(arena)) { return false; }
+        head = (head - 1) & (capacity - 1);
+        size ++;
+        front(arena) = val;
+        return true;
+    }
+
+    void clear(Arena & arena) { /* frees elements */
+        arena.free(data, capacity * sizeof(T));
+        data     = 0;
+        head     = 0;
+        size     = 0;
+        capacity = 0;
+    }
+
+private:
+    bool grow(Arena & arena) { /* double capacity & unwrap elements to start at index 0 */
+        uint32_t want  = capacity ? 2 * capacity : 4;
+        uint64_t grown = arena.alloc(want * sizeof(T));
+        if (0 == grown) { return false; }
+        T * to = static_cast<T *>(arena.addr(grown));
+        for (uint32_t i = 0; i < size; i++) { to[i] = at(arena, i); }
+        arena.free(data, capacity * sizeof(T));
+        data     = grown;
+        head     = 0;
+        capacity = want ;
+        return true;
+    }
+};
+
+#if defined(__cpp_impl_coroutine)
+
+class Task { /* coroutine run by shf::Executor, e.g. shf::Task Lookup(shf::Executor & executor, ...) { auto value = co_await executor.get(key); ... } */
+public:
+    struct promise_type {
+        Task                get_return_object  ()          { return Task(std::coroutine_handle<promise_type>::from_promise(*this)); }
+        std::suspend_always initial_suspend    () noexcept { return {}; } /* started by Executor::run() */
+        std::suspend_always final_suspend      () noexcept { return {}; } /* destroyed by Executor::run() */
+        void                return_void        ()          {}
+        void                unhandled_exception()          { std::terminate(); }
+    };
+
+               Task      (Task && other) noexcept : handle(std::exchange(other.handle, nullptr)) {}
+              ~Task      ()                 { if (handle) { handle.destroy(); } }
+               Task      (const Task &)     = delete;
+    Task     & operator= (const Task &)     = delete;
+    Task     & operator= (Task &&)          = delete;
+
+private:
+    friend class Executor;
+    explicit   Task      (std::coroutine_handle<promise_type> task_handle) : handle(task_handle) {}
+    std::coroutine_handle<promise_type> handle;
+};
+
+class Executor { /* round robins up to tasks_max tasks on this thread; each co_await get() prefetches one step of its lookup path per turn, so memory latency of other lookups is hidden */
+    struct Slot {
+        std::coroutine_handle<> handle;
+        SHF_OP                * op    ;
+        uint32_t                step  ; /* next SHF_PREFETCH_* step before resuming handle */
+    };
+
+public:
+    class Get {
+    public:
+        bool                 await_ready  () const noexcept          { return false; }
+        void                 await_suspend(std::coroutine_handle<>)  { shf_op_hash(slot->op, key.data(), key.size()); slot->step = SHF_PREFETCH_WIN; }
+        std::optional<Value> await_resume () {
+            if (SHF_RET_KEY_FOUND != shf_op_get(shf, slot->op)) { return std::nullopt; }
+            return Value{slot->op->uid, std::string_view(slot->op->val, slot->op->val_len)};
+        }
+
+    private:
+        friend class Executor;
+        Get(SHF * get_shf, Slot * get_slot, std::string_view get_key) : shf(get_shf), slot(get_slot), key(get_key) {}
+        SHF            * shf ;
+        Slot           * slot;
+        std::string_view key ; /* must stay valid until co_await returns */
+    };
+
+    Executor(Instance & instance, uint32_t tasks_max) : shf(instance.handle()), slots(tasks_max), current(nullptr) {
+        for (Slot & slot : slots) { slot.op = shf_op_new(); slot.step = SHF_PREFETCH_DONE; }
+    }
+
+    ~Executor() {
+        for (Slot                    & slot   : slots ) { if (slot.handle) { slot.handle.destroy(); } shf_op_free(slot.op); }
+        for (std::coroutine_handle<> & handle : queued) { handle.destroy(); }
+    }
+
+    Executor(const Executor &)             = delete;
+    Executor & operator=(const Executor &) = delete;
+
+    void spawn(Task && task) { queued.push_back(std::exchange(task.handle, nullptr)); }
+
+    Get get(std::string_view key) { return Get(shf, current, key); } /* only from a task being run; value valid until the task's next co_await */
+
+    void run() { /* until all spawned tasks are done */
+        shf_read_begin(shf); /* keeps tabs mapped for shf_op_prefetch() */
+        for (uint32_t active = 1; active; ) {
+            active = 0;
+            for (Slot & slot : slots) {
+                if (! slot.handle) {
+                    if (queued.empty()) { continue; }
+                    slot.handle = queued.front();
+                    slot.step   = SHF_PREFETCH_DONE;
+                    queued.pop_front();
+                }
+                active ++;
+                if (SHF_PREFETCH_DONE != slot.step) {
+                    slot.step = shf_op_prefetch(shf, slot.op, slot.step);
+                    continue;
+                }
+                current = &slot;
+                slot.handle.resume();
+                if (slot.handle.done()) {
+                    slot.handle.destroy();
+                    slot.handle = nullptr;
+                }
+            }
+        }
+        current = nullptr;
+        shf_read_end(shf);
+    }
+
+private:
+    SHF                                 * shf    ;
+    std::vector<Slot>                     slots  ;
+    std::deque<std::coroutine_handle<>>   queued ;
+    Slot                                * current;
+};
+
+#endif /* __cpp_impl_coroutine */
+
+} /* namespace shf */
+
+#endif /* __SHF_HPP__ */
@@ -35,6 +35,11 @@
 #include <errno.h>       /* for errno */
 #include <stdlib.h>      /* for exit() */
 #include <sys/stat.h>    /* for stat() */
+#include <limits.h>      /* for INT_MAX */
+#include <linux/futex.h> /* for FUTEX_* */
+#include <fcntl.h>       /* for open() */
+#include <string.h>      /* for strrchr() */
+#include <time.h>        /* for clock_gettime() */
 
 #include "shf.defines.h"
 
@@ -113,7 +118,7 @@ RETRY_LOCK_AFTER_FORCE:;
 
 #ifdef SHF_DEBUG_VERSION
     if (spin) {
-        lock->conflicts ++;
+        lock->conflicts = lock->conflicts + 1;
     }
 #endif
 
@@ -153,7 +158,7 @@ shf_spin_lock_try(SHF_SPIN_LOCK * lock)
             return SHF_SPIN_LOCK_STATUS_LOCKED_ALREADY;
         }
 #ifdef SHF_DEBUG_VERSION
-        lock->conflicts ++;
+        lock->conflicts = lock->conflicts + 1;
 #endif
         return SHF_SPIN_LOCK_STATUS_FAILED;
     }
@@ -176,6 +181,15 @@ shf_spin_unlock(SHF_SPIN_LOCK * lock)
 #define SHF_BARRIER()   asm volatile(       "": : :"memory")
 #define SHF_CPU_PAUSE() asm volatile("pause\n": : :"memory")
 
+static inline uint64_t
+shf_rdtsc(void) /* cpu time stamp counter; cheap enough to sample around each lock */
+{
+    uint32_t lo;
+    uint32_t hi;
+    asm volatile("rdtsc" : "=a" (lo), "=d" (hi));
+    return (SHF_CAST(uint64_t, hi) << 32) | lo;
+} /* shf_rdtsc() */
+
 union SHF_RW_LOCK_UNION
 {
     volatile uint64_t as_u64;
@@ -196,7 +210,7 @@ union SHF_RW_LOCK_UNION
 
 typedef struct SHF_RW_LOCK {
     volatile union SHF_RW_LOCK_UNION lock;
-    volatile pid_t                   pid;
+    volatile uint64_t                owner; /* SHF_LOCK_OWNER() of writer holding lock; 0 means no writer */
 #ifdef SHF_DEBUG_VERSION
     volatile uint32_t                line;
     volatile uint64_t                macro;
@@ -204,11 +218,105 @@ typedef struct SHF_RW_LOCK {
 #endif
 } SHF_RW_LOCK;
 
+/* Dead owner recovery: a writer records its tid & pid namespace in the lock as one 64 bit word, and a waiter which has waited
+ * for a while checks if that writer still exists. If not then the first waiter to notice claims the lock on its behalf with a
+ * compare & swap of the whole word, calls shf_lock_recover_hook() so that whatever the dead writer was modifying can be repaired,
+ * and then unlocks for it so the queue moves on. A writer in another pid namespace, e.g. another container sharing /dev/shm, is
+ * never presumed dead because its tid means nothing here. Only writers are tracked, so a reader which dies holding the lock, or
+ * a waiter which dies holding a ticket, still stalls the lock.
+ */
+
+#define SHF_LOCK_STALL_SPINS (1 << 22)      /* pauses between checks that writer holding lock is alive; power of 2 */
+#define SHF_LOCK_STALL_NS    (100000000UL)  /* sleep between checks that writer holding lock is alive; for futex lock */
+
+#define SHF_LOCK_OWNER(TID, NS)  ((SHF_CAST(uint64_t, NS) << 32) | SHF_CAST(uint32_t, TID)) /* NS is low 32 bits of pid namespace inode */
+#define SHF_LOCK_OWNER_TID(OWNER) SHF_CAST(uint32_t, (OWNER)      )
+#define SHF_LOCK_OWNER_NS(OWNER)  SHF_CAST(uint32_t, (OWNER) >> 32)
+
+extern __thread uint64_t shf_lock_owner; /* cached SHF_LOCK_OWNER() of caller; 0 until first writer lock & after fork() */
+
+extern void (* shf_lock_recover_hook)(void * lock); /* called holding dead writer's lock; NULL means only unlock */
+
+static inline uint64_t
+shf_lock_owner_get(void) /* SHF_LOCK_OWNER() of caller */
+{
+    if (0 == shf_lock_owner) {
+        struct stat sb;
+        uint32_t    ns = 0 == stat("/proc/self/ns/pid", &sb) ? SHF_CAST(uint32_t, sb.st_ino) : 0; /* 0 if unknown, e.g. no /proc */
+        shf_lock_owner = SHF_LOCK_OWNER(SHF_GETTID(), ns);
+    }
+    return shf_lock_owner;
+} /* shf_lock_owner_get() */
+
+static inline void
+shf_lock_owner_set(volatile uint64_t * owner)
+{
+    *owner = shf_lock_owner_get();
+} /* shf_lock_owner_set() */
+
+static inline uint32_t /* 0 if owner has gone poof or is a zombie; 1 if alive or not known to be dead */
+shf_lock_owner_is_alive(uint64_t owner)
+{
+    uint32_t ns = SHF_LOCK_OWNER_NS(shf_lock_owner_get());
+    if ((0 == ns) || (ns != SHF_LOCK_OWNER_NS(owner))) {
+        return 1; /* owner's tid is not in our pid namespace, so /proc cannot tell */
+    }
+    char proc_tid_stat[256];
+    SHF_SNPRINTF(0, proc_tid_stat, "/proc/%u/stat", SHF_LOCK_OWNER_TID(owner)); /* works for any tid, not only process leaders */
+    int fd = open(proc_tid_stat, O_RDONLY);
+    if (-1 == fd) {
+        return ENOENT == errno ? 0 : 1; /* e.g. EMFILE; assume alive */
+    }
+    char    stat[256];
+    ssize_t bytes = read(fd, stat, sizeof(stat) - 1);
+    close(fd);
+    if (bytes <= 0) {
+        return 0; /* task exiting */
+    }
+    stat[bytes] = 0;
+    const char * comm_end = strrchr(stat, ')'); /* e.g. '1234 (comm) S ...' */
+    return (comm_end && ('Z' == comm_end[2] || 'X' == comm_end[2])) ? 0 : 1; /* zombie means died but not reaped yet */
+} /* shf_lock_owner_is_alive() */
+
+static inline uint32_t /* 1 if lock was claimed from owner, which caller found dead; caller then calls hook & unlocks on its behalf */
+shf_lock_owner_claim(volatile uint64_t * owner_addr, uint64_t owner, void * lock)
+{
+    uint64_t claimer = shf_lock_owner_get();
+    if (! __sync_bool_compare_and_swap(owner_addr, owner, claimer)) {
+        return 0; /* another waiter got there first, or writer unlocked & lock handed on meanwhile */
+    }
+    fprintf(stderr, "WARN: lock %p waited on by tid %u of pid %u because of writer tid %u which went poof; recovering lock\n", lock, SHF_LOCK_OWNER_TID(claimer), getpid(), SHF_LOCK_OWNER_TID(owner));
+    if (shf_lock_recover_hook) {
+        shf_lock_recover_hook(lock);
+    }
+    return 1;
+} /* shf_lock_owner_claim() */
+
+static inline uint32_t /* 1 if lock was claimed from a dead writer; caller then calls hook & unlocks on its behalf */
+shf_lock_owner_claim_if_dead(volatile uint64_t * owner_addr, void * lock)
+{
+    uint64_t owner = *owner_addr; /* one load, so tid & namespace always belong to the same writer */
+    if ((0 == owner) || shf_lock_owner_is_alive(owner)) {
+        return 0;
+    }
+    return shf_lock_owner_claim(owner_addr, owner, lock);
+} /* shf_lock_owner_claim_if_dead() */
+
 /*                                                 0x0706050403020100 */
 #define SHF_RW_LOCK_INC_TICKET_NEXT_ACTIVE_WRITER (0x0000000000000001)
 #define SHF_RW_LOCK_INC_TICKET_NEXT_ACTIVE_READER (0x0000000000010000)
 #define SHF_RW_LOCK_INC_TICKET_NEXT               (0x0000000100000000)
 
+static inline void shf_rw_unlock_writer(SHF_RW_LOCK * lock);
+
+static inline void
+shf_rw_lock_recover(SHF_RW_LOCK * lock)
+{
+    if (shf_lock_owner_claim_if_dead(&lock->owner, lock)) {
+        shf_rw_unlock_writer(lock);
+    }
+} /* shf_rw_lock_recover() */
+
 static inline void
 shf_rw_lock_writer(SHF_RW_LOCK * lock)
 {
@@ -219,11 +327,15 @@ shf_rw_lock_writer(SHF_RW_LOCK * lock)
 
     lock->lock.as_u08.pad_ticket_next = 0; /* ensure overflow never gets too big */
 
-    while (ticket_next_pre_inc != lock->lock.as_u08.ticket_active_writer) { SHF_CPU_PAUSE(); spin ++; }
+    while (ticket_next_pre_inc != lock->lock.as_u08.ticket_active_writer) {
+        SHF_CPU_PAUSE(); spin ++;
+        if (0 == (spin & (SHF_LOCK_STALL_SPINS - 1))) { shf_rw_lock_recover(lock); }
+    }
+    shf_lock_owner_set(&lock->owner);
 
 #ifdef SHF_DEBUG_VERSION
     if (spin) {
-        lock->conflicts ++;
+        lock->conflicts = lock->conflicts + 1;
     }
 #endif
 } /* shf_rw_lock_writer() */
@@ -231,14 +343,15 @@ shf_rw_lock_writer(SHF_RW_LOCK * lock)
 static inline void
 shf_rw_unlock_writer(SHF_RW_LOCK * lock)
 {
+    lock->owner = 0; /* before ticket increment below, which is also a barrier */
     if (0) {
         SHF_RW_LOCK tmp;
         tmp.lock.as_u32 = lock->lock.as_u32;
 
         SHF_BARRIER();
 
-        tmp.lock.as_u08.ticket_active_writer ++;
-        tmp.lock.as_u08.ticket_active_reader ++;
+        tmp.lock.as_u08.ticket_active_writer = tmp.lock.as_u08.ticket_active_writer + 1;
+        tmp.lock.as_u08.ticket_active_reader = tmp.lock.as_u08.ticket_active_reader + 1;
 
         lock->lock.as_u32 = tmp.lock.as_u32;
     }
@@ -259,9 +372,12 @@ shf_rw_lock_reader(SHF_RW_LOCK * lock)
 
     lock->lock.as_u08.pad_ticket_next = 0; /* ensure overflow never gets too big */
 
-    while (ticket_next_pre_inc != lock->lock.as_u08.ticket_active_reader)  { SHF_CPU_PAUSE(); spin ++; } /* todo: add pid to identify trouble-maker when spinned for too long */
+    while (ticket_next_pre_inc != lock->lock.as_u08.ticket_active_reader) {
+        SHF_CPU_PAUSE(); spin ++;
+        if (0 == (spin & (SHF_LOCK_STALL_SPINS - 1))) { shf_rw_lock_recover(lock); }
+    }
     if (0) {
-        lock->lock.as_u08.ticket_active_reader ++; /* so that other readers can read concurrently (if no writer) */
+        lock->lock.as_u08.ticket_active_reader = lock->lock.as_u08.ticket_active_reader + 1; /* so that other readers can read concurrently (if no writer) */
     }
     else {
         __sync_add_and_fetch_8(&lock->lock.as_u64, SHF_RW_LOCK_INC_TICKET_NEXT_ACTIVE_READER); /* atomic increment ticket_active_reader */
@@ -270,7 +386,7 @@ shf_rw_lock_reader(SHF_RW_LOCK * lock)
 
 #ifdef SHF_DEBUG_VERSION
     if (spin) {
-        lock->conflicts ++;
+        lock->conflicts = lock->conflicts + 1;
         /* todo: record bucket stats for number of spins; consider using SHF_YIELD() instead of SHF_SHF_CPU_PAUSE() if too many spins */
     }
 #endif
@@ -283,6 +399,132 @@ shf_rw_unlock_reader(SHF_RW_LOCK * lock)
     lock->lock.as_u08.pad_ticket_active_writer = 0; /* ensure overflow never gets too big */
 } /* shf_rw_unlock_reader() */
 
+/* Hybrid spin-then-futex version of SHF_RW_LOCK: the same fair ticket order, but with 32 bit tickets in separate words so that more
+ * than 255 waiters cannot wrap, and waiters which spin for an adaptive period and then sleep on the futex of the word they wait for.
+ * Sleepers use bitset 1 << (ticket % 32) so that an unlock mostly wakes only the next ticket, and unlock only calls futex() if there
+ * are sleepers. Spinning only happens near the front of the queue, so descheduled holders do not make every waiter burn cpu.
+ */
+
+#define SHF_RW_FUTEX_LOCK_SPIN_MIN   (16)   /* fewest pauses before sleeping */
+#define SHF_RW_FUTEX_LOCK_SPIN_MAX   (4096) /* most   pauses before sleeping */
+#define SHF_RW_FUTEX_LOCK_SPIN_AHEAD (2)    /* spin only if at most this many tickets ahead of ours; else sleep at once */
+
+typedef struct SHF_RW_FUTEX_LOCK {
+    volatile uint32_t ticket_next         ; /* next ticket to hand out */
+    volatile uint32_t ticket_active_writer; /* ticket allowed to write; incremented by each unlock */
+    volatile uint32_t ticket_active_reader; /* ticket allowed to read ; incremented by each reader lock & writer unlock */
+    volatile uint32_t sleepers_writer     ; /* waiters sleeping -- or about to -- on ticket_active_writer */
+    volatile uint32_t sleepers_reader     ; /* waiters sleeping -- or about to -- on ticket_active_reader */
+    volatile uint32_t spin_limit          ; /* adaptive pauses before sleeping; 0 means SHF_RW_FUTEX_LOCK_SPIN_MIN */
+    volatile uint64_t owner               ; /* SHF_LOCK_OWNER() of writer holding lock; 0 means no writer */
+#ifdef SHF_DEBUG_VERSION
+    volatile uint32_t line;
+    volatile uint64_t macro;
+    volatile uint64_t conflicts; /* count how often lock did not lock on first try */
+#endif
+} SHF_RW_FUTEX_LOCK;
+
+static inline void
+shf_rw_futex_wake(volatile uint32_t * ticket_active, uint32_t ticket)
+{
+    syscall(SYS_futex, ticket_active, FUTEX_WAKE_BITSET, INT_MAX, NULL, NULL, 1U << (ticket % 32));
+} /* shf_rw_futex_wake() */
+
+static inline void shf_rw_futex_unlock_writer(SHF_RW_FUTEX_LOCK * lock);
+
+static inline void
+shf_rw_futex_lock_recover(SHF_RW_FUTEX_LOCK * lock)
+{
+    if (shf_lock_owner_claim_if_dead(&lock->owner, lock)) {
+        shf_rw_futex_unlock_writer(lock);
+    }
+} /* shf_rw_futex_lock_recover() */
+
+static inline void
+shf_rw_futex_lock_wait( /* wait until ticket is active; spin if near the front of the queue, else sleep */
+    SHF_RW_FUTEX_LOCK * lock         ,
+    volatile uint32_t * ticket_active,
+    volatile uint32_t * sleepers     ,
+    uint32_t            ticket       )
+{
+    uint32_t active = *ticket_active;
+    if (active == ticket) {
+        return;
+    }
+
+#ifdef SHF_DEBUG_VERSION
+    lock->conflicts = lock->conflicts + 1;
+#endif
+
+    uint32_t spin_limit = lock->spin_limit ? lock->spin_limit : SHF_RW_FUTEX_LOCK_SPIN_MIN;
+    uint32_t spin       = 0;
+    uint32_t slept      = 0;
+    do {
+        if (ticket - active <= SHF_RW_FUTEX_LOCK_SPIN_AHEAD && spin < spin_limit) {
+            SHF_CPU_PAUSE();
+            spin ++;
+        }
+        else {
+            __sync_fetch_and_add(sleepers, 1); /* before re-reading active, so unlock either sees us or we see its increment */
+            active = *ticket_active;
+            if (active != ticket) {
+                struct timespec timeout; /* absolute for FUTEX_WAIT_BITSET */
+                clock_gettime(CLOCK_MONOTONIC, &timeout);
+                timeout.tv_nsec += SHF_LOCK_STALL_NS;
+                if (timeout.tv_nsec >= 1000000000L) { timeout.tv_sec ++; timeout.tv_nsec -= 1000000000L; }
+                long value = syscall(SYS_futex, ticket_active, FUTEX_WAIT_BITSET, active, &timeout, NULL, 1U << (ticket % 32)); /* returns at once if active changed */
+                slept = 1;
+                if (-1 == value && ETIMEDOUT == errno) {
+                    __sync_fetch_and_sub(sleepers, 1);
+                    shf_rw_futex_lock_recover(lock);
+                    __sync_fetch_and_add(sleepers, 1);
+                }
+            }
+            __sync_fetch_and_sub(sleepers, 1);
+        }
+        active = *ticket_active;
+    } while (active != ticket);
+
+    /* spin longer next time if spinning paid off, else shorter; moves 1/8 of the way like glibc adaptive mutexes */
+    uint32_t spin_target = slept ? SHF_RW_FUTEX_LOCK_SPIN_MIN : (spin * 2 < SHF_RW_FUTEX_LOCK_SPIN_MAX ? spin * 2 : SHF_RW_FUTEX_LOCK_SPIN_MAX);
+             spin_target = spin_target < SHF_RW_FUTEX_LOCK_SPIN_MIN ? SHF_RW_FUTEX_LOCK_SPIN_MIN : spin_target;
+    lock->spin_limit = spin_limit + (SHF_CAST(int32_t, spin_target - spin_limit) / 8); /* racy but only a hint */
+} /* shf_rw_futex_lock_wait() */
+
+static inline void
+shf_rw_futex_lock_writer(SHF_RW_FUTEX_LOCK * lock)
+{
+    uint32_t ticket = __sync_fetch_and_add(&lock->ticket_next, 1);
+    shf_rw_futex_lock_wait(lock, &lock->ticket_active_writer, &lock->sleepers_writer, ticket);
+    shf_lock_owner_set(&lock->owner);
+} /* shf_rw_futex_lock_writer() */
+
+static inline void
+shf_rw_futex_unlock_writer(SHF_RW_FUTEX_LOCK * lock)
+{
+    lock->owner = 0; /* before ticket increment below, which is also a barrier */
+    uint32_t reader = __sync_add_and_fetch(&lock->ticket_active_reader, 1);
+    uint32_t writer = __sync_add_and_fetch(&lock->ticket_active_writer, 1);
+    if (lock->sleepers_reader) { shf_rw_futex_wake(&lock->ticket_active_reader, reader); }
+    if (lock->sleepers_writer) { shf_rw_futex_wake(&lock->ticket_active_writer, writer); }
+} /* shf_rw_futex_unlock_writer() */
+
+static inline void
+shf_rw_futex_lock_reader(SHF_RW_FUTEX_LOCK * lock)
+{
+    uint32_t ticket = __sync_fetch_and_add(&lock->ticket_next, 1);
+    shf_rw_futex_lock_wait(lock, &lock->ticket_active_reader, &lock->sleepers_reader, ticket);
+    uint32_t reader = __sync_add_and_fetch(&lock->ticket_active_reader, 1); /* so that other readers can read concurrently (if no writer) */
+    if (lock->sleepers_reader) { shf_rw_futex_wake(&lock->ticket_active_reader, reader); }
+} /* shf_rw_futex_lock_reader() */
+
+static inline void
+shf_rw_futex_unlock_reader(SHF_RW_FUTEX_LOCK * lock)
+{
+    uint32_t writer = __sync_add_and_fetch(&lock->ticket_active_writer, 1);
+    if (lock->sleepers_writer) { shf_rw_futex_wake(&lock->ticket_active_writer, writer); }
+} /* shf_rw_futex_unlock_reader() */
+
 #if 0
 
 #define SHF_LOCK                SHF_SPIN_LOCK
@@ -291,6 +533,14 @@ shf_rw_unlock_reader(SHF_RW_LOCK * lock)
 #define SHF_LOCK_WRITER(LOCK)   SHF_LOCK_READER(LOCK)
 #define SHF_UNLOCK_WRITER(LOCK) SHF_UNLOCK_READER(LOCK)
 
+#elif defined(SHF_LOCK_FUTEX)
+
+#define SHF_LOCK                SHF_RW_FUTEX_LOCK
+#define SHF_LOCK_READER(LOCK)   SHF_DEBUG("- rw futex locking for reader %s()\n", __FUNCTION__); shf_rw_futex_lock_reader(LOCK)
+#define SHF_UNLOCK_READER(LOCK)                                                                  shf_rw_futex_unlock_reader(LOCK); SHF_DEBUG("- rw futex unlocked for reader %s()\n", __FUNCTION__);
+#define SHF_LOCK_WRITER(LOCK)   SHF_DEBUG("- rw futex locking for writer %s()\n", __FUNCTION__); shf_rw_futex_lock_writer(LOCK)
+#define SHF_UNLOCK_WRITER(LOCK)                                                                  shf_rw_futex_unlock_writer(LOCK); SHF_DEBUG("- rw futex unlocked for writer %s()\n", __FUNCTION__);
+
 #else
 
 #define SHF_LOCK                SHF_RW_LOCK
@@ -25,6 +25,7 @@
 #define __SHF_PRIVATE_H__
 
 #include <stdint.h>
+#include <sys/uio.h> /* for struct iovec */
 
 #include "shf.lock.h"
 
@@ -44,10 +45,12 @@
 #define SHF_WINS_PER_SHF        (1<<SHF_WINS_PER_SHF_BITS)                                /*     256  wins per shf */
 #define SHF_REFS_PER_SHF        (SHF_REFS_PER_WIN * SHF_WINS_PER_SHF)                     /*   4,096M refs per shf */
 #define SHF_TABS_PER_SHF        (SHF_TABS_PER_WIN * SHF_WINS_PER_SHF)                     /* 524,288  tabs per shf */
+#define SHF_REF_RND_BITS        (32 - SHF_TABS_PER_WIN_BITS - 1)                          /*      20  bits         */
 
 typedef struct SHF_REF_MMAP { // todo: consider optimizing from 4+4 bytes to 3+3 bytes (maybe not due to useful atomic long?)
     volatile uint32_t tab :      SHF_TABS_PER_WIN_BITS; /* 11 bits or 2,048 tabs */
-    volatile uint32_t rnd : 32 - SHF_TABS_PER_WIN_BITS; /* 21 bits or 2,097,152; /16 is 1 in 131,072 chance */
+    volatile uint32_t rnd :      SHF_REF_RND_BITS     ; /* 20 bits or 1,048,576; /16 is 1 in 65,536 chance */
+    volatile uint32_t hit :                          1; /* CLOCK reference bit; set upon get in cache mode */
     volatile uint32_t pos                             ; /* 0 means ref UNused */
 } __attribute__((packed)) SHF_REF_MMAP;
 
@@ -88,10 +91,118 @@ typedef struct SHF_WIN_MMAP {
     volatile uint64_t     tabs_parted_new       ; /* parted in new tab */
     volatile uint64_t     keylen_misses         ; /* times hash   matched but keylen didn't match */
     volatile uint64_t     memcmp_misses         ; /* times keylen matched but key    didn't match */
+    volatile uint32_t     wheel_size            ; /* size of ttl timer wheel memory; 0 means no key with ttl put yet */
+    volatile uint64_t     keys_expired          ; /* times key with expired ttl deleted by reaper or row probe */
+    volatile uint32_t     keys_used             ; /* keys in win */
+    volatile uint64_t     data_used             ; /* key,value bytes used in win */
+    volatile uint64_t     keys_evicted          ; /* times key evicted in cache mode */
+    volatile uint16_t     clock_tab             ; /* CLOCK hand; tab */
+    volatile uint16_t     clock_ref             ; /* CLOCK hand; ref in tab */
+    volatile uint64_t     locks_recovered       ; /* times lock recovered from writer which died holding it */
 } __attribute__((packed)) SHF_WIN_MMAP;
 
+#define SHF_WHEEL_LEVELS        (4)                                                       /*       4  levels per wheel */
+#define SHF_WHEEL_SLOTS_BITS    (6)                                                       /*       6  bits             */
+#define SHF_WHEEL_SLOTS         (1<<SHF_WHEEL_SLOTS_BITS)                                 /*      64  slots per level  */
+#define SHF_WHEEL_SPAN_BITS     (SHF_WHEEL_LEVELS * SHF_WHEEL_SLOTS_BITS)                 /*      24  bits or ~194 days of seconds */
+
+typedef struct SHF_WHEEL_NODE_MMAP {
+    volatile uint32_t uid   ; /* key put with ttl */
+    volatile uint32_t expiry; /* second key expires */
+    volatile uint32_t next  ; /* next node in slot or free list; 0 means none */
+} __attribute__((packed)) SHF_WHEEL_NODE_MMAP;
+
+typedef struct SHF_WHEEL_MMAP { /* hierarchical timer wheel per win; nodes are checked against the key when they fire */
+    volatile uint32_t            now                                    ; /* last second reaped */
+    volatile uint32_t            nodes_used                             ; /* nodes in slots */
+    volatile uint32_t            nodes_free                             ; /* first node in free list; 0 means none */
+    volatile uint32_t            nodes_made                             ; /* nodes ever used; node 0 means none */
+    volatile uint32_t            slot[SHF_WHEEL_LEVELS][SHF_WHEEL_SLOTS]; /* first node in slot; 0 means none */
+    volatile SHF_WHEEL_NODE_MMAP node[0]                                ;
+} __attribute__((packed)) SHF_WHEEL_MMAP;
+
+typedef struct SHF_WHEEL {
+    SHF_WHEEL_MMAP * wheel_mmap; /* pointer to ttl timer wheel memory */
+    uint32_t         wheel_size; /* size of memory (mod 4KB) */
+} __attribute__((packed)) SHF_WHEEL;
+
+#define SHF_READERS_MAX (256) /* max attached SHF instances using shf_read_begin() at the same time */
+
+typedef struct SHF_READER_MMAP {
+    volatile pid_t    pid  ; /* 0 means slot unused */
+    volatile uint64_t epoch; /* 0 means not reading, otherwise 1 + global epoch when shf_read_begin() called */
+} __attribute__((packed)) SHF_READER_MMAP;
+
+#define SHF_LOCK_TIMES_LINEAR    (16)                                                     /*      16  buckets of 1 cycle for 0 to 15 cycles */
+#define SHF_LOCK_TIMES_SUBS_BITS (2)                                                      /*       4  buckets per power of 2 above that */
+#define SHF_LOCK_TIMES_BUCKETS   (128)                                                    /*     128  buckets up to ~2^32 cycles; last bucket counts slower too */
+
+typedef enum SHF_LOCK_OP {
+    SHF_LOCK_OP_GET   , /* key,value get, copy, add, visit */
+    SHF_LOCK_OP_PUT   , /* key,value put & update */
+    SHF_LOCK_OP_DEL   , /* key,value del */
+    SHF_LOCK_OP_PART  , /* tab part while put holds writer lock; hold only */
+    SHF_LOCK_OP_SHRINK, /* tab shrink while put or del holds writer lock; hold only */
+    SHF_LOCK_OPS
+} SHF_LOCK_OP;
+
+typedef struct SHF_LOCK_TIMES_MMAP { /* log-linear histograms of rdtsc cycles; shared by all attached processes */
+    volatile uint64_t wait[SHF_WINS_PER_SHF][SHF_LOCK_OPS][SHF_LOCK_TIMES_BUCKETS]; /* cycles waiting to get win lock */
+    volatile uint64_t hold[SHF_WINS_PER_SHF][SHF_LOCK_OPS][SHF_LOCK_TIMES_BUCKETS]; /* cycles holding win lock, or taken by part & shrink */
+} SHF_LOCK_TIMES_MMAP;
+
+#define SHF_HOT_KEYS_TOP     (64) /* keys tracked by space-saving top-K */
+#define SHF_HOT_KEYS_KEY_MAX (48) /* key bytes kept per hot key; longer keys are truncated but still told apart by hash */
+
+typedef struct SHF_HOT_KEY {
+    uint64_t hash                       ; /* shf_hash.u64[0] of key */
+    uint64_t count                      ; /* samples; over estimate by at most error; 0 means slot unused */
+    uint64_t error                      ; /* count inherited from key evicted from slot */
+    uint32_t win                        ; /* win of key */
+    uint32_t key_len                    ; /* full length of key */
+    char     key[SHF_HOT_KEYS_KEY_MAX]  ; /* first key bytes */
+} SHF_HOT_KEY;
+
+typedef struct SHF_HOT_KEYS_MMAP { /* sampled op counts & hottest keys; shared by all attached processes */
+             SHF_LOCK    lock                                ; /* serializes samplers updating keys */
+    volatile uint32_t    sample                              ; /* 1 in sample ops were sampled, last time set */
+    volatile uint64_t    samples                             ; /* all samples */
+    volatile uint64_t    ops[SHF_WINS_PER_SHF][SHF_LOCK_OPS] ; /* samples by win & op; only get, put & del */
+             SHF_HOT_KEY keys[SHF_HOT_KEYS_TOP]              ; /* hottest keys; unsorted */
+} SHF_HOT_KEYS_MMAP;
+
+#define SHF_ARENA_SEG_BITS       (22)                                                     /*   4MB per arena seg  */
+#define SHF_ARENA_SEG_SIZE       (1 << SHF_ARENA_SEG_BITS)
+#define SHF_ARENA_SEGS_MAX       (4096)                                                   /*  16GB per arena      */
+#define SHF_ARENA_CLASS_MIN_BITS (4)                                                      /*    16 bytes smallest */
+#define SHF_ARENA_CLASSES        (SHF_ARENA_SEG_BITS - SHF_ARENA_CLASS_MIN_BITS + 1)      /*    19 power of 2 size classes up to 4MB */
+#define SHF_ARENA_SLAB_SIZE      (1 << 16)                                                /*  64KB carved per size class refill */
+#define SHF_ARENA_CACHE_MAX      (32)                                                     /*    32 private free blocks per size class */
+
+typedef struct SHF_ARENA_MMAP { /* arena of blocks which never move; handle is seg << SHF_ARENA_SEG_BITS | offset, valid in all attached processes */
+             SHF_LOCK lock                      ; /* serializes carving & shared free lists */
+    volatile uint32_t segs_used                 ; /* arena.NNNN seg files made; seg 0 unused so handle 0 means none */
+    volatile uint32_t seg_bump                  ; /* bytes carved from last seg */
+    volatile uint64_t free[SHF_ARENA_CLASSES]   ; /* shared free list per size class; next handle in first 8 bytes of each block */
+} SHF_ARENA_MMAP;
+
+typedef struct SHF_ARENA_CACHE { /* private free blocks so most alloc & free avoid the arena lock */
+    uint32_t used                         ;
+    uint64_t handles[SHF_ARENA_CACHE_MAX] ;
+} SHF_ARENA_CACHE;
+
 typedef struct SHF_SHF_MMAP {
-    SHF_WIN_MMAP wins[SHF_WINS_PER_SHF]; /* 256 WINdows */
+             SHF_WIN_MMAP    wins[SHF_WINS_PER_SHF]  ; /* 256 WINdows */
+    volatile uint64_t        epoch                   ; /* global epoch; incremented each time a tab mmap() is retired */
+    volatile uint64_t        cache_data_max          ; /* cache mode key,value bytes budget; 0 means unlimited */
+    volatile uint32_t        cache_keys_max          ; /* cache mode keys budget; 0 means unlimited */
+    volatile uint32_t        lock_times_sample       ; /* sample 1 in n win lock wait & hold times into lock.times; 0 means not sampling */
+    volatile uint32_t        hot_keys_sample         ; /* sample 1 in n key,value ops into hot.keys; 0 means not sampling */
+    volatile uint32_t        is_frozen               ; /* 1 means key,values read only & readers skip locking; see shf_freeze() */
+    volatile uint32_t        is_fixed_key_val_len    ; /* 1 means key values all the same length; persisted by shf_set_is_fixed_len() */
+    volatile uint32_t        fixed_key_len           ; /* length of key   if is_fixed_key_val_len */
+    volatile uint32_t        fixed_val_len           ; /* length of value if is_fixed_key_val_len */
+             SHF_READER_MMAP readers[SHF_READERS_MAX]; /* reader epochs; one slot per attached SHF instance */
 } __attribute__((packed)) SHF_SHF_MMAP;
 
 typedef struct SHF_Q_LOCK_MMAP {
@@ -112,19 +223,91 @@ typedef struct SHF_QIID_MMAP {
     volatile uint32_t next;
 } __attribute__((packed)) SHF_QIID_MMAP;
 
+typedef struct SHF_Q_RING_MMAP { /* per qid lock free MPMC ring positions; each on own cache line so pushers & pullers don't false share */
+    volatile uint32_t push_pos        ;
+             uint8_t  push_pad[60]    ;
+    volatile uint32_t pull_pos        ;
+             uint8_t  pull_pad[60]    ;
+} __attribute__((packed)) SHF_Q_RING_MMAP;
+
+typedef struct SHF_Q_SLOT_MMAP {
+    volatile uint32_t seq             ; /* pos + 1 if slot holds qiid for pos, else pos for next push into slot */
+    volatile uint32_t qiid            ;
+} __attribute__((packed)) SHF_Q_SLOT_MMAP;
+
+#define SHF_Q_WAIT_SPIN_MIN (64)         /* fewest pauses polling for a qiid before sleeping */
+#define SHF_Q_WAIT_SPIN_MAX (16384)      /* most   pauses polling for a qiid before sleeping */
+
+typedef struct SHF_Q_WAIT_MMAP { /* per qid pullers sleeping in shf_q_pull_tail_wait(); own cache line */
+    volatile uint32_t wakes           ; /* futex word; incremented by each wake */
+    volatile uint32_t sleepers        ; /* pullers sleeping -- or about to -- on wakes */
+    volatile uint32_t armed           ; /* 1 if a puller started sleeping since the last wake; so 1 wake syscall serves many pushes */
+    volatile uint32_t spin_limit      ; /* adaptive pauses before sleeping; 0 means SHF_Q_WAIT_SPIN_MIN */
+             uint8_t  pad[48]         ;
+} __attribute__((packed)) SHF_Q_WAIT_MMAP;
+
+typedef struct SHF_Q_SPSC_CACHE { /* per process copies of the other end's ring position; only re-read when exhausted */
+    uint32_t          pull_pos_seen   ; /* for pusher; ring has room while push_pos - pull_pos_seen <= q_ring_mask */
+    uint32_t          push_pos_seen   ; /* for puller; ring has qiids while pull_pos != push_pos_seen */
+} __attribute__((packed)) SHF_Q_SPSC_CACHE;
+
+#define SHF_Q_PROCS_MAX  (64)   /* processes with own nolock qs at once; slots of dead processes are reaped; others push & pull via locked qs */
+#define SHF_Q_PROC_RETRY (1000) /* pushes & pulls via locked qs before a process without a slot tries to claim one again */
+
+typedef struct SHF_Q_PROCS_MMAP { /* head of __q_procs; own cache line */
+    volatile uint32_t lease_ms        ; /* leases also expire after lease_ms; 0 means only when owner goes; see shf_q_set_reap() */
+    volatile uint32_t is_reap         ; /* 1 once shf_q_set_reap() called; until then no leases are written */
+    volatile uint32_t nonce           ; /* last nonce handed to a claimed slot */
+             uint8_t  pad[52]         ;
+} __attribute__((packed)) SHF_Q_PROCS_MMAP;
+
+typedef struct SHF_Q_PROC_MMAP { /* per process slot in __q_procs holding its nolock pre-queues, so they survive it */
+    volatile uint32_t pid             ; /* owner; 0 if slot free */
+    volatile uint32_t nonce           ; /* owner's per claim nonce recorded in its leases; 0 while claiming or if slot free */
+    volatile uint64_t start           ; /* owner's starttime from /proc/<pid>/stat, so a reused pid is told apart */
+    volatile uint32_t ns              ; /* low 32 bits of owner's pid namespace inode; 0 if unknown, so never reaped */
+             uint32_t reserved        ;
+    SHF_QID_MMAP      qids_nolock[0]  ; /* qs nolock push qs, then qs nolock pull qs */
+} __attribute__((packed)) SHF_Q_PROC_MMAP;
+
+#define SHF_Q_LEASE(OWNER, DEADLINE) ((SHF_CAST(uint64_t, OWNER) << 32) | (DEADLINE)) /* per qiid in __q_leases; 0 if not pulled */
+#define SHF_Q_LEASE_OWNER(LEASE)      SHF_CAST(uint32_t, (LEASE) >> 32)             /* slot nonce of process which pulled qiid */
+#define SHF_Q_LEASE_DEADLINE(LEASE)   SHF_CAST(uint32_t, (LEASE)      )             /* monotonic ms when lease expires; 0 means never */
+#define SHF_Q_LEASE_OWNER_UNSLOTTED   (1U << 31)                                    /* or'd into pid if pulled by a process without a __q_procs slot */
+#define SHF_Q_LEASE_OWNER_UNKNOWN     (0xFFFFFFFFU)                                 /* owner if maybe pulled before shf_q_set_reap(); never reaped */
+
 typedef struct SHF_Q {
-    uint32_t          qs              ; /* number of queues, e.g. 3 if free, a2b, & b2a */
-    uint32_t          q_next          ; /* next qid to assign via shf_q_new_name() */
-    uint32_t          q_items         ; /* number of queue items to share between the queues */
-    uint32_t          q_item_size     ; /* size of each queue item in bytes */
-    char            * q_item_addr     ; /* address of array of queue items */
-    uint32_t          qids_nolock_max ; /* max q items in qids_nolock_(pull|pull) */
-    SHF_QID_MMAP    * qids_nolock_push; /* non-mmap qid for lockless pushing */
-    SHF_QID_MMAP    * qids_nolock_pull; /* non-mmap qid for lockless pulling */
-    SHF_QID_MMAP    * qids            ;
-    SHF_QIID_MMAP   * qiids           ;
-    SHF_Q_LOCK_MMAP * q_lock          ;
-    uint32_t          q_is_ready      ; /* successfully called shf_q_(new|get)()? */
+    uint32_t           qs              ; /* number of queues, e.g. 3 if free, a2b, & b2a */
+    uint32_t           q_next          ; /* next qid to assign via shf_q_new_name() */
+    uint32_t           q_items         ; /* number of queue items to share between the queues */
+    uint32_t           q_item_size     ; /* size of each queue item in bytes */
+    char             * q_item_addr     ; /* address of array of queue items */
+    uint32_t           qids_nolock_max ; /* max q items in qids_nolock_(pull|pull) */
+    uint32_t           q_nolock_batch  ; /* q items in nolock q before flush; qids_nolock_max unless adaptive */
+    uint32_t           q_is_adaptive   ; /* 1 means q_nolock_batch follows arrival rate; see shf_q_set_nolock_linger() */
+    uint64_t           q_linger_cycles ; /* max rdtsc cycles a q item may linger in nolock push qs; 0 means no max */
+    uint64_t           q_linger_start  ; /* rdtsc when first q item pushed to empty nolock push qs; 0 if empty or no max */
+    uint64_t           q_window_start  ; /* q_linger_start of last flushed nolock push qs while adaptive; 0 if not yet */
+    uint32_t           q_window_pushed ; /* q items pushed in last flushed nolock push qs while adaptive */
+    SHF_QID_MMAP     * qids_nolock_push; /* qids for lockless pushing in own __q_procs slot */
+    SHF_QID_MMAP     * qids_nolock_pull; /* qids for lockless pulling in own __q_procs slot */
+    SHF_Q_PROCS_MMAP * q_procs         ; /* followed by SHF_Q_PROCS_MAX slots of q_proc_size bytes */
+    SHF_Q_PROC_MMAP  * q_proc          ; /* own slot; NULL until first push or pull, or if all slots used */
+    uint32_t           q_proc_size     ;
+    uint32_t           q_proc_owner    ; /* nonce of q_proc, or pid | SHF_Q_LEASE_OWNER_UNSLOTTED if no slot */
+    uint32_t           q_proc_gen      ; /* shf_q_fork_gen when q_proc claimed; re-claim in a forked child */
+    uint32_t           q_proc_retry    ; /* pushes & pulls via locked qs left before trying to claim a slot again */
+    uint32_t           q_proc_retry_gen; /* shf_q_fork_gen when slot claim failed */
+    uint64_t         * q_leases        ; /* one per qiid; see SHF_Q_LEASE() */
+    SHF_QID_MMAP     * qids            ;
+    SHF_QIID_MMAP    * qiids           ;
+    SHF_Q_LOCK_MMAP  * q_lock          ;
+    SHF_Q_RING_MMAP  * q_rings         ; /* non-NULL if shf_q_new() called with SHF_Q_MPMC or SHF_Q_SPSC */
+    SHF_Q_SLOT_MMAP  * q_slots         ; /* q_ring_mask + 1 slots per qid */
+    uint32_t           q_ring_mask     ;
+    SHF_Q_SPSC_CACHE * q_spsc_caches   ; /* non-mmap; non-NULL if shf_q_new() called with SHF_Q_SPSC */
+    SHF_Q_WAIT_MMAP  * q_waits         ; /* one per qid */
+    uint32_t           q_is_ready      ; /* successfully called shf_q_(new|get)()? */
 } __attribute__((packed)) SHF_Q;
 
 #define SHF_PID_MAX (131072) /* todo: convert this to dynamically use cat /proc/sys/kernel/pid_max */
@@ -150,6 +333,21 @@ typedef struct SHF_LOG_MMAP {
              char     bytes[0]         ;
 } __attribute__((packed)) SHF_LOG_MMAP;
 
+typedef struct SHF_RETIRED {
+    SHF_TAB_MMAP * tab_mmap; /* old tab mmap() which readers might still be using */
+    uint32_t       tab_size; /* size of old tab mmap() */
+    uint64_t       epoch   ; /* global epoch when retired */
+} __attribute__((packed)) SHF_RETIRED;
+
+typedef enum SHF_FIXED_SHAPE { /* fixed key,value lengths with specialized compare & copy; selected once by shf_set_is_fixed_len() or attach */
+    SHF_FIXED_SHAPE_NONE , /* variable or uncommon fixed lengths; memcmp() & memcpy() */
+    SHF_FIXED_SHAPE_4_4  , /*  4 byte key,  4 byte value */
+    SHF_FIXED_SHAPE_8_8  , /*  8 byte key,  8 byte value */
+    SHF_FIXED_SHAPE_8_16 , /*  8 byte key, 16 byte value */
+    SHF_FIXED_SHAPE_16_16, /* 16 byte key, 16 byte value */
+    SHF_FIXED_SHAPE_32_N , /* 32 byte key, any value */
+} SHF_FIXED_SHAPE;
+
 typedef struct SHF {
     uint32_t       version                                 ; /* todo: implement version */
     SHF_OFF        tabs[SHF_WINS_PER_SHF][SHF_TABS_PER_WIN]; /* 524,288 private tab pointers */
@@ -157,16 +355,95 @@ typedef struct SHF {
     char         * path                                    ; /* e.g. '/dev/shm' */
     char         * name                                    ; /* e.g. 'myshf' */
     uint32_t       is_lockable                             ; /* 0 means single threaded use only, 1 means lockable */
+    uint32_t       is_read_only                            ; /* 1 means mmap()ed PROT_READ via shf_attach_existing_read_only() */
+    uint32_t       is_snapshot                             ; /* 1 means mmap()ed PROT_READ via shf_attach_existing_snapshot(); may not be frozen */
     uint32_t       is_fixed_key_val_len                    ; /* 0 means key values can be any length, 1 means key values all the same length */
     uint32_t       fixed_key_len                           ; /* length of key   if is_fixed_key_val_len */
     uint32_t       fixed_val_len                           ; /* length of value if is_fixed_key_val_len */
+    SHF_FIXED_SHAPE fixed_shape                            ; /* selects specialized key compare & key,value copy */
+    uint32_t    (* key_is_equal)(const void * tab_key, const void * key, uint32_t key_len); /* 1 if key bytes equal; set from fixed_shape by shf_fixed_shape_set() */
+    void      * (* key_cpy     )(void * to, const void * from, size_t len)               ; /* memcpy() or fixed width copy of key   ; set from fixed_shape */
+    void      * (* val_cpy     )(void * to, const void * from, size_t len)               ; /* memcpy() or fixed width copy of value ; set from fixed_shape */
     uint32_t       count_mmap                              ; /* number of mmap()s */
     uint32_t       count_xalloc                            ; /* number of (c|m)alloc()s */
     SHF_Q          q                                       ; /* for IPC q   */
     SHF_LOG_MMAP * log                                     ; /* for IPC log; value for key '__log' */
     uint32_t       log_thread_active                       ; /* for IPC log; we have the log thread? */
+    uint32_t       reader                                  ; /* 1 + index of slot in shf_mmap->readers[]; 0 means no slot yet */
+    uint32_t       reader_nest                             ; /* shf_read_begin() nesting depth */
+    SHF_RETIRED  * retired                                 ; /* tab mmap()s retired while reading; munmap()ed later */
+    uint32_t       retired_used                            ; /* number of retired tab mmap()s */
+    uint32_t       retired_size                            ; /* number of retired tab mmap()s allocated */
+    SHF_WHEEL      wheels[SHF_WINS_PER_SHF]                ; /* private ttl timer wheel pointers */
+    SHF_LOCK_TIMES_MMAP * lock_times                       ; /* lock wait & hold histograms; NULL until mapped */
+    SHF_HOT_KEYS_MMAP   * hot_keys                         ; /* sampled hot keys & win ops; NULL until mapped */
+    SHF_ARENA_MMAP      * arena                            ; /* arena header; NULL until mapped */
+    SHF_ARENA_CACHE     * arena_cache                      ; /* private free blocks per size class; NULL until first shf_arena_alloc() */
+    char                * arena_segs[SHF_ARENA_SEGS_MAX]   ; /* private arena seg pointers; NULL until mapped */
+    struct SHF          * attached_next                    ; /* next shf attached by process; for lock recovery */
 } __attribute__((packed)) SHF;
 
+typedef struct SHF_ITER {
+    SHF      * shf     ;
+    uint32_t   win     ; /* position to resume from */
+    uint32_t   tab     ;
+    uint32_t   row     ;
+    char     * buf     ; /* copy of the key,value pairs in the last row visited */
+    uint32_t   buf_size;
+    uint32_t   buf_used;
+    uint32_t   buf_pos ; /* next key,value pair in buf to yield */
+    uint32_t   uid     ; /* set by shf_iter_next() */
+    char     * key     ; /* set by shf_iter_next(); valid until the next call */
+    uint32_t   key_len ; /* set by shf_iter_next() */
+    char     * val     ; /* set by shf_iter_next(); valid until the next call */
+    uint32_t   val_len ; /* set by shf_iter_next() */
+} SHF_ITER;
+
+typedef struct SHF_SCAN {
+    uint32_t     thread      ; /* worker thread; 0 to nthreads - 1 */
+    uint32_t     win_lo      ; /* first win scanned by this thread */
+    uint32_t     win_hi      ; /* last  win scanned by this thread plus one */
+    uint32_t     win         ; /* win being scanned; progress */
+    uint64_t     keys_scanned; /* keys passed to filter callback so far; progress */
+    uint64_t     keys_matched; /* keys passed to visit  callback so far; progress */
+    uint32_t     uid         ; /* key,value pair being scanned */
+    const char * key         ; /* valid only during callback */
+    uint32_t     key_len     ;
+    const char * val         ; /* valid only during callback */
+    uint32_t     val_len     ;
+} SHF_SCAN;
+
+#define SHF_STATS_VERSION (2) /* incremented each time SHF_STATS layout changes */
+
+typedef struct SHF_STATS_WIN {
+    uint64_t tabs_used                      ; /* number of tabs in win */
+    uint64_t tabs_mmaps                     ; /* times 1 tab mmapped */
+    uint64_t tabs_mremaps                   ; /* times 1 tab mremapped */
+    uint64_t tabs_shrunk                    ; /* times 1 tab shrunk */
+    uint64_t tabs_parted                    ; /* times 1 tab parted into 2 tabs */
+    uint64_t keylen_misses                  ; /* times hash   matched but keylen didn't match */
+    uint64_t memcmp_misses                  ; /* times keylen matched but key    didn't match */
+    uint64_t keys_expired                   ; /* times key with expired ttl deleted */
+    uint64_t keys_evicted                   ; /* times key evicted in cache mode */
+    uint64_t locks_recovered                ; /* times lock recovered from writer which died holding it */
+    uint64_t refs_used                      ; /* refs used in tabs, i.e. keys */
+    uint64_t refs_size                      ; /* refs available in tabs */
+    uint64_t tab_size                       ; /* bytes of tab memory */
+    uint64_t tab_data_used                  ; /* data bytes used */
+    uint64_t tab_data_free                  ; /* data bytes marked free aka garbage */
+    uint64_t row_fill[SHF_REFS_PER_ROW + 1] ; /* histogram of rows by refs used; 0 to 16 */
+    double   load_factor                    ; /* refs_used / refs_size */
+    double   garbage_ratio                  ; /* tab_data_free / (tab_data_used + tab_data_free) */
+} SHF_STATS_WIN;
+
+typedef struct SHF_STATS {
+    uint32_t      version              ; /* SHF_STATS_VERSION */
+    uint32_t      size                 ; /* sizeof(SHF_STATS) */
+    double        time                 ; /* shf_get_time_in_seconds() when snapshot taken */
+    SHF_STATS_WIN total                ; /* sum of all wins */
+    SHF_STATS_WIN win[SHF_WINS_PER_SHF];
+} SHF_STATS;
+
 typedef union SHF_UID {
     struct {
         uint64_t win : SHF_WINS_PER_SHF_BITS; /*  8 bits or   256 wins per shf */
@@ -188,4 +465,26 @@ extern __thread       SHF_HASH   shf_hash        ;
 extern __thread const char     * shf_hash_key    ;
 extern __thread       uint32_t   shf_hash_key_len;
 
+typedef struct SHF_OP { /* reentrant op context; use instead of __thread shf_hash, shf_uid, shf_val, etc to have many ops in flight per thread */
+          SHF_HASH         hash        ; /* made by shf_op_hash(), or reused via shf_op_hash_set() */
+    const char           * hash_key    ; /* key hashed; must stay valid while op in use */
+          uint32_t         hash_key_len;
+          uint32_t         uid         ; /* set by shf_op_*() */
+          uint32_t         ttl         ; /* if non-zero, causes shf_op_del*() to conditionally delete based upon TTL; one shot */
+          long             val_long    ; /* atomically add this to value; set to value before add */
+          uint32_t         val_offset  ; /* byte offset of long in value to add to; set by shf_op_add_atom(_at)() */
+          void           * key_addr    ; /* address of key in RAM */
+          void           * val_addr    ; /* address of value in RAM; stable while shf_read_begin() or shf_freeze() */
+          char           * key         ; /* mmap(); copy of key */
+          uint32_t         key_len     ;
+          uint32_t         key_size    ; /* mmap() size */
+          char           * val         ; /* mmap(); copy of value */
+          uint32_t         val_len     ;
+          uint32_t         val_size    ; /* mmap() size */
+    const struct iovec   * iov         ; /* caller buffers for shf_op_get_buf() */
+          int              iov_cnt     ;
+          uint32_t      (* visit_cb)(const char * val, uint32_t val_len, void * ctx);
+          void           * visit_ctx   ;
+} SHF_OP;
+
 #endif /* __SHF_PRIVATE_H__ */
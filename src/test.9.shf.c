@@ -25,6 +25,8 @@
 #include <sys/mman.h> /* for mremap() */
 #include <string.h>   /* for memcmp() */
 #include <locale.h>   /* for setlocale() */
+#include <sys/wait.h> /* for waitid() */
+#include <sys/resource.h> /* for getrusage() */
 
 #include "shf.private.h"
 #include "shf.h"
@@ -41,10 +43,60 @@ upd_callback_test(const char * val, uint32_t val_len) /* callback for shf_upd_*_
     return result;
 } /* upd_callback_test() */
 
+typedef struct TEST_VISIT {
+    char     val[8];
+    uint32_t val_len;
+} TEST_VISIT;
+
+static uint32_t
+visit_callback_test(const char * val, uint32_t val_len, void * ctx) /* callback for shf_get_*_val_visit() */
+{
+    TEST_VISIT * visit = SHF_CAST(TEST_VISIT *, ctx);
+    if ((NULL == visit) || (val_len > sizeof(visit->val))) {
+        return SHF_RET_BAD_CB;
+    }
+    memcpy(visit->val, val, val_len);
+    visit->val_len = val_len;
+    return SHF_RET_OK;
+} /* visit_callback_test() */
+
+static uint32_t
+scan_filter_test(const SHF_SCAN * scan, void * ctx) /* callback for shf_scan_parallel(); match even values */
+{
+    SHF_UNUSE(ctx);
+    return (sizeof(uint32_t) == scan->val_len) && (0 == (SHF_U32_AT(scan->val, 0) % 2));
+} /* scan_filter_test() */
+
+static void
+scan_visit_test(const SHF_SCAN * scan, void * ctx) /* callback for shf_scan_parallel(); count matching key,value pairs */
+{
+    uint64_t * keys_visited = SHF_CAST(uint64_t *, ctx);
+    if (0 == memcmp(scan->key, scan->val, sizeof(uint32_t))) {
+        __sync_fetch_and_add(keys_visited, 1);
+    }
+} /* scan_visit_test() */
+
+static uint32_t
+wheel_nodes_test(SHF * shf, uint32_t uid) /* count ttl timer wheel nodes of uid */
+{
+    SHF_UID          node_uid;
+                     node_uid.as_u32 = uid;
+    SHF_WHEEL_MMAP * wheel           = shf->wheels[node_uid.as_part.win].wheel_mmap;
+    uint32_t         nodes           = 0;
+    for (uint32_t level = 0; level < SHF_WHEEL_LEVELS; level ++) {
+        for (uint32_t slot = 0; slot < SHF_WHEEL_SLOTS; slot ++) {
+            for (uint32_t node = wheel->slot[level][slot]; node; node = wheel->node[node].next) {
+                nodes += uid == wheel->node[node].uid;
+            }
+        }
+    }
+    return nodes;
+} /* wheel_nodes_test() */
+
 int main(void)
 {
     // Tell tap (test anything protocol) how many tests we expect to run.
-    plan_tests(206);
+    plan_tests(311);
 
     // To enable ```%'.0f``` in sprintf() instead of boring ```%.0f```.
     SHF_ASSERT(NULL != setlocale(LC_NUMERIC, ""), "setlocale(): %u: ", errno);
@@ -111,9 +163,25 @@ int main(void)
         ok(SHF_RET_KEY_FOUND                   == shf_get_key_val_copy (shf               ), "c: custom callback upd uid: op 2: shf_get_key_val_copy()  could     find   upd key as expected");
         ok(3                                   == shf_val_len                              , "c: custom callback upd uid: op 2: shf_val_len                                      as expected");
         ok(0 /* matches */                     == memcmp               (shf_val, "up2" , 3), "c: custom callback upd uid: op 2: shf_val                                          as expected");
+        TEST_VISIT visit = { "", 0 };
+        ok(SHF_RET_KEY_FOUND                   == shf_get_key_val_visit(shf    , visit_callback_test, &visit), "c:  visit callback get key: op 1: shf_get_key_val_visit() callback works 4 get key as expected");
+        ok(3 == visit.val_len && 0             == memcmp               (visit.val, "up2", 3)                 , "c:  visit callback get key: op 1: val visited in place                         as expected");
+        ok(SHF_RET_KEY_FOUND                   == shf_get_uid_val_visit(shf,uid, visit_callback_test, &visit), "c:  visit callback get uid: op 2: shf_get_uid_val_visit() callback works 4 get uid as expected");
+        ok(SHF_RET_KEY_FOUND + SHF_RET_BAD_CB  == shf_get_uid_val_visit(shf,uid, visit_callback_test, NULL  ), "c:  visit callback get uid: op 3: shf_get_uid_val_visit() callback error 4 get uid as expected");
+        char         copy_buf[8];
+        struct iovec copy_iov[2] = { { &copy_buf[0], 2 }, { &copy_buf[4], 4 } };
+        ok(SHF_RET_KEY_FOUND                   == shf_get_key_val_copy_buf(shf    , copy_buf, sizeof(copy_buf)), "c: caller buffer     get key: op 1: shf_get_key_val_copy_buf() could find   get key as expected");
+        ok(3 == shf_val_len && 0               == memcmp                  (copy_buf, "up2", 3               ), "c: caller buffer     get key: op 1: val copied into caller buffer             as expected");
+        ok(SHF_RET_KEY_FOUND+SHF_RET_BUF_SMALL == shf_get_uid_val_copy_buf(shf,uid, copy_buf, 2               ), "c: caller buffer     get uid: op 2: shf_get_uid_val_copy_buf() buffer too small    as expected");
+        ok(3                                   == shf_val_len                                                 , "c: caller buffer     get uid: op 2: shf_val_len is needed length              as expected");
+        ok(SHF_RET_KEY_FOUND                   == shf_get_uid_val_copy_iov(shf,uid, copy_iov, 2               ), "c: caller iovec      get uid: op 3: shf_get_uid_val_copy_iov() could find   get uid as expected");
+        ok(0 == memcmp(&copy_buf[0], "up", 2) && 0 == memcmp(&copy_buf[4], "2", 1)                            , "c: caller iovec      get uid: op 3: val scattered into caller iovec           as expected");
+        ok(SHF_RET_KEY_FOUND                   == shf_get_uid_key_copy_buf(shf,uid, copy_buf, sizeof(copy_buf)), "c: caller buffer     get uid: op 4: shf_get_uid_key_copy_buf() could find   get uid as expected");
+        ok(3 == shf_key_len && 0               == memcmp                  (copy_buf, "key", 3               ), "c: caller buffer     get uid: op 4: key copied into caller buffer             as expected");
         ok(SHF_RET_KEY_FOUND                   == shf_del_uid_val      (shf,uid           ), "c:     existing    del uid: op 1: shf_del_uid_val()       could     find   put key as expected");
         ok(SHF_RET_KEY_NONE                    == shf_get_key_val_copy (shf               ), "c:     existing    del uid: op 1: shf_get_key_val_copy()  could not find   del key as expected");
         ok(SHF_RET_KEY_NONE                    == shf_del_uid_val      (shf,uid           ), "c: non-existing    del uid: op 1: shf_del_uid_val()       could not find   del key as expected");
+        ok(SHF_RET_KEY_NONE                    == shf_get_uid_val_visit(shf,uid, visit_callback_test, &visit), "c:  visit callback get uid: op 4: shf_get_uid_val_visit() could not find   del key as expected");
         ok(SHF_RET_KEY_PUT                     == shf_put_key_val      (shf    , "2222", 4), "c: reput / reuse key / uid: op 1: shf_put_key_val()                      reput key as expected"); uid = shf_uid;
         ok(uid                                 != SHF_UID_NONE                             , "c: reput / reuse key / uid: op 1: shf_put_key_val()                      reput key as expected");
         ok(SHF_RET_KEY_FOUND                   == shf_get_uid_val_copy (shf,uid           ), "c: reput / reuse key / uid: op 1: shf_get_uid_val_copy()  could     find reput key as expected");
@@ -169,6 +237,52 @@ int main(void)
         ok(SHF_RET_KEY_NONE                    == shf_get_key_val_copy (shf               ), "c:     existing    add key: op 6: shf_get_key_val_copy()  could not find   add key as expected");
         ok(shf_uid                             == SHF_UID_NONE                             , "c:     existing    add key: op 6: shf_uid                                    unset as expected");
 
+        shf_make_hash(SHF_CONST_STR_AND_SIZE("ttl-live"));
+        ok(SHF_RET_KEY_PUT                     == shf_put_key_val_ttl  (shf, "live", 4, 3600), "c: ttl               key: op 1: shf_put_key_val_ttl()     put  key with ttl 3600s as expected");
+        ok(SHF_RET_KEY_FOUND                   == shf_get_key_val_copy (shf               ), "c: ttl               key: op 1: shf_get_key_val_copy()  could     find unexpired key as expected");
+        ok(4 == shf_val_len && 0               == memcmp               (shf_val, "live", 4), "c: ttl               key: op 1: shf_val excludes expiry                        as expected");
+        shf_make_hash(SHF_CONST_STR_AND_SIZE("ttl-dead"));
+        ok(SHF_RET_KEY_PUT                     == shf_put_key_val_ttl  (shf, "dead", 4, 0   ), "c: ttl               key: op 2: shf_put_key_val_ttl()     put  key with ttl    0s as expected"); uid = shf_uid;
+        ok(SHF_RET_KEY_NONE                    == shf_get_key_val_copy (shf               ), "c: ttl               key: op 2: shf_get_key_val_copy()  could not find   expired key as expected");
+        ok(SHF_RET_KEY_NONE                    == shf_get_uid_val_copy (shf,uid           ), "c: ttl               uid: op 2: shf_get_uid_val_copy()  could not find   expired uid as expected");
+        ok(1                                   == shf_ttl_reap         (shf               ), "c: ttl               key: op 3: shf_ttl_reap()                deleted expired key as expected");
+        ok(0                                   == shf_ttl_reap         (shf               ), "c: ttl               key: op 3: shf_ttl_reap()             deleted no more keys as expected");
+        shf_make_hash(SHF_CONST_STR_AND_SIZE("ttl-live"));
+        ok(SHF_RET_KEY_FOUND                   == shf_del_key_val      (shf               ), "c: ttl               key: op 4: shf_del_key_val()       could     find unexpired key as expected");
+        shf_make_hash(SHF_CONST_STR_AND_SIZE("ttl-far"));
+        ok(SHF_RET_KEY_PUT                     == shf_put_key_val_ttl  (shf, "far", 3, (1U << SHF_WHEEL_SPAN_BITS) + 3600), "c: ttl               key: op 5: shf_put_key_val_ttl()     put  key with ttl beyond wheel span as expected"); uid = shf_uid;
+        shf_make_hash(SHF_CONST_STR_AND_SIZE("ttl-soon"));
+        ok(SHF_RET_KEY_PUT                     == shf_put_key_val_ttl  (shf, "soon", 4, 30  ), "c: ttl               key: op 5: shf_put_key_val_ttl()     put  key with ttl   30s as expected");
+        {
+            SHF_UID uid_far ; uid_far .as_u32 = uid    ;
+            SHF_UID uid_soon; uid_soon.as_u32 = shf_uid;
+            /* pretend the wheels were last reaped a whole span ago; so slots fire long before the keys in them expire */
+                                                             shf->wheels[uid_far .as_part.win].wheel_mmap->now -= 1U << SHF_WHEEL_SPAN_BITS;
+            if (uid_far.as_part.win != uid_soon.as_part.win) { shf->wheels[uid_soon.as_part.win].wheel_mmap->now -= 1U << SHF_WHEEL_SPAN_BITS; }
+            ok(0                               == shf_ttl_reap         (shf               ), "c: ttl               key: op 5: shf_ttl_reap()          deleted no unexpired keys as expected");
+            ok(1 == wheel_nodes_test(shf, uid_far.as_u32) && 1 == wheel_nodes_test(shf, uid_soon.as_u32), "c: ttl               key: op 5: shf_ttl_reap()     re-inserted nodes of unexpired keys as expected");
+        }
+        ok(SHF_RET_KEY_FOUND                   == shf_del_key_val      (shf               ), "c: ttl               key: op 6: shf_del_key_val()       could     find unexpired key as expected");
+        shf_make_hash(SHF_CONST_STR_AND_SIZE("ttl-far"));
+        ok(SHF_RET_KEY_FOUND                   == shf_del_key_val      (shf               ), "c: ttl               key: op 6: shf_del_key_val()       could     find unexpired key as expected");
+        {
+            shf_set_is_lockable(shf, 1); /* shf.monitor deletes concurrently */
+            shf_make_hash(SHF_CONST_STR_AND_SIZE("ttl-monitor"));
+            shf_put_key_val_ttl(shf, "gone", 4, 0);
+            SHF_UID  uid_monitor; uid_monitor.as_u32 = shf_uid;
+            uint64_t keys_expired_before = shf->shf_mmap->wins[uid_monitor.as_part.win].keys_expired;
+            shf_ttl_set_reap(shf, 10 /* ms */);
+            for (uint32_t i = 0; (i < 300) && (0 != wheel_nodes_test(shf, uid_monitor.as_u32)); i++) {
+                usleep(10000);
+            }
+            uint64_t keys_expired_after = shf->shf_mmap->wins[uid_monitor.as_part.win].keys_expired;
+            uint32_t nodes_after        = wheel_nodes_test(shf, uid_monitor.as_u32);
+            shf_ttl_set_reap(shf, 0);
+            usleep(200000); /* for shf.monitor to stop reaping */
+            shf_set_is_lockable(shf, 0);
+            ok(keys_expired_before + 1 == keys_expired_after && 0 == nodes_after, "c: ttl               key: op 7: shf_ttl_set_reap()    had shf.monitor reap expired key as expected");
+        }
+
         // Use own hash -- in this example hard-coded SHA256() -- instead of shf_make_hash() function.
         uint32_t h_foo[] = {0x2c26b46b, 0x68ffc68f, 0xf99b453c, 0x1d304134, 0x13422d70, 0x6483bfa0, 0xf98a5e88, 0x6266e7ae}; /* SHA256("foo") */
         uint32_t h_bar[] = {0xfcde2b2e, 0xdba56bf4, 0x08601fb7, 0x21fe9b5c, 0x338d10ee, 0x429ea04f, 0xae5511b6, 0x8fbf8fb9}; /* SHA256("bar") */
@@ -393,6 +507,339 @@ int main(void)
             shf_debug_verbosity_more();
         }
 
+        {
+            shf_debug_verbosity_less();
+                    shf_q_del(shf);
+            ok(NULL != shf_q_new(shf, test_qs, test_q_items, test_q_item_size, SHF_Q_MPMC) && 0 == (SHF_CAST(uint64_t, shf->q.q_rings) % 64), "c: shf_q_new() with SHF_Q_MPMC returned as expected");
+
+            uint32_t test_in_order = 0;
+            test_pull_items = 0;
+            while(SHF_QIID_NONE != shf_q_pull_tail(shf, test_qid_free          )) {
+                                   SHF_CAST(uint32_t *, shf_qiid_addr)[0] = test_pull_items ++;
+                                   shf_q_push_head(shf, test_qid_a2b , shf_qiid);
+            }
+            while(SHF_QIID_NONE != shf_q_pull_tail(shf, test_qid_a2b           )) {
+                                   test_in_order += (test_in_order == SHF_CAST(uint32_t *, shf_qiid_addr)[0]) ? 1 : 0;
+                                   shf_q_push_head(shf, test_qid_b2a , shf_qiid);
+            }
+            ok(test_q_items == test_pull_items && test_q_items == test_in_order, "c: ring pulled & pushed items from free to a2b to b2a in order as expected");
+
+            /* a qiid pushed while already queued can fill a ring; then the push fails instead of aborting */
+            uint32_t test_pushes = 0;
+            uint32_t test_pulls  = 0;
+            while(SHF_RET_OK    == shf_q_push_head(shf, test_qid_a2b, 0)) { test_pushes ++; }
+            uint32_t test_full_pull = shf_q_push_head_pull_tail(shf, test_qid_a2b, 0, test_qid_b2a);
+            while(SHF_QIID_NONE != shf_q_pull_tail(shf, test_qid_a2b   )) { test_pulls  ++; }
+            ok(test_pushes == shf->q.q_ring_mask + 1 && test_pushes >= test_q_items && test_pushes == test_pulls && SHF_QIID_NONE == test_full_pull, "c: ring full returned SHF_RET_Q_FULL after %u pushes as expected", test_pushes);
+
+            uint32_t test_many_qiid;
+            shf_qiid = 0;
+            ok(0 == shf_q_pull_tail_many(shf, test_qid_a2b, &test_many_qiid, 1) && 0 == shf_qiid, "c: ring shf_q_pull_tail_many() left shf_qiid unchanged as expected");
+
+            /* 4 processes concurrently push & pull the same rings; every qiid must arrive exactly once */
+            uint32_t test_procs      = 4;
+            pid_t    children[4];
+            double   test_start_time = shf_get_time_in_seconds();
+            for (uint32_t i = 0; i < test_procs; i++) {
+                children[i] = fork();
+                if (0 == children[i]) {
+                    shf_qiid = SHF_QIID_NONE;
+                    while(SHF_QIID_NONE != shf_q_push_head_pull_tail(shf, test_qid_free, shf_qiid, test_qid_b2a)) {
+                    }
+                    _exit(0);
+                }
+            }
+            for (uint32_t i = 0; i < test_procs; i++) {
+                SHF_ASSERT(children[i] == waitpid(children[i], NULL, 0), "waitpid(): %u: ", errno);
+            }
+            double    test_elapsed_time = shf_get_time_in_seconds() - test_start_time;
+            uint8_t * test_seen         = calloc(test_q_items, 1); SHF_ASSERT(NULL != test_seen, "calloc(): %u: ", errno);
+            test_pull_items = 0;
+            while(SHF_QIID_NONE != shf_q_pull_tail(shf, test_qid_free)) {
+                                   test_pull_items += test_seen[shf_qiid] ? 0 : 1;
+                                   test_seen[shf_qiid] = 1;
+            }
+            free(test_seen);
+            ok(test_q_items == test_pull_items && SHF_QIID_NONE == shf_q_pull_tail(shf, test_qid_b2a), "c: ring moved   expected number of new queue items via %u processes // estimate %'.0f q items per second with contention", test_procs, test_q_items / test_elapsed_time);
+            shf_debug_verbosity_more();
+        }
+
+        {
+            shf_debug_verbosity_less();
+                    shf_q_del(shf);
+            ok(NULL != shf_q_new(shf, test_qs, test_q_items, test_q_item_size, SHF_Q_SPSC) && NULL != shf->q.q_spsc_caches, "c: shf_q_new() with SHF_Q_SPSC returned as expected");
+
+            uint32_t test_batch[64];
+            uint32_t test_batch_len;
+            uint32_t test_in_order = 0;
+            test_pull_items = 0;
+            while(0 != (test_batch_len = shf_q_pull_tail_many(shf, test_qid_free, test_batch, 64))) {
+                for (uint32_t i = 0; i < test_batch_len; i++) {
+                    SHF_CAST(uint32_t *, &shf->q.q_item_addr[test_batch[i] * test_q_item_size])[0] = test_pull_items ++;
+                }
+                shf_q_push_head_many(shf, test_qid_a2b, test_batch, test_batch_len);
+            }
+            while(SHF_QIID_NONE != shf_q_pull_tail(shf, test_qid_a2b           )) {
+                                   test_in_order += (test_in_order == SHF_CAST(uint32_t *, shf_qiid_addr)[0]) ? 1 : 0;
+                                   shf_q_push_head(shf, test_qid_free, shf_qiid);
+            }
+            ok(test_q_items == test_pull_items && test_q_items == test_in_order, "c: spsc pulled & pushed batches of items from free to a2b & singly back in order as expected");
+
+            /* a full spsc ring pushes none of a batch instead of aborting */
+            uint32_t test_pushes = 0;
+            uint32_t test_pulls  = 0;
+            test_batch[0] = 0;
+            while(1             == shf_q_push_head_many(shf, test_qid_a2b, test_batch, 1)) { test_pushes ++; }
+            while(SHF_QIID_NONE != shf_q_pull_tail     (shf, test_qid_a2b               )) { test_pulls  ++; }
+            ok(test_pushes == shf->q.q_ring_mask + 1 && test_pushes == test_pulls, "c: spsc ring full pushed none of batch after %u pushes as expected", test_pushes);
+
+            /* process a pushes free to a2b & pulls b2a to free; child process b pulls a2b & pushes b2a; each ring has 1 pusher & 1 puller */
+            uint32_t test_moves      = 10 * test_q_items;
+            double   test_start_time = shf_get_time_in_seconds();
+            pid_t    child           = fork();
+            if (0 == child) {
+                uint32_t moved = 0;
+                while (moved < test_moves) {
+                    if (SHF_QIID_NONE != shf_q_pull_tail(shf, test_qid_a2b)) {
+                        shf_q_push_head(shf, test_qid_b2a, shf_qiid);
+                        moved ++;
+                    }
+                }
+                _exit(0);
+            }
+            uint32_t test_sent     = 0;
+            uint32_t test_received = 0;
+            test_in_order = 0;
+            while (test_received < test_moves) {
+                if ((test_sent < test_moves) && (SHF_QIID_NONE != shf_q_pull_tail(shf, test_qid_free))) {
+                    SHF_CAST(uint32_t *, shf_qiid_addr)[0] = test_sent ++;
+                    shf_q_push_head(shf, test_qid_a2b, shf_qiid);
+                }
+                if (SHF_QIID_NONE != shf_q_pull_tail(shf, test_qid_b2a)) {
+                    test_in_order += (test_received ++ == SHF_CAST(uint32_t *, shf_qiid_addr)[0]) ? 1 : 0;
+                    shf_q_push_head(shf, test_qid_free, shf_qiid);
+                }
+            }
+            SHF_ASSERT(child == waitpid(child, NULL, 0), "waitpid(): %u: ", errno);
+            double test_elapsed_time = shf_get_time_in_seconds() - test_start_time;
+            ok(test_moves == test_in_order, "c: spsc moved   expected number of queue items a2b & back in order via 2 processes // estimate %'.0f q items per second", test_moves / test_elapsed_time);
+            shf_debug_verbosity_more();
+        }
+
+        {
+            shf_debug_verbosity_less();
+            double test_start_time = shf_get_time_in_seconds();
+            ok(SHF_QIID_NONE == shf_q_pull_tail_wait(shf, test_qid_a2b, 50) && shf_get_time_in_seconds() - test_start_time >= 0.045, "c: shf_q_pull_tail_wait() timed out on empty qid as expected");
+
+            /* child waits for each qiid & pushes it back; parent pauses before each push so child has to sleep */
+            uint32_t      test_engines[] = { SHF_Q_SPSC, SHF_Q_MPMC, 1 };
+            const char  * test_names  [] = { "spsc  "  , "mpmc  "  , "locked" };
+            for (uint32_t engine = 0; engine < 3; engine++) {
+                shf_q_del(shf);
+                shf_q_new(shf, test_qs, test_q_items, test_q_item_size, test_engines[engine]);
+                struct rusage usage;
+                getrusage(RUSAGE_CHILDREN, &usage); /* cumulative for all children waited for */
+                double   test_child_before = usage.ru_utime.tv_sec + usage.ru_stime.tv_sec + ((usage.ru_utime.tv_usec + usage.ru_stime.tv_usec) / 1000000.0);
+                uint32_t test_pings        = 50;
+                pid_t    child             = fork();
+                if (0 == child) {
+                    for (uint32_t i = 0; i < test_pings; i++) {
+                        SHF_ASSERT(SHF_QIID_NONE != shf_q_pull_tail_wait(shf, test_qid_a2b, SHF_Q_WAIT_FOREVER), "INTERNAL: expected qiid");
+                        shf_q_push_head(shf, test_qid_b2a, shf_qiid);
+                    }
+                    _exit(0);
+                }
+                uint32_t test_pongs = 0;
+                test_start_time     = shf_get_time_in_seconds();
+                for (uint32_t i = 0; i < test_pings; i++) {
+                    usleep(2000);
+                    shf_q_push_head(shf, test_qid_a2b, shf_q_pull_tail(shf, test_qid_free));
+                    test_pongs += (SHF_QIID_NONE != shf_q_pull_tail_wait(shf, test_qid_b2a, 1000)) ? 1 : 0;
+                    shf_q_push_head(shf, test_qid_free, shf_qiid);
+                }
+                SHF_ASSERT(child == waitpid(child, NULL, 0), "waitpid(): %u: ", errno);
+                double test_elapsed_time = shf_get_time_in_seconds() - test_start_time;
+                getrusage(RUSAGE_CHILDREN, &usage);
+                double test_child_time   = usage.ru_utime.tv_sec + usage.ru_stime.tv_sec + ((usage.ru_utime.tv_usec + usage.ru_stime.tv_usec) / 1000000.0);
+                ok(test_pings == test_pongs && test_child_time - test_child_before < test_elapsed_time / 2, "c: shf_q_pull_tail_wait() %s woken for %u of %u items & child used %.3f of %.3f seconds as expected", test_names[engine], test_pongs, test_pings, test_child_time - test_child_before, test_elapsed_time);
+            }
+            shf_debug_verbosity_more();
+        }
+
+        {
+            shf_debug_verbosity_less();
+            shf_q_del(shf);
+            shf_q_new(shf, test_qs, test_q_items, test_q_item_size, 1000);
+            shf_q_set_nolock_linger(shf, 1000 /* us */, 0);
+            for (uint32_t i = 0; i < 10; i++) {
+                shf_q_push_head(shf, test_qid_a2b, shf_q_pull_tail(shf, test_qid_free));
+            }
+            uint32_t test_size_before = shf->q.qids[test_qid_a2b].size; /* 10 pushes still in nolock push q */
+            uint32_t test_qiid        = shf_q_pull_tail(shf, test_qid_free);
+            usleep(2000);
+            shf_q_push_head(shf, test_qid_a2b, test_qiid);
+            ok(0 == test_size_before && 11 == shf->q.qids[test_qid_a2b].size, "c: shf_q_set_nolock_linger() flushed lingering push q items as expected");
+
+            shf_q_set_nolock_linger(shf, 1000 /* us */, 1);
+            for (uint32_t i = 0; i < 20; i++) { /* slow arrivals shrink the batch */
+                usleep(2000);
+                shf_q_push_head(shf, test_qid_a2b, shf_q_pull_tail(shf, test_qid_free));
+            }
+            uint32_t test_batch_slow = shf->q.q_nolock_batch;
+            for (uint32_t i = 0; i < 50000; i++) { /* fast arrivals grow the batch */
+                shf_q_push_head(shf, test_qid_a2b, shf_q_pull_tail(shf, test_qid_free));
+            }
+            uint32_t test_batch_fast = shf->q.q_nolock_batch;
+            ok(test_batch_slow <= 2 && test_batch_fast > 100, "c: shf_q_set_nolock_linger() adapted batch size from %u for slow to %u for fast pushes as expected", test_batch_slow, test_batch_fast);
+            shf_debug_verbosity_more();
+        }
+
+        {
+            shf_debug_verbosity_less();
+            shf_q_del(shf);
+            shf_q_new(shf, test_qs, test_q_items, test_q_item_size, 1000);
+            shf_q_set_reap(shf, test_qid_free, 0, 0);
+            pid_t child = fork();
+            if (0 == child) { /* pull 1,500 qiids in 2 batches of 1,000 & push last 300 of them, then go poof without flushing */
+                for (uint32_t i = 0; i < 1500; i++) {
+                    uint32_t qiid = shf_q_pull_tail(shf, test_qid_free);
+                    if (i >= 1200) { shf_q_push_head(shf, test_qid_a2b, qiid); }
+                }
+                _exit(0);
+            }
+            SHF_ASSERT(child == waitpid(child, NULL, 0), "waitpid(): %u: ", errno);
+            uint32_t test_free_before = shf->q.qids[test_qid_free].size;
+            uint32_t test_reaped      = shf_q_reap(shf); /* 300 pushed + 500 not yet pulled + 1,200 pulled */
+            ok(test_q_items - 2000 == test_free_before && 2000 == test_reaped && 300 == shf->q.qids[test_qid_a2b].size && test_q_items - 300 == shf->q.qids[test_qid_free].size, "c: shf_q_reap() reaped %u qiids from nolock qs & leases of process which went poof as expected", test_reaped);
+
+            shf_q_set_reap(shf, test_qid_free, 10 /* ms */, 0);
+            uint32_t test_qiid = shf_q_pull_tail(shf, test_qid_a2b); /* other 299 stay in own nolock pull q */
+            usleep(30000);
+            test_reaped = shf_q_reap(shf);
+            shf_q_push_head(shf, test_qid_b2a, test_qiid); /* ignored because reaped */
+            shf_q_flush(shf, SHF_QID_NONE);
+            ok(1 == test_reaped && 0 == shf->q.qids[test_qid_b2a].size && 299 == shf->q.qids_nolock_pull[test_qid_a2b].size && test_q_items - 299 == shf->q.qids[test_qid_free].size, "c: shf_q_reap() reaped qiid with expired lease & ignored its later push as expected");
+
+            {   /* white box: a slot whose pid was reused since its claim is reaped, but never a slot from another pid namespace */
+                SHF_Q_PROC_MMAP * test_proc_reused  = NULL;
+                SHF_Q_PROC_MMAP * test_proc_foreign = NULL;
+                for (uint32_t slot = 0; slot < SHF_Q_PROCS_MAX; slot++) {
+                    SHF_Q_PROC_MMAP * proc = SHF_CAST(SHF_Q_PROC_MMAP *, SHF_CAST(char *, shf->q.q_procs) + sizeof(SHF_Q_PROCS_MMAP) + (slot * shf->q.q_proc_size));
+                    if (0 != proc->pid) { continue; }
+                    if      (NULL == test_proc_reused ) { test_proc_reused  = proc; }
+                    else if (NULL == test_proc_foreign) { test_proc_foreign = proc; break; }
+                }
+                uint32_t test_ns = SHF_LOCK_OWNER_NS(shf_lock_owner_get());
+                test_proc_reused ->start = 1; /* own live pid, but started long after this */
+                test_proc_reused ->ns    = test_ns;
+                test_proc_reused ->pid   = getpid();
+                test_proc_reused ->nonce = 0x7FFFFFF0;
+                test_proc_foreign->start = 1;
+                test_proc_foreign->ns    = test_ns + 1;
+                test_proc_foreign->pid   = 0x3FFFFF; /* pid_max, so surely not in own pid namespace */
+                test_proc_foreign->nonce = 0x7FFFFFF1;
+                test_reaped = shf_q_reap(shf);
+                uint32_t test_foreign_pid = test_proc_foreign->pid;
+                test_proc_foreign->nonce = 0;
+                test_proc_foreign->pid   = 0;
+                ok(0 != test_ns && 0 == test_reaped && 0 == test_proc_reused->pid && 0 == test_proc_reused->nonce && 0x3FFFFF == test_foreign_pid, "c: shf_q_reap() freed slot of reused pid but not slot from another pid namespace as expected");
+            }
+
+            child = fork();
+            if (0 == child) { /* claims own slot so cannot pull from parent's nolock pull q */
+                _exit(SHF_QIID_NONE == shf_q_pull_tail(shf, test_qid_a2b) ? 0 : 1);
+            }
+            int status;
+            SHF_ASSERT(child == waitpid(child, &status, 0), "waitpid(): %u: ", errno);
+            ok(WIFEXITED(status) && 0 == WEXITSTATUS(status) && 299 == shf->q.qids_nolock_pull[test_qid_a2b].size && 0 == shf_q_reap(shf), "c: forked child used own nolock qs as expected");
+
+            shf_q_set_reap(shf, test_qid_free, 0, 50 /* ms */);
+            test_free_before = shf->q.qids[test_qid_free].size;
+            child = fork();
+            if (0 == child) { /* pull a batch of 1,000 qiids then go poof */
+                shf_q_pull_tail(shf, test_qid_free);
+                _exit(0);
+            }
+            SHF_ASSERT(child == waitpid(child, NULL, 0), "waitpid(): %u: ", errno);
+            uint32_t test_free_pulled = shf->q.qids[test_qid_free].size;
+            for (uint32_t i = 0; (i < 200) && (shf->q.qids[test_qid_free].size < test_free_before); i++) {
+                usleep(10000);
+            }
+            uint32_t test_free_after = shf->q.qids[test_qid_free].size;
+            shf_q_set_reap(shf, test_qid_free, 0, 0);
+            usleep(200000); /* for shf.monitor to stop reaping */
+            ok(test_free_before - 1000 == test_free_pulled && test_free_before == test_free_after, "c: shf.monitor reaped qiids of process which went poof as expected");
+            shf_debug_verbosity_more();
+        }
+
+        {
+            shf_debug_verbosity_less();
+            shf_q_del(shf);
+            shf_q_new(shf, test_qs, test_q_items, test_q_item_size, 1000);
+            uint32_t test_qiid       = shf_q_pull_tail(shf, test_qid_free);
+            uint64_t test_lease_none = shf->q.q_leases[test_qiid];
+            shf_q_push_head(shf, test_qid_free, test_qiid);
+            shf_q_set_reap(shf, test_qid_free, 0, 0);
+            ok(0 == test_lease_none && SHF_Q_LEASE(SHF_Q_LEASE_OWNER_UNKNOWN, 0) == shf->q.q_leases[test_qiid], "c: shf_q_set_reap() marked leases unknown & none were written before as expected");
+
+            /* all __q_procs slots used by live processes, so a forked child pushes & pulls via the locked qs */
+            shf_q_set_reap(shf, test_qid_free, 10 /* ms */, 0); /* without a slot, pulled qiids are only reaped once their leases expire */
+            uint8_t test_slot_filled[SHF_Q_PROCS_MAX];
+            for (uint32_t slot = 0; slot < SHF_Q_PROCS_MAX; slot++) {
+                SHF_Q_PROC_MMAP * proc = SHF_CAST(SHF_Q_PROC_MMAP *, SHF_CAST(char *, shf->q.q_procs) + sizeof(SHF_Q_PROCS_MMAP) + (slot * shf->q.q_proc_size));
+                test_slot_filled[slot] = 0 == proc->pid;
+                if (test_slot_filled[slot]) { proc->pid = getpid(); }
+            }
+            uint32_t test_a2b_before = shf->q.qids[test_qid_a2b].size;
+            pid_t    child           = fork();
+            if (0 == child) { /* pull 11 qiids & push 10 of them, then go poof */
+                uint32_t pulled = 0;
+                for (uint32_t i = 0; i < 11; i++) {
+                    pulled += SHF_QIID_NONE != shf_q_pull_tail(shf, test_qid_free) ? 1 : 0;
+                    if (i < 10) { shf_q_push_head(shf, test_qid_a2b, shf_qiid); }
+                }
+                _exit((NULL == shf->q.q_proc) && (11 == pulled) ? 0 : 1);
+            }
+            int status;
+            SHF_ASSERT(child == waitpid(child, &status, 0), "waitpid(): %u: ", errno);
+            for (uint32_t slot = 0; slot < SHF_Q_PROCS_MAX; slot++) {
+                SHF_Q_PROC_MMAP * proc = SHF_CAST(SHF_Q_PROC_MMAP *, SHF_CAST(char *, shf->q.q_procs) + sizeof(SHF_Q_PROCS_MMAP) + (slot * shf->q.q_proc_size));
+                if (test_slot_filled[slot]) { proc->pid = 0; }
+            }
+            uint32_t test_reaped_early = shf_q_reap(shf);
+            usleep(30000);
+            uint32_t test_reaped = shf_q_reap(shf);
+            ok(WIFEXITED(status) && 0 == WEXITSTATUS(status) && test_a2b_before + 10 == shf->q.qids[test_qid_a2b].size && 0 == test_reaped_early && 1 == test_reaped, "c: forked child without a free slot pushed & pulled via locked qs & its pulled qiid was reaped once its lease expired as expected");
+            shf_debug_verbosity_more();
+        }
+
+        {
+            shf_debug_verbosity_less();
+            uint64_t   handle_a = shf_arena_alloc(shf, 16 );
+            uint64_t   handle_b = shf_arena_alloc(shf, 100);
+            uint32_t * addr_b   = shf_arena_addr (shf, handle_b);
+            addr_b[24] = 12345; /* last uint32_t of 100 bytes */
+            shf_arena_free(shf, handle_a, 16);
+            ok(0 != handle_a && 0 != handle_b && handle_b == shf_arena_handle(shf, addr_b) && 0 == (SHF_CAST(uint64_t, addr_b) % 16) && handle_a == shf_arena_alloc(shf, 10) && 0 == shf_arena_alloc(shf, SHF_ARENA_SEG_SIZE + 1), "c: arena alloc, addr, handle, & free work as expected");
+
+            uint32_t   test_blocks = 100000; /* 12.8MB of 128 byte blocks; spans slabs & segs */
+            uint64_t * handles     = malloc(test_blocks * sizeof(uint64_t)); SHF_ASSERT(NULL != handles, "malloc(): %u: ", errno);
+            for (uint32_t i = 0; i < test_blocks; i++) {
+                handles[i] = shf_arena_alloc(shf, 100);
+                SHF_CAST(uint32_t *, shf_arena_addr(shf, handles[i]))[0] = i;
+            }
+            SHF      * shf_other    = shf_attach_existing(test_shf_folder, test_shf_name); /* maps arena segs at other addresses */
+            uint32_t   blocks_found = 0;
+            for (uint32_t i = 0; i < test_blocks; i++) {
+                blocks_found += (i == SHF_CAST(uint32_t *, shf_arena_addr(shf_other, handles[i]))[0]) ? 1 : 0;
+                shf_arena_free(shf_other, handles[i], 100);
+            }
+            shf_detach(shf_other); /* returns its private free blocks to shared free list */
+            ok(test_blocks == blocks_found && 12345 == SHF_CAST(uint32_t *, shf_arena_addr(shf, handle_b))[24], "c: arena blocks allocated by one attach are found & freed by another as expected");
+            free(handles);
+            shf_debug_verbosity_more();
+        }
+
         ok(1, "c: shf_del() // size before deletion: %s", shf_del(shf));
 
     } // end of non-fixed length tests
@@ -463,8 +910,291 @@ int main(void)
             shf_debug_verbosity_more();
         }
 
+        {
+            shf_debug_verbosity_less();
+            SHF    * shf_2 = shf_attach_existing(test_shf_folder, test_shf_name); /* fixed length mode persisted in shf; no need to set again */
+            uint32_t key   = 0;
+            shf_make_hash(SHF_CAST(const char *, &key), sizeof(key));
+            ok(fixed_len == shf_2->is_fixed_key_val_len && SHF_RET_KEY_FOUND == shf_get_key_val_copy(shf_2) && sizeof(key) == shf_val_len, "c: %s: attached shf inherits fixed length mode", test_hint);
+            shf_detach(shf_2);
+            shf_debug_verbosity_more();
+        }
+
         ok(0 == shf_debug_get_garbage(shf), "c: %s: graceful growth cleans up after itself as expected", test_hint);
 
+        {
+            SHF_STATS * stats = malloc(sizeof(SHF_STATS)); SHF_ASSERT(NULL != stats, "malloc(): %u: ", errno);
+            shf_stats_get(shf, stats);
+            uint64_t rows      = 0;
+            uint64_t refs_used = 0;
+            for (uint32_t i = 0; i <= SHF_REFS_PER_ROW; i++) {
+                rows      += stats->total.row_fill[i];
+                refs_used += stats->total.row_fill[i] * i;
+            }
+            ok(SHF_STATS_VERSION == stats->version && test_keys == stats->total.refs_used && 0 == stats->total.garbage_ratio, "c: %s: stats snapshot has expected version, keys, & garbage ratio", test_hint);
+            ok(stats->total.tabs_used * SHF_ROWS_PER_TAB == rows && test_keys == refs_used && stats->total.load_factor > 0 && stats->total.load_factor <= 1, "c: %s: stats row fill histogram adds up to %lu rows & %lu keys with load factor %.3f", test_hint, rows, refs_used, stats->total.load_factor);
+            SHF_STATS * stats_ss = malloc(sizeof(SHF_STATS)); SHF_ASSERT(NULL != stats_ss, "malloc(): %u: ", errno);
+            SHF       * shf_ss   = shf_attach_existing_snapshot(test_shf_folder, test_shf_name);
+            uint32_t    key      = 0;
+            shf_stats_get(shf_ss, stats_ss);
+            shf_make_hash(SHF_CAST(const char *, &key), sizeof(key));
+            ok(test_keys == stats_ss->total.refs_used && stats->total.tab_size == stats_ss->total.tab_size && 0 == memcmp(stats->total.row_fill, stats_ss->total.row_fill, sizeof(stats->total.row_fill)) && SHF_RET_FROZEN == shf_get_key_val_copy(shf_ss), "c: %s: lock-free snapshot attached shf has same stats & rejects get", test_hint);
+            shf_detach(shf_ss);
+            free(stats_ss);
+            free(stats);
+        }
+
+        {
+            shf_debug_verbosity_less();
+            shf_set_lock_times(shf, 1);
+            const SHF_LOCK_TIMES_MMAP * lock_times = shf_lock_times_get(shf);
+            uint64_t waits = 0;
+            uint64_t holds = 0;
+            for (uint32_t win = 0; win < SHF_WINS_PER_SHF; win++) {
+                for (uint32_t bucket = 0; bucket < SHF_LOCK_TIMES_BUCKETS; bucket++) {
+                    waits -= lock_times->wait[win][SHF_LOCK_OP_GET][bucket];
+                    holds -= lock_times->hold[win][SHF_LOCK_OP_GET][bucket];
+                }
+            }
+            for (uint32_t i = 0; i < test_keys; i++) {
+                shf_make_hash(SHF_CAST(const char *, &i), sizeof(i));
+                shf_get_key_val_copy(shf);
+            }
+            shf_set_lock_times(shf, 0);
+            shf_make_hash(SHF_CAST(const char *, &test_keys), sizeof(test_keys));
+            shf_get_key_val_copy(shf); /* not sampled */
+            for (uint32_t win = 0; win < SHF_WINS_PER_SHF; win++) {
+                for (uint32_t bucket = 0; bucket < SHF_LOCK_TIMES_BUCKETS; bucket++) {
+                    waits += lock_times->wait[win][SHF_LOCK_OP_GET][bucket];
+                    holds += lock_times->hold[win][SHF_LOCK_OP_GET][bucket];
+                }
+            }
+            ok(test_keys == waits && test_keys == holds, "c: %s: lock times sampled wait & hold of expected number of gets", test_hint);
+            holds = 0;
+            for (uint32_t win = 0; win < SHF_WINS_PER_SHF; win++) {
+                for (uint32_t bucket = 0; bucket < SHF_LOCK_TIMES_BUCKETS; bucket++) {
+                    holds -= lock_times->hold[win][SHF_LOCK_OP_GET][bucket];
+                }
+            }
+            shf_set_lock_times(shf, 64);
+            for (uint32_t i = 0; i < test_keys; i++) {
+                shf_make_hash(SHF_CAST(const char *, &i), sizeof(i));
+                shf_get_key_val_copy(shf);
+            }
+            shf_set_lock_times(shf, 0);
+            for (uint32_t win = 0; win < SHF_WINS_PER_SHF; win++) {
+                for (uint32_t bucket = 0; bucket < SHF_LOCK_TIMES_BUCKETS; bucket++) {
+                    holds += lock_times->hold[win][SHF_LOCK_OP_GET][bucket];
+                }
+            }
+            ok(holds > test_keys / 128 && holds < test_keys / 32, "c: %s: lock times sampled hold of 1 in 64 gets; %lu of %u as expected", test_hint, holds, test_keys);
+            shf_debug_verbosity_more();
+        }
+
+        {
+            shf_debug_verbosity_less();
+            shf_set_hot_keys(shf, 1 /* sample every op */);
+            shf_hot_keys_reset(shf);
+            uint32_t hot_key = 7;
+            for (uint32_t i = 0; i < test_keys; i++) {
+                shf_make_hash(SHF_CAST(const char *, &i), sizeof(i));
+                shf_get_key_val_copy(shf);
+                if (0 == i % 8) {
+                    shf_make_hash(SHF_CAST(const char *, &hot_key), sizeof(hot_key));
+                    shf_get_key_val_copy(shf);
+                }
+            }
+            shf_set_hot_keys(shf, 0);
+            const SHF_HOT_KEYS_MMAP * hot_keys = shf_hot_keys_get(shf);
+            uint64_t gets     = 0;
+            uint32_t slot_max = 0;
+            for (uint32_t win = 0; win < SHF_WINS_PER_SHF; win++) {
+                gets += hot_keys->ops[win][SHF_LOCK_OP_GET];
+            }
+            for (uint32_t slot = 0; slot < SHF_HOT_KEYS_TOP; slot++) {
+                if (hot_keys->keys[slot].count > hot_keys->keys[slot_max].count) { slot_max = slot; }
+            }
+            const SHF_HOT_KEY * hot      = &hot_keys->keys[slot_max];
+            uint64_t            hot_gets = test_keys / 8 + 1; /* + 1 for its own get in loop */
+            ok(test_keys + test_keys / 8 == hot_keys->samples && hot_keys->samples == gets && sizeof(hot_key) == hot->key_len && 0 == memcmp(hot->key, &hot_key, sizeof(hot_key)) && hot->count - hot->error <= hot_gets && hot->count >= hot_gets,
+                "c: %s: hot keys sampled expected number of gets & found hottest key with count %lu & error %lu", test_hint, hot->count, hot->error);
+            shf_debug_verbosity_more();
+        }
+
+        {
+            /* child dies holding win lock half way through a put; next locker should notice, repair the win, & unlock */
+            shf_debug_verbosity_less();
+            uint32_t key = 0;
+            shf_make_hash(SHF_CAST(const char *, &key), sizeof(key));
+            shf_get_key_val_copy(shf); /* ensure tab of key mmap()ed */
+            uint32_t       win             = shf_hash.u16[0] % SHF_WINS_PER_SHF;
+            uint16_t       tab             = shf->shf_mmap->wins[win].tabs[shf_hash.u16[1] % SHF_TABS_PER_WIN].tab;
+            SHF_TAB_MMAP * tab_mmap        = shf->tabs[win][tab].tab_mmap;
+            uint64_t       locks_recovered = shf->shf_mmap->wins[win].locks_recovered;
+            pid_t          child           = fork();
+            if (0 == child) {
+                SHF_LOCK_WRITER(&shf->shf_mmap->wins[win].lock);
+                for (uint32_t ref = 0; ref < SHF_REFS_PER_ROW; ref++) {
+                    if (0 == tab_mmap->row[0].ref[ref].pos) {
+                        tab_mmap->row[0].ref[ref].pos = tab_mmap->tab_used + 1; /* ref to key,value not appended yet */
+                        tab_mmap->tab_refs_used ++;
+                        break;
+                    }
+                }
+                _exit(0);
+            }
+            siginfo_t info;
+            SHF_ASSERT(0 == waitid(P_PID, child, &info, WEXITED | WNOWAIT), "waitid(): %u: ", errno); /* leave zombie for now */
+            shf_set_is_lockable(shf, 1);
+            ok(SHF_RET_KEY_FOUND == shf_get_key_val_copy(shf) && locks_recovered + 1 == shf->shf_mmap->wins[win].locks_recovered, "c: %s: get recovered win lock from writer which died holding it", test_hint);
+            shf_set_is_lockable(shf, 0);
+            SHF_ASSERT(child == waitpid(child, NULL, 0), "waitpid(): %u: ", errno);
+            SHF_STATS * stats = malloc(sizeof(SHF_STATS)); SHF_ASSERT(NULL != stats, "malloc(): %u: ", errno);
+            shf_stats_get(shf, stats);
+            uint64_t keys_used = 0;
+            for (uint32_t i = 0; i < SHF_WINS_PER_SHF; i++) { keys_used += shf->shf_mmap->wins[i].keys_used; }
+            ok(test_keys == stats->total.refs_used && test_keys == keys_used && locks_recovered + 1 == stats->win[win].locks_recovered, "c: %s: recovery dropped half put ref & recounted keys", test_hint);
+            free(stats);
+            shf_debug_verbosity_more();
+        }
+
+        {
+            shf_debug_verbosity_less();
+            uint32_t key = 0;
+            uint32_t val = 0;
+            shf_set_hot_keys(shf, 1 /* sample every op */);
+            shf_hot_keys_reset(shf);
+            shf_freeze(shf);
+            shf_make_hash(SHF_CAST(const char *, &key), sizeof(key));
+            ok(SHF_RET_FROZEN == shf_put_key_val(shf, SHF_CAST(const char *, &val), sizeof(val)) && SHF_RET_FROZEN == shf_del_key_val(shf) && SHF_RET_FROZEN == shf_add_key_val_atom(shf, 1) && SHF_RET_KEY_FOUND == shf_get_key_val_copy(shf), "c: %s: frozen shf rejects put, del, & add but not get", test_hint);
+            const SHF_HOT_KEYS_MMAP * hot_keys = shf_hot_keys_get(shf);
+            uint64_t frozen_samples = hot_keys->samples;
+            SHF    * shf_ro = shf_attach_existing_read_only(test_shf_folder, test_shf_name);
+            uint32_t found  = 0;
+            if (shf_ro) {
+                for (uint32_t i = 0; i < test_keys; i++) {
+                    shf_make_hash(SHF_CAST(const char *, &i), sizeof(i));
+                    found += SHF_RET_KEY_FOUND == shf_get_key_val_copy(shf_ro) ? 1 : 0;
+                }
+                found = SHF_RET_FROZEN == shf_put_key_val(shf_ro, SHF_CAST(const char *, &val), sizeof(val)) ? found : 0;
+                shf_detach(shf_ro);
+            }
+            ok(test_keys == found, "c: %s: read only attached shf gets all %u keys & rejects put", test_hint, found);
+            shf_thaw(shf);
+            shf_make_hash(SHF_CAST(const char *, &key), sizeof(key));
+            shf_get_key_val_copy(shf);
+            ok(0 == frozen_samples && 1 == hot_keys->samples, "c: %s: frozen shf get leaves hot keys untouched but thawed get samples as expected", test_hint);
+            shf_set_hot_keys(shf, 0);
+            shf_ro = shf_attach_existing_read_only(test_shf_folder, test_shf_name);
+            key = test_keys * 8; /* not used by other tests */
+            shf_make_hash(SHF_CAST(const char *, &key), sizeof(key));
+            ok(NULL == shf_ro && SHF_RET_KEY_PUT == shf_put_key_val(shf, SHF_CAST(const char *, &val), sizeof(val)) && SHF_RET_KEY_FOUND == shf_del_key_val(shf), "c: %s: thawed shf cannot be attached read only & accepts put & del", test_hint);
+            shf_debug_verbosity_more();
+        }
+
+        {
+            shf_debug_verbosity_less();
+            SHF_OP * op_a     = shf_op_new();
+            SHF_OP * op_b     = shf_op_new();
+            uint32_t key_a    = 1;
+            uint32_t key_b    = 2;
+            uint32_t uid_old  = shf_uid;
+            shf_op_hash(op_a, SHF_CAST(const char *, &key_a), sizeof(key_a));
+            shf_op_hash(op_b, SHF_CAST(const char *, &key_b), sizeof(key_b));
+            uint32_t result_a = shf_op_get(shf, op_a);
+            uint32_t result_b = shf_op_get(shf, op_b);
+            ok(SHF_RET_KEY_FOUND == result_a && SHF_RET_KEY_FOUND == result_b && key_a == SHF_CAST(uint32_t *, op_a->val)[0] && key_b == SHF_CAST(uint32_t *, op_b->val)[0] && op_a->uid != op_b->uid && uid_old == shf_uid, "c: %s: two ops in flight get own vals & leave __thread globals alone", test_hint);
+            uint32_t key = test_keys * 8; /* not used by other tests */
+            uint32_t got = 0;
+            shf_op_hash    (op_a, SHF_CAST(const char *, &key), sizeof(key));
+            shf_op_hash_set(op_b, &op_a->hash, SHF_CAST(const char *, &key), sizeof(key)); /* hash once, use twice */
+            result_a = shf_op_put    (shf, op_a, SHF_CAST(const char *, &key), sizeof(key));
+            result_b = shf_op_get_buf(shf, op_b, SHF_CAST(char *, &got), sizeof(got));
+            ok(SHF_RET_KEY_PUT == result_a && SHF_RET_KEY_FOUND == result_b && key == got && SHF_RET_KEY_FOUND == shf_op_del_uid(shf, op_b, op_a->uid) && SHF_RET_KEY_NONE == shf_op_get(shf, op_a), "c: %s: op put, get via reused hash, del by uid, & get again work", test_hint);
+            shf_op_free(op_a);
+            shf_op_free(op_b);
+            shf_debug_verbosity_more();
+        }
+
+        {
+            shf_debug_verbosity_less();
+            void ** val_addrs = malloc(test_keys * sizeof(void *)); SHF_ASSERT(NULL != val_addrs, "malloc(): %u: ", errno);
+            shf_read_begin(shf);
+            for (uint32_t i = 0; i < test_keys; i++) {
+                shf_make_hash(SHF_CAST(const char *, &i), sizeof(i));
+                SHF_ASSERT(SHF_RET_KEY_FOUND == shf_get_key_val_addr(shf), "INTERNAL: expected to find key %u\n", i);
+                val_addrs[i] = shf_val_addr;
+            }
+            for (uint32_t i = (test_keys * 3); i < (test_keys * 4); i++) {
+                shf_make_hash(SHF_CAST(const char *, &i), sizeof(i));
+                shf_put_key_val(shf, SHF_CAST(const char *, &i), sizeof(i));
+            }
+            ok(0 < shf->retired_used, "c: %s: put while reading retires tab mmap()s as expected", test_hint);
+            uint32_t vals_intact = 0;
+            for (uint32_t i = 0; i < test_keys; i++) {
+                vals_intact += (0 == memcmp(&i, val_addrs[i], sizeof(i))) ? 1 : 0;
+            }
+            ok(test_keys == vals_intact, "c: %s: got expected number of guarded val addrs after put", test_hint);
+            shf_read_end(shf);
+            ok(0 == shf->retired_used, "c: %s: end of reading munmap()s retired tab mmap()s as expected", test_hint);
+            for (uint32_t i = (test_keys * 3); i < (test_keys * 4); i++) {
+                shf_make_hash(SHF_CAST(const char *, &i), sizeof(i));
+                SHF_ASSERT(SHF_RET_KEY_FOUND == shf_del_key_val(shf), "INTERNAL: expected to del key %u\n", i);
+            }
+            free(val_addrs);
+            shf_debug_verbosity_more();
+        }
+
+        {
+            shf_debug_verbosity_less();
+            double test_start_time = shf_get_time_in_seconds();
+            uint32_t keys_found = 0;
+            uint32_t keys_good  = 0;
+            SHF_ITER * iter = shf_iter_new(shf);
+            while (SHF_RET_KEY_FOUND == shf_iter_next(iter)) {
+                keys_found ++;
+                keys_good  += (sizeof(uint32_t) == iter->key_len && sizeof(uint32_t) == iter->val_len && 0 == memcmp(iter->key, iter->val, sizeof(uint32_t))) ? 1 : 0;
+            }
+            shf_iter_free(iter);
+            double test_elapsed_time = shf_get_time_in_seconds() - test_start_time;
+            ok(test_keys == keys_found, "c: %s: iterated expected number of existing keys // estimate %'.0f keys per second", test_hint, test_keys / test_elapsed_time);
+            ok(test_keys == keys_good , "c: %s: iterated expected number of key,value pairs", test_hint);
+            shf_debug_verbosity_more();
+        }
+
+        {
+            shf_debug_verbosity_less();
+            double test_start_time = shf_get_time_in_seconds();
+            uint64_t keys_visited = 0;
+            uint64_t keys_matched = shf_scan_parallel(shf, 4, scan_filter_test, scan_visit_test, &keys_visited);
+            double test_elapsed_time = shf_get_time_in_seconds() - test_start_time;
+            ok(test_keys / 2 == keys_matched, "c: %s: scanned expected number of matching keys // estimate %'.0f keys per second", test_hint, test_keys / test_elapsed_time);
+            ok(test_keys / 2 == keys_visited, "c: %s: visited expected number of matching key,value pairs", test_hint);
+            shf_debug_verbosity_more();
+        }
+
+        {
+            shf_debug_verbosity_less();
+            uint64_t keys_expired = 0;
+            for (uint32_t win = 0; win < SHF_WINS_PER_SHF; win++) { keys_expired -= shf->shf_mmap->wins[win].keys_expired; }
+            for (uint32_t i = (test_keys * 4); i < (test_keys * 5); i++) {
+                shf_make_hash(SHF_CAST(const char *, &i), sizeof(i));
+                shf_put_key_val_ttl(shf, SHF_CAST(const char *, &i), sizeof(i), 0 /* expire immediately */);
+            }
+            uint32_t keys_found = 0;
+            for (uint32_t i = (test_keys * 4); i < (test_keys * 5); i++) {
+                shf_make_hash(SHF_CAST(const char *, &i), sizeof(i));
+                keys_found += (SHF_RET_KEY_FOUND == shf_get_key_val_copy(shf)) ? 1 : 0;
+            }
+            ok(0 == keys_found, "c: %s: got expected number of expired keys", test_hint);
+            double test_start_time = shf_get_time_in_seconds();
+            uint32_t keys_reaped = shf_ttl_reap(shf);
+            double test_elapsed_time = shf_get_time_in_seconds() - test_start_time;
+            for (uint32_t win = 0; win < SHF_WINS_PER_SHF; win++) { keys_expired += shf->shf_mmap->wins[win].keys_expired; }
+            ok(test_keys == keys_expired, "c: %s: reaped %u & lazily deleted %lu expired keys as expected // estimate %'.0f keys per second", test_hint, keys_reaped, keys_expired - keys_reaped, keys_reaped / test_elapsed_time);
+            shf_debug_verbosity_more();
+        }
+
         {
             shf_debug_verbosity_less();
             double test_start_time = shf_get_time_in_seconds();
@@ -480,6 +1210,30 @@ int main(void)
 
         ok(0 != shf_debug_get_garbage(shf), "c: %s: del does not    clean  up after itself as expected", test_hint);
 
+        {
+            shf_debug_verbosity_less();
+            uint32_t cache_keys = SHF_WINS_PER_SHF * 64; /* 64 keys per win */
+            uint32_t hot_key    = test_keys * 5;
+            shf_set_cache_budget(shf, 0 /* unlimited bytes */, cache_keys);
+            shf_make_hash(SHF_CAST(const char *, &hot_key), sizeof(hot_key));
+            shf_put_key_val(shf, SHF_CAST(const char *, &hot_key), sizeof(hot_key));
+            for (uint32_t i = (test_keys * 5) + 1; i < (test_keys * 6); i++) {
+                shf_make_hash(SHF_CAST(const char *, &i), sizeof(i));
+                shf_put_key_val(shf, SHF_CAST(const char *, &i), sizeof(i));
+                if (0 == (i % 64)) {
+                    shf_make_hash(SHF_CAST(const char *, &hot_key), sizeof(hot_key));
+                    shf_get_key_val_copy(shf); /* sets CLOCK reference bit */
+                }
+            }
+            uint32_t keys_used = 0;
+            for (uint32_t win = 0; win < SHF_WINS_PER_SHF; win++) { keys_used += shf->shf_mmap->wins[win].keys_used; }
+            ok(keys_used <= cache_keys && test_keys == keys_used + shf_cache_get_evicted(shf), "c: %s: cache mode kept %u keys & evicted %lu keys as expected", test_hint, keys_used, shf_cache_get_evicted(shf));
+            shf_make_hash(SHF_CAST(const char *, &hot_key), sizeof(hot_key));
+            ok(SHF_RET_KEY_FOUND == shf_get_key_val_copy(shf), "c: %s: cache mode kept frequently got key as expected", test_hint);
+            shf_set_cache_budget(shf, 0, 0);
+            shf_debug_verbosity_more();
+        }
+
         ok(1, "c: %s: shf_del() // size before deletion: %s", test_hint, shf_del(shf));
 
     } /* for (fixed_len ...)*/
@@ -21,15 +21,22 @@
  * ============================================================================
  */
 
+#include <algorithm> /* before tap.h which defines ok() etc macros */
+#include <string>
+#include <utility>
+#include <vector>
+
 extern "C" {
 #include <string.h> /* for memcmp() */
 #include <locale.h> /* for setlocale() */
+#include <stdlib.h> /* for getenv() */
 
 #include <tap.h>
 #include <shf.defines.h>
 }
 
 #include <SharedHashFile.hpp>
+#include <shf.hpp>
 
 static uint32_t
 upd_callback_test(const char * val, uint32_t val_len) /* callback for ->Upd*Val() */
@@ -42,10 +49,64 @@ upd_callback_test(const char * val, uint32_t val_len) /* callback for ->Upd*Val(
     return result;
 } /* upd_callback_test() */
 
+typedef struct TEST_COUNTER { /* value for shf::SharedHashMap<> tests */
+    long     hits;
+    uint32_t id  ;
+    uint32_t pad ;
+} TEST_COUNTER;
+
+struct TEST_POINT { /* value for shf::SharedHashMap<> tests; not default constructible */
+    TEST_POINT(uint32_t point_x, uint32_t point_y) : x(point_x), y(point_y) {}
+    uint32_t x;
+    uint32_t y;
+};
+
+typedef struct TEST_VISIT {
+    char     val[8];
+    uint32_t val_len;
+} TEST_VISIT;
+
+static uint32_t
+visit_callback_test(const char * val, uint32_t val_len, void * ctx) /* callback for ->Get*ValVisit() */
+{
+    TEST_VISIT * visit = SHF_CAST(TEST_VISIT *, ctx);
+    if ((NULL == visit) || (val_len > sizeof(visit->val))) {
+        return SHF_RET_BAD_CB;
+    }
+    memcpy(visit->val, val, val_len);
+    visit->val_len = val_len;
+    return SHF_RET_OK;
+} /* visit_callback_test() */
+
+static uint32_t
+scan_filter_test(const SHF_SCAN * scan, void * ctx) /* callback for ->ScanParallel(); match even values */
+{
+    SHF_UNUSE(ctx);
+    return (sizeof(uint32_t) == scan->val_len) && (0 == (SHF_U32_AT(scan->val, 0) % 2));
+} /* scan_filter_test() */
+
+static void
+scan_visit_test(const SHF_SCAN * scan, void * ctx) /* callback for ->ScanParallel(); count matching key,value pairs */
+{
+    uint64_t * keys_visited = SHF_CAST(uint64_t *, ctx);
+    if (0 == memcmp(scan->key, scan->val, sizeof(uint32_t))) {
+        __sync_fetch_and_add(keys_visited, 1);
+    }
+} /* scan_visit_test() */
+
+static shf::Task
+executor_get_test(shf::Executor & executor, uint32_t first, uint32_t stride, uint32_t keys, uint32_t * keysFound) /* task for shf::Executor; gets every stride key */
+{
+    for (uint32_t i = first; i < keys; i += stride) {
+        std::optional<shf::Value> value = co_await executor.get(std::string_view(SHF_CAST(const char *, &i), sizeof(i)));
+        *keysFound += (value && sizeof(i) == value->val.size() && 0 == memcmp(&i, value->val.data(), sizeof(i))) ? 1 : 0;
+    }
+} /* executor_get_test() */
+
 int
 main(/* int argc,char **argv */)
 {
-    plan_tests(8+206);
+    plan_tests(8+242+6+5+3+4);
 
     SHF_ASSERT(NULL != setlocale(LC_NUMERIC, ""), "setlocale(): %u: ", errno);
 
@@ -111,9 +172,25 @@ main(/* int argc,char **argv */)
         ok(SHF_RET_KEY_FOUND                   == shf->GetKeyValCopy  (                                  ), "c++: custom callback upd uid: op 2: ->GetKeyValCopy()   could     find   upd key as expected");
         ok(3                                   == shf_val_len                                             , "c++: custom callback upd uid: op 2: shf_val_len                                  as expected");
         ok(0 /* matches */                     == memcmp              (shf_val, "up2" , 3                ), "c++: custom callback upd uid: op 2: shf_val                                      as expected");
+        TEST_VISIT visit = { "", 0 };
+        ok(SHF_RET_KEY_FOUND                   == shf->GetKeyValVisit (     visit_callback_test, &visit     ), "c++:  visit callback get key: op 1: ->GetKeyValVisit()  callback works 4 get key as expected");
+        ok(3 == visit.val_len && 0             == memcmp              (visit.val, "up2", 3               ), "c++:  visit callback get key: op 1: val visited in place                     as expected");
+        ok(SHF_RET_KEY_FOUND                   == shf->GetUidValVisit (uid, visit_callback_test, &visit     ), "c++:  visit callback get uid: op 2: ->GetUidValVisit()  callback works 4 get uid as expected");
+        ok(SHF_RET_KEY_FOUND + SHF_RET_BAD_CB  == shf->GetUidValVisit (uid, visit_callback_test, NULL       ), "c++:  visit callback get uid: op 3: ->GetUidValVisit()  callback error 4 get uid as expected");
+        char         copyBuf[8];
+        struct iovec copyIov[2] = { { &copyBuf[0], 2 }, { &copyBuf[4], 4 } };
+        ok(SHF_RET_KEY_FOUND                   == shf->GetKeyValCopyBuf(     copyBuf, sizeof(copyBuf)     ), "c++: caller buffer     get key: op 1: ->GetKeyValCopyBuf() could find   get key as expected");
+        ok(3 == shf_val_len && 0               == memcmp              (copyBuf, "up2", 3                 ), "c++: caller buffer     get key: op 1: val copied into caller buffer        as expected");
+        ok(SHF_RET_KEY_FOUND+SHF_RET_BUF_SMALL == shf->GetUidValCopyBuf(uid, copyBuf, 2                   ), "c++: caller buffer     get uid: op 2: ->GetUidValCopyBuf() buffer too small    as expected");
+        ok(3                                   == shf_val_len                                             , "c++: caller buffer     get uid: op 2: shf_val_len is needed length         as expected");
+        ok(SHF_RET_KEY_FOUND                   == shf->GetUidValCopyIov(uid, copyIov, 2                   ), "c++: caller iovec      get uid: op 3: ->GetUidValCopyIov() could find   get uid as expected");
+        ok(0 == memcmp(&copyBuf[0], "up", 2) && 0 == memcmp(&copyBuf[4], "2", 1)                          , "c++: caller iovec      get uid: op 3: val scattered into caller iovec      as expected");
+        ok(SHF_RET_KEY_FOUND                   == shf->GetUidKeyCopyBuf(uid, copyBuf, sizeof(copyBuf)     ), "c++: caller buffer     get uid: op 4: ->GetUidKeyCopyBuf() could find   get uid as expected");
+        ok(3 == shf_key_len && 0               == memcmp              (copyBuf, "key", 3                 ), "c++: caller buffer     get uid: op 4: key copied into caller buffer        as expected");
         ok(SHF_RET_KEY_FOUND                   == shf->DelUidVal      (uid                               ), "c++:     existing    del uid: op 1: ->DelUidVal()       could     find   put key as expected");
         ok(SHF_RET_KEY_NONE                    == shf->GetKeyValCopy  (                                  ), "c++:     existing    del uid: op 1: ->GetKeyValCopy()   could not find   del key as expected");
         ok(SHF_RET_KEY_NONE                    == shf->DelUidVal      (uid                               ), "c++: non-existing    del uid: op 1: ->DelUidVal()       could not find   del key as expected");
+        ok(SHF_RET_KEY_NONE                    == shf->GetUidValVisit (uid, visit_callback_test, &visit     ), "c++:  visit callback get uid: op 4: ->GetUidValVisit()  could not find   del key as expected");
         ok(SHF_RET_KEY_PUT                     == shf->PutKeyVal      (         "2222", 4                ), "c++: reput / reuse key / uid: op 1: ->PutKeyVal()                      reput key as expected"); uid = shf_uid;
         ok(uid                                 != SHF_UID_NONE                                            , "c++: reput / reuse key / uid: op 1: ->PutKeyVal()                      reput key as expected");
         ok(SHF_RET_KEY_FOUND                   == shf->GetUidValCopy  (uid                               ), "c++: reput / reuse key / uid: op 1: ->GetUidValCopy()   could     find reput key as expected");
@@ -169,6 +246,11 @@ main(/* int argc,char **argv */)
         ok(SHF_RET_KEY_NONE                    == shf->GetKeyValCopy  (                                  ), "c++:     existing    add key: op 6: ->GetKeyValCopy()   could not find   add key as expected");
         ok(shf_uid                             == SHF_UID_NONE                                            , "c++:     existing    add key: op 6: shf_uid                                unset as expected");
 
+                                                  shf->MakeHash       (         "ttl-dead", sizeof("ttl-dead") - 1);
+        ok(SHF_RET_KEY_PUT                     == shf->PutKeyValTtl   (         "dead", 4, 0                     ), "c++: ttl               key: op 1: ->PutKeyValTtl()     put  key with ttl 0s as expected");
+        ok(SHF_RET_KEY_NONE                    == shf->GetKeyValCopy  (                                          ), "c++: ttl               key: op 1: ->GetKeyValCopy()   could not find expired key as expected");
+        ok(1                                   == shf->TtlReap        (                                          ), "c++: ttl               key: op 2: ->TtlReap()            deleted expired key as expected");
+
         // Use own hash -- in this example hard-coded SHA256() -- instead of shf->MakeHash function.
         uint32_t h_foo[] = {0x2c26b46b, 0x68ffc68f, 0xf99b453c, 0x1d304134, 0x13422d70, 0x6483bfa0, 0xf98a5e88, 0x6266e7ae}; /* SHA256("foo") */
         uint32_t h_bar[] = {0xfcde2b2e, 0xdba56bf4, 0x08601fb7, 0x21fe9b5c, 0x338d10ee, 0x429ea04f, 0xae5511b6, 0x8fbf8fb9}; /* SHA256("bar") */
@@ -461,6 +543,121 @@ main(/* int argc,char **argv */)
 
         ok(0 == shf->DebugGetGarbage(), "c++: %s: graceful growth cleans up after itself as expected", testHint);
 
+        {
+            SHF_STATS * stats = SHF_CAST(SHF_STATS *, malloc(sizeof(SHF_STATS))); SHF_ASSERT(NULL != stats, "malloc(): %u: ", errno);
+            shf->StatsGet(stats);
+            ok(SHF_STATS_VERSION == stats->version && testKeys == stats->total.refs_used && 0 == stats->total.tab_data_free, "c++: %s: stats snapshot has expected version, keys, & garbage", testHint);
+            free(stats);
+        }
+
+        {
+            shf->DebugVerbosityLess();
+            shf->SetLockTimes(1);
+            uint32_t key = 0;
+            shf->MakeHash(SHF_CAST(const char *, &key), sizeof(key));
+            shf->GetKeyValCopy();
+            shf->SetLockTimes(0);
+            const SHF_LOCK_TIMES_MMAP * lockTimes = shf->LockTimesGet();
+            uint64_t holds = 0;
+            for (uint32_t win = 0; win < SHF_WINS_PER_SHF; win++) {
+                for (uint32_t bucket = 0; bucket < SHF_LOCK_TIMES_BUCKETS; bucket++) {
+                    holds += lockTimes->hold[win][SHF_LOCK_OP_GET][bucket];
+                }
+            }
+            ok(holds > 0, "c++: %s: lock times sampled hold of get", testHint);
+            shf->DebugVerbosityMore();
+        }
+
+        {
+            shf->DebugVerbosityLess();
+            shf->SetHotKeys(1);
+            shf->HotKeysReset();
+            uint32_t key = 0;
+            shf->MakeHash(SHF_CAST(const char *, &key), sizeof(key));
+            shf->GetKeyValCopy();
+            shf->SetHotKeys(0);
+            const SHF_HOT_KEYS_MMAP * hotKeys = shf->HotKeysGet();
+            uint32_t slots = 0;
+            for (uint32_t slot = 0; slot < SHF_HOT_KEYS_TOP; slot++) {
+                slots += hotKeys->keys[slot].count ? 1 : 0;
+            }
+            ok(1 == hotKeys->samples && 1 == slots, "c++: %s: hot keys sampled get", testHint);
+            shf->DebugVerbosityMore();
+        }
+
+        {
+            shf->DebugVerbosityLess();
+            uint32_t key = 0;
+            shf->Freeze();
+            shf->MakeHash(SHF_CAST(const char *, &key), sizeof(key));
+            uint32_t gotFrozen = shf->GetKeyValCopy();
+            uint32_t putFrozen = shf->PutKeyVal(SHF_CAST(const char *, &key), sizeof(key));
+            ok(SHF_RET_KEY_FOUND == gotFrozen && SHF_RET_FROZEN == putFrozen, "c++: %s: frozen get finds key & put fails as expected", testHint);
+            shf->Thaw();
+            shf->MakeHash(SHF_CAST(const char *, &key), sizeof(key));
+            ok(SHF_RET_KEY_FOUND == shf->DelKeyVal() && SHF_RET_KEY_PUT == shf->PutKeyVal(SHF_CAST(const char *, &key), sizeof(key)), "c++: %s: thawed del & put work again", testHint);
+            shf->DebugVerbosityMore();
+        }
+
+        {
+            shf->DebugVerbosityLess();
+            SHF_OP * op  = shf_op_new();
+            uint32_t key = testKeys * 8; /* not used by other tests */
+            shf_op_hash(op, SHF_CAST(const char *, &key), sizeof(key));
+            uint32_t putResult = shf->OpPut(op, SHF_CAST(const char *, &key), sizeof(key));
+            uint32_t getResult = shf->OpGet(op);
+            ok(SHF_RET_KEY_PUT == putResult && SHF_RET_KEY_FOUND == getResult && key == SHF_CAST(uint32_t *, op->val)[0] && SHF_RET_KEY_FOUND == shf->OpDel(op), "c++: %s: op put, get, & del work", testHint);
+            shf_op_free(op);
+            shf->DebugVerbosityMore();
+        }
+
+        {
+            shf->DebugVerbosityLess();
+            void ** valAddrs = SHF_CAST(void **, malloc(testKeys * sizeof(void *))); SHF_ASSERT(NULL != valAddrs, "malloc(): %u: ", errno);
+            shf->ReadBegin();
+            for (uint32_t i = 0; i < testKeys; i++) {
+                shf->MakeHash(SHF_CAST(const char *, &i), sizeof(i));
+                SHF_ASSERT(SHF_RET_KEY_FOUND == shf->GetKeyValAddr(), "INTERNAL: expected to find key %u\n", i);
+                valAddrs[i] = shf_val_addr;
+            }
+            for (uint32_t i = (testKeys * 3); i < (testKeys * 4); i++) {
+                shf->MakeHash (SHF_CAST(const char *, &i), sizeof(i));
+                shf->PutKeyVal(SHF_CAST(const char *, &i), sizeof(i));
+            }
+            uint32_t valsIntact = 0;
+            for (uint32_t i = 0; i < testKeys; i++) {
+                valsIntact += (0 == memcmp(&i, valAddrs[i], sizeof(i))) ? 1 : 0;
+            }
+            ok(testKeys == valsIntact, "c++: %s: got expected number of guarded val addrs after put", testHint);
+            shf->ReadEnd();
+            for (uint32_t i = (testKeys * 3); i < (testKeys * 4); i++) {
+                shf->MakeHash(SHF_CAST(const char *, &i), sizeof(i));
+                SHF_ASSERT(SHF_RET_KEY_FOUND == shf->DelKeyVal(), "INTERNAL: expected to del key %u\n", i);
+            }
+            free(valAddrs);
+            shf->DebugVerbosityMore();
+        }
+
+        {
+            shf->DebugVerbosityLess();
+            uint32_t keys_found = 0;
+            SHF_ITER * iter = shf->IterNew();
+            while (SHF_RET_KEY_FOUND == shf->IterNext(iter)) {
+                keys_found += (sizeof(uint32_t) == iter->key_len && 0 == memcmp(iter->key, iter->val, sizeof(uint32_t))) ? 1 : 0;
+            }
+            shf->IterFree(iter);
+            ok(testKeys == keys_found, "c++: %s: iterated expected number of existing keys", testHint);
+            shf->DebugVerbosityMore();
+        }
+
+        {
+            shf->DebugVerbosityLess();
+            uint64_t keysVisited = 0;
+            uint64_t keysMatched = shf->ScanParallel(4, scan_filter_test, scan_visit_test, &keysVisited);
+            ok(testKeys / 2 == keysMatched && testKeys / 2 == keysVisited, "c++: %s: scanned & visited expected number of matching keys", testHint);
+            shf->DebugVerbosityMore();
+        }
+
         {
             shf->DebugVerbosityLess();
             double testStartTime = shf_get_time_in_seconds();
@@ -476,12 +673,221 @@ main(/* int argc,char **argv */)
 
         ok(0 != shf->DebugGetGarbage(), "c++: %s: del does not    clean  up after itself as expected", testHint);
 
+        {
+            shf->DebugVerbosityLess();
+            uint64_t cacheData = SHF_WINS_PER_SHF * 1024; /* 1KB of key,values per win */
+            shf->SetCacheBudget(cacheData, 0 /* unlimited keys */);
+            for (uint32_t i = (testKeys * 5); i < (testKeys * 6); i++) {
+                shf->MakeHash (SHF_CAST(const char *, &i), sizeof(i));
+                shf->PutKeyVal(SHF_CAST(const char *, &i), sizeof(i));
+            }
+            uint64_t keysKept = testKeys - shf->CacheGetEvicted();
+            ok(keysKept <= cacheData / (1 + sizeof(uint32_t) + sizeof(uint32_t)), "c++: %s: cache mode kept %lu keys within %lu bytes as expected", testHint, keysKept, cacheData);
+            shf->SetCacheBudget(0, 0);
+            shf->DebugVerbosityMore();
+        }
+
         ok(1, "c++: %s: ->Del() // size before deletion: %s", testHint, shf->Del());
 
         delete shf;
 
     } /* for (fixed_len ...)*/
 
+    { // start of shf::Instance tests
+
+        char  testShfName[256];
+        char  testShfFolder[] = "/dev/shm";
+        pid_t pid             = getpid();
+        SHF_SNPRINTF(1, testShfName, "test-%05u-instance", pid);
+
+        ok(! shf::Instance::attach_existing(testShfFolder, testShfName), "c++: instance: ::attach_existing() fails for non-existing file as expected");
+
+        shf::Instance moved(testShfFolder, testShfName, 1 /* delete upon process exit */);
+        shf::Instance instance(std::move(moved));
+        shf_set_is_lockable(instance.handle(), 0); /* single threaded test; no need to lock */
+        std::optional<shf::Value> none = instance.get("key");
+        bool                      put  = instance.put("key", "val");
+        std::optional<shf::Value> got  = instance.get("key");
+        ok(! moved && instance && ! none && put && got && "val" == got->val && SHF_UID_NONE != got->uid, "c++: instance: moved instance put & get work as expected");
+
+        std::vector<std::pair<std::string, std::string>> keyVals;
+        std::vector<std::string>                         keys;
+        for (uint32_t i = 0; i < 1000; i++) {
+            keyVals.emplace_back("key-" + std::to_string(i), "val-" + std::to_string(i));
+            keys   .emplace_back("key-" + std::to_string(i));
+        }
+        uint32_t valsMatched = 0;
+        ok(1000 == instance.put(keyVals), "c++: instance: batch put of 1000 keys works as expected");
+        ok(1000 == instance.get(keys, [&](std::string_view key, const std::optional<shf::Value> & value) {
+            valsMatched += (value && key.substr(4) == value->val.substr(4)) ? 1 : 0;
+        }) && 1000 == valsMatched, "c++: instance: batch get of 1000 keys visits expected values");
+
+        uint32_t itemsMatched = 0;
+        for (shf::Item item : instance.items()) {
+            itemsMatched += (item.key.substr(3) == item.val.substr(3) && SHF_UID_NONE != item.uid) ? 1 : 0;
+        }
+        ok(1001 == itemsMatched, "c++: instance: range for iterates expected number of existing keys");
+
+        ok(1000 == instance.del(keys) && instance.get("key") && ! instance.get("key-0"), "c++: instance: batch del of 1000 keys works as expected // size before deletion: %s", instance.destroy());
+
+    } // end of shf::Instance tests
+
+    { // start of shf::SharedHashMap<> tests
+
+        char  testShfName[256];
+        char  testShfFolder[] = "/dev/shm";
+        pid_t pid             = getpid();
+        SHF_SNPRINTF(1, testShfName, "test-%05u-map", pid);
+
+        shf::SharedHashMap<uint32_t, TEST_COUNTER> map(testShfFolder, testShfName, 1 /* delete upon process exit */);
+        shf_set_is_lockable(map.handle(), 0); /* single threaded test; no need to lock */
+        uint32_t putsGot = 0;
+        for (uint32_t i = 0; i < 1000; i++) {
+            TEST_COUNTER counter = { 0, i, 0 };
+            std::optional<TEST_COUNTER> got = map.put(i, counter) ? map.get(i) : std::nullopt;
+            putsGot += (got && i == got->id) ? 1 : 0;
+        }
+        ok(1000 == putsGot && sizeof(uint32_t) == map.handle()->fixed_key_len && sizeof(TEST_COUNTER) == map.handle()->fixed_val_len && ! map.get(1000), "c++: map: typed put & get by value of 1000 keys work as expected");
+
+        std::optional<long> hitsAfter  = map.add(7U, offsetof(TEST_COUNTER, hits), 5L);
+                                         map.add(7U, offsetof(TEST_COUNTER, hits), 2L);
+        ok(hitsAfter && 5 == *hitsAfter && 7 == map.get(7)->hits && 7 == map.get(7)->id && ! map.add(1000U, offsetof(TEST_COUNTER, hits), 1L) && ! map.add(7U, offsetof(TEST_COUNTER, pad), 1L), "c++: map: in place atomic add to field works as expected");
+
+        {
+            shf::SharedHashMap<uint32_t, TEST_COUNTER>::Ref ref = map.ref(9);
+            ok(ref && 9 == (*ref).id && nullptr != ref.addr() && ! map.ref(1000), "c++: map: guarded reference to value in place works as expected");
+        }
+
+        shf::SharedHashMap<uint32_t, TEST_COUNTER> mapAgain = shf::SharedHashMap<uint32_t, TEST_COUNTER>::attach_existing(testShfFolder, testShfName);
+        shf::SharedHashMap<uint32_t, uint32_t    > mapOther = shf::SharedHashMap<uint32_t, uint32_t    >::attach_existing(testShfFolder, testShfName);
+        bool attachedAgain = mapAgain && 9 == mapAgain.get(9)->id && mapAgain.del(9) && ! map.get(9) && ! mapOther;
+        mapAgain.detach();
+        ok(attachedAgain, "c++: map: attach existing works for same & fails for other key,value types // size before deletion: %s", map.destroy());
+
+        SHF_SNPRINTF(1, testShfName, "test-%05u-map-point", pid);
+        shf::SharedHashMap<uint64_t, TEST_POINT> points(testShfFolder, testShfName, 1 /* delete upon process exit */);
+        std::optional<TEST_POINT> point = points.put(3, TEST_POINT(4, 5)) ? points.get(3) : std::nullopt;
+        bool pointInPlace = 5 == (*points.ref(3)).y; /* ref released before destroy() */
+        ok(point && 4 == point->x && 5 == point->y && pointInPlace && ! points.get(4), "c++: map: value type without default constructor works as expected // size before deletion: %s", points.destroy());
+
+    } // end of shf::SharedHashMap<> tests
+
+    { // start of shf::Executor tests; compare plain, batched, & interleaved coroutine gets
+
+        char  testShfName[256];
+        char  testShfFolder[] = "/dev/shm";
+        pid_t pid             = getpid();
+        SHF_SNPRINTF(1, testShfName, "test-%05u-executor", pid);
+
+        uint32_t isPerformance = getenv("SHF_PERFORMANCE_TEST_ENABLE") && atoi(getenv("SHF_PERFORMANCE_TEST_ENABLE"));
+        uint32_t testKeys      = getenv("SHF_PERFORMANCE_TEST_KEYS"  ) ? SHF_CAST(uint32_t, atoi(getenv("SHF_PERFORMANCE_TEST_KEYS"))) : (isPerformance ? 10000000 : 100000);
+
+        shf::Instance instance(testShfFolder, testShfName, 1 /* delete upon process exit */);
+        shf_set_is_fixed_len(instance.handle(), sizeof(uint32_t), sizeof(uint32_t));
+        shf_set_data_need_factor(250);
+        for (uint32_t i = 0; i < testKeys; i++) {
+            std::string_view key(SHF_CAST(const char *, &i), sizeof(i));
+            instance.put(key, key);
+        }
+
+        double   testStartTime = shf_get_time_in_seconds();
+        uint32_t keysFound     = 0;
+        for (uint32_t i = 0; i < testKeys; i++) {
+            std::optional<shf::Value> value = instance.get(std::string_view(SHF_CAST(const char *, &i), sizeof(i)));
+            keysFound += (value && 0 == memcmp(&i, value->val.data(), sizeof(i))) ? 1 : 0;
+        }
+        double testElapsedTime = shf_get_time_in_seconds() - testStartTime;
+        ok(testKeys == keysFound, "c++: executor: plain       get of %u keys // estimate %'.0f keys per second", testKeys, testKeys / testElapsedTime);
+
+        testStartTime = shf_get_time_in_seconds();
+        keysFound     = 0;
+        std::vector<uint32_t>         batchKeys(1000);
+        std::vector<std::string_view> batch    (1000);
+        for (uint32_t i = 0; i < testKeys; i += batch.size()) {
+            batch.resize(std::min<uint32_t>(batchKeys.size(), testKeys - i));
+            for (uint32_t j = 0; j < batch.size(); j++) {
+                batchKeys[j] = i + j;
+                batch    [j] = std::string_view(SHF_CAST(const char *, &batchKeys[j]), sizeof(uint32_t));
+            }
+            keysFound += instance.get(batch, [&](std::string_view key, const std::optional<shf::Value> & value) {
+                SHF_ASSERT(value && key == value->val, "INTERNAL: expected value to match key\n");
+            });
+        }
+        testElapsedTime = shf_get_time_in_seconds() - testStartTime;
+        ok(testKeys == keysFound, "c++: executor: batched     get of %u keys in prefetched groups // estimate %'.0f keys per second", testKeys, testKeys / testElapsedTime);
+
+        testStartTime = shf_get_time_in_seconds();
+        keysFound     = 0;
+        uint32_t      tasks = 16;
+        shf::Executor executor(instance, tasks);
+        for (uint32_t task = 0; task < tasks; task++) {
+            executor.spawn(executor_get_test(executor, task, tasks, testKeys, &keysFound));
+        }
+        executor.run();
+        testElapsedTime = shf_get_time_in_seconds() - testStartTime;
+        ok(testKeys == keysFound, "c++: executor: interleaved get of %u keys via %u tasks // estimate %'.0f keys per second; size before deletion: %s", testKeys, tasks, testKeys / testElapsedTime, instance.destroy());
+
+    } // end of shf::Executor tests
+
+    { // start of shf::Arena tests
+
+        char  testShfName[256];
+        char  testShfFolder[] = "/dev/shm";
+        pid_t pid             = getpid();
+        SHF_SNPRINTF(1, testShfName, "test-%05u-arena", pid);
+
+        shf::Instance instance     (testShfFolder, testShfName, 1 /* delete upon process exit */);
+        shf::Instance instanceAgain = shf::Instance::attach_existing(testShfFolder, testShfName); /* stands in for another process */
+        shf::Arena    arena        (instance     );
+        shf::Arena    arenaAgain   (instanceAgain);
+
+        uint64_t                                   vectorHandle = arena.alloc(sizeof(shf::ArenaVector<uint32_t>));
+        shf::ArenaPtr<shf::ArenaVector<uint32_t> > vectorPtr    = { vectorHandle };
+        shf::ArenaVector<uint32_t>               * vector       = vectorPtr.get(arena);
+        memset(vector, 0, sizeof(*vector));
+        uint32_t pushed = 0;
+        for (uint32_t i = 0; i < 1000; i++) {
+            pushed += vector->push_back(arena, i) ? 1 : 0;
+        }
+        ok(vectorHandle && 1000 == pushed && 1000 == vector->size && 999 == vector->at(arena, 999) && ! shf::ArenaPtr<uint32_t>{0}, "c++: arena: vector in arena block grows to 1000 elements");
+
+        shf::ArenaVector<uint32_t> * vectorAgain = vectorPtr.get(arenaAgain);
+        uint64_t                     sum         = 0;
+        for (const uint32_t * i = vectorAgain->begin(arenaAgain); i != vectorAgain->end(arenaAgain); i++) {
+            sum += *i;
+        }
+        ok(1000 == vectorAgain->size && 999 * 1000 / 2 == sum, "c++: arena: vector read via offset handles from other attach works as expected");
+        vector->clear(arena);
+        arena.free(vectorHandle, sizeof(shf::ArenaVector<uint32_t>));
+
+        shf::ArenaDeque<uint32_t> deque = { 0, 0, 0, 0 };
+        bool dequeOrdered = true;
+        for (uint32_t i = 0; i < 100; i++) { /* wrap head around then grow */
+            deque.push_back (arena,       i);
+            deque.push_front(arena, 999 - i);
+        }
+        for (uint32_t i = 0; i < 100; i++) {
+            dequeOrdered = dequeOrdered && (900 + i == deque.front(arena)) && (99 - i == deque.back(arena));
+            deque.pop_front();
+            deque.pop_back ();
+        }
+        ok(dequeOrdered && 0 == deque.size && 256 == deque.capacity, "c++: arena: deque push & pop at both ends across growth works as expected");
+        deque.clear(arena);
+
+        bool allocatorShared;
+        {
+            std::vector<uint64_t, shf::ArenaAllocator<uint64_t> > stdVector{shf::ArenaAllocator<uint64_t>(arena)};
+            for (uint64_t i = 0; i < 1000; i++) {
+                stdVector.push_back(i);
+            }
+            uint64_t dataHandle = shf_arena_handle(instance.handle(), stdVector.data());
+            allocatorShared     = dataHandle && 999 == SHF_CAST(uint64_t *, arenaAgain.addr(dataHandle))[999];
+        }
+        instanceAgain.detach();
+        ok(allocatorShared, "c++: arena: std::vector with arena allocator stores elements in shared memory // size before deletion: %s", instance.destroy());
+
+    } // end of shf::Arena tests
+
     ok(1, "c++: test still alive");
 
     return exit_status();
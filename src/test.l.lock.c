@@ -0,0 +1,179 @@
+/*
+ * ============================================================================
+ * Copyright (c) 2014 Hardy-Francis Enterprises Inc.
+ * This file is part of SharedHashFile.
+ *
+ * SharedHashFile is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or (at your
+ * option) any later version.
+ *
+ * SharedHashFile is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU Affero General Public
+ * License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program. If not, see www.gnu.org/licenses/.
+ * ----------------------------------------------------------------------------
+ * To use SharedHashFile in a closed-source product, commercial licenses are
+ * available; email office [@] sharedhashfile [.] com for more information.
+ * ============================================================================
+ */
+
+#define _GNU_SOURCE
+#include <stdint.h>
+#include <stdio.h>        /* for printf() */
+#include <unistd.h>       /* for sysconf() */
+#include <errno.h>        /* for errno */
+#include <stdlib.h>       /* for getenv() */
+#include <string.h>       /* for memset() */
+#include <locale.h>       /* for setlocale() */
+#include <pthread.h>
+#include <sys/resource.h> /* for getrusage() */
+#include <sys/wait.h>     /* for waitpid() */
+
+#include <shf.private.h>
+#include <shf.h>
+#include "tap.h"
+
+/* contended lock micro benchmark: SHF_RW_LOCK versus SHF_RW_FUTEX_LOCK with a thread per cpu, and with more threads than cpus as on
+ * oversubscribed hosts; reports ops per second & cpu seconds burned per second, and checks that writers were exclusive */
+
+#define TEST_LOCK_CONFIGS (4)
+
+static const uint32_t test_lock_threads_per_cpu[TEST_LOCK_CONFIGS] = {   1,  1,  4,  4 };
+static const uint32_t test_lock_write_percent  [TEST_LOCK_CONFIGS] = { 100, 10, 100, 10 };
+
+typedef struct TEST_LOCK {
+    SHF_RW_LOCK       rw_lock      ;
+    SHF_RW_FUTEX_LOCK rw_futex_lock;
+    uint32_t          is_futex     ;
+    uint32_t          write_percent;
+    volatile uint32_t is_stop      ;
+    volatile uint64_t written_a    ; /* writers increment both; readers expect both the same */
+    volatile uint64_t written_b    ;
+    volatile uint64_t torn         ; /* readers which saw a writer half way */
+} TEST_LOCK;
+
+typedef struct TEST_LOCK_THREAD {
+    pthread_t thread;
+    uint32_t  rnd   ;
+    uint64_t  reads ;
+    uint64_t  writes;
+} TEST_LOCK_THREAD;
+
+static TEST_LOCK test_lock;
+
+static void *
+test_lock_thread(void * arg)
+{
+    TEST_LOCK_THREAD * lock_thread = arg;
+    while (0 == test_lock.is_stop) {
+        lock_thread->rnd ^= lock_thread->rnd << 13;
+        lock_thread->rnd ^= lock_thread->rnd >> 17;
+        lock_thread->rnd ^= lock_thread->rnd <<  5;
+        if (lock_thread->rnd % 100 < test_lock.write_percent) {
+            if (test_lock.is_futex) { shf_rw_futex_lock_writer(&test_lock.rw_futex_lock); }
+            else                    { shf_rw_lock_writer      (&test_lock.rw_lock      ); }
+            test_lock.written_a ++;
+            SHF_CPU_PAUSE();
+            test_lock.written_b ++;
+            if (test_lock.is_futex) { shf_rw_futex_unlock_writer(&test_lock.rw_futex_lock); }
+            else                    { shf_rw_unlock_writer      (&test_lock.rw_lock      ); }
+            lock_thread->writes ++;
+        }
+        else {
+            if (test_lock.is_futex) { shf_rw_futex_lock_reader(&test_lock.rw_futex_lock); }
+            else                    { shf_rw_lock_reader      (&test_lock.rw_lock      ); }
+            if (test_lock.written_a != test_lock.written_b) { __sync_fetch_and_add(&test_lock.torn, 1); }
+            if (test_lock.is_futex) { shf_rw_futex_unlock_reader(&test_lock.rw_futex_lock); }
+            else                    { shf_rw_unlock_reader      (&test_lock.rw_lock      ); }
+            lock_thread->reads ++;
+        }
+    }
+    return NULL;
+} /* test_lock_thread() */
+
+static double
+test_lock_cpu_seconds(void)
+{
+    struct rusage usage;
+    SHF_ASSERT(0 == getrusage(RUSAGE_SELF, &usage), "getrusage(): %u: ", errno);
+    return usage.ru_utime.tv_sec + usage.ru_stime.tv_sec + (usage.ru_utime.tv_usec + usage.ru_stime.tv_usec) / 1000000.0;
+} /* test_lock_cpu_seconds() */
+
+int main(void)
+{
+    plan_tests(2 * TEST_LOCK_CONFIGS + 4);
+
+    SHF_ASSERT(NULL != setlocale(LC_NUMERIC, ""), "setlocale(): %u: ", errno); /* to enable ```%'.0f``` in sprintf() instead of boring ```%.0f``` */
+
+    long     cpu_count = sysconf(_SC_NPROCESSORS_ONLN); SHF_ASSERT(cpu_count >= 1, "%ld=sysconf(_SC_NPROCESSORS_ONLN): %u:  ", cpu_count, errno);
+    uint32_t seconds   = getenv("SHF_PERFORMANCE_TEST_ENABLE") && atoi(getenv("SHF_PERFORMANCE_TEST_ENABLE")) ? 2 : 0; /* 0 means only 1/4 second */
+    if (0 == seconds) {
+        fprintf(stderr, "NOTE: prefix make with SHF_PERFORMANCE_TEST_ENABLE=1 for a longer lock benchmark?\n");
+    }
+
+    for (uint32_t is_futex = 0; is_futex <= 1; is_futex++) {
+        for (uint32_t config = 0; config < TEST_LOCK_CONFIGS; config++) {
+            memset(SHF_CAST(void *, &test_lock), 0, sizeof(test_lock));
+            test_lock.is_futex      = is_futex;
+            test_lock.write_percent = test_lock_write_percent[config];
+            test_lock.rw_futex_lock.ticket_next          = UINT32_MAX - 100; /* tickets wrap during test */
+            test_lock.rw_futex_lock.ticket_active_writer = UINT32_MAX - 100;
+            test_lock.rw_futex_lock.ticket_active_reader = UINT32_MAX - 100;
+
+            uint32_t           threads      = cpu_count * test_lock_threads_per_cpu[config];
+            TEST_LOCK_THREAD * lock_threads = calloc(threads, sizeof(TEST_LOCK_THREAD)); SHF_ASSERT(NULL != lock_threads, "calloc(): %u: ", errno);
+            double             cpu_start    = test_lock_cpu_seconds();
+            double             time_start   = shf_get_time_in_seconds();
+            for (uint32_t i = 0; i < threads; i++) {
+                lock_threads[i].rnd = 2463534242U + i;
+                SHF_ASSERT(0 == pthread_create(&lock_threads[i].thread, NULL, test_lock_thread, &lock_threads[i]), "pthread_create(): %u: ", errno);
+            }
+            if (seconds) { sleep (seconds); }
+            else         { usleep(250000 ); }
+            test_lock.is_stop = 1;
+            uint64_t reads  = 0;
+            uint64_t writes = 0;
+            for (uint32_t i = 0; i < threads; i++) {
+                SHF_ASSERT(0 == pthread_join(lock_threads[i].thread, NULL), "pthread_join(): %u: ", errno);
+                reads  += lock_threads[i].reads ;
+                writes += lock_threads[i].writes;
+            }
+            double time_elapsed = shf_get_time_in_seconds() - time_start;
+            double cpu_elapsed  = test_lock_cpu_seconds()   - cpu_start ;
+            ok(writes == test_lock.written_a && writes == test_lock.written_b && 0 == test_lock.torn, "lock: %-13s: %3u threads on %2ld cpus, %3u%% writes: %'11.0f ops per second, %5.2f cpu seconds per second",
+                is_futex ? "rw futex lock" : "rw lock", threads, cpu_count, test_lock.write_percent, (reads + writes) / time_elapsed, cpu_elapsed / time_elapsed);
+            free(lock_threads);
+        }
+    }
+
+    {
+        /* dead owner recovery; the owner word holds tid & pid namespace so a waiter sees both from the same writer */
+        pid_t child = fork();
+        if (0 == child) { _exit(0); }
+        SHF_ASSERT(child == waitpid(child, NULL, 0), "waitpid(): %u: ", errno); /* child's tid now dead */
+        uint64_t    owner_live = shf_lock_owner_get();
+        uint64_t    owner_dead = SHF_LOCK_OWNER(child, SHF_LOCK_OWNER_NS(owner_live));
+        SHF_RW_LOCK lock;
+        memset(SHF_CAST(void *, &lock), 0, sizeof(lock));
+
+        lock.owner = owner_dead;
+        uint64_t owner_seen = lock.owner; /* waiter loads owner of dead writer ... */
+        lock.owner = SHF_LOCK_OWNER(SHF_LOCK_OWNER_TID(owner_live) + 1, SHF_LOCK_OWNER_NS(owner_live)); /* ... then lock handed over to next writer */
+        uint64_t owner_next = lock.owner;
+        ok(0 == shf_lock_owner_is_alive(owner_seen) && 0 == shf_lock_owner_claim(&lock.owner, owner_seen, &lock) && owner_next == lock.owner, "lock: writer which got lock after waiter saw dead writer was not claimed from");
+
+        lock.owner = SHF_LOCK_OWNER(child, SHF_LOCK_OWNER_NS(owner_live) + 1);
+        ok(0 == shf_lock_owner_claim_if_dead(&lock.owner, &lock) && SHF_LOCK_OWNER(child, SHF_LOCK_OWNER_NS(owner_live) + 1) == lock.owner, "lock: writer in another pid namespace was not presumed dead");
+
+        lock.owner = owner_dead;
+        ok(1 == shf_lock_owner_claim_if_dead(&lock.owner, &lock) && owner_live == lock.owner, "lock: writer which died was claimed from");
+    }
+
+    ok(1, "lock: test still alive");
+
+    return exit_status();
+} /* main() */
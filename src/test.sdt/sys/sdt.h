@@ -0,0 +1,47 @@
+/*
+ * ============================================================================
+ * Copyright (c) 2014 Hardy-Francis Enterprises Inc.
+ * This file is part of SharedHashFile.
+ *
+ * SharedHashFile is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or (at your
+ * option) any later version.
+ *
+ * SharedHashFile is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU Affero General Public
+ * License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program. If not, see www.gnu.org/licenses/.
+ * ----------------------------------------------------------------------------
+ * To use SharedHashFile in a closed-source product, commercial licenses are
+ * available; email office [@] sharedhashfile [.] com for more information.
+ * ============================================================================
+ */
+
+#ifndef __SHF_TEST_SDT_H__
+#define __SHF_TEST_SDT_H__
+
+/* stand-in for systemtap's sys/sdt.h so that the SHF_PROBE() path is compile tested even where sys/sdt.h is not installed; see GNUmakefile
+ * like the real STAP_PROBEV(), each arg must have a sizeof() (so no bitfields) & fit an asm "nor" operand
+ */
+
+#define SHF_TEST_SDT_ARG(ARG)        (void) sizeof(ARG); __asm__ __volatile__ ("" :: "nor" (ARG));
+#define SHF_TEST_SDT_ARGS_1(ARG     ) SHF_TEST_SDT_ARG(ARG)
+#define SHF_TEST_SDT_ARGS_2(ARG, ...) SHF_TEST_SDT_ARG(ARG) SHF_TEST_SDT_ARGS_1(__VA_ARGS__)
+#define SHF_TEST_SDT_ARGS_3(ARG, ...) SHF_TEST_SDT_ARG(ARG) SHF_TEST_SDT_ARGS_2(__VA_ARGS__)
+#define SHF_TEST_SDT_ARGS_4(ARG, ...) SHF_TEST_SDT_ARG(ARG) SHF_TEST_SDT_ARGS_3(__VA_ARGS__)
+#define SHF_TEST_SDT_ARGS_5(ARG, ...) SHF_TEST_SDT_ARG(ARG) SHF_TEST_SDT_ARGS_4(__VA_ARGS__)
+#define SHF_TEST_SDT_ARGS_6(ARG, ...) SHF_TEST_SDT_ARG(ARG) SHF_TEST_SDT_ARGS_5(__VA_ARGS__)
+#define SHF_TEST_SDT_ARGS_7(ARG, ...) SHF_TEST_SDT_ARG(ARG) SHF_TEST_SDT_ARGS_6(__VA_ARGS__)
+#define SHF_TEST_SDT_ARGS_8(ARG, ...) SHF_TEST_SDT_ARG(ARG) SHF_TEST_SDT_ARGS_7(__VA_ARGS__)
+#define SHF_TEST_SDT_COUNT_(_1, _2, _3, _4, _5, _6, _7, _8, N, ...) N
+#define SHF_TEST_SDT_COUNT(...)      SHF_TEST_SDT_COUNT_(__VA_ARGS__, 8, 7, 6, 5, 4, 3, 2, 1)
+#define SHF_TEST_SDT_CAT(A, B)       A ## B
+#define SHF_TEST_SDT_ARGS(N, ...)    SHF_TEST_SDT_CAT(SHF_TEST_SDT_ARGS_, N)(__VA_ARGS__)
+
+#define STAP_PROBEV(PROVIDER, NAME, ...) do { SHF_TEST_SDT_ARGS(SHF_TEST_SDT_COUNT(__VA_ARGS__), __VA_ARGS__) __asm__ __volatile__ ("nop # " #PROVIDER ":" #NAME); } while (0)
+
+#endif /* __SHF_TEST_SDT_H__ */